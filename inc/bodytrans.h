@@ -7,6 +7,8 @@
  *	12-apr-95	no more ARGS  - defer math stuff to stdinc.h
  *      31-dec-02       gcc3/SINGLEPREC
  *      24-sep-04       added macro defining r as specified in man page  WD
+ *      16-oct-26       batch versions btrtrans_n, btitrans_n, btreval, btieval,
+ *                      and BODYTRANS() to define both versions
  */
 
 #ifndef _bodytrans_h
@@ -26,6 +28,18 @@ typedef int  (*iproc_body)(Body *, real, int);
 extern rproc_body btrtrans(string expr);
 extern iproc_body btitrans(string expr);
 
+/*
+ * Batch versions, out[k] = fn(btab+k, t, i0+k) for k=0..n-1
+ */
+
+typedef void (*rproc_body_n)(Body *, int, real, int, real *);
+typedef void (*iproc_body_n)(Body *, int, real, int, int *);
+
+extern rproc_body_n btrtrans_n(rproc_body fn);      /* NULL if none */
+extern iproc_body_n btitrans_n(iproc_body fn);
+extern void btreval(rproc_body fn, Body *btab, int n, real t, int i0, real *out);
+extern void btieval(iproc_body fn, Body *btab, int n, real t, int i0, int *out);
+
 #ifndef _bodytransc_h
 /*
  * Macros for standard components of a body b.-- only needed in true bodytrans
@@ -69,5 +83,29 @@ extern iproc_body btitrans(string expr);
 
 #define eps   Eps(b)
 
+/*
+ * BODYTRANS(type,name,expr) defines a function name(b,t,i) returning expr,
+ * and its batch version name_n(btab,n,t,i0,out), a loop the compiler
+ * can optimize as a whole
+ */
+
+#define BODYTRANS(type,name,...)                                        \
+type name(Body *b, real t, int i)                                       \
+{                                                                       \
+    return (__VA_ARGS__);                                               \
+}                                                                       \
+void name##_n(Body *_btab, int _n, real t, int _i0, type *_out)         \
+{                                                                       \
+    Body *b;                                                            \
+    int _k, i;                                                          \
+                                                                        \
+    for (_k=0; _k<_n; _k++) {                                           \
+        b = _btab+_k;                                                   \
+        i = _i0+_k;                                                     \
+        _out[_k] = (__VA_ARGS__);                                       \
+        (void) b; (void) i;                                             \
+    }                                                                   \
+}
+
 #endif /* _bodytransc_h */
 #endif /* _bodytrans_h  */
@@ -5,6 +5,10 @@
  *     12-apr-95  prototypes without ARGS       PJT
  *      2-jun-05  blocked I/O as a flavor of random I/O     PJT
  *     11-dec-09  half precision type                       PJT
+ *     16-oct-26  get_data_ptr for mapped input
+ *     16-oct-26  index of top level items for random access
+ *     16-oct-26  get_data_ran: size_t offsets, and coerced
+ *     16-oct-26  put_zip: compressed output
  */
 #ifndef _filestruct_h
 #define _filestruct_h
@@ -64,6 +68,7 @@ extern void put_tes (stream, string);
 extern void put_string ( stream, string , string );
 extern void put_data ( stream, string, string, void *, int, ...);
 extern void put_data_sub ( stream, string, string, void *, int *, bool);
+extern void put_zip ( stream, int );
 
 extern void get_set ( stream str, string tag );
 extern void get_tes ( stream str, string tag );
@@ -73,6 +78,7 @@ extern void get_data ( stream, string, string, void *, int, ...);
 extern void get_data_coerced ( stream, string, string, void *, int, ...);
 			 
 extern void get_data_sub ( stream, string, string, void *, int *, bool);
+extern const void *get_data_ptr ( stream, string, string, int, ...);
 		     
 extern bool get_tag_ok ( stream, string);
 extern bool skip_item ( stream);
@@ -85,7 +91,7 @@ extern void strclose ( stream);
 
 extern void get_data_set     ( stream , string , string , int,  ...);
 extern void get_data_tes     ( stream , string  );
-extern void get_data_ran     ( stream , string , void *, int , int );
+extern void get_data_ran     ( stream , string , void *, size_t , size_t );
 extern void get_data_blocked ( stream , string , void *, int);
 
 extern void put_data_set     ( stream , string , string , int,  ...);
@@ -94,4 +100,9 @@ extern void put_data_ran     ( stream , string , void *, int , int  );
 extern void put_data_blocked ( stream , string , void *, int );
 
 extern bool qsf ( stream );
+
+extern int  get_index       ( stream, bool );
+extern int  get_index_count ( stream, string );
+extern bool get_index_seek  ( stream, string, int );
+extern bool get_index_time  ( stream, string, double );
 #endif
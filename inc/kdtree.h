@@ -0,0 +1,30 @@
+/*
+ * kdtree.h:  k-d tree for (K-)nearest neighbour searches in any dimension
+ *
+ *	16-oct-2026	created
+ */
+
+#ifndef _kdtree_h
+#define _kdtree_h
+
+typedef struct kdnode {
+    int lo, hi;             /* points lo..hi-1 (in tree order) of this node */
+    int left, right;        /* child nodes, -1 for a leaf */
+} kdnode;
+
+typedef struct kdtree {
+    int    ndim;            /* dimension of the points */
+    int    npts;            /* number of points */
+    int    nleaf;           /* max number of points in a leaf */
+    int    nnode;           /* number of nodes, the root is node[0] */
+    kdnode *node;           /* nodes[nnode] */
+    real   *box;            /* bounding boxes, min[ndim] and max[ndim] per node */
+    real   *pos;            /* copy of the points, in tree order [npts*ndim] */
+    int    *idx;            /* original index of the points, in tree order */
+} kdtree, *kdtreeptr;
+
+kdtree *kd_build(real *pos, int npts, int ndim, int nleaf);  /* pos[npts*ndim] */
+int     kd_knn(kdtree *kd, real *x, int k, int skip, int *idx, real *d2);
+void    kd_free(kdtree *kd);
+
+#endif
@@ -150,6 +150,10 @@ float rcbrt(float);
 int init_xrandom(string);
 int set_xrandom(int);
 double xrandom(double, double);
+void xrandom_n(double *, int, double, double);
+double xrandom_i(long, int *, double, double);
+double grandom_i(long, int *, double, double);
+bool xrandom_philox(void);
 double grandom(double, double);
 double erandom(double);
 double frandom(double, double, real_proc);
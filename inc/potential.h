@@ -4,6 +4,8 @@
  *
  *	jul 1987:	original implementation
  *	sep 2001:	added C++ support, including const'ing 
+ *	oct 2026:	added potential_n(): batch of n positions
+ *			added set_potential_cache()
  */
 
 #ifndef _potential_h
@@ -25,6 +27,15 @@ typedef potproc_float potproc_real;
 typedef potproc_double potproc_real;
 #endif
 
+/* batch version: (ndim, n, pos[n][ndim], acc[n][ndim], pot[n], time) */
+typedef void (*potproc_n_double)(const int *, const int *, const double *, double *, double *, const double *);
+typedef void (*potproc_n_float) (const int *, const int *, const float *,  float *,  float *,  const float *);
+#ifdef SINGLEPREC
+typedef potproc_n_float potproc_n_real;
+#else
+typedef potproc_n_double potproc_n_real;
+#endif
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -33,9 +44,13 @@ extern "C" {
 potproc_real   get_potential        (const string, const string, const string);
 potproc_float  get_potential_float  (const string, const string, const string);
 potproc_double get_potential_double (const string, const string, const string);
+potproc_n_real   get_potential_n        (void);
+potproc_n_float  get_potential_n_float  (void);
+potproc_n_double get_potential_n_double (void);
 proc           get_inipotential     (void);
 real           get_pattern          (void);
 void           set_pattern          (real);
+void           set_potential_cache  (string);
 
 #if defined(__cplusplus)
 }
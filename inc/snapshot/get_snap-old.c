@@ -14,6 +14,11 @@
  *       2-apr-02 add UdotIntTag for ZENO	pjt
  *      30-may-07 allocate() needs size_t args for > 44.7M      pjt
  *    14-feb-2017 added get_snap_nbody()                        pjt
+ *    16-oct-2026 read straight from mapped files via get_data_ptr()
+ *    16-oct-2026 added get_snap_seek() and get_snap_seek_time()
+ *    16-oct-2026 added get_snap_chunk()
+ *    16-oct-2026 file sets: get_snap_set(), one thread per member
+ *    16-oct-2026 get_snap_set(): all members have particles, or none
  */
 
 /*
@@ -145,13 +150,18 @@ int *nbptr;			/* pointer to number of bodies */
 int *ifptr;			/* pointer to input bit flags */
 {
 #ifdef Mass
-    real *mbuf, *mp;
+    real *mbuf = NULL;
+    const real *mp;
     Body *bp;
 
     if (get_tag_ok(instr, MassTag)) {
-        mbuf = (real *) allocate((size_t)(*nbptr) * sizeof(real));
-	get_data_coerced(instr, MassTag, RealType, mbuf, *nbptr, 0);
-	for (bp = *btptr, mp = mbuf; bp < *btptr + *nbptr; bp++)
+        mp = (const real *) get_data_ptr(instr, MassTag, RealType, *nbptr, 0);
+	if (mp == NULL) {
+	    mbuf = (real *) allocate((size_t)(*nbptr) * sizeof(real));
+	    get_data_coerced(instr, MassTag, RealType, mbuf, *nbptr, 0);
+	    mp = mbuf;
+	}
+	for (bp = *btptr; bp < *btptr + *nbptr; bp++)
 	    Mass(bp) = *mp++;
 	free(mbuf);
 	*ifptr |= MassBit;
@@ -177,14 +187,20 @@ int *nbptr;			/* pointer to number of bodies */
 int *ifptr;			/* pointer to input bit flags */
 {
 #ifdef Phase
-    real *rvbuf, *rvp;
+    real *rvbuf = NULL;
+    const real *rvp;
     Body *bp;
 
     if (get_tag_ok(instr, PhaseSpaceTag)) {
-        rvbuf = (real *) allocate((size_t)(*nbptr) * 2 * NDIM * sizeof(real));
-	get_data_coerced(instr, PhaseSpaceTag, RealType, rvbuf,
-			 *nbptr, 2, NDIM, 0);
-	for (bp = *btptr, rvp = rvbuf; bp < *btptr + *nbptr; bp++) {
+        rvp = (const real *) get_data_ptr(instr, PhaseSpaceTag, RealType,
+					  *nbptr, 2, NDIM, 0);
+	if (rvp == NULL) {
+	    rvbuf = (real *) allocate((size_t)(*nbptr) * 2 * NDIM * sizeof(real));
+	    get_data_coerced(instr, PhaseSpaceTag, RealType, rvbuf,
+			     *nbptr, 2, NDIM, 0);
+	    rvp = rvbuf;
+	}
+	for (bp = *btptr; bp < *btptr + *nbptr; bp++) {
 	    SETV(Phase(bp)[0], rvp);
 	    rvp += NDIM;
 	    SETV(Phase(bp)[1], rvp);
@@ -233,13 +249,18 @@ int *nbptr;			/* pointer to number of bodies */
 int *ifptr;			/* pointer to input bit flags */
 {
 #ifdef Phi
-    real *pbuf, *pp;
+    real *pbuf = NULL;
+    const real *pp;
     Body *bp;
 
     if (get_tag_ok(instr, PotentialTag)) {
-        pbuf = (real *) allocate((size_t)(*nbptr) * sizeof(real));
-	get_data_coerced(instr, PotentialTag, RealType, pbuf, *nbptr, 0);
-	for (bp = *btptr, pp = pbuf; bp < *btptr + *nbptr; bp++)
+        pp = (const real *) get_data_ptr(instr, PotentialTag, RealType, *nbptr, 0);
+	if (pp == NULL) {
+	    pbuf = (real *) allocate((size_t)(*nbptr) * sizeof(real));
+	    get_data_coerced(instr, PotentialTag, RealType, pbuf, *nbptr, 0);
+	    pp = pbuf;
+	}
+	for (bp = *btptr; bp < *btptr + *nbptr; bp++)
 	    Phi(bp) = *pp++;
 	free(pbuf);
 	*ifptr |= PotentialBit;
@@ -265,14 +286,20 @@ int *nbptr;			/* pointer to number of bodies */
 int *ifptr;			/* pointer to input bit flags */
 {
 #ifdef Acc
-    real *abuf, *ap;
+    real *abuf = NULL;
+    const real *ap;
     Body *bp;
 
     if (get_tag_ok(instr, AccelerationTag)) {
-        abuf = (real *) allocate((size_t)(*nbptr) * NDIM * sizeof(real));
-	get_data_coerced(instr, AccelerationTag, RealType, abuf,
-			 *nbptr, NDIM, 0);
-	for (bp = *btptr, ap = abuf; bp < *btptr + *nbptr; bp++) {
+        ap = (const real *) get_data_ptr(instr, AccelerationTag, RealType,
+					 *nbptr, NDIM, 0);
+	if (ap == NULL) {
+	    abuf = (real *) allocate((size_t)(*nbptr) * NDIM * sizeof(real));
+	    get_data_coerced(instr, AccelerationTag, RealType, abuf,
+			     *nbptr, NDIM, 0);
+	    ap = abuf;
+	}
+	for (bp = *btptr; bp < *btptr + *nbptr; bp++) {
 	    SETV(Acc(bp), ap);
 	    ap += NDIM;
 	}
@@ -300,13 +327,18 @@ int *nbptr;			/* pointer to number of bodies */
 int *ifptr;			/* pointer to input bit flags */
 {
 #ifdef Aux
-    real *abuf, *ap;
+    real *abuf = NULL;
+    const real *ap;
     Body *bp;
 
     if (get_tag_ok(instr, AuxTag)) {
-        abuf = (real *) allocate((size_t)(*nbptr) * sizeof(real));
-	get_data_coerced(instr, AuxTag, RealType, abuf, *nbptr, 0);
-	for (bp = *btptr, ap = abuf; bp < *btptr + *nbptr; bp++)
+        ap = (const real *) get_data_ptr(instr, AuxTag, RealType, *nbptr, 0);
+	if (ap == NULL) {
+	    abuf = (real *) allocate((size_t)(*nbptr) * sizeof(real));
+	    get_data_coerced(instr, AuxTag, RealType, abuf, *nbptr, 0);
+	    ap = abuf;
+	}
+	for (bp = *btptr; bp < *btptr + *nbptr; bp++)
 	    Aux(bp) = *ap++;
 	free(abuf);
 	*ifptr |= AuxBit;
@@ -364,13 +396,18 @@ int *nbptr;			/* pointer to number of bodies */
 int *ifptr;			/* pointer to input bit flags */
 {
 #ifdef Dens
-    real *abuf, *ap;
+    real *abuf = NULL;
+    const real *ap;
     Body *bp;
 
     if (get_tag_ok(instr, DensityTag)) {
-        abuf = (real *) allocate((size_t)(*nbptr) * sizeof(real));
-	get_data_coerced(instr, DensityTag, RealType, abuf, *nbptr, 0);
-	for (bp = *btptr, ap = abuf; bp < *btptr + *nbptr; bp++)
+        ap = (const real *) get_data_ptr(instr, DensityTag, RealType, *nbptr, 0);
+	if (ap == NULL) {
+	    abuf = (real *) allocate((size_t)(*nbptr) * sizeof(real));
+	    get_data_coerced(instr, DensityTag, RealType, abuf, *nbptr, 0);
+	    ap = abuf;
+	}
+	for (bp = *btptr; bp < *btptr + *nbptr; bp++)
 	    Dens(bp) = *ap++;
 	free(abuf);
 	*ifptr |= DensBit;
@@ -429,13 +466,18 @@ int *nbptr;			/* pointer to number of bodies */
 int *ifptr;			/* pointer to input bit flags */
 {
 #ifdef Eps
-    real *abuf, *ap;
+    real *abuf = NULL;
+    const real *ap;
     Body *bp;
 
     if (get_tag_ok(instr, EpsTag)) {
-        abuf = (real *) allocate((size_t)(*nbptr) * sizeof(real));
-	get_data_coerced(instr, EpsTag, RealType, abuf, *nbptr, 0);
-	for (bp = *btptr, ap = abuf; bp < *btptr + *nbptr; bp++)
+        ap = (const real *) get_data_ptr(instr, EpsTag, RealType, *nbptr, 0);
+	if (ap == NULL) {
+	    abuf = (real *) allocate((size_t)(*nbptr) * sizeof(real));
+	    get_data_coerced(instr, EpsTag, RealType, abuf, *nbptr, 0);
+	    ap = abuf;
+	}
+	for (bp = *btptr; bp < *btptr + *nbptr; bp++)
 	    Eps(bp) = *ap++;
 	free(abuf);
 	*ifptr |= EpsBit;
@@ -498,6 +540,125 @@ int *ifptr;			/* pointer to input bit flags */
 
 #endif
 
+/*
+ * GET_SNAP_SET: read the next snapshot of each member of a file set (see
+ * stropen(3NEMO)) as one snapshot, the bodies of the members following
+ * each other in the body array.  The headers are read first, and then
+ * the particles of all members at the same time, one thread per member.
+ * If times is not NULL, the particles are only read if the time of the
+ * first member matches, as in get_snap_by_t.
+ */
+
+#ifndef get_snap_set
+
+#define get_snap_set  _get_snap_set
+
+#include <pthread.h>
+
+#ifndef TimeFuzz
+#define TimeFuzz  0.001			/* slop allowed in time comparison  */
+#endif
+
+typedef struct {
+    stream str;			/* member of the set */
+    Body *btab;			/* where its bodies go */
+    int nbody;			/* number of its bodies */
+    real tsnap;			/* its time */
+    int bits;			/* its bit flags */
+} _snapset_member;
+
+local void *
+_get_snap_set_member(arg)
+void *arg;
+{
+    _snapset_member *mp = (_snapset_member *) arg;
+
+    get_snap_particles(mp->str, &mp->btab, &mp->nbody, &mp->bits);
+    get_snap_diagnostics(mp->str, &mp->bits);
+    get_tes(mp->str, SnapShotTag);
+    return NULL;
+}
+
+local int
+_get_snap_set(set, nset, btptr, nbptr, tsptr, ifptr, times)
+stream *set;			/* members of the file set */
+int nset;			/* number of members */
+Body **btptr;			/* pointer to body array */
+int *nbptr;			/* pointer to number of bodies */
+real *tsptr;			/* pointer to time of input */
+int *ifptr;			/* pointer to input bit flags */
+string times;			/* time selection, or NULL */
+{
+    _snapset_member *mem;
+    pthread_t *tid;
+    bool *started;
+    int k, ntot, npart;
+
+    *ifptr = 0;
+    if (! get_tag_ok(set[0], SnapShotTag))
+	return 0;
+    mem = (_snapset_member *) allocate(nset * sizeof(_snapset_member));
+    tid = (pthread_t *) allocate(nset * sizeof(pthread_t));
+    started = (bool *) allocate(nset * sizeof(bool));
+    for (k = 0, ntot = 0; k < nset; k++) {	/* headers, one by one */
+	mem[k].str = set[k];
+	if (k > 0)				/* skip others' history */
+	    while (! get_tag_ok(set[k], SnapShotTag))
+		if (! skip_item(set[k]))
+		    error("get_snap_set: no snapshot left in member %d", k);
+	get_set(set[k], SnapShotTag);
+	mem[k].btab = NULL;
+	mem[k].nbody = 0;
+	mem[k].bits = 0;
+	get_snap_parameters(set[k], &mem[k].btab, &mem[k].nbody,
+			    &mem[k].tsnap, &mem[k].bits);
+	ntot += mem[k].nbody;
+    }
+    if (*btptr != NULL && ntot > *nbptr)
+	error("get_snap_set: %s = %d is too big now %d\n",
+	      NobjTag, ntot, *nbptr);
+    *nbptr = ntot;
+    *tsptr = mem[0].tsnap;
+    *ifptr = mem[0].bits;
+    if (times == NULL || streq(times, "all") ||
+	  (*ifptr & TimeBit && within(*tsptr, times, TimeFuzz))) {
+	for (k = 0, npart = 0; k < nset; k++)	/* all members, or none */
+	    if (get_tag_ok(set[k], ParticlesTag))
+		npart++;
+	if (npart > 0 && npart < nset)
+	    error("get_snap_set: only %d of %d members have %s",
+		  npart, nset, ParticlesTag);
+	if (*btptr == NULL && npart > 0)
+	    *btptr = (Body *) allocate((size_t) ntot * sizeof(Body));
+	for (k = 0, ntot = 0; k < nset; k++) {	/* particles, all at once */
+	    mem[k].btab = *btptr == NULL ? NULL : *btptr + ntot;
+	    ntot += mem[k].nbody;
+	    started[k] = k > 0 && pthread_create(&tid[k], NULL,
+				     _get_snap_set_member, &mem[k]) == 0;
+	}
+	for (k = 0; k < nset; k++)
+	    if (! started[k])
+		_get_snap_set_member(&mem[k]);
+	*ifptr = mem[0].bits;
+	for (k = 1; k < nset; k++) {
+	    if (started[k])
+		pthread_join(tid[k], NULL);
+	    if ((mem[k].bits | TimeBit) != (mem[0].bits | TimeBit))
+		warning("get_snap_set: member %d has bits 0x%x, not 0x%x",
+			k, mem[k].bits, mem[0].bits);
+	    *ifptr &= mem[k].bits | TimeBit;
+	}
+    } else
+	for (k = 0; k < nset; k++)
+	    get_tes(set[k], SnapShotTag);
+    free(started);
+    free(tid);
+    free(mem);
+    return 1;
+}
+
+#endif
+
 /*
  * GET_SNAP: control routine for snapshot input.
  */
@@ -514,6 +675,11 @@ int *nbptr;			/* pointer to number of bodies */
 real *tsptr;			/* pointer to time of input */
 int *ifptr;			/* pointer to input bit flags */
 {
+    stream *set;
+    int nset;
+
+    if ((set = strfileset(instr, &nset)) != NULL)	/* a file set? */
+	return get_snap_set(set, nset, btptr, nbptr, tsptr, ifptr, NULL);
     *ifptr = 0;
     if (get_tag_ok(instr, SnapShotTag)) {
 	get_set(instr, SnapShotTag);
@@ -549,6 +715,11 @@ real *tsptr;			/* pointer to time of input */
 int *ifptr;			/* pointer to input bit flags */
 string times;
 {
+    stream *set;
+    int nset;
+
+    if ((set = strfileset(instr, &nset)) != NULL)	/* a file set? */
+	return get_snap_set(set, nset, btptr, nbptr, tsptr, ifptr, times);
     *ifptr = 0;
     if (get_tag_ok(instr, SnapShotTag)) {
 	get_set(instr, SnapShotTag);
@@ -593,3 +764,159 @@ stream instr;
 }
 
 #endif
+
+/*
+ * GET_SNAP_SEEK: position the input in front of the n-th (0=first,
+ * -1=last) snapshot, using the item index of the file (see get_index in
+ * filestruct(3NEMO)).  Returns FALSE, leaving the input as is, if there is
+ * no such snapshot, or if the input cannot be indexed, e.g. a pipe.
+ */
+
+#ifndef get_snap_seek
+
+#define get_snap_seek  _get_snap_seek
+
+local bool
+_get_snap_seek(instr, n)
+stream instr;
+int n;
+{
+  return get_index_seek(instr, SnapShotTag, n);
+}
+
+#endif
+
+/*
+ * GET_SNAP_SEEK_TIME: position the input in front of the first snapshot
+ * with a time at or after tsnap, as for get_snap_seek().
+ */
+
+#ifndef get_snap_seek_time
+
+#define get_snap_seek_time  _get_snap_seek_time
+
+local bool
+_get_snap_seek_time(instr, tsnap)
+stream instr;
+real tsnap;
+{
+  return get_index_time(instr, SnapShotTag, tsnap);
+}
+
+#endif
+
+/*
+ * GET_SNAP_CHUNK: read the next chunk of at most chunk bodies of a
+ * snapshot, see get_snapdata_chunk() in snapdata(3NEMO).  The body array
+ * is (re)allocated to hold a chunk, *ioff is the index of its first
+ * body and *ntptr the number of bodies in the snapshot.  Returns FALSE, with the arguments left as they
+ * were, after the last chunk, or if there is no snapshot (with particles)
+ * next; call with chunk=0 to skip the rest of a snapshot.
+ */
+
+#ifndef get_snap_chunk
+
+#define get_snap_chunk  _get_snap_chunk
+
+local bool
+_get_snap_chunk(instr, btptr, nbptr, tsptr, ifptr, chunk, ioff, ntptr)
+stream instr;			/* input stream, of course */
+Body **btptr;			/* pointer to body array */
+int *nbptr;			/* pointer to number of bodies in chunk */
+real *tsptr;			/* pointer to time of input */
+int *ifptr;			/* pointer to input bit flags */
+int chunk;			/* max number of bodies per chunk */
+int *ioff;			/* pointer to index of first body */
+int *ntptr;			/* pointer to number of bodies in snapshot */
+{
+    permanent snapdata sd;
+    permanent int nalloc = 0;
+    int want = 0, i, k;
+    Body *bp;
+
+    if (strfileset(instr, &k) != NULL)
+	error("get_snap_chunk: cannot read a file set in chunks");
+    if (chunk <= 0) {
+	end_snapdata_chunk(instr, &sd);
+	return FALSE;
+    }
+#ifdef Mass
+    want |= MassBit;
+#endif
+#ifdef Phase
+    want |= PhaseSpaceBit;
+#endif
+#ifdef Phi
+    want |= PotentialBit;
+#endif
+#ifdef Acc
+    want |= AccelerationBit;
+#endif
+#ifdef Aux
+    want |= AuxBit;
+#endif
+#ifdef Key
+    want |= KeyBit;
+#endif
+#ifdef Dens
+    want |= DensBit;
+#endif
+#ifdef Eps
+    want |= EpsBit;
+#endif
+    if (! get_snapdata_chunk(instr, &sd, want, chunk))
+	return FALSE;
+    if (*btptr == NULL || nalloc < sd.nbody) {
+	if (*btptr != NULL)
+	    free(*btptr);
+	nalloc = MAX(chunk, sd.nbody);
+	*btptr = (Body *) allocate(nalloc * sizeof(Body));
+    }
+    for (i = 0, bp = *btptr; i < sd.nbody; i++, bp++) {
+#ifdef Mass
+	if (sd.bits & MassBit)
+	    Mass(bp) = sd.mass[i];
+#endif
+#ifdef Phase
+	for (k = 0; k < NDIM; k++) {
+	    if (sd.bits & PosBit)
+		Phase(bp)[0][k] = sd.pos[k][i];
+	    if (sd.bits & VelBit)
+		Phase(bp)[1][k] = sd.vel[k][i];
+	}
+#endif
+#ifdef Phi
+	if (sd.bits & PotentialBit)
+	    Phi(bp) = sd.phi[i];
+#endif
+#ifdef Acc
+	if (sd.bits & AccelerationBit)
+	    for (k = 0; k < NDIM; k++)
+		Acc(bp)[k] = sd.acc[k][i];
+#endif
+#ifdef Aux
+	if (sd.bits & AuxBit)
+	    Aux(bp) = sd.aux[i];
+#endif
+#ifdef Key
+	if (sd.bits & KeyBit)
+	    Key(bp) = sd.key[i];
+#endif
+#ifdef Dens
+	if (sd.bits & DensBit)
+	    Dens(bp) = sd.dens[i];
+#endif
+#ifdef Eps
+	if (sd.bits & EpsBit)
+	    Eps(bp) = sd.eps[i];
+#endif
+    }
+    *nbptr = sd.nbody;
+    *ioff = sd.first;
+    *ntptr = sd.ntot;
+    *tsptr = sd.time;
+    *ifptr = sd.bits;
+    return TRUE;
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include <history.h>
+#include <snapshot/snapdata.h>
 #ifdef NEWIO
 #include <snapshot/get_snap-ran.c>
 #else
@@ -0,0 +1,47 @@
+/*
+ * SNAPDATA.H: a snapshot as a structure of arrays, one contiguous
+ *	       array per (component of a) particle field, see snapdata(3NEMO).
+ *	       Only the fields asked for are read and allocated.
+ *
+ *	16-oct-26	created
+ *	16-oct-26	chunked input, get_snapdata_chunk()
+ */
+
+#ifndef _snapdata_h
+#define _snapdata_h
+
+typedef struct {
+    int    nbody;		/* number of bodies in the arrays */
+    int    nmax;		/* allocated length of the arrays */
+    real   time;		/* time of snapshot, if TimeBit set */
+    int    bits;		/* fields present, as in get_snap() */
+    real  *mass;		/* MassBit */
+    real  *pos[NDIM];		/* PosBit (or PhaseSpaceBit) */
+    real  *vel[NDIM];		/* VelBit (or PhaseSpaceBit) */
+    real  *acc[NDIM];		/* AccelerationBit */
+    real  *phi;			/* PotentialBit */
+    real  *aux;			/* AuxBit */
+    real  *dens;		/* DensBit */
+    real  *eps;			/* EpsBit */
+    int   *key;			/* KeyBit */
+    int    ntot;		/* bodies in the whole snapshot */
+    int    first;		/* index of the first body in the arrays */
+    stream str;			/* private: input inside a chunked snapshot */
+    real  *buf;			/* private: scratch for interleaved fields */
+    size_t nbuf;		/* private: allocated length of buf */
+} snapdata, *snapdataptr;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+extern bool get_snapdata(stream, snapdataptr, int);
+extern bool get_snapdata_chunk(stream, snapdataptr, int, int);
+extern void end_snapdata_chunk(stream, snapdataptr);
+extern void free_snapdata(snapdataptr);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -48,6 +48,8 @@
  *    jul-20    add cputime2()                                      PJT
  *    oct-21    deal with error() in the GNU C library              PJT
  *              programs linking with e.g. gnuastro will otherwise barf
+ * 16-oct-26    bulk float/double/halfp conversion kernels (io/convert.c)
+ * 16-oct-26    strfileset()
  */
 
 #ifndef _stdinc_h      /* protect against re-entry */
@@ -435,6 +437,7 @@ extern stream stropen(const_string, string);
 extern int    strdelete(stream, bool);
 extern string strname(stream);
 extern bool   strseek(stream);
+extern stream *strfileset(stream, int *);
 
 /* io/mstropen.c */
 extern mstr  *mstr_init(string tmplate);
@@ -450,6 +453,14 @@ extern bool LittleEndian(void);
 /* io/filesecret.c */
 extern void   strclose(stream);
 
+/* io/convert.c : bulk conversions, from and to may not overlap */
+extern void convert_f2d_n(size_t n, const float  *from, double *to);
+extern void convert_d2f_n(size_t n, const double *from, float  *to);
+extern void convert_h2f_n(size_t n, const halfp  *from, float  *to);
+extern void convert_f2h_n(size_t n, const float  *from, halfp  *to);
+extern void convert_h2d_n(size_t n, const halfp  *from, double *to);
+extern void convert_d2h_n(size_t n, const double *from, halfp  *to);
+
 /*
  * tell nemo that this process is part of an MPI run: give its rank (dprintf.c)
  */
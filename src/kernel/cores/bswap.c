@@ -30,16 +30,73 @@
  *      30-sep-03  testing memcpy, and improved the testing
  *      20-sep-05  little and big endian versions
  *      14-may-12  optionally use the ffswapX routines from cfitsio
+ *      16-oct-26  gcc/clang: byteswap builtins, which vectorize; OpenMP
  */
 
 //#define HAVE_CFITSIO
 //#define HAVE_FFSWAP
 
 #include <stdinc.h>
+#include <stdint.h>
 #if defined(HAVE_CFITSIO)
 #include "fitsio2.h"
 #endif
 
+#if defined(__GNUC__) && !defined(HAVE_FFSWAP)
+#define HAVE_BUILTIN_BSWAP
+#define BSWAP_OMP  (1<<20)	/* this many items are swapped in parallel */
+
+/*
+ * the memcpy's are there for alignment, and compile away; the loops
+ * get vectorized into byte shuffles.
+ */
+
+local void bswap2(char *dat, ptrdiff_t cnt)
+{
+    ptrdiff_t i;
+    uint16_t x;
+
+#if defined(_OPENMP)
+#pragma omp parallel for private(x) if (cnt >= BSWAP_OMP)
+#endif
+    for (i = 0; i < cnt; i++) {
+        memcpy(&x, dat + 2*i, 2);
+        x = __builtin_bswap16(x);
+        memcpy(dat + 2*i, &x, 2);
+    }
+}
+
+local void bswap4(char *dat, ptrdiff_t cnt)
+{
+    ptrdiff_t i;
+    uint32_t x;
+
+#if defined(_OPENMP)
+#pragma omp parallel for private(x) if (cnt >= BSWAP_OMP)
+#endif
+    for (i = 0; i < cnt; i++) {
+        memcpy(&x, dat + 4*i, 4);
+        x = __builtin_bswap32(x);
+        memcpy(dat + 4*i, &x, 4);
+    }
+}
+
+local void bswap8(char *dat, ptrdiff_t cnt)
+{
+    ptrdiff_t i;
+    uint64_t x;
+
+#if defined(_OPENMP)
+#pragma omp parallel for private(x) if (cnt >= BSWAP_OMP)
+#endif
+    for (i = 0; i < cnt; i++) {
+        memcpy(&x, dat + 8*i, 8);
+        x = __builtin_bswap64(x);
+        memcpy(dat + 8*i, &x, 8);
+    }
+}
+#endif
+
 void bswap(void *vdat, int len, int cnt)
 {
     char tmp, *dat = (char *) vdat;
@@ -60,6 +117,24 @@ void bswap(void *vdat, int len, int cnt)
             dat[len-1-k] = tmp;
         }
     }
+#elif defined(HAVE_BUILTIN_BSWAP)
+    if (len==1)
+	return;
+    else if (len==2)
+        bswap2(dat,cnt);
+    else if (len==4)
+        bswap4(dat,cnt);
+    else if (len==8)
+        bswap8(dat,cnt);
+    else  /* the general SLOOOOOOOOOWE case */
+        while (cnt--) {
+            for(k=0; k<len/2; k++) {
+                tmp = dat[k];
+                dat[k] = dat[len-1-k];
+                dat[len-1-k] = tmp;
+            }
+            dat += len;
+        }
 #else
     if (len==1)
 	return;
@@ -6,16 +6,38 @@
  *  work done IN SITU; either starting from the bottom upwards, or
  *  top downwards.
  *
+ *  bulk conversion kernels, for arrays that do not overlap:
+ *      convert_f2d_n, convert_d2f_n, convert_h2f_n, convert_f2h_n,
+ *      convert_h2d_n, convert_d2h_n
+ *
+ *  on x86 these use the AVX (and for halfp the F16C) instructions if
+ *  the CPU has them, and with OpenMP long arrays are split over the
+ *  threads.
+ *
  *
  *     25-may-91  written for some new code?     PJT
- *     25-feb-92  amazing, had to make gcc2.0 happy PJT 
+ *     25-feb-92  amazing, had to make gcc2.0 happy PJT
  *     19-aug-92  added illegal address protection, <nemoinc>
  *                added convert_f2d but never tested...      PJT
  *     20-jun-01  gcc3
  *     11-dec-09  half-precision code added   PJT
+ *     16-oct-26  bulk (_n) kernels; halfp now round to nearest even
+ *     16-oct-26  use_avx() asks the CPU once, via pthread_once()
  */
 
 #include <stdinc.h>
+#include <stdint.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX
+#include <immintrin.h>
+#include <pthread.h>
+#endif
+
+#define CVT_OMP  (1<<20)	/* arrays this long are converted in parallel */
+
+local bool disjoint(const void *a, size_t na, const void *b, size_t nb);
+local bool use_avx(void);
 
 int convert_d2f(int n,double *from, float *to)
 {
@@ -23,6 +45,10 @@ int convert_d2f(int n,double *from, float *to)
     if (to==NULL)   error("convert_d2f: illegal to=NULL address");
     if (n<1) return 0;
 
+    if (disjoint(from, n*sizeof(double), to, n*sizeof(float))) {
+	convert_d2f_n(n, from, to);
+	return 1;
+    }
     while(n--)                     /* can be done in situ */
 	*to++ = *from++;
     return 1;
@@ -34,6 +60,10 @@ int convert_f2d(int n,float *from,double *to)
     if (to==NULL)   error("convert_f2d: illegal to=NULL address");
     if (n<1) return 0;
 
+    if (disjoint(from, n*sizeof(float), to, n*sizeof(double))) {
+	convert_f2d_n(n, from, to);
+	return 1;
+    }
     from = from+n-1;               /* find the address at top */
     to = to+n-1;
 
@@ -42,32 +72,347 @@ int convert_f2d(int n,float *from,double *to)
     return 1;
 }
 
-/* 
- * needs: ieeehalfprecision.c 
- * http://www.mathworks.com/matlabcentral/fileexchange/23173
+/*
+ * The halfp routines used to call the ones in ieeehalfprecision.c; the
+ * ones below give the same results, except that they round to nearest
+ * even (as the hardware does) instead of rounding halfway cases up.
+ * They cannot be done in situ, except d2h.
  */
 
-extern int singles2halfp(void *target, void *source, int numel);
-extern int doubles2halfp(void *target, void *source, int numel);
-extern int halfp2singles(void *target, void *source, int numel);
-extern int halfp2doubles(void *target, void *source, int numel);
-
 int convert_h2f(int n,halfp *from,float *to)
 {
-  return halfp2singles(to,from,n);
+  if (n<1) return 0;
+  convert_h2f_n(n,from,to);
+  return 0;
 }
 
 int convert_h2d(int n,halfp *from,double *to)
 {
-  return halfp2doubles(to,from,n);
+  if (n<1) return 0;
+  convert_h2d_n(n,from,to);
+  return 0;
 }
 
 int convert_d2h(int n,double *from,halfp *to)
 {
-  return doubles2halfp(to,from,n);  
+  halfp tmp[1024];
+  int k;
+
+  if (n<1) return 0;
+  if (disjoint(from, n*sizeof(double), to, n*sizeof(halfp))) {
+    convert_d2h_n(n,from,to);
+    return 0;
+  }
+  for (; n > 0; n -= k, from += k, to += k) {	/* in situ: via tmp */
+    k = MIN(n, 1024);
+    convert_d2h_n(k,from,tmp);
+    memcpy(to,tmp,k*sizeof(halfp));
+  }
+  return 0;
 }
 
 int convert_f2h(int n,float *from,halfp *to)
 {
-  return singles2halfp(to,from,n);  
+  if (n<1) return 0;
+  convert_f2h_n(n,from,to);
+  return 0;
+}
+
+/*
+ * bulk kernels; from and to should not overlap
+ */
+
+#if defined(HAVE_AVX)
+__attribute__((target("avx")))
+local void f2d_avx(size_t n, const float *from, double *to)
+{
+    size_t i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+	_mm256_storeu_pd(to + i, _mm256_cvtps_pd(_mm_loadu_ps(from + i)));
+    for (; i < n; i++)
+	to[i] = (double) from[i];
+}
+
+__attribute__((target("avx")))
+local void d2f_avx(size_t n, const double *from, float *to)
+{
+    size_t i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+	_mm_storeu_ps(to + i, _mm256_cvtpd_ps(_mm256_loadu_pd(from + i)));
+    for (; i < n; i++)
+	to[i] = (float) from[i];
+}
+#endif
+
+local void f2d_n(size_t n, const float *from, double *to)
+{
+    size_t i;
+
+#if defined(HAVE_AVX)
+    if (use_avx()) {
+	f2d_avx(n, from, to);
+	return;
+    }
+#endif
+    for (i = 0; i < n; i++)
+	to[i] = (double) from[i];
+}
+
+local void d2f_n(size_t n, const double *from, float *to)
+{
+    size_t i;
+
+#if defined(HAVE_AVX)
+    if (use_avx()) {
+	d2f_avx(n, from, to);
+	return;
+    }
+#endif
+    for (i = 0; i < n; i++)
+	to[i] = (float) from[i];
+}
+
+/*
+ * portable halfp conversion of one value, with the bits in an integer;
+ * a NaN keeps as much of its payload as fits, and becomes quiet.
+ */
+
+local inline uint32_t h2f_bits(uint16_t h)
+{
+    union { uint32_t u; float f; } o, magic = { 113U << 23 };
+    uint32_t e;
+
+    o.u = (uint32_t) (h & 0x7fff) << 13;	/* exponent and mantissa    */
+    e = o.u & (0x7c00U << 13);
+    o.u += (127 - 15) << 23;			/* rebias exponent          */
+    if (e == (0x7c00U << 13)) {			/* Inf or NaN               */
+	o.u += (128 - 16) << 23;
+	if (o.u & 0x7fffff) o.u |= 0x400000;
+    } else if (e == 0) {			/* zero or denormal         */
+	o.u += 1 << 23;
+	o.f -= magic.f;
+    }
+    return o.u | (uint32_t) (h & 0x8000) << 16;
+}
+
+local inline uint16_t f2h_bits(uint32_t f)
+{
+    union { uint32_t u; float f; } o, magic = { 126U << 23 };
+    uint32_t sign = f & 0x80000000U, odd;
+    uint16_t h;
+
+    f ^= sign;
+    if (f >= 0x47800000U)			/* too big, Inf or NaN      */
+	h = f > 0x7f800000U ? 0x7e00 | ((f >> 13) & 0x3ff) : 0x7c00;
+    else if (f < 0x38800000U) {			/* becomes denormal or 0    */
+	o.u = f;
+	o.f += magic.f;				/*   let the FPU round      */
+	h = (uint16_t) (o.u - magic.u);
+    } else {					/* normal: round to even    */
+	odd = (f >> 13) & 1;
+	f += ((uint32_t) (15 - 127) << 23) + 0xfff + odd;
+	h = (uint16_t) (f >> 13);
+    }
+    return h | (uint16_t) (sign >> 16);
+}
+
+local inline uint16_t d2h_bits(uint64_t d)
+{
+    union { uint64_t u; double f; } o, magic = { 1051ULL << 52 };
+    uint64_t sign = d & 0x8000000000000000ULL, odd;
+    uint16_t h;
+
+    d ^= sign;
+    if (d >= 0x40f0000000000000ULL)		/* too big, Inf or NaN      */
+	h = d > 0x7ff0000000000000ULL ? 0x7e00 | ((d >> 42) & 0x3ff) : 0x7c00;
+    else if (d < 0x3f10000000000000ULL) {	/* becomes denormal or 0    */
+	o.u = d;
+	o.f += magic.f;
+	h = (uint16_t) (o.u - magic.u);
+    } else {					/* normal: round to even    */
+	odd = (d >> 42) & 1;
+	d += ((uint64_t) (15 - 1023) << 52) + 0x1ffffffffffULL + odd;
+	h = (uint16_t) (d >> 42);
+    }
+    return h | (uint16_t) (sign >> 48);
+}
+
+#if defined(HAVE_AVX)
+__attribute__((target("avx,f16c")))
+local void h2f_f16c(size_t n, const halfp *from, float *to)
+{
+    size_t i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+	_mm256_storeu_ps(to + i,
+	    _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *) (from + i))));
+    for (; i < n; i++) {
+	uint32_t u = h2f_bits(from[i]);
+	memcpy(to + i, &u, sizeof(u));
+    }
+}
+
+__attribute__((target("avx,f16c")))
+local void f2h_f16c(size_t n, const float *from, halfp *to)
+{
+    size_t i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+	_mm_storeu_si128((__m128i *) (to + i),
+	    _mm256_cvtps_ph(_mm256_loadu_ps(from + i), _MM_FROUND_TO_NEAREST_INT));
+    for (; i < n; i++) {
+	uint32_t u;
+	memcpy(&u, from + i, sizeof(u));
+	to[i] = f2h_bits(u);
+    }
+}
+#endif
+
+local void h2f_n(size_t n, const halfp *from, float *to)
+{
+    size_t i;
+    uint32_t u;
+
+#if defined(HAVE_AVX)
+    if (use_avx()) {
+	h2f_f16c(n, from, to);
+	return;
+    }
+#endif
+    for (i = 0; i < n; i++) {
+	u = h2f_bits(from[i]);
+	memcpy(to + i, &u, sizeof(u));
+    }
+}
+
+local void f2h_n(size_t n, const float *from, halfp *to)
+{
+    size_t i;
+    uint32_t u;
+
+#if defined(HAVE_AVX)
+    if (use_avx()) {
+	f2h_f16c(n, from, to);
+	return;
+    }
+#endif
+    for (i = 0; i < n; i++) {
+	memcpy(&u, from + i, sizeof(u));
+	to[i] = f2h_bits(u);
+    }
+}
+
+/*
+ * the kernels work on blocks, which are handed out to the threads; h2d
+ * goes via a small float buffer, which is exact.
+ */
+
+#define CVT_BLK 4096
+
+void convert_f2d_n(size_t n, const float *restrict from, double *restrict to)
+{
+    ptrdiff_t b, nb = (n + CVT_BLK - 1) / CVT_BLK;
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (n >= CVT_OMP)
+#endif
+    for (b = 0; b < nb; b++)
+	f2d_n(MIN(CVT_BLK, n - b*CVT_BLK), from + b*CVT_BLK, to + b*CVT_BLK);
+}
+
+void convert_d2f_n(size_t n, const double *restrict from, float *restrict to)
+{
+    ptrdiff_t b, nb = (n + CVT_BLK - 1) / CVT_BLK;
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (n >= CVT_OMP)
+#endif
+    for (b = 0; b < nb; b++)
+	d2f_n(MIN(CVT_BLK, n - b*CVT_BLK), from + b*CVT_BLK, to + b*CVT_BLK);
+}
+
+void convert_h2f_n(size_t n, const halfp *restrict from, float *restrict to)
+{
+    ptrdiff_t b, nb = (n + CVT_BLK - 1) / CVT_BLK;
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (n >= CVT_OMP)
+#endif
+    for (b = 0; b < nb; b++)
+	h2f_n(MIN(CVT_BLK, n - b*CVT_BLK), from + b*CVT_BLK, to + b*CVT_BLK);
+}
+
+void convert_f2h_n(size_t n, const float *restrict from, halfp *restrict to)
+{
+    ptrdiff_t b, nb = (n + CVT_BLK - 1) / CVT_BLK;
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (n >= CVT_OMP)
+#endif
+    for (b = 0; b < nb; b++)
+	f2h_n(MIN(CVT_BLK, n - b*CVT_BLK), from + b*CVT_BLK, to + b*CVT_BLK);
+}
+
+void convert_h2d_n(size_t n, const halfp *restrict from, double *restrict to)
+{
+    ptrdiff_t b, nb = (n + CVT_BLK - 1) / CVT_BLK;
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (n >= CVT_OMP)
+#endif
+    for (b = 0; b < nb; b++) {
+	float tmp[CVT_BLK];
+	size_t m = MIN(CVT_BLK, n - b*CVT_BLK);
+
+	h2f_n(m, from + b*CVT_BLK, tmp);
+	f2d_n(m, tmp, to + b*CVT_BLK);
+    }
+}
+
+void convert_d2h_n(size_t n, const double *restrict from, halfp *restrict to)
+{
+    ptrdiff_t i, m = n;
+    uint64_t u;
+
+#if defined(_OPENMP)
+#pragma omp parallel for private(u) if (m >= CVT_OMP)
+#endif
+    for (i = 0; i < m; i++) {		/* not via float: double rounding */
+	memcpy(&u, from + i, sizeof(u));
+	to[i] = d2h_bits(u);
+    }
+}
+
+local bool disjoint(const void *a, size_t na, const void *b, size_t nb)
+{
+    const char *ca = (const char *) a, *cb = (const char *) b;
+
+    return ca + na <= cb || cb + nb <= ca;
+}
+
+/*
+ * the CPU is asked once, whichever thread (OpenMP, or a file set
+ * reader) gets here first; the others wait for the answer
+ */
+
+#if defined(HAVE_AVX)
+local bool avx_ok = FALSE;
+local pthread_once_t avx_once = PTHREAD_ONCE_INIT;
+
+local void avx_check(void)
+{
+    avx_ok = __builtin_cpu_supports("f16c") && __builtin_cpu_supports("avx");
+}
+#endif
+
+local bool use_avx(void)	/* for halfp we also need F16C */
+{
+#if defined(HAVE_AVX)
+    pthread_once(&avx_once, avx_check);
+    return avx_ok;
+#else
+    return FALSE;
+#endif
 }
@@ -16,6 +16,7 @@
  *			a fixed NULL vs. 0 warning
  *      11-dec-09   V1.6  experimenting with half precision 
  *      19-apr-23   V1.8  allow raw "cp" style copy using blocksize=
+ *      16-oct-26   V1.9  zip= and keep= for compressed output
  */
 
 #include <stdinc.h>
@@ -32,7 +33,9 @@ string defv[] = {
     "convert=\n		Conversion options {d2f,f2d,i2f,f2i,d2i,i2d,h2d,d2h}",
     "blocksize=0\n      If selected, use raw I/O with this blocksize, bypassing structured I/O",
     "headline=\n        Add additional headline",
-    "VERSION=1.8a\n	18-dec-2023 PJT",
+    "zip=\n             Compress the output? [default: $NEMOZIP]",
+    "keep=0\n           If >0, mantissa bits kept in compressed float/double data",
+    "VERSION=1.9\n	16-oct-2026",
     NULL,
 };
 
@@ -98,6 +101,8 @@ void nemo_main(void)
         dprintf(1,"\n\n");
     }
     outstr = stropen(getparam("out"), "w");
+    if (hasvalue("zip"))
+      put_zip(outstr, getbparam("zip") ? getiparam("keep") : -1);
     if (hasvalue("headline"))
       put_string(outstr, HeadlineTag, getparam("headline"));
     cntrd = 0;      /* keep track of items read */
@@ -0,0 +1,236 @@
+/*
+ *  CVTBENCH:  micro-benchmark and check of the bulk conversion kernels
+ *             convert_XXX_n (convert.c) and bswap (cores/bswap.c)
+ *
+ *    16-oct-2026    V1.0    written
+ */
+
+#include <nemo.h>
+#include <stdint.h>
+#include <time.h>
+
+string defv[] = {
+    "n=10000000\n    Number of elements",
+    "repeat=5\n      Number of times each kernel is run",
+    "test=f2d,d2f,h2f,f2h,h2d,d2h,bswap2,bswap4,bswap8,fread\n  Kernels to test",
+    "check=t\n       Check the results as well?",
+    "tmp=cvtbench.tmp\n  Scratch file for the fread test",
+    "VERSION=1.0\n   16-oct-2026",
+    NULL,
+};
+
+string usage="micro-benchmark of the float/double/halfp conversion kernels";
+
+string cvsid="$Id:$";
+
+local double wtime(void);
+local void report(string name, size_t n, int repeat, double t, double tref, int nbad);
+local int check_halfp(float *f, halfp *h, size_t n);
+local bool not_nearest(halfp h, double x);
+
+extern int convert_f2d(int, float  *, double *);
+extern int convert_d2f(int, double *, float  *);
+
+void nemo_main()
+{
+    size_t n = getiparam("n"), i, k, m;
+    int repeat = getiparam("repeat"), r, nbad;
+    bool Qcheck = getbparam("check");
+    string *tests = burststring(getparam("test"), ", ");
+    float *f1, *f2;
+    double *d1, *d2, *d3, t0, t1, t2;
+    halfp *h1;
+    char *c1;
+    stream str;
+    int j;
+
+    if (n < 1 || repeat < 1) error("n=%ld repeat=%d: both need to be > 0", (long) n, repeat);
+    f1 = (float *) allocate(n * sizeof(float));
+    f2 = (float *) allocate(n * sizeof(float));
+    d1 = (double *) allocate(n * sizeof(double));
+    d2 = (double *) allocate(n * sizeof(double));
+    h1 = (halfp *) allocate(n * sizeof(halfp));
+    memset(f2, 0, n * sizeof(float));	/* touch all pages */
+    memset(d2, 0, n * sizeof(double));
+    memset(h1, 0, n * sizeof(halfp));
+    for (i = 0; i < n; i++) {		/* values of all sizes, with some halfp range */
+	d1[i] = (xrandom(-1.0, 1.0)) * pow(2.0, xrandom(-30.0, 20.0));
+	f1[i] = (float) d1[i];
+    }
+    printf("# kernel   n      Melem/s  ref-Melem/s  speedup  bad\n");
+
+    for (j = 0; tests[j] != NULL; j++) {
+	nbad = 0;
+	t1 = t2 = 0.0;
+	if (streq(tests[j], "f2d")) {
+	    t0 = wtime();
+	    for (r = 0; r < repeat; r++) convert_f2d_n(n, f1, d2);
+	    t1 = wtime() - t0;
+	    d3 = (double *) allocate(n * sizeof(double));
+	    t0 = wtime();			/* reference: in situ */
+	    for (r = 0; r < repeat; r++) {
+		memcpy(d3, f1, n * sizeof(float));
+		convert_f2d(n, (float *) d3, d3);
+	    }
+	    t2 = wtime() - t0;
+	    if (Qcheck)
+		for (i = 0; i < n; i++) nbad += d2[i] != (double) f1[i] || d3[i] != d2[i];
+	    free(d3);
+	} else if (streq(tests[j], "d2f")) {
+	    t0 = wtime();
+	    for (r = 0; r < repeat; r++) convert_d2f_n(n, d1, f2);
+	    t1 = wtime() - t0;
+	    memcpy(d2, d1, n * sizeof(double));	/* reference: in situ */
+	    t0 = wtime();
+	    for (r = 0; r < repeat; r++) convert_d2f(n, d2, (float *) d2);
+	    t2 = wtime() - t0;
+	    if (Qcheck)
+		for (i = 0; i < n; i++) nbad += f2[i] != (float) d1[i];
+	} else if (streq(tests[j], "f2h") || streq(tests[j], "h2f")) {
+	    convert_f2h_n(n, f1, h1);
+	    t0 = wtime();
+	    for (r = 0; r < repeat; r++)
+		if (streq(tests[j], "f2h"))
+		    convert_f2h_n(n, f1, h1);
+		else
+		    convert_h2f_n(n, h1, f2);
+	    t1 = wtime() - t0;
+	    if (Qcheck)
+		nbad = check_halfp(f1, h1, n);
+	} else if (streq(tests[j], "h2d")) {
+	    convert_f2h_n(n, f1, h1);
+	    t0 = wtime();
+	    for (r = 0; r < repeat; r++) convert_h2d_n(n, h1, d2);
+	    t1 = wtime() - t0;
+	    if (Qcheck) {
+		convert_h2f_n(n, h1, f2);
+		for (i = 0; i < n; i++) nbad += d2[i] != (double) f2[i] && f2[i] == f2[i];
+	    }
+	} else if (streq(tests[j], "d2h")) {
+	    t0 = wtime();
+	    for (r = 0; r < repeat; r++) convert_d2h_n(n, d1, h1);
+	    t1 = wtime() - t0;
+	    if (Qcheck)				/* nearest halfp? */
+		for (i = 0; i < n; i++)
+		    nbad += not_nearest(h1[i], d1[i]);
+	} else if (streq(tests[j], "bswap2") || streq(tests[j], "bswap4") ||
+		   streq(tests[j], "bswap8")) {
+	    k = tests[j][5] - '0';
+	    m = n * sizeof(float) / k;
+	    c1 = (char *) f2;
+	    memcpy(c1, f1, m * k);
+	    t0 = wtime();
+	    for (r = 0; r < repeat; r++) bswap(c1, k, m);
+	    t1 = wtime() - t0;
+	    t0 = wtime();
+	    for (r = 0; r < repeat; r++)	/* reference: one at a time */
+		for (i = 0; i < m; i++) bswap(c1 + i*k, k, 1);
+	    t2 = wtime() - t0;
+	    if (Qcheck)				/* an even number of swaps */
+		nbad = memcmp(c1, f1, m * k) != 0;
+	} else if (streq(tests[j], "fread")) {	/* the old getflt() path */
+	    str = stropen(getparam("tmp"), "w!");
+	    if (fwrite(f1, sizeof(float), n, str) != n) error("writing tmp");
+	    strclose(str);
+	    str = stropen(getparam("tmp"), "r");
+	    t0 = wtime();
+	    for (r = 0; r < repeat; r++) {
+		rewind(str);
+		for (i = 0; i < n; i += m) {
+		    m = MIN(n - i, 2048);
+		    if (fread(f2, sizeof(float), m, str) != m) error("reading tmp");
+		    convert_f2d_n(m, f2, d2 + i);
+		}
+	    }
+	    t1 = wtime() - t0;
+	    t0 = wtime();
+	    for (r = 0; r < repeat; r++) {
+		rewind(str);
+		for (i = 0; i < n; i++) {
+		    float x;
+		    if (fread(&x, sizeof(float), 1, str) != 1) error("reading tmp");
+		    d1[i] = x;
+		}
+	    }
+	    t2 = wtime() - t0;
+	    strclose(str);
+	    unlink(getparam("tmp"));
+	    if (Qcheck)
+		nbad = memcmp(d1, d2, n * sizeof(double)) != 0;
+	} else
+	    error("test=%s: unknown kernel", tests[j]);
+	report(tests[j], n, repeat, t1, t2, nbad);
+    }
+}
+
+/*
+ * all halfp's must survive a roundtrip through float, and f2h must give
+ * the nearest halfp of each float
+ */
+
+local int check_halfp(float *f, halfp *h, size_t n)
+{
+    halfp hh[65536], h2[65536];
+    float ff[65536];
+    int nbad = 0, k;
+    size_t i;
+
+    for (k = 0; k < 65536; k++)
+	hh[k] = (halfp) k;
+    convert_h2f_n(65536, hh, ff);
+    convert_f2h_n(65536, ff, h2);
+    for (k = 0; k < 65536; k++) {
+	if ((hh[k] & 0x7c00) == 0x7c00 && (hh[k] & 0x3ff))	/* NaN: stays NaN */
+	    nbad += (h2[k] & 0x7c00) != 0x7c00 || (h2[k] & 0x3ff) == 0;
+	else
+	    nbad += h2[k] != hh[k];
+    }
+    for (i = 0; i < n; i++)
+	nbad += not_nearest(h[i], f[i]);
+    return nbad;
+}
+
+/*
+ * is one of the neighbours of h (with the same sign) closer to x?
+ */
+
+local bool not_nearest(halfp h, double x)
+{
+    uint16_t u = (uint16_t) h, un;
+    halfp hn;
+    float fh, fn;
+    int d;
+
+    if ((u & 0x7c00) == 0x7c00)			/* Inf/NaN: out of range */
+	return FALSE;
+    convert_h2f_n(1, &h, &fh);
+    for (d = -1; d <= 1; d += 2) {
+	un = (uint16_t) (u + d);
+	if (((un ^ u) & 0x8000) || (un & 0x7c00) == 0x7c00)
+	    continue;
+	hn = (halfp) un;
+	convert_h2f_n(1, &hn, &fn);
+	if (ABS(fn - x) < ABS(fh - x))
+	    return TRUE;
+    }
+    return FALSE;
+}
+
+local void report(string name, size_t n, int repeat, double t, double tref, int nbad)
+{
+    double rate = t > 0 ? n * (double) repeat / t / 1e6 : 0.0;
+    double rref = tref > 0 ? n * (double) repeat / tref / 1e6 : 0.0;
+
+    if (rref > 0)
+	printf("%-8s %ld  %8.1f  %8.1f  %6.2f  %d\n", name, (long) n, rate, rref, rate/rref, nbad);
+    else
+	printf("%-8s %ld  %8.1f         -       -  %d\n", name, (long) n, rate, nbad);
+}
+
+local double wtime(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
@@ -43,10 +43,29 @@
  * V 3.4  12-dec-09   pjt    support the new halfp type for I/O (see also csf)
  *        27-Sep-10   jcl    MINGW32/WINDOWS support
  *   3.5   8-jun-13   pjt    eltcnt type fixed for 64bit so it handles > 2B
+ *   3.7  16-oct-26          mmap seekable regular input files, get_data_ptr()
+ *        16-oct-26          get_index() etc.: random access to top level items
+ *        16-oct-26          NEMOPREFETCH: read ahead in a thread after get_tes()
+ *                           the swap flag kept per stream
+ *        16-oct-26          get_data_ran(): size_t offsets, coerced to the type
+ *                           given to get_data_set(); f2d/d2f offset bug fixed
+ *        16-oct-26          compressed items, see put_zip() and NEMOZIP
+ *        16-oct-26          f2d/d2f copy: bulk reads and convert_XXX_n kernels
+ *        16-oct-26          strclose closes all members of a file set
+ *                           findstream() locked for file set threads
+ *        16-oct-26          stream table indexed by file descriptor
+ *        16-oct-26          input items, tags and dims in an arena per top
+ *                           level item; interned type strings
+ *        16-oct-26          .toc sidecar also checks nanoseconds of mtime
+ *        16-oct-26          bounds of compressed blocks checked on input
+ *        16-oct-26          prefetch no longer reads deferred data into core
+ *        16-oct-26          reused stream entries release their old map,
+ *                           index and arenas; unaligned maps converted
+ *                           via a buffer
  *
- *  Although the SWAP test is done on input for every item - for deferred
- *  input it may fail if in the mean time another file was read which was
- *  not in swap mode => Perhaps better to HardCode (#define)???
+ *  The SWAP test is done on input for every item, and remembered with
+ *  the stream, so deferred input from a swapped file stays correct while
+ *  other files are being read, also by a prefetch thread.
  *
  *  array of strings ??
  *                                  
@@ -55,12 +74,28 @@
 #include <stdinc.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <strlib.h>
 #include <filestruct.h>
 #include <extstring.h>
 #include "filesecret.h"
 #include <stdarg.h>
+#if defined(MMAPIO)
+#include <sys/mman.h>
+#endif
+#if defined(MMAPIO) || defined(PREFETCH)
+#include <fcntl.h>
+#endif
+
+/*
+ * Interned type strings: every item points to one of these, so the
+ * type of an item can be tested with a pointer compare.
+ */
 
+local char ty_any[] = AnyType, ty_char[] = CharType, ty_byte[] = ByteType,
+           ty_short[] = ShortType, ty_int[] = IntType, ty_long[] = LongType,
+           ty_halfp[] = HalfpType, ty_float[] = FloatType,
+           ty_double[] = DoubleType, ty_set[] = SetType, ty_tes[] = TesType;
 
 extern int convert_d2f(int, double *, float  *);
 extern int convert_f2d(int, float  *, double *);
@@ -68,6 +103,12 @@ extern int convert_h2f(int, halfp  *, float  *);
 extern int convert_h2d(int, halfp  *, double *);
 extern int convert_f2h(int, float  *, halfp  *);
 extern int convert_d2h(int, double *, halfp  *);
+extern void zip_shuffle  (void *, const void *, size_t, int);
+extern void zip_unshuffle(void *, const void *, size_t, int);
+extern size_t zip_block  (void *, const void *, size_t);
+extern bool zip_unblock  (void *, size_t, const void *, size_t);
+extern void zip_truncf   (float *, size_t, int);
+extern void zip_truncd   (double *, size_t, int);
 #ifdef __MINGW32__
 #define fseeko fseek
 #define ftello ftell
@@ -333,6 +374,21 @@ void put_data_sub(
 	error("put_data_sub: putitem failed");
     freeitem(ipt, FALSE);			/* and reclaim storage      */
 }
+
+/*
+ * PUT_ZIP: compress the larger numeric arrays written to a stream from
+ * now on. keep>0 also rounds float and double data to that many mantissa
+ * bits (lossy), keep=0 is lossless, keep<0 stops compression. The
+ * default comes from the environment: NEMOZIP=1 or NEMOZIP=1,keep.
+ */
+
+void put_zip(stream str, int keep)
+{
+    strstkptr sspt;
+
+    sspt = findstream(str);
+    sspt->ss_zip = keep;
+}
 
 /************************************************************************/
 /*                         USER OUTPUT FUNCTIONS (RANDOM)               */
@@ -492,7 +548,7 @@ void get_set(stream str, string tag)
     sptr = scantag(sspt, tag);			/* scan for that tag        */
     if (sptr == NULL)				/* check for end of file    */
 	error("get_set: at EOF");
-    if (! streq(ItemTyp(sptr), SetType))	/* be sure its a set        */
+    if (ItemTyp(sptr) != ty_set)		/* be sure its a set        */
 	error("get_set: %s not a set", tag);
     ss_push(sspt, sptr);
 }
@@ -517,6 +573,9 @@ void get_tes(stream str, string tag)
     if (sspt->ss_stp == -1) {			/* back to top level?	    */
 	freeitem(sspt->ss_stk[0], TRUE);	/*   then free input set    */
 	sspt->ss_stk[0] = NULL;			/*   and flush pending item */
+#if defined(PREFETCH)
+	pf_start(sspt);				/*   and read ahead         */
+#endif
     }
 }
 
@@ -603,6 +662,57 @@ void get_data_sub(
     if (sspt->ss_stp == -1)			/* was input at top level?  */
 	freeitem(ipt, TRUE);			/*   yes, free saved item   */
 }
+
+/*
+ * GET_DATA_PTR: return a read-only view of a data object, without
+ * copying it.  This is only possible if the input file was mapped
+ * in memory, the data does not need swapping, the types match exactly
+ * and the data happen to be aligned for their type. Otherwise NULL
+ * is returned, the item is left in place, and the caller should fall
+ * back to get_data() or get_data_coerced().
+ * The view remains valid until strclose() is called on the stream.
+ * Synopsis: ptr = get_data_ptr(str, tag, typ, dimN, ..., dim1, 0)
+ */
+const void *get_data_ptr(stream str, string tag, string typ, int dim1, ...)
+{
+    va_list ap;
+    int dim[MaxVecDim], n = 0;
+    strstkptr sspt;
+    itemptr ipt;
+    void *dat;
+
+    dim[0] = dim1;
+    va_start(ap, dim1);				/* access argument list     */
+    while (dim[n++] > 0) {			/* loop reading dimensions  */
+	if (n >= MaxVecDim)			/*   no room for any more?  */
+	    error("get_data_ptr: item %s: too many dims", tag);
+	dim[n] = va_arg(ap, int);		/*   else get next argument */
+    } 
+    va_end(ap);
+
+    sspt = findstream(str);			/* access assoc. info	    */
+    ipt = scantag(sspt, tag);			/* scan input for tag	    */
+    if (ipt == NULL)				/* check input succeeded    */
+	error("get_data_ptr: at EOF");
+    if (dim[0] != 0 && ItemDim(ipt) != NULL &&	/* check layout of data     */
+	  ! xstreq(dim, ItemDim(ipt), sizeof(int)))
+	error("get_data_ptr: item %s: dimensions don't match", tag);
+    else if (dim[0] == 0 && ItemDim(ipt) != NULL)
+	error("get_data_ptr: item %s: can't copy plural to scalar", tag);
+    else if (dim[0] != 0 && ItemDim(ipt) == NULL)
+	error("get_data_ptr: item %s: can't copy scalar to plural", tag);
+    dat = ItemMap(ipt);				/* NULL if not mapped       */
+    if (dat != NULL && (! streq(typ, ItemTyp(ipt)) ||
+			(size_t) dat % ItemLen(ipt) != 0))
+	dat = NULL;				/* needs a converted copy   */
+    if (sspt->ss_stp == -1) {			/* was input at top level?  */
+	if (dat == NULL)
+	    sspt->ss_stk[0] = ipt;		/*   put back for get_data  */
+	else
+	    freeitem(ipt, TRUE);		/*   or free saved item     */
+    }
+    return dat;
+}
 
 /************************************************************************/
 /*                          USER INPUT FUNCTIONS (RANDOM)               */
@@ -637,6 +747,12 @@ void get_data_set(stream str, string tag, string typ, int dim1, ...)
 
     sspt->ss_pos = ItemPos(ipt) + datlen(ipt,0);         /* end of random data */
     sspt->ss_ran = ipt;
+    sspt->ss_rancop = copyfun(ItemTyp(ipt), typ);        /* coerce if needed */
+    if (sspt->ss_rancop == NULL) {
+	dprintf(1,"get_data_set: %s: no %s -> %s, raw copy\n",
+		tag, ItemTyp(ipt), typ);
+	sspt->ss_rancop = copydata;
+    }
 }
 
 /*
@@ -668,8 +784,8 @@ void get_data_ran(
     stream str,
     string tag,
     void *dat,
-    int offset,
-    int length
+    size_t offset,
+    size_t length
 ) {
     itemptr ipt;
     strstkptr sspt;
@@ -678,7 +794,10 @@ void get_data_ran(
     ipt = sspt->ss_ran;
     if (ipt==NULL)
         error("get_data_ran: tag %s is not in random access mode",tag);
-    copydata(dat,offset,length,ipt,str);
+    if (offset + length > eltcnt(ipt,0))
+        error("get_data_ran: %s: %lu+%lu beyond %ld elements", tag,
+	      (unsigned long) offset, (unsigned long) length, eltcnt(ipt,0));
+    (sspt->ss_rancop)(dat,offset,length,ipt,str);
 }
 
 void get_data_blocked(
@@ -693,10 +812,10 @@ void get_data_blocked(
 
     sspt = findstream(str);
     ipt = sspt->ss_ran;
-    offset = ItemOff(ipt);
     if (ipt==NULL)
         error("get_data_blocked: tag %s is not in blocked access mode",tag);
-    copydata(dat,offset,length,ipt,str);
+    offset = ItemOff(ipt);
+    (sspt->ss_rancop)(dat,offset,length,ipt,str);
     ItemOff(ipt) = offset+length;
 }
 
@@ -723,7 +842,7 @@ string get_string(
     if (ipt == NULL)				/* check input succeeded    */
 	error("get_string: at EOF");
     dp = ItemDim(ipt);				/* get list of dimensions   */
-    if (! streq(ItemTyp(ipt), CharType) ||	/* check type of item       */
+    if (ItemTyp(ipt) != ty_char ||		/* check type of item       */
 	  dp == NULL || *dp++ == 0 || *dp != 0)	/* and shape of data        */
 	error("get_string: item %s: not plural char", tag);
     dlen = datlen(ipt,0);
@@ -864,6 +983,9 @@ bool skip_item(
 	    return FALSE;			/*     then nothing to skip */
 	freeitem(ipt, TRUE);			/*   reclaim storage space  */
 	sspt->ss_stk[0] = NULL;			/*   and flush that item    */
+#if defined(PREFETCH)
+	pf_start(sspt);				/*   and read ahead         */
+#endif
 	return TRUE;				/*   handled an item        */
     } else {
 	printf("skip_item: within set");
@@ -883,7 +1005,7 @@ local bool writeitem(stream str, itemptr ipt)
 {
     itemptr *setp, tesp;
 
-    if (! streq(ItemTyp(ipt), SetType))		/* just a simple item?      */
+    if (ItemTyp(ipt) != ty_set)			/* just a simple item?      */
 	return (putitem(str, ipt));		/*   then write it out      */
     else {					/* recursively handle set   */
 	if (! putitem(str, ipt))		/*   write out set item     */
@@ -906,13 +1028,17 @@ local bool writeitem(stream str, itemptr ipt)
 
 local bool putitem(stream str, itemptr ipt)
 {
-    if (! puthdr(str, ipt))                     /* write item header        */
-        return (FALSE);
-    if (! streq(ItemTyp(ipt), SetType) && ! streq(ItemTyp(ipt), TesType))
+    zipinfo zi;
+    bool ok;
+
+    if (zipwanted(str, ipt, &zi))		/* compress the data?       */
+	ItemZip(ipt) = &zi;
+    ok = puthdr(str, ipt);                      /* write item header        */
+    if (ok && ItemTyp(ipt) != ty_set && ItemTyp(ipt) != ty_tes)
 						/* an ordinary data item?   */
-	if (! putdat(str, ipt))                 /*   write item data        */
-	    return (FALSE);
-    return (TRUE);                              /* indicate success         */
+	ok = putdat(str, ipt);                  /*   write item data        */
+    ItemZip(ipt) = NULL;
+    return (ok);                                /* indicate success         */
 }
 
 /*
@@ -924,7 +1050,10 @@ local bool puthdr(stream str, itemptr ipt)
     short num;
 
     
-    num = (ItemDim(ipt) == NULL) ? SingMagic : PlurMagic;
+    if (ItemZip(ipt) != NULL)
+	num = ZipMagic;
+    else
+	num = (ItemDim(ipt) == NULL) ? SingMagic : PlurMagic;
     						/* determine magic number   */
     if (fwrite((char *)&num, sizeof(short), 1, str) != 1)
 	return (FALSE);				/* return FALSE on failure  */
@@ -955,10 +1084,97 @@ local bool putdat(stream str, itemptr ipt)
 
     if (ItemDat(ipt) == NULL)			/* no data to write?        */
 	error("putdat: item %s has no data", ItemTag(ipt));
+    if (ItemZip(ipt) != NULL)			/* compressed item?         */
+	return putzip(str, ipt);
     len = datlen(ipt, 0);			/* count bytes to output  */
     return (fwrite((char*)ItemDat(ipt), sizeof(byte), len, str) == len);
 						/* write data to stream   */
 }
+
+/*
+ * ZIPWANTED: decide if an item is to be compressed; only the larger
+ * numeric arrays are, on streams where it was asked for.
+ */
+
+local bool zipwanted(stream str, itemptr ipt, zipinfoptr zp)
+{
+    strstkptr sspt;
+    string typ = ItemTyp(ipt);
+
+    if (ItemDim(ipt) == NULL || datlen(ipt, 0) < ZipMinLen)
+	return FALSE;
+    if (! streq(typ, ShortType) && ! streq(typ, IntType) &&
+	  ! streq(typ, LongType) && ! streq(typ, HalfpType) &&
+	  ! streq(typ, FloatType) && ! streq(typ, DoubleType))
+	return FALSE;
+    sspt = findstream(str);
+    if (sspt->ss_zip < 0)
+	return FALSE;
+    memset(zp, 0, sizeof(zipinfo));
+    zp->zp_flags = ZipShuffle;
+    if (streq(typ, FloatType) || streq(typ, DoubleType))
+	zp->zp_flags |= (sspt->ss_zip & 0xff) << 8;
+    return TRUE;
+}
+
+/*
+ * PUTZIP: write the data of an item as compressed blocks: the floating
+ * point data are optionally rounded, the bytes shuffled, and then LZ
+ * compressed. The whole compressed item is kept in memory before it is
+ * written, since the block lengths come first.
+ */
+
+local bool putzip(stream str, itemptr ipt)
+{
+    zipinfoptr zp = ItemZip(ipt);
+    int len = ItemLen(ipt), keep = zp->zp_flags >> 8, zh[3], *csiz, b;
+    size_t n, m, blen, clen, ctot = 0;
+    char *src, *raw, *cbuf;
+    bool ok;
+
+    n = eltcnt(ipt, 0);
+    zp->zp_blkelt = ZipBlockLen / len;
+    zp->zp_nblk = (int) ((n + zp->zp_blkelt - 1) / zp->zp_blkelt);
+    csiz = (int *) allocate(zp->zp_nblk * sizeof(int));
+    cbuf = (char *) allocate(datlen(ipt, 0));	/* worst case: all as is    */
+    raw = (char *) allocate(2 * ZipBlockLen);
+    zp->zp_tmp = raw + ZipBlockLen;
+    for (b = 0; b < zp->zp_nblk; b++) {
+	m = MIN(zp->zp_blkelt, n - (size_t) b * zp->zp_blkelt);
+	blen = m * len;
+	src = (char *) ItemDat(ipt) + (size_t) b * zp->zp_blkelt * len;
+	if (keep > 0 && ItemTyp(ipt) == ty_float) {
+	    memcpy(raw, src, blen);		/* round a copy             */
+	    zip_truncf((float *) raw, m, keep);
+	    src = raw;
+	} else if (keep > 0 && ItemTyp(ipt) == ty_double) {
+	    memcpy(raw, src, blen);
+	    zip_truncd((double *) raw, m, keep);
+	    src = raw;
+	}
+	zip_shuffle(zp->zp_tmp, src, m, len);
+	clen = zip_block(cbuf + ctot, zp->zp_tmp, blen);
+	if (clen == 0) {			/* did not compress         */
+	    memcpy(cbuf + ctot, zp->zp_tmp, blen);
+	    clen = blen;
+	}
+	csiz[b] = (int) clen;
+	ctot += clen;
+    }
+    dprintf(2,"putzip: %s: %ld -> %ld bytes in %d blocks\n", ItemTag(ipt),
+	    (long) datlen(ipt, 0), (long) ctot, zp->zp_nblk);
+    zh[0] = zp->zp_blkelt;
+    zh[1] = zp->zp_nblk;
+    zh[2] = zp->zp_flags;
+    ok = fwrite(zh, sizeof(int), 3, str) == 3 &&
+	 fwrite(csiz, sizeof(int), zp->zp_nblk, str) == zp->zp_nblk &&
+	 fwrite(cbuf, sizeof(byte), ctot, str) == ctot;
+    free(raw);
+    free(cbuf);
+    free(csiz);
+    zp->zp_tmp = NULL;
+    return ok;
+}
 
 /************************************************************************/
 /*                                 INPUT                                */
@@ -996,7 +1212,7 @@ local itemptr nextitem(strstkptr sspt)
     if (sspt->ss_stk[0] != NULL)		/* pending item exists?     */
 	ipt = sspt->ss_stk[0];			/*   then use it	    */
     else {					/* nothing pending?	    */
-	ipt = readitem(sspt->ss_str, NULL);	/*   read next item in      */
+	ipt = readitem(sspt, NULL);		/*   read next item in      */
 	sspt->ss_stk[0] = ipt;			/*   and save for later     */
     }
     return (ipt);				/* supply item to caller    */
@@ -1017,32 +1233,47 @@ local itemptr finditem(strstkptr sspt, string tag)
 }
 
 /*
- * READITEM: read a simple or compound item.
+ * READITEM: read a simple or compound item.  A top level item (first
+ * is NULL) and everything in it is made in an arena of its own.
  */
 
-local itemptr readitem(stream str, itemptr first)
+local itemptr readitem(strstkptr sspt, itemptr first)
 {
     itemptr ip, ibuf[MaxSetLen], *bufp, np, res;
+    arenaptr ar;
+    string tag;
 
-    ip = first != NULL ? first : getitem(str);	/* use 1st or next item     */
-    if (ip == NULL ||				/* EOF detected by getitem  */
-	  ! streq(ItemTyp(ip), SetType))	/* or item not a set?       */
+    if (first == NULL) {			/* new top level item?      */
+	ar = sspt->ss_arena = ar_get(sspt);	/*   gets its own arena     */
+	ip = getitem(sspt);
+	res = ip != NULL ? readitem(sspt, ip) : NULL;
+	if (res == NULL)			/*   EOF detected by getitem */
+	    ar_put(ar);
+	else
+	    ar->ar_owner = res;			/*   freed with the item    */
+	sspt->ss_arena = NULL;
+	return (res);
+    }
+    ip = first;					/* use 1st item             */
+    if (ItemTyp(ip) != ty_set)			/* item not a set?          */
 	return (ip);				/*   just return it	    */
     bufp = &ibuf[0];				/* prepare item buffer	    */
     for ( ; ; ) {				/* loop reading items in    */
 	if (bufp >= &ibuf[MaxSetLen])		/*   no room for next?	    */
 	    error("readitem: set %s: buffer overflow", ItemTag(ip));
-	np = getitem(str);		        /*   look at next item	    */
+	np = getitem(sspt);		        /*   look at next item	    */
 	if (np == NULL)				/*   at end of file?	    */
 	    error("readitem: set %s: unexpected EOF", ItemTag(ip));
-	if (streq(ItemTyp(np), TesType))	/*   end of set item?	    */
+	if (ItemTyp(np) == ty_tes)		/*   end of set item?	    */
 	    break;				/*     quit input loop	    */
-	*bufp++ = readitem(str, np);	  	/*   read next component    */
+	*bufp++ = readitem(sspt, np);	  	/*   read next component    */
     }
-    *bufp = NULL;				/* terminate item vector    */
-    res = makeitem(scopy(SetType), scopy(ItemTag(ip)),
-		   copxstr(ibuf, sizeof(itemptr)), NULL);
-						/* construct compound item  */
+    *bufp++ = NULL;				/* terminate item vector    */
+    ar = sspt->ss_arena;
+    tag = ar != NULL ? ItemTag(ip) : scopy(ItemTag(ip));
+    res = newitem(ar, ty_set, tag, ar_alloc(ar, (bufp - ibuf) * sizeof(itemptr)),
+		  NULL);			/* construct compound item  */
+    memcpy(ItemDat(res), ibuf, (bufp - ibuf) * sizeof(itemptr));
     freeitem(ip, TRUE);				/* reclaim orig. header     */
     freeitem(np, TRUE);
     return (res);				/* return compound item     */
@@ -1050,18 +1281,20 @@ local itemptr readitem(stream str, itemptr first)
 
 /*
  * GETITEM: read item from stream; return ptr to item or NULL.
+ * Note this, and readitem(), are also called from the prefetch
+ * thread, so they must not use findstream().
  */
 
-local itemptr getitem(stream str)
+local itemptr getitem(strstkptr sspt)
 {
     itemptr ipt;
 
-    ipt = gethdr(str);				/* try reading header in    */
+    ipt = gethdr(sspt);				/* try reading header in    */
     if (ipt == NULL)				/* did gethdr detect EOF?   */
         return (NULL);				/*   return NULL on EOF     */
-    if (! streq(ItemTyp(ipt), SetType) &&	/* if item does not start   */
-	  ! streq(ItemTyp(ipt), TesType))	/* or terminate a set       */
-	getdat(ipt, str);			/*   try reading data in    */
+    if (ItemTyp(ipt) != ty_set &&		/* if item does not start   */
+	  ItemTyp(ipt) != ty_tes)		/* or terminate a set       */
+	getdat(ipt, sspt);			/*   try reading data in    */
     return (ipt);                               /* return resulting item */
 }
 
@@ -1069,34 +1302,37 @@ local itemptr getitem(stream str)
  * GETHDR: read a item header from a stream.
  */
 
-local itemptr gethdr(stream str)
+local itemptr gethdr(strstkptr sspt)
 {
+    stream str = sspt->ss_str;
     short num;
-    string typ, tag;
+    string typ = NULL, tag;
     int *dim, *ip;  /* ISSWAP */
-    permanent bool firsttime = TRUE;
+    int zh[3], i;
+    size_t blkbytes;
+    itemptr ipt;
+    zipinfoptr zp;
+    typlenptr tp;
+    char tbuf[MaxXLen];
 
     if (fread(&num, sizeof(short), 1, str) != 1)/* read magic number*/
 	return NULL;				/*   return NULL on EOF     */
-    if (num == SingMagic || num == PlurMagic) {	/* new-style magic number?  */
-	typ = (string) getxstr(str, sizeof(char));
+    if (num == SingMagic || num == PlurMagic || num == ZipMagic) {
+						/* new-style magic number?  */
+	typ = (string) getxarena(NULL, str, sizeof(char), tbuf);
 						/*   read type string       */
-	if (typ == NULL)			/*   check for EOF          */
-	    error("gethdr: EOF reading type");
-        swap = FALSE;
+        sspt->ss_swap = FALSE;
     }
 #if defined(CHKSWAP)
     else {        /* ISSWAP */
         bswap((char *)&num,sizeof(short int),1);        /* swap the bytes */
-        if (num == SingMagic || num == PlurMagic) {    /* test the swapped */
-            if (firsttime)
+        if (num == SingMagic || num == PlurMagic || num == ZipMagic) {
+						/* test the swapped */
+            if (! sspt->ss_swap)		/* once per stream */
                 fprintf(stderr,"[filestruct: reading swapped]");
-	    typ = (string) getxstr(str, sizeof(char));
+	    typ = (string) getxarena(NULL, str, sizeof(char), tbuf);
 						/*   read type string       */
-	    if (typ == NULL)			/*   check for EOF          */
-	        error("gethdr: EOF reading type");
-            swap = TRUE;
-            firsttime = FALSE;
+            sspt->ss_swap = TRUE;
         } else {
             bswap(&num,sizeof(short int),1);
             error("gethdr: bad magic: %o", num);
@@ -1107,18 +1343,23 @@ local itemptr gethdr(stream str)
         error("gethdr: bad magic: %o",num);
     }
 #endif
-    if (! streq(typ, TesType)) {		/* is item tag next?        */
-	tag = (string) getxstr(str, sizeof(char));
+    if (typ == NULL)				/* check for EOF            */
+	error("gethdr: EOF reading type");
+    tp = findtl(typ);				/* intern the type          */
+    if (tp == NULL)
+	error("gethdr: type %s unknown", typ);
+    if (tp->tl_typ != ty_tes) {			/* is item tag next?        */
+	tag = (string) getxarena(sspt->ss_arena, str, sizeof(char), NULL);
 	if (tag == NULL)			/*   check for EOF          */
 	    error("gethdr: EOF reading tag");
     } else
 	tag = NULL;				/*   item is not tagged     */
-    if (num == PlurMagic) {			/* are dimensions next?     */
-	dim = (int *) getxstr(str, sizeof(int));
+    if (num == PlurMagic || num == ZipMagic) {	/* are dimensions next?     */
+	dim = (int *) getxarena(sspt->ss_arena, str, sizeof(int), NULL);
 	if (dim == NULL)			/*   check for EOF          */
 	    error("gethdr: EOF reading dimensions");
 #if defined(CHKSWAP)
-        if (swap) {     /* ISSWAP */
+        if (sspt->ss_swap) {     /* ISSWAP */
             ip = dim;
             while (*ip) {
                 bswap((char *)ip,sizeof(int),1);
@@ -1128,7 +1369,31 @@ local itemptr gethdr(stream str)
 #endif
     } else
 	dim = NULL;
-    return (makeitem(typ, tag, NULL, dim));	/* return item less data    */
+    ipt = newitem(sspt->ss_arena, tp->tl_typ, tag, NULL, dim);
+						/* item less data           */
+    if (num == ZipMagic) {			/* block structure is next  */
+	zp = (zipinfoptr) allocate(sizeof(zipinfo));
+	ssread(zh, sizeof(int), 3, sspt);
+	zp->zp_blkelt = zh[0];
+	zp->zp_nblk = zh[1];
+	zp->zp_flags = zh[2];
+	if (zp->zp_blkelt <= 0 || zp->zp_nblk < 0 || dim == NULL ||
+	      (long) zp->zp_nblk * zp->zp_blkelt < eltcnt(ipt, 0))
+	    error("gethdr: %s: bad compressed item", tag);
+	blkbytes = (size_t) zp->zp_blkelt * ItemLen(ipt);
+	zp->zp_off = (off_t *) allocate((zp->zp_nblk + 1) * sizeof(off_t));
+	zp->zp_off[0] = 0;
+	for (i = 0; i < zp->zp_nblk; i++) {	/* lengths -> offsets       */
+	    ssread(zh, sizeof(int), 1, sspt);
+	    if (zh[0] <= 0 || (size_t) zh[0] > blkbytes)
+		error("gethdr: %s: bad length %d of block %d", tag, zh[0], i);
+	    zp->zp_off[i+1] = zp->zp_off[i] + zh[0];
+	}
+	zp->zp_swap = sspt->ss_swap;
+	zp->zp_blk = -1;
+	ItemZip(ipt) = zp;
+    }
+    return (ipt);				/* return item less data    */
 } /* gethdr */
 /*
  * GETHDR: read a item header from a stream.
@@ -1143,13 +1408,13 @@ bool qsf(stream str)
 
     if (fread(&num, sizeof(short), 1, str) != 1)/* read magic number        */
 	return FALSE;				/*   return NULL on EOF     */
-    if (num == SingMagic || num == PlurMagic) {	/* new-style magic number?  */
-        return TRUE;
+    if (num == SingMagic || num == PlurMagic || num == ZipMagic) {
+        return TRUE;				/* new-style magic number?  */
     }
 #if defined(CHKSWAP)
     else {
         bswap(&num,sizeof(short int),1);        /* swap the bytes */
-        if (num == SingMagic || num == PlurMagic) {    /* test the swapped */
+        if (num == SingMagic || num == PlurMagic || num == ZipMagic) {
             return TRUE;
         } else {
             return FALSE;
@@ -1168,12 +1433,32 @@ bool qsf(stream str)
 
 #define MaxReadNow  256
 
-local void getdat(itemptr ipt, stream str)
+local void getdat(itemptr ipt, strstkptr sspt)
 {
+    stream str = sspt->ss_str;
     size_t dlen, elen;
+#if defined(MMAPIO)
+    off_t pos;
+#endif
 
+    if (ItemZip(ipt) != NULL) {			/* compressed data?         */
+	getzip(ipt, sspt);
+	return;
+    }
     elen = eltcnt(ipt, 0);
     dlen = elen * ItemLen(ipt);                 /* count bytes of data	    */
+#if defined(MMAPIO)
+    if (sspt->ss_map != NULL && ! sspt->ss_swap) { /* mapped input file?    */
+	pos = ftello(str);
+	if (pos >= 0 && pos + dlen <= sspt->ss_maplen) {
+	    ItemDat(ipt) = NULL;		/*   no data in core        */
+	    ItemPos(ipt) = pos;			/*   remember this place    */
+	    ItemMap(ipt) = sspt->ss_map + pos;	/*   data is in the map     */
+	    safeseek(str, dlen, 1);		/*   skip over data         */
+	    return;
+	}					/*   else beyond map: read  */
+    }
+#endif
 #if 0
     if (dlen <= MaxReadNow) {			/* small enough to read?    */
 #else
@@ -1183,7 +1468,7 @@ local void getdat(itemptr ipt, stream str)
 	ItemDat(ipt) = (byte *) calloc(dlen,1);	/*   then alloc space now   */
 	if (ItemDat(ipt) == NULL)		/*   did alloc fail?	    */
 	    error("getdat: no memory (%d bytes)", dlen);
-	saferead(ItemDat(ipt), ItemLen(ipt), elen, str);
+	ssread(ItemDat(ipt), ItemLen(ipt), elen, sspt);
 						/*   read data in now       */
     } else {					/* too big, so skip now     */
 	ItemDat(ipt) = NULL;			/*   no data in core	    */
@@ -1191,6 +1476,146 @@ local void getdat(itemptr ipt, stream str)
 	safeseek(str, dlen, 1);			/*   skip over data	    */
     }
 } /* getdat */
+
+/*
+ * GETZIP: as getdat, for compressed data. Blocks in a mapped file, or in
+ * a large enough seekable file, are left there and only expanded when
+ * asked for (see zipspan); otherwise the whole item is expanded now,
+ * and from then on it is an ordinary item.
+ */
+
+local void getzip(itemptr ipt, strstkptr sspt)
+{
+    stream str = sspt->ss_str;
+    zipinfoptr zp = ItemZip(ipt);
+    size_t clen, blkbytes;
+    off_t pos;
+    char *cbuf;
+    int b;
+    struct stat st;
+
+    clen = zp->zp_off[zp->zp_nblk];		/* bytes of compressed data */
+    pos = ftello(str);
+    ItemPos(ipt) = pos;
+#if defined(MMAPIO)
+    if (sspt->ss_map != NULL && pos >= 0 && pos + clen <= sspt->ss_maplen) {
+	zp->zp_map = sspt->ss_map + pos;	/* blocks are in the map    */
+	safeseek(str, clen, 1);
+	return;
+    }
+#endif
+    if (clen > MaxReadNow && strseek(str)) {	/* deferred                 */
+	if (fstat(fileno(str), &st) == 0 && S_ISREG(st.st_mode) &&
+	      pos + clen > st.st_size)
+	    error("getzip: %s: %ld bytes of blocks run past end of file",
+		  ItemTag(ipt), (long) clen);
+	safeseek(str, clen, 1);
+	return;
+    }
+    cbuf = (char *) allocate(clen + 1);		/* read and expand now      */
+    if (fread(cbuf, sizeof(byte), clen, str) != clen)
+	error("getzip: %s: error reading %ld bytes", ItemTag(ipt), (long) clen);
+    zp->zp_map = cbuf;
+    blkbytes = (size_t) zp->zp_blkelt * ItemLen(ipt);
+    ItemDat(ipt) = (byte *) allocate(datlen(ipt, 0));
+    for (b = 0; b < zp->zp_nblk; b++)
+	zipexpand(ipt, str, b, (char *) ItemDat(ipt) + b * blkbytes);
+    free(cbuf);
+    freezip(zp);
+    ItemZip(ipt) = NULL;
+}
+
+/*
+ * ZIPEXPAND: uncompress block b of an item into dst.
+ */
+
+local void zipexpand(itemptr ipt, stream str, int b, char *dst)
+{
+    zipinfoptr zp = ItemZip(ipt);
+    size_t m, blen, clen;
+    off_t oldpos;
+    char *src;
+
+    m = MIN(zp->zp_blkelt, eltcnt(ipt, 0) - (size_t) b * zp->zp_blkelt);
+    blen = m * ItemLen(ipt);
+    clen = zp->zp_off[b+1] - zp->zp_off[b];
+    if (zp->zp_tmp == NULL)
+	zp->zp_tmp = (char *) allocate(2 * zp->zp_blkelt * ItemLen(ipt));
+    if (zp->zp_map != NULL)			/* in memory                */
+	src = zp->zp_map + zp->zp_off[b];
+    else {					/* read it in               */
+	src = zp->zp_tmp + zp->zp_blkelt * ItemLen(ipt);
+	oldpos = ftello(str);
+	safeseek(str, ItemPos(ipt) + zp->zp_off[b], 0);
+	if (fread(src, sizeof(byte), clen, str) != clen)
+	    error("zipexpand: %s: error reading block %d", ItemTag(ipt), b);
+	safeseek(str, oldpos, 0);
+    }
+    if (clen != blen) {				/* compressed block         */
+	if (! zip_unblock(zp->zp_tmp, blen, src, clen))
+	    error("zipexpand: %s: corrupt block %d", ItemTag(ipt), b);
+	src = zp->zp_tmp;
+    }
+    if (zp->zp_flags & ZipShuffle)
+	zip_unshuffle(dst, src, m, ItemLen(ipt));
+    else
+	memcpy(dst, src, blen);
+#if defined(CHKSWAP)
+    if (zp->zp_swap) bswap(dst, ItemLen(ipt), m);
+#endif
+}
+
+/*
+ * ZIPSPAN: pointer to element off of a compressed item, and in *n how
+ * many elements (at most len) follow it in the same block.
+ */
+
+local char *zipspan(itemptr ipt, stream str, size_t off, size_t len, size_t *n)
+{
+    zipinfoptr zp = ItemZip(ipt);
+    int b = (int) (off / zp->zp_blkelt);
+    size_t i = off % zp->zp_blkelt;
+
+    if (zp->zp_blk != b) {
+	if (zp->zp_buf == NULL)
+	    zp->zp_buf = (char *) allocate(zp->zp_blkelt * ItemLen(ipt));
+	zipexpand(ipt, str, b, zp->zp_buf);
+	zp->zp_blk = b;
+    }
+    *n = MIN(len, zp->zp_blkelt - i);
+    return zp->zp_buf + i * ItemLen(ipt);
+}
+
+local void freezip(zipinfoptr zp)
+{
+    if (zp->zp_off != NULL) free(zp->zp_off);
+    if (zp->zp_buf != NULL) free(zp->zp_buf);
+    if (zp->zp_tmp != NULL) free(zp->zp_tmp);
+    free(zp);
+}
+
+/*
+ * ZIP_ENV: default compression of output streams, from the environment:
+ * NEMOZIP=1 (lossless), or NEMOZIP=1,keep to also round float and double
+ * data to keep mantissa bits. Returns -1 for no compression.
+ */
+
+local int zip_env(void)
+{
+    permanent int zipenv = -2;
+    string cp;
+
+    if (zipenv == -2) {
+	cp = getenv("NEMOZIP");
+	if (cp == NULL || atoi(cp) <= 0)
+	    zipenv = -1;
+	else if ((cp = strchr(cp, ',')) != NULL)
+	    zipenv = MAX(0, atoi(cp+1));
+	else
+	    zipenv = 0;
+    }
+    return zipenv;
+}
 
 /*
  * COPYFUN: select copy routine for given data types.
@@ -1213,104 +1638,166 @@ local copyproc copyfun(string srctyp, string destyp)
 
 local void copydata(
     void *vdat,
-    int off,
-    int len,
+    size_t off,
+    size_t len,
     itemptr ipt,
     stream str)
 {
     char *src, *dat = (char *) vdat;
     off_t oldpos;
+    size_t boff, n;
       
-    off *= ItemLen(ipt);                        /* offset bytes from start  */
+    boff = off * ItemLen(ipt);                  /* offset bytes from start  */
     if (ItemDat(ipt) != NULL) {			/* data already in core?    */
-	src = (char *) ItemDat(ipt) + off;	/*   get pointer to source  */
-    	len *= ItemLen(ipt);			/* number of bytes to copy  */
-	while (--len >= 0)			/*   loop copying data      */
-	    *dat++ = *src++;			/*     byte by byte         */
+	src = (char *) ItemDat(ipt) + boff;	/*   get pointer to source  */
+	memcpy(dat, src, len * ItemLen(ipt));
+    } else if (ItemZip(ipt) != NULL) {		/* compressed data?         */
+	while (len > 0) {			/*   a block at a time      */
+	    src = zipspan(ipt, str, off, len, &n);
+	    memcpy(dat, src, n * ItemLen(ipt));
+	    dat += n * ItemLen(ipt);
+	    off += n;
+	    len -= n;
+	}
+    } else if (ItemMap(ipt) != NULL) {		/* data in a mapped file?   */
+	src = (char *) ItemMap(ipt) + boff;
+	memcpy(dat, src, len * ItemLen(ipt));
     } else {					/* time to read data in     */
 	oldpos = ftello(str);                   /*   save current place     */
-	safeseek(str, ItemPos(ipt) + off, 0);   /*   seek back to data      */
+	safeseek(str, ItemPos(ipt) + boff, 0);  /*   seek back to data      */
 	saferead(dat, ItemLen(ipt), len, str);	/*   read data and check it */
 	safeseek(str, oldpos, 0);               /*   reset file pointer     */
     }
 } /* copydata */
-
+
+#define CvtBufLen  2048			/* elements read at a time  */
+
 local void copydata_f2d(
     double *dat,
-    int off,
-    int len,
+    size_t off,
+    size_t len,
     itemptr ipt,
     stream str)
 {
-    float *src;
+    float *src, buf[CvtBufLen];
+    char *cp;
     off_t oldpos;
+    size_t n;
       
-    off *= ItemLen(ipt);
     if (ItemDat(ipt) != NULL) {			/* data already in core?    */
 	src = (float *) ItemDat(ipt) + off;	/*   get pointer to source  */
-	/*    	len *= ItemLen(ipt);		==> BUG */
-	while (--len >= 0)			/*   loop converting data   */
-	    *dat++ = (double) *src++;		/*     float to double      */
+	convert_f2d_n(len, src, dat);		/*   float to double        */
+    } else if (ItemZip(ipt) != NULL) {		/* compressed data?         */
+	while (len > 0) {
+	    src = (float *) zipspan(ipt, str, off, len, &n);
+	    convert_f2d_n(n, src, dat);
+	    dat += n;
+	    off += n;
+	    len -= n;
+	}
+    } else if (ItemMap(ipt) != NULL) {		/* data in a mapped file?   */
+	cp = (char *) ItemMap(ipt) + off * sizeof(float);
+	if ((size_t) cp % sizeof(float) == 0)	/*   aligned: convert there */
+	    convert_f2d_n(len, (float *) cp, dat);
+	else
+	    while (len > 0) {			/*   else via the buffer    */
+		n = MIN(len, CvtBufLen);
+		memcpy(buf, cp, n * sizeof(float));
+		convert_f2d_n(n, buf, dat);
+		cp += n * sizeof(float);
+		dat += n;
+		len -= n;
+	    }
     } else {					/* time to read data in     */
 	oldpos = ftello(str);                   /*   save this position     */
-	safeseek(str, ItemPos(ipt) + off, 0);	/*   seek back to data      */
-	while (--len >= 0)			/*   loop reading data      */
-	    *dat++ = (double) getflt(str);	/*     float to double      */
+	safeseek(str, ItemPos(ipt) + off * ItemLen(ipt), 0);
+						/*   seek back to data      */
+	while (len > 0) {			/*   read a buffer full     */
+	    n = MIN(len, CvtBufLen);
+	    saferead(buf, sizeof(float), n, str);
+	    convert_f2d_n(n, buf, dat);		/*   and convert it         */
+	    dat += n;
+	    len -= n;
+	}
 	safeseek(str, oldpos, 0);               /*   reset file pointer     */
     }
 } /* copydata_f2d */
 
 local void copydata_d2f(
     float *dat,
-    int off,
-    int len,
+    size_t off,
+    size_t len,
     itemptr ipt,
     stream str)
 {
-    double *src;
+    double *src, buf[CvtBufLen];
+    char *cp;
     off_t oldpos;
+    size_t n;
       
-    off *= ItemLen(ipt);
     if (ItemDat(ipt) != NULL) {			/* data already in core?    */
 	src = (double *) ItemDat(ipt) + off;	/*   get pointer to source  */
-    	/* len *= ItemLen(ipt);		BUG <===	*/
-	while (--len >= 0)			/*   loop converting data   */
-	    *dat++ = (float) *src++;		/*     double to float      */
+	convert_d2f_n(len, src, dat);		/*   double to float        */
+    } else if (ItemZip(ipt) != NULL) {		/* compressed data?         */
+	while (len > 0) {
+	    src = (double *) zipspan(ipt, str, off, len, &n);
+	    convert_d2f_n(n, src, dat);
+	    dat += n;
+	    off += n;
+	    len -= n;
+	}
+    } else if (ItemMap(ipt) != NULL) {		/* data in a mapped file?   */
+	cp = (char *) ItemMap(ipt) + off * sizeof(double);
+	if ((size_t) cp % sizeof(double) == 0)	/*   aligned: convert there */
+	    convert_d2f_n(len, (double *) cp, dat);
+	else
+	    while (len > 0) {			/*   else via the buffer    */
+		n = MIN(len, CvtBufLen);
+		memcpy(buf, cp, n * sizeof(double));
+		convert_d2f_n(n, buf, dat);
+		cp += n * sizeof(double);
+		dat += n;
+		len -= n;
+	    }
     } else {					/* time to read data in     */
 	oldpos = ftello(str);                   /*   save this position     */
-	safeseek(str, ItemPos(ipt) + off, 0);	/*   seek back to data      */
-	while (--len >= 0)			/*   loop reading data      */
-	    *dat++ = (float) getdbl(str);	/*     double to float      */
+	safeseek(str, ItemPos(ipt) + off * ItemLen(ipt), 0);
+						/*   seek back to data      */
+	while (len > 0) {			/*   read a buffer full     */
+	    n = MIN(len, CvtBufLen);
+	    saferead(buf, sizeof(double), n, str);
+	    convert_d2f_n(n, buf, dat);		/*   and convert it         */
+	    dat += n;
+	    len -= n;
+	}
 	safeseek(str, oldpos, 0);               /*   reset file pointer     */
     }
 } /* copydata_d2f */
 
-local float getflt(stream str)
+local void saferead(
+    void *dat,
+    int siz,
+    int cnt,
+    stream str)
 {
-    float x;
-
-    saferead((char *)&x, sizeof(float), 1, str);
-    return x; 
+    ssread(dat, siz, cnt, findstream(str));
 }
 
-local double getdbl(stream str)
-{
-    double x;
-
-    saferead((char *)&x, sizeof(double), 1, str);
-    return x;
-}
+/*
+ * SSREAD: saferead() for a known stream entry; used by the prefetch
+ * thread, which must not call findstream().
+ */
 
-local void saferead(
+local void ssread(
     void *dat,
     int siz,
     int cnt,
-    stream str)
+    strstkptr sspt)
 {
-    if (fread(dat, siz, cnt, str) != cnt)
+    if (fread(dat, siz, cnt, sspt->ss_str) != cnt)
 	error("saferead: error calling fread %d*%d bytes", siz, cnt);
 #if defined(CHKSWAP)
-    if (swap) bswap(dat,siz,cnt);
+    if (sspt->ss_swap) bswap(dat,siz,cnt);
 #endif
 }
 
@@ -1369,12 +1856,30 @@ local itemptr makeitem(
     string tag,     	        /* tag for generated item */
     void *dat,              	/* pointer to data */
     int *dim)                 	/* dims, terminated with 0 */
+{
+    typlenptr tp;
+
+    tp = findtl(typ);				/* intern type string       */
+    if (tp == NULL)
+	error("makeitem: tag %s: type %s unknown", tag, typ);
+    return newitem(NULL, tp->tl_typ, tag, dat, dim);
+}
+
+/*
+ * NEWITEM: same, in an arena if ar is not NULL, for an interned type.
+ */
+
+local itemptr newitem(
+    arenaptr ar,		/* arena, or NULL to malloc */
+    string typ,			/* interned type string */
+    string tag,     	        /* tag for generated item */
+    void *dat,              	/* pointer to data */
+    int *dim)                 	/* dims, terminated with 0 */
 {
     itemptr ipt;
 
-    ipt = (itemptr) calloc(sizeof(item),1);	/* get space for item       */
-    if (ipt == NULL)				/* check malloc worked      */
-	error("makeitem: tag %s: malloc failed", tag);
+    ipt = (itemptr) ar_alloc(ar, sizeof(item));	/* get space for item       */
+    memset(ipt, 0, sizeof(item));
     ItemTyp(ipt) = typ;				/* set type code string     */
     ItemLen(ipt) = baselen(typ);		/* set basic datum length   */
     ItemTag(ipt) = tag;				/* set item tag string      */
@@ -1384,52 +1889,59 @@ local itemptr makeitem(
 	ItemDim(ipt) = NULL;			/*   clear out dimensions   */
     ItemDat(ipt) = dat;				/* set pointer to data      */
     ItemPos(ipt) = 0;				/* clear out file position  */
+    ItemMap(ipt) = NULL;			/* not in a mapped file     */
+    ItemZip(ipt) = NULL;			/* not compressed           */
+    ItemArena(ipt) = ar;
     return (ipt);                               /* return complete item     */
 }
 
 /*
- * FREEITEM: deallocate item and data.
+ * FREEITEM: deallocate item and data.  Type strings are interned and
+ * never freed; what is in an arena goes when the arena's owner goes.
  */
 local void freeitem(
     itemptr ipt,			/* address of item to free */
     bool flg)			/* if true, free fields of item */
 {
     itemptr *ivp;
+    arenaptr ar = ItemArena(ipt);
 
-    if (flg && ItemTyp(ipt) != NULL) {		/* does item have a type?   */
-	if (streq(ItemTyp(ipt), SetType)) {	/*   free set recursively?  */
-	    ivp = (itemptr *) ItemDat(ipt);	/*     get vector of items  */
-	    if (ivp != NULL) 			/*     is data given?       */
-		while (*ivp != NULL)		/*       loop over item set */
-		    freeitem(*ivp++, TRUE);	/*         and free them up */
-	}
-	free(ItemTyp(ipt));			/*   free type string	    */
+    if (flg && ItemTyp(ipt) == ty_set) {	/* free set recursively?    */
+	ivp = (itemptr *) ItemDat(ipt);		/*   get vector of items    */
+	if (ivp != NULL) 			/*   is data given?         */
+	    while (*ivp != NULL)		/*     loop over item set   */
+		freeitem(*ivp++, TRUE);		/*       and free them up   */
     }
-    if (flg && ItemTag(ipt) != NULL)            /* is tag field set?        */
-        free(ItemTag(ipt));                     /*   then free copy of tag  */
-    if (flg && ItemDim(ipt) != NULL)
+    if (flg && ar == NULL && ItemTag(ipt) != NULL)
+        free(ItemTag(ipt));                     /* free copy of tag         */
+    if (flg && ar == NULL && ItemDim(ipt) != NULL)
         free(ItemDim(ipt));
-    if (flg && ItemDat(ipt) != NULL)
-        free(ItemDat(ipt));
-    free(ipt);                                  /* free item itself         */
+    if (flg && ItemDat(ipt) != NULL && (ar == NULL || ItemTyp(ipt) != ty_set))
+        free(ItemDat(ipt));			/* set vectors are in arena */
+    if (flg && ItemZip(ipt) != NULL)
+        freezip(ItemZip(ipt));
+    if (ar == NULL)
+	free(ipt);                              /* free item itself         */
+    else if (ar->ar_owner == (void *) ipt)	/* top level item?          */
+	ar_put(ar);				/*   free all of it         */
 }
-
+
 /*
  * BASELEN: compute length of basic type in bytes.
  */
 
 local typlen tl_tab[] = {
-    { AnyType,	  sizeof(byte),   },
-    { CharType,	  sizeof(char),   },
-    { ByteType,	  sizeof(byte),   },
-    { ShortType,  sizeof(short),  },
-    { IntType,	  sizeof(int),    },
-    { LongType,	  sizeof(long),   },
-    { HalfpType,  sizeof(short),  },
-    { FloatType,  sizeof(float),  },
-    { DoubleType, sizeof(double), },
-    { SetType,    0,              },
-    { TesType,	  0,              },
+    { ty_any,	  sizeof(byte),   },
+    { ty_char,	  sizeof(char),   },
+    { ty_byte,	  sizeof(byte),   },
+    { ty_short,   sizeof(short),  },
+    { ty_int,	  sizeof(int),    },
+    { ty_long,	  sizeof(long),   },
+    { ty_halfp,   sizeof(short),  },
+    { ty_float,   sizeof(float),  },
+    { ty_double,  sizeof(double), },
+    { ty_set,     0,              },
+    { ty_tes,	  0,              },
     { NULL,	  0,              },
 };
 
@@ -1437,13 +1949,152 @@ local int baselen(string typ)
 {
     typlenptr tp;
 
+    tp = findtl(typ);				/* look up type	            */
+    if (tp == NULL)
+	error("baselen: type %s unknown", typ);	/* bad type string          */
+    return (tp->tl_len);			/* return byte length       */
+}
+
+/*
+ * FINDTL: table entry of a type, whose tl_typ is the interned string.
+ */
+
+local typlenptr findtl(string typ)
+{
+    typlenptr tp;
+
+    for (tp = tl_tab; tp->tl_typ != NULL; tp++)	/* an interned one?         */
+	if (typ == tp->tl_typ)
+	    return (tp);
     for (tp = tl_tab; tp->tl_typ != NULL; tp++)	/* loop over basic types    */
 	if (streq(typ, tp->tl_typ))		/*   found type we want?    */
-	    return (tp->tl_len);		/*     return byte length   */
-    error("baselen: type %s unknown", typ);	/* bad type string          */
-    return (0);                                 /* will never get here      */
+	    return (tp);
+    return (NULL);
 }
-
+
+/************************************************************************/
+/*                             ARENAS                                   */
+/************************************************************************/
+
+/*
+ * GETXARENA: read an extended string (see extstring.c) into the buffer
+ * tbuf of MaxXLen bytes if given (for a type, which is interned right
+ * away), or else into an arena, or malloc-ed memory if ar==NULL.
+ * Returns NULL on EOF, as getxstr() does.
+ */
+
+local void *getxarena(arenaptr ar, stream str, int nbyt, char *tbuf)
+{
+    char buf[MaxXLen], *b0, *bp, *res;
+    int i, ch;
+    bool more;
+
+    b0 = bp = tbuf != NULL ? tbuf : buf;
+    do {					/* read up to n 0 bytes     */
+	more = FALSE;
+	for (i = 0; i < nbyt; i++) {
+	    if (bp >= b0 + MaxXLen)
+		error("getxarena: buffer overflow");
+	    ch = getc(str);
+	    if (ch == EOF)			/*   no string after all    */
+		return (NULL);
+	    *bp = (char) ch;
+	    if (*bp++ != 0)
+		more = TRUE;
+	}
+    } while (more);
+    if (tbuf != NULL)
+	return (tbuf);
+    res = (char *) ar_alloc(ar, bp - buf);
+    memcpy(res, buf, bp - buf);
+    return (res);
+}
+
+/*
+ * AR_GET: an empty arena for the next top level item of a stream.
+ */
+
+local arenaptr ar_get(strstkptr sspt)
+{
+    arenaptr ar;
+
+    ar = sspt->ss_arfree;
+    if (ar != NULL)				/* reuse one given back     */
+	sspt->ss_arfree = ar->ar_next;
+    else {
+	ar = (arenaptr) allocate(sizeof(arena));
+	ar->ar_blk = (arblkptr) allocate(sizeof(arblk) + ArenaBlkLen);
+	ar->ar_blk->ab_next = NULL;
+	ar->ar_blk->ab_len = ArenaBlkLen;
+	ar->ar_home = &sspt->ss_arfree;
+    }
+    ar->ar_cur = ar->ar_blk;
+    ar->ar_used = 0;
+    ar->ar_owner = NULL;
+    ar->ar_next = NULL;
+    return (ar);
+}
+
+/*
+ * AR_PUT: give an arena, and everything in it, back to its stream.
+ */
+
+local void ar_put(arenaptr ar)
+{
+    ar->ar_owner = NULL;
+    ar->ar_next = *ar->ar_home;
+    *ar->ar_home = ar;
+}
+
+/*
+ * AR_FREEALL: really free the arenas given back to a stream.
+ */
+
+local void ar_freeall(strstkptr sspt)
+{
+    arenaptr ar;
+    arblkptr ab;
+
+    while ((ar = sspt->ss_arfree) != NULL) {
+	sspt->ss_arfree = ar->ar_next;
+	while ((ab = ar->ar_blk) != NULL) {
+	    ar->ar_blk = ab->ab_next;
+	    free(ab);
+	}
+	free(ar);
+    }
+}
+
+/*
+ * AR_ALLOC: n bytes in an arena, or from malloc if ar is NULL.  The
+ * blocks of an arena that was used before are filled again in order;
+ * a new one is added only when the next one is too small.
+ */
+
+local void *ar_alloc(arenaptr ar, size_t n)
+{
+    arblkptr ab;
+    char *res;
+
+    if (ar == NULL)
+	return allocate(n);
+    n = (n + ArenaAlign - 1) & ~((size_t) ArenaAlign - 1);
+    if (ar->ar_used + n > ar->ar_cur->ab_len) {	/* no room left in block?   */
+	ab = ar->ar_cur->ab_next;
+	if (ab == NULL || ab->ab_len < n) {	/*   add a block after it   */
+	    ab = (arblkptr) allocate(sizeof(arblk) + MAX(n, ArenaBlkLen));
+	    ab->ab_len = MAX(n, ArenaBlkLen);
+	    ab->ab_next = ar->ar_cur->ab_next;
+	    ar->ar_cur->ab_next = ab;
+	}
+	ar->ar_cur = ab;
+	ar->ar_used = 0;
+    }
+    res = (char *) &ar->ar_cur->ab_align + ar->ar_used;
+    ar->ar_used += n;
+    return (res);
+}
+
 /************************************************************************/
 /*                             FINDING                                  */
 /************************************************************************/
@@ -1468,53 +2119,396 @@ local string findtype(string *a, string type)
     return NULL;
 }
 
+/************************************************************************/
+/*                             ITEM INDEX                               */
+/************************************************************************/
+
+/*
+ * GET_INDEX: build an index of the top level items of an input stream,
+ * recording their tag, type, dims, position, length and (for sets) the
+ * first Time item found inside. It is then possible to jump to an item
+ * with get_index_seek() or get_index_time(), instead of reading through
+ * all the previous ones.  A valid sidecar file <name>.toc is used if
+ * present, and if save=TRUE a new one is written.
+ * Returns the number of items indexed, or -1 if the stream cannot
+ * be indexed, e.g. because it is a pipe.
+ */
+
+#define IndexTimeTag  "Time"
+
+int get_index(stream str, bool save)
+{
+    strstkptr sspt;
+    struct stat st;
+    string name;
+
+    sspt = findstream(str);			/* lookup associated entry  */
+    if (sspt->ss_idx != NULL)			/* already known ?          */
+	return sspt->ss_nidx;
+    if (fstat(fileno(str), &st) < 0 || ! S_ISREG(st.st_mode))
+	return -1;				/* need a seekable file     */
+    name = strname(str);			/* NULL or - for stdin      */
+    if (name != NULL && *name == '-')
+	name = NULL;
+    if (name == NULL || ! ix_load(sspt, name, &st)) {
+	ix_build(sspt);				/* scan the whole file      */
+	if (save && name != NULL)
+	    ix_save(sspt, name, &st);
+    }
+    dprintf(1,"get_index: %d items in %s\n", sspt->ss_nidx,
+	    name == NULL ? "-" : name);
+    return sspt->ss_nidx;
+}
+
+/*
+ * GET_INDEX_COUNT: number of top level items with a given tag (or
+ * all of them if tag==NULL); -1 if the stream cannot be indexed.
+ */
+
+int get_index_count(stream str, string tag)
+{
+    strstkptr sspt;
+    int i, n = 0;
+
+    if (get_index(str, FALSE) < 0)
+	return -1;
+    sspt = findstream(str);
+    for (i = 0; i < sspt->ss_nidx; i++)
+	if (tag == NULL || streq(tag, sspt->ss_idx[i].ix_tag))
+	    n++;
+    return n;
+}
+
+/*
+ * GET_INDEX_SEEK: position the input in front of the n-th (0=first)
+ * top level item with a given tag; n<0 counts from the end (-1=last).
+ * Returns FALSE, leaving the input alone, if there is no such item.
+ */
+
+bool get_index_seek(stream str, string tag, int n)
+{
+    strstkptr sspt;
+    int i, cnt;
+
+    cnt = get_index_count(str, tag);
+    if (cnt < 0)
+	return FALSE;
+    if (n < 0)
+	n += cnt;
+    if (n < 0 || n >= cnt)
+	return FALSE;
+    sspt = findstream(str);
+    for (i = 0; i < sspt->ss_nidx; i++)
+	if (tag == NULL || streq(tag, sspt->ss_idx[i].ix_tag))
+	    if (n-- == 0) {
+		ix_goto(sspt, i);
+		return TRUE;
+	    }
+    return FALSE;				/* never reached */
+}
+
+/*
+ * GET_INDEX_TIME: position the input in front of the first top level item
+ * with a given tag whose Time is at least t. Items without a Time are never
+ * skipped over. Returns FALSE, leaving the input alone, if none was found.
+ */
+
+bool get_index_time(stream str, string tag, double t)
+{
+    strstkptr sspt;
+    stridxptr ix;
+    int i;
+
+    if (get_index(str, FALSE) < 0)
+	return FALSE;
+    sspt = findstream(str);
+    for (i = 0, ix = sspt->ss_idx; i < sspt->ss_nidx; i++, ix++) {
+	if (tag != NULL && ! streq(tag, ix->ix_tag))
+	    continue;
+	if (! ix->ix_hastime || ix->ix_time >= t) {
+	    ix_goto(sspt, i);
+	    return TRUE;
+	}
+    }
+    return FALSE;
+}
+
+local void ix_goto(strstkptr sspt, int i)
+{
+    if (sspt->ss_stp != -1)
+	error("get_index: can only seek at top level");
+    if (sspt->ss_stk[0] != NULL) {		/* drop pending item        */
+	freeitem(sspt->ss_stk[0], TRUE);
+	sspt->ss_stk[0] = NULL;
+    }
+    safeseek(sspt->ss_str, sspt->ss_idx[i].ix_pos, 0);
+}
+
+/*
+ * IX_BUILD: scan all top level items, and return to where we were.
+ * Large data are skipped, not read (see getdat).
+ */
+
+local void ix_build(strstkptr sspt)
+{
+    stream str = sspt->ss_str;
+    itemptr ipt;
+    stridxptr ix;
+    off_t oldpos, pos;
+    int nmax = 64, n = 0;
+
+    ix = (stridxptr) allocate(nmax * sizeof(stridx));
+    oldpos = ftello(str);
+    safeseek(str, 0, 0);
+    for (;;) {
+	pos = ftello(str);
+	ipt = readitem(sspt, NULL);		/* whole item or set        */
+	if (ipt == NULL)
+	    break;
+	if (n == nmax) {
+	    nmax *= 2;
+	    ix = (stridxptr) reallocate(ix, nmax * sizeof(stridx));
+	}
+	memset(&ix[n], 0, sizeof(stridx));
+	ix[n].ix_pos = pos;
+	ix[n].ix_len = ftello(str) - pos;
+	strncpy(ix[n].ix_tag, ItemTag(ipt), MaxTagLen);
+	strncpy(ix[n].ix_typ, ItemTyp(ipt), 3);
+	if (ItemDim(ipt) != NULL)
+	    memcpy(ix[n].ix_dim, ItemDim(ipt),
+		   xstrlen(ItemDim(ipt), sizeof(int)) * sizeof(int));
+	ix[n].ix_hastime = ix_findtime(ipt, str, &ix[n].ix_time);
+	freeitem(ipt, TRUE);
+	n++;
+    }
+    safeseek(str, oldpos, 0);
+    sspt->ss_idx = ix;
+    sspt->ss_nidx = n;
+}
+
+local bool ix_findtime(itemptr ipt, stream str, double *t)
+{
+    itemptr *ivp;
+    float f;
+
+    if (ItemTyp(ipt) == ty_set) {		/* depth first search       */
+	for (ivp = (itemptr *) ItemDat(ipt); *ivp != NULL; ivp++)
+	    if (ix_findtime(*ivp, str, t))
+		return TRUE;
+	return FALSE;
+    }
+    if (ItemDim(ipt) != NULL || ! streq(ItemTag(ipt), IndexTimeTag))
+	return FALSE;
+    if (ItemTyp(ipt) == ty_double)
+	copydata(t, 0, 1, ipt, str);
+    else if (ItemTyp(ipt) == ty_float) {
+	copydata(&f, 0, 1, ipt, str);
+	*t = f;
+    } else
+	return FALSE;
+    return TRUE;
+}
+
+/*
+ * IX_LOAD, IX_SAVE: read and write the sidecar index file. It is only
+ * used if the size and modification time of the data file still match;
+ * the time is compared to the nanosecond, since a file rewritten within
+ * the same second often has the same size.
+ */
+
+local bool ix_load(strstkptr sspt, string name, struct stat *st)
+{
+    char tocname[MAXPATHLEN];
+    tochdr hdr;
+    stream tstr;
+
+    snprintf(tocname, MAXPATHLEN, "%s.toc", name);
+    if ((tstr = fopen(tocname, "r")) == NULL)
+	return FALSE;
+    if (fread(&hdr, sizeof(tochdr), 1, tstr) != 1 ||
+	  strncmp(hdr.toc_magic, TocMagic, 8) != 0 ||
+	  hdr.toc_idxlen != sizeof(stridx) ||
+	  hdr.toc_size != st->st_size || hdr.toc_mtime != st->st_mtime ||
+	  hdr.toc_mtimens != MtimeNs(st)) {
+	dprintf(1,"ix_load: ignoring stale or foreign %s\n", tocname);
+	fclose(tstr);
+	return FALSE;
+    }
+    sspt->ss_idx = (stridxptr) allocate((hdr.toc_nidx + 1) * sizeof(stridx));
+    if (fread(sspt->ss_idx, sizeof(stridx), hdr.toc_nidx, tstr) != hdr.toc_nidx) {
+	warning("ix_load: short read on %s", tocname);
+	free(sspt->ss_idx);
+	sspt->ss_idx = NULL;
+	fclose(tstr);
+	return FALSE;
+    }
+    sspt->ss_nidx = hdr.toc_nidx;
+    fclose(tstr);
+    dprintf(1,"ix_load: using %s\n", tocname);
+    return TRUE;
+}
+
+local void ix_save(strstkptr sspt, string name, struct stat *st)
+{
+    char tocname[MAXPATHLEN];
+    tochdr hdr;
+    stream tstr;
+
+    snprintf(tocname, MAXPATHLEN, "%s.toc", name);
+    if ((tstr = fopen(tocname, "w")) == NULL) {
+	dprintf(0,"[ix_save: cannot write %s]\n", tocname);
+	return;
+    }
+    memset(&hdr, 0, sizeof(tochdr));
+    memcpy(hdr.toc_magic, TocMagic, 8);
+    hdr.toc_idxlen = sizeof(stridx);
+    hdr.toc_nidx = sspt->ss_nidx;
+    hdr.toc_size = st->st_size;
+    hdr.toc_mtime = st->st_mtime;
+    hdr.toc_mtimens = MtimeNs(st);
+    if (fwrite(&hdr, sizeof(tochdr), 1, tstr) != 1 ||
+	  fwrite(sspt->ss_idx, sizeof(stridx), sspt->ss_nidx, tstr) != sspt->ss_nidx)
+	warning("ix_save: error writing %s", tocname);
+    fclose(tstr);
+}
+
 /************************************************************************/
 /*                             STREAM TABLE                             */
 /************************************************************************/
 
 /*
- * FINDSTREAM: scan strtable for entry associated with stream.
- * If none is found, a new entry is initialized.
- * The table is small, no hash table is needed, although a quick
- * lookup is provided by first comparing it with the one used in 
- * the previous findstream() call.
- * A small degrading in performance may be the result in alternating I/O
+ * FINDSTREAM: return the entry associated with a stream, and initialize
+ * a new one if there is none yet.  Entries are found through the file
+ * descriptor of the stream, in pages of FdPageLen entries that are
+ * allocated when first needed and never move, so a lookup is a few
+ * loads, no matter how many streams are open or in what order they are
+ * used, and needs no lock.  Only making a new entry is serialized, so
+ * threads that each own their streams can do I/O at the same time.
+ * An entry is kept after strclose() and reused for the next stream on
+ * the same descriptor; if its stream was fclose()d instead, what the
+ * entry still holds is released then.
  */
 
-local strstk strtable[StrTabLen], *last = NULL;
+local strstkptr *fdpage[FdPages];		/* the stream table	    */
+#if defined(PREFETCH)
+local pthread_mutex_t fdlock = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
 local strstkptr findstream(stream str)
 {
-    strstkptr stfree, sspt;
+    strstkptr sspt;
 
-    if (last!=NULL && last->ss_str == str)
-        return(last);
-    stfree = NULL;				/* remember free slot	    */
-    for (sspt = strtable; sspt < strtable+StrTabLen; sspt++) {
-						/* loop over the table	    */
-	if (sspt->ss_str == str) {		/*   found that stream?	    */
-            last = sspt;
-	    return (sspt);			/*     then return slot	    */
-        }
-	if (stfree == NULL && sspt->ss_str == NULL)
-						/*   first empty slot?	    */
-	    stfree = sspt;			/*     save free slot ptr   */
+    sspt = ss_lookup(str);
+    if (sspt == NULL)				/* new stream?		    */
+	return ss_create(str);
+#if defined(PREFETCH)
+    if (sspt->ss_pfbusy) pf_wait(sspt);		/* catch up with reader     */
+#endif
+    return (sspt);
+}
+
+/*
+ * SS_LOOKUP: the entry of a stream, or NULL if it has none; this does
+ * not wait for a prefetch thread, which may be the caller.
+ */
+
+local strstkptr ss_lookup(stream str)
+{
+    int fd = fileno(str);
+    strstkptr *page, sspt;
+
+    if (fd < 0 || fd >= FdPages*FdPageLen)
+	return NULL;
+    page = fdpage[fd / FdPageLen];
+    if (page == NULL)
+	return NULL;
+    sspt = page[fd % FdPageLen];
+    return (sspt != NULL && sspt->ss_str == str ? sspt : NULL);
+}
+
+local strstkptr ss_create(stream str)
+{
+    int fd = fileno(str);
+    strstkptr *page, stfree;
+
+    if (fd < 0)
+	error("findstream: stream has no file descriptor");
+    if (fd >= FdPages*FdPageLen)
+	error("findstream: file descriptor %d too large, max %d",
+	      fd, FdPages*FdPageLen - 1);
+#if defined(PREFETCH)
+    pthread_mutex_lock(&fdlock);
+#endif
+    page = fdpage[fd / FdPageLen];
+    if (page == NULL) {				/* first on this page?	    */
+	page = (strstkptr *) allocate(FdPageLen * sizeof(strstkptr));
+	memset(page, 0, FdPageLen * sizeof(strstkptr));
+	fdpage[fd / FdPageLen] = page;
+    }
+    stfree = page[fd % FdPageLen];
+    if (stfree == NULL) {			/* first on this descriptor */
+	stfree = (strstkptr) allocate(sizeof(strstk));
+	stfree->ss_arfree = NULL;		/*   no arenas yet          */
+	page[fd % FdPageLen] = stfree;
+    }
+#if defined(PREFETCH)
+    pthread_mutex_unlock(&fdlock);
+#endif
+    if (stfree->ss_str != NULL) {		/* fclose()d, not strclose()d */
+	dprintf(1,"findstream: fd=%d reused without strclose\n", fd);
+#if defined(PREFETCH)
+	if (stfree->ss_pfbusy) pf_wait(stfree);
+#endif
+	ss_release(stfree);
     }
-    if (stfree == NULL)				/* no free slot left?	    */
-      error("findstream: no free slots, StrTabLen=%d",StrTabLen);
 
     stfree->ss_str = str;			/* init saved stream	    */
     stfree->ss_stk[0] = NULL;			/* clear pending item	    */
     stfree->ss_stp = -1;			/* empty item stack	    */
     stfree->ss_seek = TRUE;			/* permit seeks on stream   */
+    stfree->ss_swap = FALSE;			/* native byte order	    */
+    stfree->ss_arena = NULL;			/* not reading an item      */
+    stfree->ss_zip = zip_env();			/* compress output ?        */
 #if defined(RANDOM)
     stfree->ss_ran = NULL;                      /* mark as no item random   */
+    stfree->ss_rancop = NULL;
     stfree->ss_pos = 0L;                        /* set at start of file     */
 #endif
-    last = stfree;                              /* mark for quick access    */
+#if defined(MMAPIO)
+    ss_mmap(stfree);				/* map it if we can         */
+#endif
+    stfree->ss_idx = NULL;			/* no index built yet       */
+    stfree->ss_nidx = 0;
+#if defined(PREFETCH)
+    stfree->ss_pfbusy = FALSE;			/* no reader thread yet     */
+    stfree->ss_pfitem = NULL;
+    stfree->ss_pf = pf_wanted(stfree);		/* but maybe later          */
+#endif
     return (stfree);				/* return new slot	    */
 }
 
+/*
+ * SS_RELEASE: free what an entry still holds of its last stream: the
+ * pending or partly read item, the map, the index and the arenas.
+ */
+
+local void ss_release(strstkptr sspt)
+{
+    if (sspt->ss_stk[0] != NULL)		/* anything on the stack?   */
+	freeitem(sspt->ss_stk[0], TRUE);	/*   free bottom item	    */
+    sspt->ss_stk[0] = NULL;
+    sspt->ss_stp = -1;
+#if defined(MMAPIO)
+    ss_munmap(sspt);				/* views into it are gone   */
+#endif
+    if (sspt->ss_idx != NULL) {			/* drop any index           */
+	free(sspt->ss_idx);
+	sspt->ss_idx = NULL;
+    }
+    sspt->ss_nidx = 0;
+    ar_freeall(sspt);				/* free the item arenas     */
+}
+
 local void ss_push(strstkptr sspt, itemptr ipt)
 {
     if (sspt->ss_stp++ == SetStkLen)		/* check stack overflow	    */
@@ -1528,26 +2522,177 @@ local void ss_pop(strstkptr sspt)
 	error("ss_pop: stream stack underflow");
     sspt->ss_stp--;				/* bump stack pointer	    */
 }
+
+#if defined(MMAPIO)
+/*
+ * SS_MMAP: map an input stream in memory, if it is a regular file opened
+ * for reading only. Items will then point into the map instead of being
+ * read (see getdat), and get_data() simply copies them out of the map.
+ * Pipes, sockets, and files opened for (also) writing are left alone.
+ */
+
+local void ss_mmap(strstkptr sspt)
+{
+    struct stat st;
+    int fd, flags;
+    void *map;
+
+    sspt->ss_map = NULL;
+    sspt->ss_maplen = 0;
+    fd = fileno(sspt->ss_str);
+    flags = fcntl(fd, F_GETFL);
+    if (flags == -1 || (flags & O_ACCMODE) != O_RDONLY)
+	return;					/* input only               */
+    if (fstat(fd, &st) < 0 || ! S_ISREG(st.st_mode) || st.st_size <= 0)
+	return;					/* regular files only       */
+    map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+	dprintf(1,"ss_mmap: cannot map fd=%d, using stdio\n", fd);
+	return;
+    }
+    (void) madvise(map, (size_t) st.st_size, MADV_SEQUENTIAL);
+    sspt->ss_map = (char *) map;
+    sspt->ss_maplen = (size_t) st.st_size;
+    dprintf(1,"ss_mmap: mapped fd=%d, %ld bytes\n", fd, (long) st.st_size);
+}
+
+local void ss_munmap(strstkptr sspt)
+{
+    if (sspt->ss_map == NULL) return;
+    if (munmap(sspt->ss_map, sspt->ss_maplen) < 0)
+	warning("ss_munmap: error unmapping %ld bytes", (long) sspt->ss_maplen);
+    sspt->ss_map = NULL;
+    sspt->ss_maplen = 0;
+}
+#endif
+
+#if defined(PREFETCH)
+/*
+ * PREFETCH: with NEMOPREFETCH=1 in the environment, every input stream
+ * gets a reader thread after each completed top level item (get_tes or
+ * skip_item), which reads the next item while the caller is still busy
+ * with the current one. Deferred data is not read into core, which
+ * would defeat chunked access: pages of mapped files (or the compressed
+ * blocks) are touched so they are resident, otherwise the kernel is
+ * asked to read ahead with posix_fadvise(WILLNEED). The
+ * next findstream() on that stream waits for the thread, and the item
+ * it read becomes the pending item, as if nextitem() had read it.
+ * Because the stream is shared with the thread, the application should
+ * not do its own stdio on it (e.g. rewind) right after a get_tes().
+ */
+
+local bool pf_wanted(strstkptr sspt)
+{
+    permanent int pfenv = -1;
+    string cp;
+    int flags;
+
+    if (pfenv < 0) {
+	cp = getenv("NEMOPREFETCH");
+	pfenv = (cp != NULL && atoi(cp) > 0) ? 1 : 0;
+    }
+    if (pfenv == 0)
+	return FALSE;
+    flags = fcntl(fileno(sspt->ss_str), F_GETFL);
+    return flags != -1 && (flags & O_ACCMODE) == O_RDONLY;	/* input only */
+}
+
+local void pf_start(strstkptr sspt)
+{
+    if (! sspt->ss_pf || sspt->ss_pfbusy || sspt->ss_stp != -1 ||
+	  sspt->ss_stk[0] != NULL)
+	return;					/* nothing to do            */
+    if (pthread_create(&sspt->ss_pfthr, NULL, pf_read, sspt) != 0) {
+	dprintf(1,"pf_start: no thread, prefetch disabled\n");
+	sspt->ss_pf = FALSE;
+	return;
+    }
+    sspt->ss_pfbusy = TRUE;
+    dprintf(2,"pf_start: reading ahead on fd=%d\n", fileno(sspt->ss_str));
+}
+
+local void pf_wait(strstkptr sspt)
+{
+    if (pthread_join(sspt->ss_pfthr, NULL) != 0)
+	error("pf_wait: cannot join reader thread");
+    sspt->ss_pfbusy = FALSE;
+    sspt->ss_stk[0] = sspt->ss_pfitem;		/* now the pending item     */
+    sspt->ss_pfitem = NULL;
+    if (sspt->ss_stk[0] == NULL)		/* nothing more to read     */
+	sspt->ss_pf = FALSE;
+}
+
+local void *pf_read(void *arg)
+{
+    strstkptr sspt = (strstkptr) arg;
+    itemptr ipt;
+
+    ipt = readitem(sspt, NULL);			/* whole item or set        */
+    if (ipt != NULL)
+	pf_load(ipt, sspt);			/* and the data it defers   */
+    sspt->ss_pfitem = ipt;
+    return NULL;
+}
+
+local void pf_load(itemptr ipt, strstkptr sspt)
+{
+    itemptr *ivp;
+    size_t dlen, i;
+    volatile char touch;
+    char *buf;
+
+    if (ItemTyp(ipt) == ty_set) {
+	for (ivp = (itemptr *) ItemDat(ipt); *ivp != NULL; ivp++)
+	    pf_load(*ivp, sspt);
+	return;
+    }
+    if (ItemDat(ipt) != NULL || (dlen = datlen(ipt, 0)) == 0)
+	return;					/* already in core          */
+    buf = NULL;
+    if (ItemZip(ipt) != NULL) {			/* compressed blocks only   */
+	dlen = ItemZip(ipt)->zp_off[ItemZip(ipt)->zp_nblk];
+	buf = ItemZip(ipt)->zp_map;
+    }
+#if defined(MMAPIO)
+    else
+	buf = (char *) ItemMap(ipt);
+#endif
+    if (buf != NULL) {				/* fault the pages in       */
+	for (i = 0; i < dlen; i += 4096)
+	    touch = buf[i];
+	touch = buf[dlen-1];
+	(void) touch;
+	return;
+    }
+#if defined(POSIX_FADV_WILLNEED)
+    (void) posix_fadvise(fileno(sspt->ss_str), ItemPos(ipt), (off_t) dlen,
+			 POSIX_FADV_WILLNEED);	/* ask the kernel to read   */
+#endif
+}
+#endif
 
 /************************************************************************/
 /*			USER STREAM CONTROL FUNCTIONS			*/
 /************************************************************************/
 
 /*
- * STRCLOSE: remove stream from strtable, free associated items, and close.
+ * STRCLOSE: remove stream from the stream table, free associated items, and close.
  */
 
 void strclose(stream str)
 {
     strstkptr sspt;
+    stream *set;
+    int k, nset;
 
+    set = strfileset(str, &nset);		/* first of a file set?     */
+    for (k = 1; k < nset; k++)			/*   close the others too   */
+	strclose(set[k]);
     sspt = findstream(str);			/* lookup associated entry  */
     if (sspt->ss_stp != -1)			/* dont close if incomplete */
 	error("strclose: not at top level");
-    if (sspt->ss_stk[0] != NULL)		/* anything on the stack?   */
-	freeitem(sspt->ss_stk[0], TRUE);	/*   free bottom item	    */
-    sspt->ss_str = NULL;			/* remove from strtable	    */
-    last = NULL;                                /* also removed quick access*/
+    ss_release(sspt);				/* free items, map, index   */
+    sspt->ss_str = NULL;			/* remove from the table    */
     strdelete(str,FALSE);                       /* delete file if scratch   */
     fclose(str);				/* and close it up for sure */
 }
@@ -12,11 +12,24 @@
  *   3.5   8-jun-13   element counter type fixed to handle > 2B
  *   3.6  11-apr-19   increase StrTabLen from 64 to 1024 (Linux now handles 1024)
  *                    check with  'ulimit -n'
+ *   3.7  16-oct-26   memory mapped input for seekable regular files
+ *        16-oct-26   index of top level items, optionally saved as sidecar
+ *        16-oct-26   optional reader thread to prefetch the next top level item
+ *                    and the swap flag kept per stream (ss_swap)
+ *        16-oct-26   size_t offsets in the copy routines, coerced random access
+ *        16-oct-26   compressed items (ZipMagic)
+ *   3.8  16-oct-26   stream table indexed by file descriptor
+ *        16-oct-26   input items in an arena per top level item, interned types
  */
  
 #define RANDOM  /* allow random access */
 #define CHKSWAP /* allow mixed endian datasets - 
                    this can be dangerous if you are multi-plexing them */
+#if !defined(__MINGW32__)
+#define MMAPIO  /* map seekable regular input files, data is read in place */
+#define PREFETCH /* allow a reader thread per input stream, see NEMOPREFETCH */
+#include <pthread.h>
+#endif
 
 /*
  * New-style magic numbers, for (bigendian) FITS type machines (like SUN)
@@ -25,6 +38,56 @@
 
 #define SingMagic  ((011<<8) + 0222)		/* singular items */
 #define PlurMagic  ((013<<8) + 0222)		/* plural items */
+#define ZipMagic   ((015<<8) + 0222)		/* compressed plural items */
+
+/*
+ * ZIPINFO: block structure of a compressed item. On disk the header of
+ * a ZipMagic item is followed by 3 ints (elements per block, number of
+ * blocks, flags) and the compressed length of each block (an int); then
+ * the blocks themselves. A block is stored as is if it did not compress.
+ */
+
+#define ZipBlockLen  65536          /* bytes in an uncompressed block */
+#define ZipMinLen     4096          /* smaller items are not compressed */
+#define ZipShuffle      01          /* flag: bytes shuffled before LZ */
+
+typedef struct {
+  int    zp_blkelt;               /* elements per block */
+  int    zp_nblk;                 /* number of blocks */
+  int    zp_flags;                /* ZipShuffle, and (flags>>8) bits kept */
+  off_t *zp_off;                  /* nblk+1 block offsets from ItemPos */
+  char  *zp_map;                  /* blocks in a mapped input file, or NULL */
+  bool   zp_swap;                 /* data need byte swapping */
+  int    zp_blk;                  /* block now in zp_buf, or -1 */
+  char  *zp_buf;                  /* one uncompressed block */
+  char  *zp_tmp;                  /* scratch for one (de)compressed block */
+} zipinfo, *zipinfoptr;
+
+/*
+ * ARENA: memory for the items, tags, dimensions and set vectors of one
+ * top level input item, handed out in order and all given back at once
+ * when that item is freed.  The blocks are kept and the arena goes on
+ * a free list of its stream, so reading the next item allocates nothing.
+ */
+
+#define ArenaBlkLen  4096           /* bytes in a normal arena block */
+#define ArenaAlign      8           /* alignment of everything in it */
+#define MaxXLen      1024           /* longest tag or dims, in bytes, incl. 0's */
+
+typedef struct arblk {
+  struct arblk *ab_next;          /* next block, kept for reuse */
+  size_t  ab_len;                 /* bytes of room after this header */
+  double  ab_align;               /* start of room, aligned */
+} arblk, *arblkptr;
+
+typedef struct arena {
+  arblkptr ar_blk;                /* first block */
+  arblkptr ar_cur;                /* block now being filled */
+  size_t  ar_used;                /* bytes used in ar_cur */
+  void   *ar_owner;               /* top level item; freeing it frees all */
+  struct arena **ar_home;         /* free list of the stream it came from */
+  struct arena *ar_next;          /* next on that free list */
+} arena, *arenaptr;
 
 /*
  * ITEM: structure representing data-token.
@@ -38,6 +101,9 @@ typedef struct {
   void  *itemdat;		/* the real goodies, if any, or NULL */
   off_t  itempos;		/* where the item began in stream (i/o) */
   off_t  itemoff;               /* RAN/SEQ offset where the current data ptr is */
+  void  *itemmap;               /* data inside a mapped input file, or NULL */
+  zipinfoptr itemzip;           /* compressed data, or NULL */
+  arenaptr itemarena;           /* arena of item, tag, dims and set vector, or NULL */
 } item, *itemptr;    
 
 #define ItemTyp(ip)  ((ip)->itemtyp)
@@ -47,24 +113,88 @@ typedef struct {
 #define ItemDat(ip)  ((ip)->itemdat)
 #define ItemPos(ip)  ((ip)->itempos)
 #define ItemOff(ip)  ((ip)->itemoff)
+#define ItemMap(ip)  ((ip)->itemmap)
+#define ItemZip(ip)  ((ip)->itemzip)
+#define ItemArena(ip) ((ip)->itemarena)
 
 
+/*
+ * STRIDX: index entry for a top level item, see get_index().
+ *         The sidecar file (<name>.toc) is a TOCHDR followed by these.
+ */
+
+typedef struct {
+  off_t  ix_pos;                /* where the item header starts */
+  off_t  ix_len;                /* length on disk, incl. header and any set */
+  char   ix_tag[MaxTagLen+1];   /* tag of the item */
+  char   ix_typ[4];             /* type string of the item */
+  int    ix_dim[MaxVecDim+1];   /* dimensions, zero terminated */
+  int    ix_hastime;            /* was a Time found in the item? */
+  double ix_time;               /* first Time found in the item (a set) */
+} stridx, *stridxptr;
+
+#define TocMagic  "NEMOTOC2"
+
+typedef struct {
+  char   toc_magic[8];          /* TocMagic */
+  int    toc_idxlen;            /* sizeof(stridx) of the writer */
+  int    toc_nidx;              /* number of entries that follow */
+  off_t  toc_size;              /* size of the indexed file */
+  time_t toc_mtime;             /* modification time of the indexed file */
+  long   toc_mtimens;           /* and its nanoseconds, where known */
+} tochdr;
+
+#if defined(__APPLE__)
+#define MtimeNs(st)  ((long) (st)->st_mtimespec.tv_nsec)
+#elif defined(__MINGW32__)
+#define MtimeNs(st)  0L
+#else
+#define MtimeNs(st)  ((long) (st)->st_mtim.tv_nsec)
+#endif
+
+/* PROC_COPY's :
+ *    replaces the old "proc" type unsafe stuff  (for 
+ *    good practice for C, but needed for C++)
+ *    offset and length are in elements of the source item
+ */
+typedef void (*copyproc)  (void *,   size_t, size_t, itemptr, stream);
+typedef void (*copyproc_d)(double *, size_t, size_t, itemptr, stream);
+typedef void (*copyproc_f)(float *,  size_t, size_t, itemptr, stream);
+
 /*
  * STRSTK: structure used to associate stream with item stack.
  */
 
 #define SetStkLen    8
-#define StrTabLen 1024
+#define FdPageLen  256	/* stream table entries allocated at a time */
+#define FdPages   1024	/* so file descriptors up to 256K are handled */
 
 typedef struct {
   stream  ss_str;                 /* pointer to stdio stream */
   itemptr ss_stk[SetStkLen+1];    /* stack of assoc. items (extra dummy) */
   int     ss_stp;		  /* item stack pointer */
   bool    ss_seek;		  /* permit seeks on this stream ? */
+  bool    ss_swap;		  /* last header read was byte swapped ? */
+  arenaptr ss_arena;              /* arena of the top level item being read */
+  arenaptr ss_arfree;             /* arenas given back, for reuse */
+  int     ss_zip;                 /* compress output: -1 no, else bits kept */
 #if defined(RANDOM)
   int     ss_mode;                /* mode: 0=none 1=(still)sequential 2=random */
   off_t   ss_pos;                 /* tail of file, in case random access */
   itemptr ss_ran;                 /* pointer to random access item */
+  copyproc ss_rancop;             /* and how to copy (and coerce) its data */
+#endif
+#if defined(MMAPIO)
+  char   *ss_map;                 /* read-only mapping of the whole file, or NULL */
+  size_t  ss_maplen;              /* length of the mapping in bytes */
+#endif
+  stridxptr ss_idx;               /* index of top level items, or NULL */
+  int     ss_nidx;                /* number of entries in the index */
+#if defined(PREFETCH)
+  bool    ss_pf;                  /* prefetch the next top level item ? */
+  bool    ss_pfbusy;              /* reader thread is running */
+  pthread_t ss_pfthr;             /* the reader thread */
+  itemptr ss_pfitem;              /* what it read, or NULL at EOF */
 #endif
 } strstk, *strstkptr;
 
@@ -77,14 +207,6 @@ typedef struct {
     int    tl_len;			/* length of elements in bytes      */
 } typlen, *typlenptr;
 
-/* PROC_COPY's :
- *    replaces the old "proc" type unsafe stuff  (for 
- *    good practice for C, but needed for C++)
- */
-typedef void (*copyproc)  (void *,   int, int, itemptr, stream);
-typedef void (*copyproc_d)(double *, int, int, itemptr, stream);
-typedef void (*copyproc_f)(float *,  int, int, itemptr, stream);
-
 
 /*
  * Function declarations.
@@ -96,33 +218,61 @@ local bool writeitem   ( stream str, itemptr ipt );
 local bool putitem     ( stream str, itemptr ipt );
 local bool puthdr      ( stream str, itemptr ipt );
 local bool putdat      ( stream str, itemptr ipt );
+local bool putzip      ( stream str, itemptr ipt );
+local bool zipwanted   ( stream str, itemptr ipt, zipinfoptr zp );
 local itemptr scantag  ( strstkptr sspt, string tag );
 local itemptr nextitem ( strstkptr sspt );
 local itemptr finditem ( strstkptr sspt, string tag );
-local itemptr readitem ( stream str, itemptr first );
-local itemptr getitem  ( stream str );
-local itemptr gethdr   ( stream str );
-local void getdat      ( itemptr ipt, stream str );
+local itemptr readitem ( strstkptr sspt, itemptr first );
+local itemptr getitem  ( strstkptr sspt );
+local itemptr gethdr   ( strstkptr sspt );
+local void getdat      ( itemptr ipt, strstkptr sspt );
+local void getzip      ( itemptr ipt, strstkptr sspt );
+local void zipexpand   ( itemptr ipt, stream str, int b, char *dst );
+local char *zipspan    ( itemptr ipt, stream str, size_t off, size_t len, size_t *n );
+local void freezip     ( zipinfoptr zp );
+local int  zip_env     ( void );
 local copyproc copyfun ( string srctyp, string destyp );
-local void copydata    ( void *dat,   int off, int len, itemptr ipt, stream str );
-local void copydata_f2d( double *dat, int off, int len, itemptr ipt, stream str );
-local void copydata_d2f( float  *dat, int off, int len, itemptr ipt, stream str );
-local float getflt     ( stream str );
-local double getdbl    ( stream str );
+local void copydata    ( void *dat,   size_t off, size_t len, itemptr ipt, stream str );
+local void copydata_f2d( double *dat, size_t off, size_t len, itemptr ipt, stream str );
+local void copydata_d2f( float  *dat, size_t off, size_t len, itemptr ipt, stream str );
 local void saferead    ( void *dat, int siz, int cnt, stream str );
+local void ssread      ( void *dat, int siz, int cnt, strstkptr sspt );
 local void safeseek    ( stream str, off_t offset, int key );
 local long eltcnt      ( itemptr ipt, int skp );
 local size_t datlen    ( itemptr ipt, int skp );
 local itemptr makeitem ( string typ, string tag, void *dat, int *dim );
+local itemptr newitem  ( arenaptr ar, string typ, string tag, void *dat, int *dim );
 local void freeitem    ( itemptr ipt, bool flg);
 local int baselen      ( string typ );
+local typlenptr findtl ( string typ );
+local void *getxarena  ( arenaptr ar, stream str, int nbyt, char *tbuf );
+local arenaptr ar_get  ( strstkptr sspt );
+local void ar_put      ( arenaptr ar );
+local void ar_freeall  ( strstkptr sspt );
+local void *ar_alloc   ( arenaptr ar, size_t n );
 local strstkptr findstream ( stream str );
+local strstkptr ss_lookup  ( stream str );
+local strstkptr ss_create  ( stream str );
+local void ss_release  ( strstkptr sspt );
 local void ss_push     ( strstkptr sspt, itemptr ipt );
 local void ss_pop      ( strstkptr sspt );
+#if defined(MMAPIO)
+local void ss_mmap     ( strstkptr sspt );
+local void ss_munmap   ( strstkptr sspt );
+#endif
 local string findtype  ( string *a, string type );
-
-
-#if defined(CHKSWAP)
- local bool swap=FALSE;
+#if defined(PREFETCH)
+local bool pf_wanted   ( strstkptr sspt );
+local void pf_start    ( strstkptr sspt );
+local void pf_wait     ( strstkptr sspt );
+local void *pf_read    ( void *arg );
+local void pf_load     ( itemptr ipt, strstkptr sspt );
 #endif
+local bool ix_findtime ( itemptr ipt, stream str, double *t );
+local void ix_build    ( strstkptr sspt );
+local bool ix_load     ( strstkptr sspt, string name, struct stat *st );
+local void ix_save     ( strstkptr sspt, string name, struct stat *st );
+local void ix_goto     ( strstkptr sspt, int i );
+
 
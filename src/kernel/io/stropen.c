@@ -1,4 +1,4 @@
-/* stropen(), strdelete(), strname(), strseek()
+/* stropen(), strdelete(), strname(), strseek(), strfileset()
  *
  * STROPEN: open a STDIO stream much like fopen does, with these
  * additional features: 
@@ -10,6 +10,10 @@
  * (4) a mode "s" is a scratch-file - will be deleted when
  *     strclose() is called
  * (5) names containing :// are assumed a URL
+ * (6) for input, a name with a single printf-style %d, %3d or %03d (as
+ *     in mstropen) that is not itself a file or a URL, is a file set:
+ *     name%0, name%1, ... until one does not exist (counting from 0 or 1).
+ *     The first member is returned, see strfileset() for the others.
  *
  * fopen() itself officially recognizes the following modes:
  *         r, w, a, r+, w+, a+
@@ -44,10 +48,13 @@
  *      27-Sep-10    MINGW32/WINDOWS i/o support                        jcl
  *      18-oct-10    assume unlink/dup in unistd.h                      pjt
  *      19-oct-10    unlimited number of open files                     wd
+ *      16-oct-26    file sets for input, strfileset()
+ *      16-oct-26    file sets only for a single %d conversion, not for URLs
  */
 #include <stdinc.h>
 #include <strlib.h>
 
+#include <ctype.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -76,6 +83,8 @@ local struct flist_element {
     stream str;
     bool   scratch;
     bool   seek;        /* flag to denote seekability and deletability */
+    stream *set;        /* all members, if first member of a file set */
+    int    nset;        /* number of members in the set */
     struct flist_element *next;
 } *flist = 0;           /* our internal file list for stropen/strdelete */
 
@@ -92,6 +101,9 @@ static string urlGetCommand = "curl -s";
 static string urlGetCommand = "wget -q -O -";
 #endif
 
+local stream stropen_set(const_string pattern);
+local bool setpattern(const_string name);
+
 /* stropen:
  *       name:   can also be "-", or "-num" , or "
  *	 mode:   "r"ead, "w"rite, "w!"rite on!, "a"ppend 
@@ -139,6 +151,10 @@ stream stropen(const_string name, string mode)
 	fe->str = res;
 	fe->scratch = FALSE;
 	fe->seek = FALSE;
+	fe->set = NULL;
+	fe->nset = 0;
+    } else if (inflag && setpattern(name) && stat(name,&buf) != 0) {
+        return stropen_set(name);               /* a file set */
     } else {                                    /* regular file */
         strncpy(tempname,name,MAXPATHLEN);
         if (streq(mode,"s")) {          /* scratch mode */
@@ -205,6 +221,8 @@ stream stropen(const_string name, string mode)
 	fe->str = res;
 	fe->scratch = streq(mode,"s");
 	fe->seek = canSeek;
+	fe->set = NULL;
+	fe->nset = 0;
     }
     return res;
 }
@@ -239,6 +257,7 @@ int strdelete( stream str, bool scratch)
                 }
             }
 	    free(fe->name);               /* free space for name */
+	    if (fe->set) free(fe->set);
 	    *pfe = fe->next;              /* link previous to next */
 	    free(fe);                     /* free this entry */
             return retval;
@@ -279,6 +298,87 @@ bool strseek(stream str)
 }
 
 
+/*
+ * SETPATTERN:   can name be a file set: not a URL, and the only % in it
+ *               is a single %d, %<width>d or %0<width>d conversion
+ */
+
+local bool setpattern(const_string name)
+{
+    const char *cp;
+
+    if (strstr(name,"://") != NULL)             /* URL: % is an escape */
+        return FALSE;
+    cp = strchr(name,'%');
+    if (cp == NULL || strchr(cp+1,'%') != NULL) /* none, or more than one */
+        return FALSE;
+    cp++;
+    if (*cp == '0') cp++;
+    while (isdigit((unsigned char)*cp)) cp++;
+    return *cp == 'd';
+}
+
+/*
+ * STROPEN_SET:  open all members of a file set for input, and remember
+ *               them with the first one, which is returned
+ */
+
+local stream stropen_set(const_string pattern)
+{
+    char member[MAXPATHLEN];
+    struct stat buf;
+    stream *set = NULL;
+    int first, k, nset = 0, maxset = 0;
+    fentry *fe;
+
+    for (first = 0; first < 2; first++) {       /* count from 0 or 1 */
+        snprintf(member, MAXPATHLEN, pattern, first);
+        if (stat(member, &buf) == 0) break;
+    }
+    if (first == 2)
+        error("stropen: cannot open file \"%s\" for input, nor as a file set",
+              pattern);
+    for (k = first; ; k++) {
+        snprintf(member, MAXPATHLEN, pattern, k);
+        if (stat(member, &buf) != 0) break;
+        if (nset == maxset) {
+            maxset = maxset ? 2*maxset : 16;
+            set = (stream *) reallocate(set, maxset * sizeof(stream));
+        }
+        set[nset++] = stropen(member, "r");
+    }
+    dprintf(1,"stropen: %s is a set of %d files\n", pattern, nset);
+    if (nset == 1) {                            /* no need for a set */
+        stream str = set[0];
+        free(set);
+        return str;
+    }
+    for (fe=flist; fe; fe=fe->next)
+        if (fe->str == set[0]) break;
+    fe->set = set;
+    fe->nset = nset;
+    return set[0];
+}
+
+/*
+ * STRFILESET:   members of the file set, if str is the first member of
+ *               one, and NULL otherwise; *n is the number of members
+ */
+
+stream *strfileset(stream str, int *n)
+{
+    fentry*fe;
+
+    for(fe=flist; fe; fe=fe->next)   /* check all entries */
+	if (str == fe->str) {
+            *n = fe->nset;
+            return fe->set;
+        }
+    *n = 0;
+    return NULL;
+}
+
+
 #ifdef TESTBED
 
 #include <getparam.h>
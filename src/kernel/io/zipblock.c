@@ -0,0 +1,241 @@
+/*
+ *  block compression for compressed structured file items (see filesecret.c)
+ *      zip_shuffle     group the n-th bytes of all elements together
+ *      zip_unshuffle   and undo it
+ *      zip_block       LZ77 compress a block of bytes
+ *      zip_unblock     and decompress it again
+ *      zip_truncf      round floats to fewer mantissa bits (lossy)
+ *      zip_truncd      same for doubles
+ *
+ *  Floating point and integer arrays rarely have repeated byte strings,
+ *  but after shuffling the (mostly constant) sign/exponent and high
+ *  mantissa bytes form long runs, which a simple and fast LZ coder can
+ *  find. Rounding off the low mantissa bits makes the low bytes
+ *  compressible as well.
+ *
+ *  The compressed format is a sequence of tokens: a byte with the
+ *  number of literals (high nibble) and the match length-ZipMinMatch
+ *  (low nibble), each extended with bytes of 255... if they are 15,
+ *  then the literals, and then the 2 byte (little endian) offset of
+ *  the match. The last token has literals only, and no offset.
+ *
+ *     16-oct-26  written for the compressed items in filesecret.c
+ */
+
+#include <stdinc.h>
+
+#define ZipMinMatch 4
+#define ZipHashBits 13
+#define ZipMaxOff   65535
+
+local size_t zip_putlen(unsigned char *op, size_t n);
+
+/*
+ * ZIP_SHUFFLE: dst[k*n+i] = src[i*size+k], for n elements of size bytes
+ */
+
+void zip_shuffle(void *vdst, const void *vsrc, size_t n, int size)
+{
+    unsigned char *dst = (unsigned char *) vdst;
+    const unsigned char *src = (const unsigned char *) vsrc;
+    size_t i;
+    int k;
+
+    if (size == 1) {
+	memcpy(dst, src, n);
+	return;
+    }
+    for (k = 0; k < size; k++, dst += n)
+	for (i = 0; i < n; i++)
+	    dst[i] = src[i*size + k];
+}
+
+void zip_unshuffle(void *vdst, const void *vsrc, size_t n, int size)
+{
+    unsigned char *dst = (unsigned char *) vdst;
+    const unsigned char *src = (const unsigned char *) vsrc;
+    size_t i;
+    int k;
+
+    if (size == 1) {
+	memcpy(dst, src, n);
+	return;
+    }
+    for (k = 0; k < size; k++, src += n)
+	for (i = 0; i < n; i++)
+	    dst[i*size + k] = src[i];
+}
+
+/*
+ * ZIP_BLOCK: compress len bytes from src into dst, which must have room
+ * for len bytes. Returns the compressed length, or 0 if it would not be
+ * smaller than len, in which case the block should be stored as is.
+ */
+
+size_t zip_block(void *vdst, const void *vsrc, size_t len)
+{
+    unsigned char *dst = (unsigned char *) vdst;
+    const unsigned char *src = (const unsigned char *) vsrc;
+    const unsigned char *ip, *anchor, *ref, *iend, *mlimit;
+    unsigned char *op, *token;
+    unsigned int hash[1<<ZipHashBits];
+    size_t nlit, mlen;
+    unsigned int seq;
+
+    if (len < 2*ZipMinMatch)
+	return 0;
+    memset(hash, 0, sizeof(hash));		/* 0 means: no entry        */
+    ip = anchor = src;
+    iend = src + len;
+    mlimit = iend - ZipMinMatch;
+    op = dst;
+    while (ip < mlimit) {
+	memcpy(&seq, ip, 4);
+	seq = (seq * 2654435761U) >> (32 - ZipHashBits);
+	ref = src + hash[seq];
+	hash[seq] = (unsigned int) (ip - src);
+	if (ref >= ip || ip - ref > ZipMaxOff || memcmp(ref, ip, 4) != 0) {
+	    ip++;
+	    continue;
+	}
+	mlen = ZipMinMatch;			/* got a match; extend it   */
+	while (ip + mlen < iend && ref[mlen] == ip[mlen])
+	    mlen++;
+	nlit = ip - anchor;
+	if ((op-dst) + 1 + nlit/255 + 1 + nlit + 2 + mlen/255 + 1 >= len)
+	    return 0;				/* no gain                  */
+	token = op++;
+	*token = (unsigned char) ((nlit < 15 ? nlit : 15) << 4);
+	if (nlit >= 15)
+	    op += zip_putlen(op, nlit - 15);
+	memcpy(op, anchor, nlit);
+	op += nlit;
+	*op++ = (unsigned char) ((ip - ref) & 0xff);
+	*op++ = (unsigned char) ((ip - ref) >> 8);
+	mlen -= ZipMinMatch;
+	*token |= (unsigned char) (mlen < 15 ? mlen : 15);
+	if (mlen >= 15)
+	    op += zip_putlen(op, mlen - 15);
+	ip += mlen + ZipMinMatch;
+	anchor = ip;
+    }
+    nlit = iend - anchor;			/* last literals            */
+    if ((op-dst) + 1 + nlit/255 + 1 + nlit >= len)
+	return 0;
+    token = op++;
+    *token = (unsigned char) ((nlit < 15 ? nlit : 15) << 4);
+    if (nlit >= 15)
+	op += zip_putlen(op, nlit - 15);
+    memcpy(op, anchor, nlit);
+    op += nlit;
+    return op - dst;
+}
+
+local size_t zip_putlen(unsigned char *op, size_t n)
+{
+    size_t k = 0;
+
+    while (n >= 255) {
+	op[k++] = 255;
+	n -= 255;
+    }
+    op[k++] = (unsigned char) n;
+    return k;
+}
+
+/*
+ * ZIP_UNBLOCK: decompress clen bytes from src into exactly len bytes at
+ * dst. Returns FALSE if the data are corrupt.
+ */
+
+bool zip_unblock(void *vdst, size_t len, const void *vsrc, size_t clen)
+{
+    unsigned char *dst = (unsigned char *) vdst, *op, *oend, *ref;
+    const unsigned char *ip = (const unsigned char *) vsrc, *iend = ip + clen;
+    size_t nlit, mlen, off;
+    unsigned int t;
+
+    op = dst;
+    oend = dst + len;
+    while (ip < iend) {
+	t = *ip++;
+	nlit = t >> 4;
+	if (nlit == 15)
+	    do {
+		if (ip >= iend) return FALSE;
+		nlit += *ip;
+	    } while (*ip++ == 255);
+	if (nlit > (size_t)(iend - ip) || nlit > (size_t)(oend - op))
+	    return FALSE;
+	memcpy(op, ip, nlit);
+	op += nlit;
+	ip += nlit;
+	if (ip == iend)				/* last token               */
+	    break;
+	if (iend - ip < 2)
+	    return FALSE;
+	off = ip[0] | (ip[1] << 8);
+	ip += 2;
+	mlen = t & 15;
+	if (mlen == 15)
+	    do {
+		if (ip >= iend) return FALSE;
+		mlen += *ip;
+	    } while (*ip++ == 255);
+	mlen += ZipMinMatch;
+	if (off == 0 || off > (size_t)(op - dst) || mlen > (size_t)(oend - op))
+	    return FALSE;
+	ref = op - off;				/* may overlap: byte copy   */
+	while (mlen-- > 0)
+	    *op++ = *ref++;
+    }
+    return op == oend;
+}
+
+/*
+ * ZIP_TRUNCF, ZIP_TRUNCD: round to the nearest value with only keep
+ * mantissa bits left, in situ. Inf and NaN are left alone, and values
+ * that would round up to Inf are truncated instead.
+ */
+
+void zip_truncf(float *x, size_t n, int keep)
+{
+    unsigned int u, v, half, mask;
+    int drop = 23 - keep;
+
+    if (keep <= 0 || drop <= 0)
+	return;
+    half = 1U << (drop - 1);
+    mask = ~((1U << drop) - 1);
+    while (n-- > 0) {
+	memcpy(&u, x, sizeof(u));
+	if ((u & 0x7f800000U) != 0x7f800000U) {
+	    v = (u + half) & mask;
+	    if ((v & 0x7f800000U) == 0x7f800000U)
+		v = u & mask;
+	    memcpy(x, &v, sizeof(v));
+	}
+	x++;
+    }
+}
+
+void zip_truncd(double *x, size_t n, int keep)
+{
+    unsigned long long u, v, half, mask, expo = 0x7ff0000000000000ULL;
+    int drop = 52 - keep;
+
+    if (keep <= 0 || drop <= 0)
+	return;
+    half = 1ULL << (drop - 1);
+    mask = ~((1ULL << drop) - 1);
+    while (n-- > 0) {
+	memcpy(&u, x, sizeof(u));
+	if ((u & expo) != expo) {
+	    v = (u + half) & mask;
+	    if ((v & expo) == expo)
+		v = u & mask;
+	    memcpy(x, &v, sizeof(v));
+	}
+	x++;
+    }
+}
@@ -7,9 +7,20 @@
  *
  *      output: idx[] 'pointer' array, such that x[idx[i-1]]<x[idx[i]] for
  *                    i=1..n
+ *
+ *  SORTPTR_RADIX:  same, but a (stable) LSD radix sort, in parallel with
+ *		    OpenMP, for large arrays
+ *  SELECTPTR:      partial sort: only find the positions where the
+ *		    cumulative (weighted) count reaches a number of values
+ *
+ *	16-oct-2026	added sortptr_radix and selectptr, for snapsort/snapmradii
  */
         
 #include <stdinc.h>
+#include <stdint.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 void sortptr (real *x ,int *idx, int n)
 {
@@ -39,6 +50,180 @@ void sortptr (real *x ,int *idx, int n)
 }
 
 
+/*
+ * the 64 bits of a double, flipped such that unsigned order is numeric
+ * order; a float (SINGLEPREC) converts to double exactly
+ */
+
+local inline uint64_t radix_key(real x)
+{
+    union { double d; uint64_t u; } v;
+
+    v.d = x;
+    return (v.u >> 63) ? ~v.u : v.u | ((uint64_t)1 << 63);
+}
+
+#define NRADIX  256
+#define NINSERT 64      /* below this an insertion sort */
+
+void sortptr_radix(real *x, int *idx, int n)
+{
+    uint64_t *key, *key2, *kt;
+    int *idx1, *idx2, *it;
+    int pass, shift, nthr = 1, i, d, t;
+    size_t *count, off;
+    bool skip;
+
+    if (n < NINSERT) {
+        for (i=0; i<n; i++) {
+            for (t=i; t>0 && x[idx[t-1]] > x[i]; t--)
+                idx[t] = idx[t-1];
+            idx[t] = i;
+        }
+        return;
+    }
+#ifdef _OPENMP
+    nthr = omp_get_max_threads();
+#endif
+    key   = (uint64_t *) allocate(n * sizeof(uint64_t));
+    key2  = (uint64_t *) allocate(n * sizeof(uint64_t));
+    idx2  = (int *) allocate(n * sizeof(int));
+    count = (size_t *) allocate(nthr * NRADIX * sizeof(size_t));
+    idx1  = idx;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (i=0; i<n; i++) {
+        key[i] = radix_key(x[i]);
+        idx1[i] = i;
+    }
+    for (pass=0; pass<8; pass++) {          /* 8 bits per pass */
+        shift = 8*pass;
+#ifdef _OPENMP
+#pragma omp parallel private(i,d,t)
+#endif
+        {
+            int nt = 1, me = 0, lo, hi;
+            size_t *c;
+#ifdef _OPENMP
+            nt = omp_get_num_threads();
+            me = omp_get_thread_num();
+#endif
+            lo = (int) ((long) n * me / nt);
+            hi = (int) ((long) n * (me+1) / nt);
+            c = count + me*NRADIX;
+            for (d=0; d<NRADIX; d++) c[d] = 0;
+            for (i=lo; i<hi; i++)
+                c[(key[i] >> shift) & 0xff]++;
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp single
+#endif
+            {                   /* offsets by digit, then thread: stable */
+                for (d=0, skip=FALSE; d<NRADIX && !skip; d++) {
+                    for (t=0, off=0; t<nt; t++) off += count[t*NRADIX+d];
+                    skip = (off == n);   /* all the same digit */
+                }
+                for (d=0, off=0; d<NRADIX; d++)
+                    for (t=0; t<nt; t++) {
+                        i = count[t*NRADIX+d];
+                        count[t*NRADIX+d] = off;
+                        off += i;
+                    }
+            }
+            if (!skip)
+                for (i=lo; i<hi; i++) {
+                    d = (key[i] >> shift) & 0xff;
+                    key2[c[d]] = key[i];
+                    idx2[c[d]++] = idx1[i];
+                }
+        }
+        if (skip) continue;
+        kt = key;  key  = key2; key2 = kt;
+        it = idx1; idx1 = idx2; idx2 = it;
+    }
+    if (idx1 != idx) {                      /* odd number of passes done */
+        memcpy(idx, idx1, n * sizeof(int));
+        idx2 = idx1;
+    }
+    free(key);
+    free(key2);
+    free(idx2);
+    free(count);
+}
+
+/*
+ * SELECTPTR:  partial sort of x[] with weights w[] (NULL: all 1) via the
+ *	       index array idx[], such that for each of the nq (ascending)
+ *	       cumulative weights wq[], kq[] is the position in sorted order
+ *	       where the cumulative weight first reaches wq[], as in
+ *		    sum(w[idx[0..kq-1]]) < wq <= sum(w[idx[0..kq]])
+ *	       Values before position kq are <= x[idx[kq]], those after >=.
+ *	       Without weights, wq=k+1 gives the k-th smallest at kq=k, as the
+ *	       C++ nth_element().  Expected time O(n log nq).
+ */
+
+#define NSMALL  16
+#define W(i)    (w ? w[i] : 1.0)
+
+local void wselect(real *x, real *w, int *idx, int lo, int hi, real wlo,
+                   int nq, real *wq, int *kq)
+{
+    int i, j, m, lt, gt, t;
+    real p, a, b, c, wl, we;
+
+    if (nq <= 0) return;
+    if (hi-lo <= NSMALL) {                  /* insertion sort the rest */
+        for (i=lo+1; i<hi; i++) {
+            t = idx[i];
+            for (j=i; j>lo && x[idx[j-1]] > x[t]; j--)
+                idx[j] = idx[j-1];
+            idx[j] = t;
+        }
+        for (i=lo, c=wlo, j=0; i<hi && j<nq; i++) {
+            c += W(idx[i]);
+            while (j<nq && c >= wq[j]) kq[j++] = i;
+        }
+        while (j<nq) kq[j++] = hi-1;        /* roundoff beyond the total */
+        return;
+    }
+    a = x[idx[lo]];                         /* median of three as pivot */
+    b = x[idx[(lo+hi)/2]];
+    c = x[idx[hi-1]];
+    p = a < b ? (b < c ? b : (a < c ? c : a)) : (a < c ? a : (b < c ? c : b));
+    for (i=lt=lo, gt=hi; i<gt; ) {          /* three way partition */
+        if (x[idx[i]] < p) {
+            t = idx[lt]; idx[lt++] = idx[i]; idx[i++] = t;
+        } else if (x[idx[i]] > p) {
+            t = idx[--gt]; idx[gt] = idx[i]; idx[i] = t;
+        } else
+            i++;
+    }
+    for (i=lo, wl=0.0; i<lt; i++) wl += W(idx[i]);
+    for (i=lt, we=0.0; i<gt; i++) we += W(idx[i]);
+    for (m=0; m<nq && lt>lo && wq[m] <= wlo+wl; m++)
+        ;
+    wselect(x, w, idx, lo, lt, wlo, m, wq, kq);
+    for (j=m, c=wlo+wl, i=lt; j<nq && wq[j] <= wlo+wl+we; j++) {
+        while (i < gt-1 && c + W(idx[i]) < wq[j])
+            c += W(idx[i++]);
+        kq[j] = i;                          /* in the block equal to p */
+    }
+    wselect(x, w, idx, gt, hi, wlo+wl+we, nq-j, wq+j, kq+j);
+}
+
+void selectptr(real *x, real *w, int *idx, int n, int nq, real *wq, int *kq)
+{
+    int i;
+
+    for (i=0; i<n; i++)
+        idx[i] = i;
+    for (i=1; i<nq; i++)
+        if (wq[i] < wq[i-1]) error("selectptr: wq[] not sorted");
+    if (n > 0)
+        wselect(x, w, idx, 0, n, 0.0, nq, wq, kq);
+}
+
 #ifdef TESTBED
 
 static real   x[10]={9, 5, 4, 7, 6, 2, 1, 3, 8, 0};
@@ -31,6 +31,8 @@
  *              1e7 grandom:   V2.2 -> 1.40"    V2.3 -> 0.85
  *  11-aug-22   implement special value -3 to use /dev/random on linux        PJT
  *  27-sep-23   less verbose by default                                       PJT
+ *  16-oct-26   counter based Philox4x32-10 generator: seed=N,philox, xrandom_i()
+ *              for reproducible per-particle streams, and bulk xrandom_n()
  *
  *  See also: getrandom(2) for seed=-3
  */
@@ -40,6 +42,7 @@
 #include <extstring.h>
 
 #include <unistd.h>
+#include <stdint.h>
 #include <time.h>
 #include <sys/types.h>
 #ifndef __MINGW32__
@@ -75,6 +78,19 @@ extern double random0(void);
 
 local int idum;            /* local variable to store used seed */
 
+/*
+ * Philox4x32-10 (Salmon et al. 2011, SC11) is a counter based generator:
+ * the numbers are a pure function of (key,counter), with the seed as key.
+ * Stream i (e.g. a particle index) has key (seed,0) and counter (k/2,0,i),
+ * and gives the same numbers regardless of order or thread.  If selected
+ * with init_xrandom("seed,philox") it also drives xrandom(), using a
+ * sequential stream with key (seed,1).
+ */
+
+local bool     Qphilox = FALSE;   /* counter based generator for xrandom() ? */
+local uint32_t pkey = 0;          /* key (seed) for the counter based streams */
+local uint64_t pcount = 0;        /* position in the sequential stream */
+
 #ifdef HAVE_GSL
 # include <gsl/gsl_rng.h>
 # include <gsl/gsl_randist.h>
@@ -87,6 +103,61 @@ local int idum;            /* local variable to store used seed */
 #endif
 
 
+local inline void philox4x32(uint32_t c[4], uint32_t k0, uint32_t k1)
+{
+    uint64_t p0, p1;
+    int r;
+
+    for (r=0; r<10; r++) {
+        p0 = (uint64_t) 0xD2511F53 * c[0];
+        p1 = (uint64_t) 0xCD9E8D57 * c[2];
+        c[0] = (uint32_t)(p1>>32) ^ c[1] ^ k0;
+        c[1] = (uint32_t) p1;
+        c[2] = (uint32_t)(p0>>32) ^ c[3] ^ k1;
+        c[3] = (uint32_t) p0;
+        k0 += 0x9E3779B9;
+        k1 += 0xBB67AE85;
+    }
+}
+
+/* uniform in [0,1) with 53 bits, from two 32 bit words */
+
+local inline double philox_u01(uint32_t a, uint32_t b)
+{
+    return ((a>>5)*67108864.0 + (b>>6)) * (1.0/9007199254740992.0);
+}
+
+/* n-th number of the sequential stream; each counter gives two */
+
+local inline double philox_seq(uint64_t n)
+{
+    uint32_t c[4];
+
+    c[0] = (uint32_t)(n>>1);
+    c[1] = (uint32_t)(n>>33);
+    c[2] = c[3] = 0;
+    philox4x32(c, pkey, 1);
+    return (n&1) ? philox_u01(c[2],c[3]) : philox_u01(c[0],c[1]);
+}
+
+/* "seed,philox" selects the counter based generator, also with GSL */
+
+local bool init_philox(string init)
+{
+    string *is;
+    bool Qok;
+
+    is = burststring(init,", ");
+    Qok = xstrlen(is,sizeof(string))-1 == 2 && streq(is[1],"philox");
+    if (Qok) {
+        set_xrandom(natoi(is[0]));        /* sets pkey */
+        Qphilox = TRUE;
+        dprintf(1,"init_xrandom: philox4x32-10 seed=%u\n",pkey);
+    }
+    freestrings(is);
+    return Qok;
+}
+
 int init_xrandom(string init)
 {
 #ifdef HAVE_GSL
@@ -94,6 +165,14 @@ int init_xrandom(string init)
     string *is;
     int nis, iseed;
 
+    if (init && init_philox(init)) {          /* GSL routines still need my_r */
+        gsl_rng_env_setup();
+        my_T = gsl_rng_default;
+        my_r = gsl_rng_alloc(my_T);
+        gsl_rng_set(my_r, (unsigned long) pkey);
+        dprintf(1,"GSL generator type: %s, seed = %u\n",gsl_rng_name(my_r),pkey);
+        return (int) pkey;
+    }
     is = burststring(init,", ");                      /* parse init as "[seed[,name]]"  */
     nis = xstrlen(is,sizeof(string))-1;
     if (nis > 0) {                                          /* seed is first, but optional */
@@ -122,8 +201,12 @@ int init_xrandom(string init)
     dprintf(1,"GSL seed = %u\n",gsl_rng_default_seed);
     dprintf(1,"GSL first value = %u\n",gsl_rng_get(my_r));
 
+    Qphilox = FALSE;
+    pkey = (uint32_t) gsl_rng_default_seed;
     return (int) gsl_rng_default_seed;
 #else
+    if (init && init_philox(init)) return (int) pkey;
+    Qphilox = FALSE;
     return set_xrandom(init? natoi(init) : 0);     /*  18/06/2008: allow for init=0 WD */
 #endif
 }
@@ -165,6 +248,9 @@ int set_xrandom(int dum)
     } else
     	retval = idum = dum;	           /* use supplied seed in argument */
 
+    pkey = (uint32_t) retval;              /* also (re)start the counter streams */
+    pcount = 0;
+
 #if !defined(HAVE_GSL)
 #if defined(NUMREC)
     dprintf(2,"set_xrandom(NUMREC portable) seed=%d\n",idum);
@@ -190,6 +276,9 @@ double xrandom(double xl, double xh)
 {
     double retval;
 
+    if (Qphilox)
+        return xl + philox_seq(pcount++)*(xh-xl);
+
     for(;;) {
 #if defined(HAVE_GSL)
         if (my_r == NULL) error("GSL init_xrandom was never called");
@@ -212,6 +301,62 @@ double xrandom(double xl, double xh)
     return xl + retval*(xh-xl);
 }
 
+/*
+ * XRANDOM_N: the next n numbers of xrandom().  For the counter based
+ *            generator these are independent, and the loop vectorizes.
+ */
+
+void xrandom_n(double *x, int n, double xl, double xh)
+{
+    uint64_t c0 = pcount;
+    int i;
+
+    if (!Qphilox) {
+        for (i=0; i<n; i++)
+            x[i] = xrandom(xl,xh);
+        return;
+    }
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+    for (i=0; i<n; i++)
+        x[i] = xl + philox_seq(c0+i)*(xh-xl);
+    pcount += n;
+}
+
+/*
+ * XRANDOM_I: number *k of the counter based stream i, *k is incremented.
+ *            Thread safe, and independent of xrandom() and its generator.
+ * GRANDOM_I: same, gaussian (Box-Muller), uses two numbers of the stream.
+ */
+
+double xrandom_i(long i, int *k, double xl, double xh)
+{
+    uint32_t c[4];
+    int n = (*k)++;
+
+    c[0] = (uint32_t)(n>>1);
+    c[1] = 0;
+    c[2] = (uint32_t) i;
+    c[3] = (uint32_t)((uint64_t) i >> 32);
+    philox4x32(c, pkey, 0);
+    return xl + ((n&1) ? philox_u01(c[2],c[3]) : philox_u01(c[0],c[1]))*(xh-xl);
+}
+
+double grandom_i(long i, int *k, double mean, double sdev)
+{
+    double r = sqrt(-2.0*log(xrandom_i(i,k,1.0,0.0)));    /* (0,1] */
+
+    return mean + sdev * r * cos(TWO_PI*xrandom_i(i,k,0.0,1.0));
+}
+
+/* TRUE if xrandom() uses the counter based generator */
+
+bool xrandom_philox(void)
+{
+    return Qphilox;
+}
+
 /*
  * GRANDOM: normally distributed random number (polar method)
  *	    referred to as the Box-Mueller method, although
@@ -267,9 +412,9 @@ double erandom(double a)
 
 string defv[] = {
 #ifdef HAVE_GSL
-    "seed=0,mt19937\n Seed [0=seconds_1970, -1=centisec_boot -2=pid], and optional GSL name",
+    "seed=0,mt19937\n Seed [0=seconds_1970, -1=centisec_boot -2=pid], and optional GSL name or philox",
 #else
-    "seed=0\n       Seed [0=seconds_1970, -1=centisec_boot -2=pid]",
+    "seed=0\n       Seed [0=seconds_1970, -1=centisec_boot -2=pid], optionally ,philox",
 #endif
     "n=0\n          Number of random numbers to draw",
     "m=1\n          Number of times to repeat experiment (enforces tab=f)",
@@ -283,7 +428,7 @@ string defv[] = {
     "gsl=\n         If given, GSL distribution name",
     "pars=\n        Parameters for GSL distribution",
 #endif
-    "VERSION=2.5\n  23-sep-2023 PJT",
+    "VERSION=2.6\n  16-oct-2026",
     NULL,
 };
 
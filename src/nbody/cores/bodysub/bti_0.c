@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-int bti_0(Body *b,real t,int  i)
-{
-    return (0);
-}
+BODYTRANS(int, bti_0, 0)
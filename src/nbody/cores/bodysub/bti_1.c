@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-int bti_1(Body *b,real t,int  i)
-{
-    return (1);
-}
+BODYTRANS(int, bti_1, 1)
@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-int bti_i(Body *b,real t,int  i)
-{
-    return (i);
-}
+BODYTRANS(int, bti_i, i)
@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-int bti_key(Body *b,real t,int  i)
-{
-    return (key);
-}
+BODYTRANS(int, bti_key, key)
@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_0(Body *b,real t,int  i)
-{
-    return (0.0);
-}
+BODYTRANS(real, btr_0, 0.0)
@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_1(Body *b,real t,int  i)
-{
-    return (1.0);
-}
+BODYTRANS(real, btr_1, 1.0)
@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_aux(Body *b,real t,int  i)
-{
-    return (aux);
-}
+BODYTRANS(real, btr_aux, aux)
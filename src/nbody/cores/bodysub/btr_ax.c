@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_ax(Body *b,real t,int  i)
-{
-    return (ax);
-}
+BODYTRANS(real, btr_ax, ax)
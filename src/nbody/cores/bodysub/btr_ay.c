@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_ay(Body *b,real t,int  i)
-{
-    return (ay);
-}
+BODYTRANS(real, btr_ay, ay)
@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_az(Body *b,real t,int  i)
-{
-    return (az);
-}
+BODYTRANS(real, btr_az, az)
@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_dec(Body *b,real t,int  i)
-{
-    return y*180.0/PI;
-}
+BODYTRANS(real, btr_dec, y*180.0/PI)
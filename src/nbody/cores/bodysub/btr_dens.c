@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_dens(Body *b,real t,int  i)
-{
-    return (dens);
-}
+BODYTRANS(real, btr_dens, dens)
@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_eps(Body *b,real t,int  i)
-{
-    return (eps);
-}
+BODYTRANS(real, btr_eps, eps)
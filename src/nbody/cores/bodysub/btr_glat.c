@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_glat(Body *b,real t,int  i)
-{
-    return atan2(z,sqrt(x*x+y*y))*180.0/PI;
-}
+BODYTRANS(real, btr_glat, atan2(z,sqrt(x*x+y*y))*180.0/PI)
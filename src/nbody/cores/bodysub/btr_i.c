@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_i(Body *b, real t, int i)
-{
-    return i;
-}
+BODYTRANS(real, btr_i, i)
@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_jtot(Body *b,real t,int  i)
-{
-    return (sqrt(sqr(x*vy - y*vx) + sqr(y*vz - z*vy) + sqr(z*vx - x*vz)));
-}
+BODYTRANS(real, btr_jtot, sqrt(sqr(x*vy - y*vx) + sqr(y*vz - z*vy) + sqr(z*vx - x*vz)))
@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_jx(Body *b,real t,int  i)
-{
-  return y*vz - z*vy;
-}
+BODYTRANS(real, btr_jx, y*vz - z*vy)
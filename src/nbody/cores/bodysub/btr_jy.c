@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_jy(Body *b,real t,int  i)
-{
-    return z*vx - x*vz;
-}
+BODYTRANS(real, btr_jy, z*vx - x*vz)
@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_jz(Body *b,real t,int  i)
-{
-  return x*vy - y*vx;
-}
+BODYTRANS(real, btr_jz, x*vy - y*vx)
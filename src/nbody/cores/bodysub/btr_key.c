@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_key(Body *b,real t,int  i)
-{
-    return (key);
-}
+BODYTRANS(real, btr_key, key)
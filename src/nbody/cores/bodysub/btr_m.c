@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_m(Body *b,real t,int  i)
-{
-    return (m);
-}
+BODYTRANS(real, btr_m, m)
@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_phi(Body *b,real t,int  i)
-{
-    return (phi);
-}
+BODYTRANS(real, btr_phi, phi)
@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_r(Body *b,real t,int  i)
-{
-    return (sqrt(x*x + y*y + z*z));
-}
+BODYTRANS(real, btr_r, sqrt(x*x + y*y + z*z))
@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_r2(Body *b,real t,int  i)
-{
-    return (sqrt(x*x + y*y));
-}
+BODYTRANS(real, btr_r2, sqrt(x*x + y*y))
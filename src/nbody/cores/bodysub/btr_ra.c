@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_ra(Body *b,real t,int  i)
-{
-    return -x*180.0/PI;    
-}
+BODYTRANS(real, btr_ra, -x*180.0/PI)
@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_t(Body *b,real t,int  i)
-{
-    return (t);
-}
+BODYTRANS(real, btr_t, t)
@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_v(Body *b,real t,int  i)
-{
-    return (sqrt(vx*vx + vy*vy + vz*vz));
-}
+BODYTRANS(real, btr_v, sqrt(vx*vx + vy*vy + vz*vz))
@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_v2(Body *b,real t,int  i)
-{
-    return (sqrt(vx*vx + vy*vy));
-}
+BODYTRANS(real, btr_v2, sqrt(vx*vx + vy*vy))
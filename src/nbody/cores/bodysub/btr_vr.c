@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_vr(Body *b,real t,int  i)
-{
-    return ((x*vx + y*vy + z*vz) / sqrt(x*x + y*y + z*z));
-}
+BODYTRANS(real, btr_vr, (x*vx + y*vy + z*vz) / sqrt(x*x + y*y + z*z))
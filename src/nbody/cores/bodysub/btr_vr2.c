@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_vr2(Body *b,real t,int  i)
-{
-    return ((x*vx + y*vy) / sqrt(x*x + y*y));
-}
+BODYTRANS(real, btr_vr2, (x*vx + y*vy) / sqrt(x*x + y*y))
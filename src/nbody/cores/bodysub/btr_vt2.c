@@ -1,7 +1,3 @@
 #include <bodytrans.h>
 
-real btr_vt2(Body *b,real t,int  i)
-{
-    return (sqrt((vx*vx + vy*vy) -
-		   sqr(x*vx + y*vy) / (x*x + y*y)));
-}
+BODYTRANS(real, btr_vt2, sqrt((vx*vx + vy*vy) - sqr(x*vx + y*vy) / (x*x + y*y)))
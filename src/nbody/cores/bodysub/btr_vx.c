@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_vx(Body *b,real t,int  i)
-{
-    return (vx);
-}
+BODYTRANS(real, btr_vx, vx)
@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_vy(Body *b,real t,int  i)
-{
-    return (vy);
-}
+BODYTRANS(real, btr_vy, vy)
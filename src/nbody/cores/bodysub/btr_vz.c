@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_vz(Body *b,real t,int  i)
-{
-    return (vz);
-}
+BODYTRANS(real, btr_vz, vz)
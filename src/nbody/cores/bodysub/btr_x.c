@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_x(Body *b,real t,int  i)
-{
-    return (x);
-}
+BODYTRANS(real, btr_x, x)
@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_y(Body *b,real t,int  i)
-{
-    return (y);
-}
+BODYTRANS(real, btr_y, y)
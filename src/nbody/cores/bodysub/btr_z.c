@@ -1,6 +1,3 @@
 #include <bodytrans.h>
 
-real btr_z(Body *b,real t,int  i)
-{
-    return (z);
-}
+BODYTRANS(real, btr_z, z)
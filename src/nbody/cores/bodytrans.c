@@ -5,6 +5,10 @@
  * public routines:
  *      rproc_body btrtrans(expr)
  *      iproc_body btitrans(expr)
+ *      rproc_body_n btrtrans_n(fn)     batch version of fn, if available
+ *      iproc_body_n btitrans_n(fn)
+ *      void btreval(fn, btab, n, t, i0, out)   evaluate fn for n bodies
+ *      void btieval(fn, btab, n, t, i0, out)
  *
  *  -DTOOLBOX  version of this file can test and save bodytrans(5) files
  *  -DSAVE_OBJ will save bodytrans(5) files
@@ -60,12 +64,15 @@
  *  27-jul-05   add dummy loader for lazy gcc4 type linkers
  *  28-jul-06   add show= options
  *  15-Aug-09   add support for Cygwin DLL by LOADOBJDLL
+ *  16-oct-26   V4.0 also compile a batch version btX_NAME_n over an array of bodies
+ *  16-oct-26   V4.1 interpret expressions (bodytransvm.c) instead of invoking cc
  *
  *  Used environment variables (normally set through .cshrc/NEMORC files)
  *      NEMO        used in case NEMOOBJ was not available
  *      NEMOOBJ     normally points to $NEMO/obj/bodytrans
  *      BTRPATH     path of directories where to look for object files
  *	CFLAGS      if present, used in on-the-fly C compilation (only < V3)
+ *      BTRVM       if 0, compile all new expressions, never interpret them
  *
  * TODO:
  *   shared objects are mostly .so, but HP uses .sl, and cygwin .dll
@@ -91,8 +98,10 @@
 #define SHORT_FNAMELEN   64
 
 local proc   bodytrans(string,string,string);
+local void   add_bt_n(proc, proc);
 local void   ini_bt(void), end_bt(void), make_bt(string), show_bt(void);
 local string get_bt(string), put_bt(string,char,string);
+extern proc  bodytrans_vm(string,string,proc *);
 
 void bodytrans_dummy_for_c(void);
 
@@ -145,7 +154,7 @@ local proc bodytrans(string type, string expr, string fname)
     string btrpath;
     string fullfile, hexpr;
     stream cdstr;
-    proc result;
+    proc result, result_n;
 
 #if defined(LOADOBJ3)
     dprintf(1,"bodytrans: V3 .so for %s\n",expr);
@@ -200,6 +209,12 @@ local proc bodytrans(string type, string expr, string fname)
 	loadobj(file);
         sprintf(func, "%s", cp);               /* generic symbol name */
         mapsys(func);                                     /* remap it */
+    } else if ((fname == NULL || *fname == 0) &&      /* interpret it */
+               ((cp=getenv("BTRVM")) == NULL || *cp != '0') &&
+               (result = bodytrans_vm(type, expr, &result_n)) != NULL) {
+        dprintf(1,"bodytrans: interpreting %s\n",expr);
+        add_bt_n(result, result_n);
+        return result;
     } else {                                           /* make a file */
         dprintf(0, "[bodytrans_new: invoking cc");
 #if defined(SAVE_OBJ)
@@ -220,8 +235,7 @@ local proc bodytrans(string type, string expr, string fname)
         sprintf(file, "/tmp/%s.c", name);
         cdstr = fopen(file, "w");
         fprintf(cdstr, "#include <bodytrans.h>\n\n");
-        fprintf(cdstr, "%s %s(Body *b,real t,int i)\n", type, sname);/* use generic name */
-        fprintf(cdstr, "{\n    return (%s);\n}\n", expr);
+        fprintf(cdstr, "BODYTRANS(%s, %s, %s)\n", type, sname, expr);   /* generic name */
         fclose(cdstr);
 	cflags = getenv("CFLAGS");
 #if defined(LOADOBJ3)
@@ -284,8 +298,82 @@ local proc bodytrans(string type, string expr, string fname)
       error("Cant find %s (from findfn)", func);
       bodytrans_dummy_for_c();
     }
+    strcat(func, "_n");             /* older objects do not have one */
+    add_bt_n(result, findfn(func));
     return result;
 }
+
+/*
+ * BTRTRANS_N, BTITRANS_N: the batch version of a function returned by
+ * btrtrans() or btitrans(), evaluating n bodies in one call, as in
+ *      fn_n(btab, n, t, i0, out);      out[k] = fn(btab+k, t, i0+k)
+ * or NULL if the object file was compiled before these existed.
+ */
+
+#define MAXBT_N 64
+
+local int  nbt_n = 0;
+local proc bt_fn[MAXBT_N], bt_fn_n[MAXBT_N];
+
+local void add_bt_n(proc fn, proc fn_n)
+{
+    int i;
+
+    dprintf(1,"bodytrans: batch version %sfound\n", fn_n ? "" : "not ");
+    for (i=0; i<nbt_n; i++)
+        if (bt_fn[i] == fn) return;
+    if (nbt_n == MAXBT_N) return;   /* no matter, btreval() will loop */
+    bt_fn[nbt_n] = fn;
+    bt_fn_n[nbt_n++] = fn_n;
+}
+
+local proc find_bt_n(proc fn)
+{
+    int i;
+
+    for (i=0; i<nbt_n; i++)
+        if (bt_fn[i] == fn) return bt_fn_n[i];
+    return NULL;
+}
+
+rproc_body_n btrtrans_n(rproc_body fn)
+{
+    return (rproc_body_n) find_bt_n((proc) fn);
+}
+
+iproc_body_n btitrans_n(iproc_body fn)
+{
+    return (iproc_body_n) find_bt_n((proc) fn);
+}
+
+/*
+ * BTREVAL, BTIEVAL: evaluate fn for bodies btab[0..n-1], which have
+ * index i0.. ; with the batch version if there is one.
+ */
+
+void btreval(rproc_body fn, Body *btab, int n, real t, int i0, real *out)
+{
+    rproc_body_n fn_n = btrtrans_n(fn);
+    int k;
+
+    if (fn_n)
+        (*fn_n)(btab, n, t, i0, out);
+    else
+        for (k=0; k<n; k++)
+            out[k] = (*fn)(btab+k, t, i0+k);
+}
+
+void btieval(iproc_body fn, Body *btab, int n, real t, int i0, int *out)
+{
+    iproc_body_n fn_n = btitrans_n(fn);
+    int k;
+
+    if (fn_n)
+        (*fn_n)(btab, n, t, i0, out);
+    else
+        for (k=0; k<n; k++)
+            out[k] = (*fn)(btab+k, t, i0+k);
+}
 
 /*  
  * INI_BT: initialize some filenames for subsequent _BT functions
@@ -560,7 +648,7 @@ string defv[] = {
     "alias=\n		Filename to save expression in (bt<TYPE>_<ALIAS>)",
     "btnames=\n		BTNAMES filename to regenerate .so files",
     "show=f\n           show all existing bodytrans in the system",
-    "VERSION=3.3a\n	23-jan-2021 PJT",
+    "VERSION=4.1\n	16-oct-2026",
     NULL,
 };
 
@@ -607,10 +695,20 @@ nemo_main()
         rtrans = (rproc_body) bodytrans("real", expr, fname);
         cp = get_bt(expr);
         printf("%s = %g (%s)\n", expr, (*rtrans)(&b,t,i), (cp)?(cp):(""));
+        if (btrtrans_n(rtrans)) {
+            real r_n;
+            (*btrtrans_n(rtrans))(&b,1,t,i,&r_n);
+            dprintf(1,"batch: %s = %g\n", expr, r_n);
+        }
     } else if (type[0] == 'i') {
         itrans = (iproc_body) bodytrans("int", expr, fname);
         cp = get_bt(expr);
         printf("%s = %d (%s)\n", expr, (*itrans)(&b,t,i), (cp)?(cp):(""));
+        if (btitrans_n(itrans)) {
+            int i_n;
+            (*btitrans_n(itrans))(&b,1,t,i,&i_n);
+            dprintf(1,"batch: %s = %d\n", expr, i_n);
+        }
     } else
         dprintf(0,"Warning: not a valid type, must be real or int\n");
 }
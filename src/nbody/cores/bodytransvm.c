@@ -0,0 +1,664 @@
+/*
+ * BODYTRANSVM.C: interpreter for bodytrans(5NEMO) expressions, used by
+ * bodytrans() when there is no precompiled object file, so that no C
+ * compiler has to be invoked.
+ *
+ *	The C expression is compiled to code for a machine whose registers
+ *	are vectors, each instruction is a loop over a block of bodies.
+ *	All values are kept in double; int valued expressions (i, key,
+ *	integer constants, comparisons) follow the C rules for /, % and
+ *	conversion to int, and are never -0, so the results are those of
+ *	the compiled version in a DOUBLEPREC build.  With SINGLEPREC or
+ *	MIXEDPREC the compiled code does (some of) its arithmetic in
+ *	float, so there the interpreter is not used at all.
+ *	Anything not understood (bit operators, pos[], other functions ...)
+ *	returns NULL, and the caller falls back to the C compiler.
+ *
+ *	16-oct-2026	V1.0 created
+ *			V1.1 only for DOUBLEPREC
+ */
+
+#include <stdinc.h>
+#include <strlib.h>
+#include <bodytransc.h>
+#include <ctype.h>
+#include <setjmp.h>
+
+#define MAXVM    16             /* max number of interpreted expressions */
+#define MAXCODE 128             /* max number of instructions for one */
+#define NREG     16             /* number of registers */
+#define NVEC    128             /* length of a register */
+
+enum {
+    OP_LDF, OP_LDK, OP_LDI, OP_LDT, OP_LDC,     /* loads */
+    OP_NEG, OP_INEG, OP_NOT, OP_INT,
+    OP_ADD, OP_SUB, OP_MUL, OP_IMUL, OP_DIV, OP_IDIV, OP_IMOD,
+    OP_EQ, OP_NE, OP_LT, OP_GT, OP_LE, OP_GE, OP_AND, OP_OR, OP_SEL,
+    OP_ABSM, OP_SGNM, OP_MINM, OP_MAXM,         /* the stdinc.h macros */
+    OP_SQRT, OP_EXP, OP_LOG, OP_LOG10, OP_SIN, OP_COS, OP_TAN,
+    OP_ASIN, OP_ACOS, OP_ATAN, OP_SINH, OP_COSH, OP_TANH,
+    OP_FABS, OP_FLOOR, OP_CEIL, OP_SQR,
+    OP_ATAN2, OP_POW, OP_FMOD, OP_HYPOT,
+};
+
+typedef struct vminstr {
+    short  op, d, a, b, c;      /* operation, result and operand registers */
+    int    off;                 /* OP_LDF: offset of the field in a Body */
+    double con;                 /* OP_LDC: the constant */
+} vminstr;
+
+typedef struct vmprog {
+    char    type;               /* 'r' or 'i' */
+    string  expr;
+    int     ncode;
+    int     res;                /* register with the result */
+    vminstr code[MAXCODE];
+} vmprog;
+
+local vmprog vmprogs[MAXVM];
+local int    nvm = 0;
+
+/*
+ * VM_ARITH:  d[k] = op(a[k],b[k],c[k]) for k=0..n-1
+ */
+
+#define LOOP(expr)  for (k=0; k<n; k++) d[k] = (expr); break
+
+local void vm_arith(int op, int n, double *d, double *a, double *b, double *c)
+{
+    int k;
+
+    switch (op) {
+    case OP_NEG:   LOOP(-a[k]);
+    case OP_INEG:  LOOP(0.0 - a[k]);
+    case OP_NOT:   LOOP(a[k] == 0);
+    case OP_INT:   LOOP(trunc(a[k]) + 0.0);
+    case OP_ADD:   LOOP(a[k] + b[k]);
+    case OP_SUB:   LOOP(a[k] - b[k]);
+    case OP_MUL:   LOOP(a[k] * b[k]);
+    case OP_IMUL:  LOOP(a[k] * b[k] + 0.0);
+    case OP_DIV:   LOOP(a[k] / b[k]);
+    case OP_IDIV:  LOOP(b[k] != 0 ? trunc(a[k] / b[k]) + 0.0 : 0.0);
+    case OP_IMOD:  LOOP(b[k] != 0 ? fmod(a[k], b[k]) + 0.0 : 0.0);
+    case OP_EQ:    LOOP(a[k] == b[k]);
+    case OP_NE:    LOOP(a[k] != b[k]);
+    case OP_LT:    LOOP(a[k] <  b[k]);
+    case OP_GT:    LOOP(a[k] >  b[k]);
+    case OP_LE:    LOOP(a[k] <= b[k]);
+    case OP_GE:    LOOP(a[k] >= b[k]);
+    case OP_AND:   LOOP(a[k] != 0 && b[k] != 0);
+    case OP_OR:    LOOP(a[k] != 0 || b[k] != 0);
+    case OP_SEL:   LOOP(a[k] != 0 ? b[k] : c[k]);
+    case OP_ABSM:  LOOP(ABS(a[k]));
+    case OP_SGNM:  LOOP(SGN(a[k]));
+    case OP_MINM:  LOOP(MIN(a[k], b[k]));
+    case OP_MAXM:  LOOP(MAX(a[k], b[k]));
+    case OP_SQRT:  LOOP(sqrt(a[k]));
+    case OP_EXP:   LOOP(exp(a[k]));
+    case OP_LOG:   LOOP(log(a[k]));
+    case OP_LOG10: LOOP(log10(a[k]));
+    case OP_SIN:   LOOP(sin(a[k]));
+    case OP_COS:   LOOP(cos(a[k]));
+    case OP_TAN:   LOOP(tan(a[k]));
+    case OP_ASIN:  LOOP(asin(a[k]));
+    case OP_ACOS:  LOOP(acos(a[k]));
+    case OP_ATAN:  LOOP(atan(a[k]));
+    case OP_SINH:  LOOP(sinh(a[k]));
+    case OP_COSH:  LOOP(cosh(a[k]));
+    case OP_TANH:  LOOP(tanh(a[k]));
+    case OP_FABS:  LOOP(fabs(a[k]));
+    case OP_FLOOR: LOOP(floor(a[k]));
+    case OP_CEIL:  LOOP(ceil(a[k]));
+    case OP_SQR:   LOOP(a[k] * a[k]);
+    case OP_ATAN2: LOOP(atan2(a[k], b[k]));
+    case OP_POW:   LOOP(pow(a[k], b[k]));
+    case OP_FMOD:  LOOP(fmod(a[k], b[k]));
+    case OP_HYPOT: LOOP(hypot(a[k], b[k]));
+    default:
+        error("bodytrans_vm: bad opcode %d", op);
+    }
+}
+
+local void vm_load(vminstr *ip, int n, Body *btab, real t, int i0, double *d)
+{
+    int k;
+
+    switch (ip->op) {
+    case OP_LDF:  LOOP(*(real *)((char *)(btab+k) + ip->off));
+    case OP_LDK:  LOOP(Key(btab+k));
+    case OP_LDI:  LOOP(i0+k);
+    case OP_LDT:  LOOP(t);
+    case OP_LDC:  LOOP(ip->con);
+    }
+}
+
+/*
+ * VM_RUN:  evaluate program p for bodies btab[0..n-1], with index i0..,
+ *	    in blocks of NVEC bodies
+ */
+
+local void vm_run(vmprog *p, Body *btab, int n, real t, int i0,
+                  real *rout, int *iout)
+{
+    double reg[NREG][NVEC], *res = reg[p->res];
+    vminstr *ip, *end = p->code + p->ncode;
+    int k, k0, nb;
+
+    for (k0=0; k0<n; k0+=NVEC) {
+        nb = MIN(NVEC, n-k0);
+        for (ip=p->code; ip<end; ip++)
+            if (ip->op <= OP_LDC)
+                vm_load(ip, nb, btab+k0, t, i0+k0, reg[ip->d]);
+            else
+                vm_arith(ip->op, nb, reg[ip->d], reg[ip->a], reg[ip->b], reg[ip->c]);
+        if (rout)
+            for (k=0; k<nb; k++) rout[k0+k] = res[k];
+        else
+            for (k=0; k<nb; k++) iout[k0+k] = (int) res[k];
+    }
+}
+
+/*
+ * Since a function pointer cannot carry its program, each program slot
+ * has its own small functions, real and int, single and batch version.
+ */
+
+#define VMSLOT(k)                                                         \
+local real vmr_##k(Body *b, real t, int i)                                \
+{ real v; vm_run(vmprogs+k, b, 1, t, i, &v, NULL); return v; }            \
+local int vmi_##k(Body *b, real t, int i)                                 \
+{ int v; vm_run(vmprogs+k, b, 1, t, i, NULL, &v); return v; }             \
+local void vmr_##k##_n(Body *btab, int n, real t, int i0, real *out)      \
+{ vm_run(vmprogs+k, btab, n, t, i0, out, NULL); }                         \
+local void vmi_##k##_n(Body *btab, int n, real t, int i0, int *out)       \
+{ vm_run(vmprogs+k, btab, n, t, i0, NULL, out); }
+
+VMSLOT(0)  VMSLOT(1)  VMSLOT(2)  VMSLOT(3)
+VMSLOT(4)  VMSLOT(5)  VMSLOT(6)  VMSLOT(7)
+VMSLOT(8)  VMSLOT(9)  VMSLOT(10) VMSLOT(11)
+VMSLOT(12) VMSLOT(13) VMSLOT(14) VMSLOT(15)
+
+#define VMSLOTS(p,s)  p##0##s,  p##1##s,  p##2##s,  p##3##s,  \
+                      p##4##s,  p##5##s,  p##6##s,  p##7##s,  \
+                      p##8##s,  p##9##s,  p##10##s, p##11##s, \
+                      p##12##s, p##13##s, p##14##s, p##15##s
+
+local rproc_body   vm_r[MAXVM]   = { VMSLOTS(vmr_,) };
+local iproc_body   vm_i[MAXVM]   = { VMSLOTS(vmi_,) };
+local rproc_body_n vm_r_n[MAXVM] = { VMSLOTS(vmr_,_n) };
+local iproc_body_n vm_i_n[MAXVM] = { VMSLOTS(vmi_,_n) };
+
+/*
+ * The compiler: recursive descent over the C expression grammar.  A value
+ * is either a constant, folded as long as possible, or lives in a register;
+ * registers are used as a stack.
+ */
+
+typedef struct vmval {
+    int    reg;                 /* register, or -1 for a constant */
+    bool   isint;               /* int valued, in C */
+    double con;                 /* the constant */
+} vmval;
+
+local vmprog *vp;               /* program being compiled */
+local char   *vs;               /* current position in its expression */
+local int     vtop;             /* first free register */
+local jmp_buf vjmp;             /* to give up */
+
+local vmval vm_expr(void);
+
+local void vm_fail(string msg)
+{
+    dprintf(1, "bodytrans_vm: %s at \"%s\"\n", msg, vs);
+    longjmp(vjmp, 1);
+}
+
+/* skip the token tok if it is next, but "<" must not match "<=", etc. */
+
+local bool vm_match(string tok)
+{
+    int n = strlen(tok);
+
+    while (isspace(*vs)) vs++;
+    if (strncmp(vs, tok, n) != 0) return FALSE;
+    if (n == 1 && vs[1] == '=' && strchr("<>!=", *vs)) return FALSE;
+    if (n == 1 && vs[1] == *vs && strchr("&|+-<>=", *vs)) return FALSE;
+    vs += n;
+    return TRUE;
+}
+
+local void vm_expect(string tok)
+{
+    if (!vm_match(tok)) vm_fail("syntax error");
+}
+
+local vminstr *vm_emit(int op, int d, int a, int b, int c)
+{
+    vminstr *ip;
+
+    if (vp->ncode == MAXCODE) vm_fail("expression too long");
+    ip = vp->code + vp->ncode++;
+    ip->op = op;
+    ip->d = d;
+    ip->a = a;
+    ip->b = b;
+    ip->c = c;
+    ip->off = 0;
+    ip->con = 0.0;
+    return ip;
+}
+
+local vmval vm_const(double con, bool isint)
+{
+    vmval v;
+
+    v.reg = -1;
+    v.isint = isint;
+    v.con = con;
+    return v;
+}
+
+local vmval vm_ld(int op, int off, bool isint)
+{
+    vmval v;
+
+    if (vtop == NREG) vm_fail("expression too deep");
+    v.reg = vtop++;
+    v.isint = isint;
+    v.con = 0.0;
+    vm_emit(op, v.reg, 0, 0, 0)->off = off;
+    return v;
+}
+
+/* make sure a value is in a register */
+
+local int vm_reg(vmval *v)
+{
+    if (v->reg < 0) {
+        if (vtop == NREG) vm_fail("expression too deep");
+        v->reg = vtop++;
+        vm_emit(OP_LDC, v->reg, 0, 0, 0)->con = v->con;
+    }
+    return v->reg;
+}
+
+/* apply op to nargs values, the last ones on the register stack */
+
+local vmval vm_apply(int op, bool isint, int nargs, vmval *arg)
+{
+    vmval v;
+    int k, r[3], lo;
+    double c[3];
+
+    for (k=0; k<nargs; k++)
+        if (arg[k].reg >= 0) break;
+    if (k == nargs) {                           /* all constant: fold */
+        for (k=0; k<nargs; k++)
+            c[k] = arg[k].con;
+        vm_arith(op, 1, &v.con, c, c+1, c+2);
+        v.reg = -1;
+        v.isint = isint;
+        return v;
+    }
+    for (k=0, lo=NREG; k<nargs; k++) {
+        r[k] = vm_reg(&arg[k]);
+        lo = MIN(lo, r[k]);
+    }
+    for (; k<3; k++)
+        r[k] = 0;
+    vm_emit(op, lo, r[0], r[1], r[2]);
+    vtop = lo + 1;
+    v.reg = lo;
+    v.isint = isint;
+    v.con = 0.0;
+    return v;
+}
+
+local vmval vm_op1(int op, bool isint, vmval a)
+{
+    return vm_apply(op, isint, 1, &a);
+}
+
+local vmval vm_op2(int op, bool isint, vmval a, vmval b)
+{
+    vmval arg[2];
+
+    arg[0] = a;
+    arg[1] = b;
+    return vm_apply(op, isint, 2, arg);
+}
+
+local vmval vm_toint(vmval v)
+{
+    return v.isint ? v : vm_op1(OP_INT, TRUE, v);
+}
+
+local bool vm_ident(char *name, int len)
+{
+    int n = 0;
+
+    while (isspace(*vs)) vs++;
+    if (!isalpha(*vs) && *vs != '_') return FALSE;
+    while ((isalnum(*vs) || *vs == '_') && n < len-1)
+        name[n++] = *vs++;
+    name[n] = 0;
+    if (isalnum(*vs) || *vs == '_') vm_fail("name too long");
+    return TRUE;
+}
+
+local vmval vm_number(void)
+{
+    char *end;
+    double con;
+    bool isint;
+
+    if (vs[0] == '0' && (vs[1] == 'x' || vs[1] == 'X'))
+        vm_fail("hex constant");
+    con = strtod(vs, &end);
+    if (end == vs || isalnum(*end) || *end == '_' || *end == '.')
+        vm_fail("bad number");
+    isint = (strspn(vs, "0123456789") == end-vs);
+    if (isint && vs[0] == '0' && end-vs > 1)
+        vm_fail("octal constant");
+    vs = end;
+    return vm_const(con, isint);
+}
+
+/* the body variables, as macro-fied in bodytrans.h, and constants */
+
+local vmval vm_var(string name)
+{
+    Body b0, *b = &b0;
+    real *fp = NULL;
+    char *save;
+    vmval v;
+
+    if      (streq(name, "m"))    fp = &Mass(b);
+    else if (streq(name, "x"))    fp = &Pos(b)[0];
+    else if (streq(name, "y"))    fp = &Pos(b)[1];
+    else if (streq(name, "vx"))   fp = &Vel(b)[0];
+    else if (streq(name, "vy"))   fp = &Vel(b)[1];
+    else if (streq(name, "ax"))   fp = &Acc(b)[0];
+    else if (streq(name, "ay"))   fp = &Acc(b)[1];
+#if defined(THREEDIM)
+    else if (streq(name, "z"))    fp = &Pos(b)[2];
+    else if (streq(name, "vz"))   fp = &Vel(b)[2];
+    else if (streq(name, "az"))   fp = &Acc(b)[2];
+#endif
+    else if (streq(name, "phi"))  fp = &Phi(b);
+    else if (streq(name, "aux"))  fp = &Aux(b);
+    else if (streq(name, "dens")) fp = &Dens(b);
+    else if (streq(name, "eps"))  fp = &Eps(b);
+    if (fp)
+        return vm_ld(OP_LDF, (char *)fp - (char *)b, FALSE);
+
+    if (streq(name, "key"))  return vm_ld(OP_LDK, 0, TRUE);
+    if (streq(name, "i"))    return vm_ld(OP_LDI, 0, TRUE);
+    if (streq(name, "t"))    return vm_ld(OP_LDT, 0, FALSE);
+    if (streq(name, "r")) {                     /* the macro */
+        save = vs;
+#if defined(THREEDIM)
+        vs = "sqrt(x*x+y*y+z*z)";
+#else
+        vs = "sqrt(x*x+y*y)";
+#endif
+        v = vm_expr();
+        vs = save;
+        return v;
+    }
+    if (streq(name, "PI"))        return vm_const(PI, FALSE);
+    if (streq(name, "TWO_PI"))    return vm_const(TWO_PI, FALSE);
+    if (streq(name, "FOUR_PI"))   return vm_const(FOUR_PI, FALSE);
+    if (streq(name, "HALF_PI"))   return vm_const(HALF_PI, FALSE);
+    if (streq(name, "FRTHRD_PI")) return vm_const(FRTHRD_PI, FALSE);
+    if (streq(name, "HUGE"))      return vm_const(HUGE, FALSE);
+    if (streq(name, "TRUE"))      return vm_const(1.0, TRUE);
+    if (streq(name, "FALSE"))     return vm_const(0.0, TRUE);
+    vm_fail("unknown variable");
+    return vm_const(0.0, FALSE);
+}
+
+/*
+ * functions and macros; type 'r' returns real, 'i' takes and returns int,
+ * 's' returns int, '=' the type of its arguments
+ */
+
+local struct {
+    string name;
+    int    op, nargs;
+    char   type;
+} vmfunc[] = {
+    { "sqrt",  OP_SQRT,  1, 'r' },
+    { "exp",   OP_EXP,   1, 'r' },
+    { "log",   OP_LOG,   1, 'r' },
+    { "log10", OP_LOG10, 1, 'r' },
+    { "sin",   OP_SIN,   1, 'r' },
+    { "cos",   OP_COS,   1, 'r' },
+    { "tan",   OP_TAN,   1, 'r' },
+    { "asin",  OP_ASIN,  1, 'r' },
+    { "acos",  OP_ACOS,  1, 'r' },
+    { "atan",  OP_ATAN,  1, 'r' },
+    { "sinh",  OP_SINH,  1, 'r' },
+    { "cosh",  OP_COSH,  1, 'r' },
+    { "tanh",  OP_TANH,  1, 'r' },
+    { "fabs",  OP_FABS,  1, 'r' },
+    { "floor", OP_FLOOR, 1, 'r' },
+    { "ceil",  OP_CEIL,  1, 'r' },
+    { "sqr",   OP_SQR,   1, 'r' },
+    { "atan2", OP_ATAN2, 2, 'r' },
+    { "pow",   OP_POW,   2, 'r' },
+    { "fmod",  OP_FMOD,  2, 'r' },
+    { "hypot", OP_HYPOT, 2, 'r' },
+    { "abs",   OP_FABS,  1, 'i' },
+    { "ABS",   OP_ABSM,  1, '=' },
+    { "SGN",   OP_SGNM,  1, 's' },
+    { "MIN",   OP_MINM,  2, '=' },
+    { "MAX",   OP_MAXM,  2, '=' },
+    { NULL,    0,        0,  0  },
+};
+
+local vmval vm_call(string name)
+{
+    vmval arg[2];
+    bool isint;
+    int f, k;
+
+    for (f=0; vmfunc[f].name != NULL; f++)
+        if (streq(name, vmfunc[f].name)) break;
+    if (vmfunc[f].name == NULL) vm_fail("unknown function");
+    isint = (vmfunc[f].type != 'r');
+    for (k=0; k<vmfunc[f].nargs; k++) {
+        if (k > 0) vm_expect(",");
+        arg[k] = vm_expr();
+        if (vmfunc[f].type == 'i')
+            arg[k] = vm_toint(arg[k]);
+        else if (vmfunc[f].type == '=')
+            isint = isint && arg[k].isint;
+    }
+    vm_expect(")");
+    return vm_apply(vmfunc[f].op, isint, vmfunc[f].nargs, arg);
+}
+
+local vmval vm_unary(void)
+{
+    char name[32], *save;
+    vmval v;
+
+    if (vm_match("-")) {
+        v = vm_unary();
+        return vm_op1(v.isint ? OP_INEG : OP_NEG, v.isint, v);
+    }
+    if (vm_match("+"))
+        return vm_unary();
+    if (vm_match("!"))
+        return vm_op1(OP_NOT, TRUE, vm_unary());
+    if (vm_match("(")) {
+        save = vs;
+        if (vm_ident(name, sizeof(name))) {
+            if (streq(name, "int") && vm_match(")"))
+                return vm_toint(vm_unary());
+            if ((streq(name, "real") || streq(name, "double")) && vm_match(")")) {
+                v = vm_unary();
+                v.isint = FALSE;
+                return v;
+            }
+        }
+        vs = save;
+        v = vm_expr();
+        vm_expect(")");
+        return v;
+    }
+    while (isspace(*vs)) vs++;
+    if (isdigit(*vs) || *vs == '.')
+        return vm_number();
+    if (!vm_ident(name, sizeof(name)))
+        vm_fail("syntax error");
+    if (vm_match("("))
+        return vm_call(name);
+    return vm_var(name);
+}
+
+local vmval vm_mul(void)
+{
+    vmval a = vm_unary(), b;
+
+    for (;;) {
+        if (vm_match("*")) {
+            b = vm_unary();
+            if (a.isint && b.isint)
+                a = vm_op2(OP_IMUL, TRUE, a, b);
+            else
+                a = vm_op2(OP_MUL, FALSE, a, b);
+        } else if (vm_match("/")) {
+            b = vm_unary();
+            if (a.isint && b.isint)
+                a = vm_op2(OP_IDIV, TRUE, a, b);
+            else
+                a = vm_op2(OP_DIV, FALSE, a, b);
+        } else if (vm_match("%")) {
+            b = vm_unary();
+            if (!a.isint || !b.isint) vm_fail("% needs int operands");
+            a = vm_op2(OP_IMOD, TRUE, a, b);
+        } else
+            return a;
+    }
+}
+
+local vmval vm_add(void)
+{
+    vmval a = vm_mul(), b;
+
+    for (;;) {
+        if (vm_match("+")) {
+            b = vm_mul();
+            a = vm_op2(OP_ADD, a.isint && b.isint, a, b);
+        } else if (vm_match("-")) {
+            b = vm_mul();
+            a = vm_op2(OP_SUB, a.isint && b.isint, a, b);
+        } else
+            return a;
+    }
+}
+
+local vmval vm_rel(void)
+{
+    vmval a = vm_add();
+
+    for (;;) {
+        if      (vm_match("<="))  a = vm_op2(OP_LE, TRUE, a, vm_add());
+        else if (vm_match(">="))  a = vm_op2(OP_GE, TRUE, a, vm_add());
+        else if (vm_match("<"))   a = vm_op2(OP_LT, TRUE, a, vm_add());
+        else if (vm_match(">"))   a = vm_op2(OP_GT, TRUE, a, vm_add());
+        else return a;
+    }
+}
+
+local vmval vm_equ(void)
+{
+    vmval a = vm_rel();
+
+    for (;;) {
+        if      (vm_match("=="))  a = vm_op2(OP_EQ, TRUE, a, vm_rel());
+        else if (vm_match("!="))  a = vm_op2(OP_NE, TRUE, a, vm_rel());
+        else return a;
+    }
+}
+
+/* there are no side effects, so && and || can evaluate both sides */
+
+local vmval vm_and(void)
+{
+    vmval a = vm_equ();
+
+    while (vm_match("&&"))
+        a = vm_op2(OP_AND, TRUE, a, vm_equ());
+    return a;
+}
+
+local vmval vm_or(void)
+{
+    vmval a = vm_and();
+
+    while (vm_match("||"))
+        a = vm_op2(OP_OR, TRUE, a, vm_and());
+    return a;
+}
+
+local vmval vm_expr(void)
+{
+    vmval arg[3];
+
+    arg[0] = vm_or();
+    if (!vm_match("?"))
+        return arg[0];
+    arg[1] = vm_expr();
+    vm_expect(":");
+    arg[2] = vm_expr();
+    return vm_apply(OP_SEL, arg[1].isint && arg[2].isint, 3, arg);
+}
+
+/*
+ * BODYTRANS_VM:  compile expr, of type "real" or "int", and return the
+ *		  function, with its batch version in *fn_n; or NULL if
+ *		  the expression is not understood.
+ */
+
+proc bodytrans_vm(string type, string expr, proc *fn_n)
+{
+    vmval v;
+    int k;
+
+#if !defined(DOUBLEPREC)
+    return NULL;                                /* compile it, see above */
+#endif
+    for (k=0; k<nvm; k++)
+        if (vmprogs[k].type == type[0] && streq(vmprogs[k].expr, expr))
+            break;
+    if (k == nvm) {                             /* a new one */
+        if (nvm == MAXVM) {
+            dprintf(1, "bodytrans_vm: more than %d expressions\n", MAXVM);
+            return NULL;
+        }
+        vp = vmprogs + nvm;
+        vp->type = type[0];
+        vp->ncode = 0;
+        vtop = 0;
+        vs = expr;
+        if (setjmp(vjmp) != 0)
+            return NULL;
+        v = vm_expr();
+        while (isspace(*vs)) vs++;
+        if (*vs) vm_fail("syntax error");
+        vp->res = vm_reg(&v);
+        vp->expr = scopy(expr);
+        nvm++;
+        dprintf(1, "bodytrans_vm: %s %s in %d instructions\n",
+                type, expr, vp->ncode);
+    }
+    if (type[0] == 'i') {
+        *fn_n = (proc) vm_i_n[k];
+        return (proc) vm_i[k];
+    }
+    *fn_n = (proc) vm_r_n[k];
+    return (proc) vm_r[k];
+}
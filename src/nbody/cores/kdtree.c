@@ -0,0 +1,262 @@
+/*
+ * KDTREE.C: k-d tree for (K-)nearest neighbour searches in any dimension
+ *
+ *	The tree splits at the median along the longest side of the bounding
+ *	box, until at most nleaf points are left.  Since the split is always
+ *	at n/2 the node layout follows from the number of points alone, so
+ *	subtrees can be built in parallel (OpenMP tasks).  Queries only read
+ *	the tree, and can be done in parallel by the caller.
+ *
+ *	16-oct-2026	V1.0 created, for snapdens, snapnear and snapbinary
+ */
+
+#include <stdinc.h>
+#include <kdtree.h>
+
+#define NLEAF  8              /* default max number of points in a leaf */
+#define NTASK  16384          /* only spawn tasks for larger subtrees */
+
+local int count_nodes(int n, int nleaf)
+{
+    if (n <= nleaf) return 1;
+    return 1 + count_nodes(n/2, nleaf) + count_nodes(n-n/2, nleaf);
+}
+
+/*
+ * SELECT_KTH:  permute perm[lo..hi-1] such that perm[k] has the k-th
+ *		coordinate d, with smaller ones before and larger after it
+ */
+
+local void select_kth(real *pos, int ndim, int d, int *perm, int lo, int hi, int k)
+{
+    int i, j, t;
+    real x;
+
+    for (hi--; lo < hi; ) {
+        x = pos[perm[k]*ndim+d];
+        i = lo;
+        j = hi;
+        do {
+            while (pos[perm[i]*ndim+d] < x) i++;
+            while (x < pos[perm[j]*ndim+d]) j--;
+            if (i <= j) {
+                t = perm[i]; perm[i] = perm[j]; perm[j] = t;
+                i++;
+                j--;
+            }
+        } while (i <= j);
+        if (j < k) lo = i;
+        if (k < i) hi = j;
+    }
+}
+
+local void build(kdtree *kd, real *pos, int node, int lo, int hi)
+{
+    kdnode *np = kd->node + node;
+    int ndim = kd->ndim, n = hi-lo, mid, i, d, split;
+    real *bmin = kd->box + 2*ndim*node, *bmax = bmin + ndim, *p;
+
+    for (d=0; d<ndim; d++) {
+        bmin[d] =  HUGE;
+        bmax[d] = -HUGE;
+    }
+    for (i=lo; i<hi; i++) {
+        p = pos + kd->idx[i]*ndim;
+        for (d=0; d<ndim; d++) {
+            if (p[d] < bmin[d]) bmin[d] = p[d];
+            if (p[d] > bmax[d]) bmax[d] = p[d];
+        }
+    }
+    np->lo = lo;
+    np->hi = hi;
+    if (n <= kd->nleaf) {
+        np->left = np->right = -1;
+        return;
+    }
+    for (d=1, split=0; d<ndim; d++)
+        if (bmax[d]-bmin[d] > bmax[split]-bmin[split]) split = d;
+    mid = lo + n/2;
+    select_kth(pos, ndim, split, kd->idx, lo, hi, mid);
+    np->left  = node + 1;
+    np->right = node + 1 + count_nodes(mid-lo, kd->nleaf);
+#ifdef _OPENMP
+#pragma omp task if(n > NTASK)
+#endif
+    build(kd, pos, np->left, lo, mid);
+    build(kd, pos, np->right, mid, hi);
+#ifdef _OPENMP
+#pragma omp taskwait
+#endif
+}
+
+/*
+ * KD_BUILD:  build a tree of npts points pos[npts*ndim]; the points are
+ *	      copied, so pos can be released.  nleaf <= 0 uses the default.
+ */
+
+kdtree *kd_build(real *pos, int npts, int ndim, int nleaf)
+{
+    kdtree *kd;
+    int i, d;
+
+    if (ndim < 1) error("kd_build: ndim=%d", ndim);
+    kd = (kdtree *) allocate(sizeof(kdtree));
+    kd->ndim  = ndim;
+    kd->npts  = npts;
+    kd->nleaf = nleaf > 0 ? nleaf : NLEAF;
+    kd->nnode = count_nodes(npts, kd->nleaf);
+    kd->node  = (kdnode *) allocate(kd->nnode * sizeof(kdnode));
+    kd->box   = (real *) allocate(2 * (size_t)kd->nnode * ndim * sizeof(real));
+    kd->pos   = (real *) allocate((size_t)npts * ndim * sizeof(real));
+    kd->idx   = (int *) allocate((npts > 0 ? npts : 1) * sizeof(int));
+    for (i=0; i<npts; i++)
+        kd->idx[i] = i;
+#ifdef _OPENMP
+#pragma omp parallel
+#pragma omp single
+#endif
+    build(kd, pos, 0, 0, npts);
+#ifdef _OPENMP
+#pragma omp parallel for private(d)
+#endif
+    for (i=0; i<npts; i++)
+        for (d=0; d<ndim; d++)
+            kd->pos[i*ndim+d] = pos[kd->idx[i]*ndim+d];
+    dprintf(1,"kd_build: %d points, ndim=%d, %d nodes\n",npts,ndim,kd->nnode);
+    return kd;
+}
+
+void kd_free(kdtree *kd)
+{
+    free(kd->node);
+    free(kd->box);
+    free(kd->pos);
+    free(kd->idx);
+    free(kd);
+}
+
+/*
+ * The K nearest are kept in a bounded max-heap on (d2,idx), so that of
+ * equal distances the lowest index wins, as in a brute force search.
+ */
+
+typedef struct knnq {
+    real *x;                /* query point */
+    int  k, n;              /* max and current length of the heap */
+    int  skip;              /* index to skip, e.g. the query point itself */
+    int  *idx;              /* heap: index */
+    real *d2;               /*       and distance squared */
+} knnq;
+
+#define FARTHER(a,ia,b,ib)  ((a) > (b) || ((a) == (b) && (ia) > (ib)))
+
+local void sift_down(knnq *q, int i, int n)
+{
+    int c, it;
+    real dt;
+
+    for (;;) {
+        c = 2*i+1;
+        if (c >= n) break;
+        if (c+1 < n && FARTHER(q->d2[c+1],q->idx[c+1],q->d2[c],q->idx[c])) c++;
+        if (!FARTHER(q->d2[c],q->idx[c],q->d2[i],q->idx[i])) break;
+        dt = q->d2[i]; q->d2[i] = q->d2[c]; q->d2[c] = dt;
+        it = q->idx[i]; q->idx[i] = q->idx[c]; q->idx[c] = it;
+        i = c;
+    }
+}
+
+local void heap_add(knnq *q, real d2, int j)
+{
+    int i, p;
+
+    if (q->n < q->k) {                      /* not full: sift up */
+        for (i = q->n++; i > 0; i = p) {
+            p = (i-1)/2;
+            if (!FARTHER(d2,j,q->d2[p],q->idx[p])) break;
+            q->d2[i] = q->d2[p];
+            q->idx[i] = q->idx[p];
+        }
+        q->d2[i] = d2;
+        q->idx[i] = j;
+    } else if (FARTHER(q->d2[0],q->idx[0],d2,j)) {  /* replace the farthest */
+        q->d2[0] = d2;
+        q->idx[0] = j;
+        sift_down(q, 0, q->n);
+    }
+}
+
+/* distance squared from x to the bounding box of a node */
+
+local real box_dist(kdtree *kd, int node, real *x)
+{
+    int d, ndim = kd->ndim;
+    real *bmin = kd->box + 2*ndim*node, *bmax = bmin + ndim, d2 = 0.0;
+
+    for (d=0; d<ndim; d++) {
+        if (x[d] < bmin[d])
+            d2 += sqr(bmin[d]-x[d]);
+        else if (x[d] > bmax[d])
+            d2 += sqr(x[d]-bmax[d]);
+    }
+    return d2;
+}
+
+local void search(kdtree *kd, int node, knnq *q)
+{
+    kdnode *np = kd->node + node;
+    int i, d, ndim = kd->ndim, first, second;
+    real d2, df, ds, *p;
+
+    if (np->left < 0) {                     /* leaf: check its points */
+        for (i=np->lo, p=kd->pos+i*ndim; i<np->hi; i++, p+=ndim) {
+            if (kd->idx[i] == q->skip) continue;
+            for (d=0, d2=0.0; d<ndim; d++)
+                d2 += sqr(p[d]-q->x[d]);
+            heap_add(q, d2, kd->idx[i]);
+        }
+        return;
+    }
+    df = box_dist(kd, np->left, q->x);      /* visit the nearer child first */
+    ds = box_dist(kd, np->right, q->x);
+    if (df <= ds) {
+        first = np->left;
+        second = np->right;
+    } else {
+        first = np->right;
+        second = np->left;
+        d2 = df; df = ds; ds = d2;
+    }
+    if (q->n < q->k || df <= q->d2[0]) search(kd, first, q);
+    if (q->n < q->k || ds <= q->d2[0]) search(kd, second, q);
+}
+
+/*
+ * KD_KNN:  find the k nearest points to x, skipping the point with
+ *	    original index skip (use -1 to skip none).  Returns their number
+ *	    (less than k only if there are not enough points), with the
+ *	    indices and distances squared in idx[] and d2[], nearest first.
+ *	    Thread safe.
+ */
+
+int kd_knn(kdtree *kd, real *x, int k, int skip, int *idx, real *d2)
+{
+    knnq q;
+    int m, it;
+    real dt;
+
+    q.x = x;
+    q.k = k;
+    q.n = 0;
+    q.skip = skip;
+    q.idx = idx;
+    q.d2 = d2;
+    if (k > 0 && kd->npts > 0)
+        search(kd, 0, &q);
+    for (m = q.n-1; m > 0; m--) {           /* heap sort: nearest first */
+        dt = d2[0]; d2[0] = d2[m]; d2[m] = dt;
+        it = idx[0]; idx[0] = idx[m]; idx[m] = it;
+        sift_down(&q, 0, m);
+    }
+    return q.n;
+}
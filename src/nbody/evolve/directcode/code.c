@@ -9,6 +9,7 @@
  *     21-jul-09   1.1c  added code to check euler steps at PiTP09
  *     29-jul-09   1.2   added option eps < 0 for PN force   PJT
  *     30-jul-09   1.3   added option gravc=                 PJT
+ *     16-oct-26   1.4   forces from a tiled kernel, in threads (np=)
  */
 
 #define global
@@ -38,7 +39,7 @@ string defv[] = {		/* DEFAULT PARAMETER VALUES */
 
     "gravc=1\n                    Gravitatonal constant",
 
-    "VERSION=1.3b\n		  6-dec-2016 PJT",
+    "VERSION=1.4\n		  16-oct-2026",
     NULL,
 };
 
@@ -135,19 +136,14 @@ void stepsystem_leapfrog(void)
 
   dt = 1.0 / freq;				/* get basic time-step      */
   dthf = 0.5 * dt;				/* and basic half-step      */
-  if (nstep==0) {
-    for (p = bodytab; p < bodytab+nbody; p++) {
-      hackgrav(p);				/*   compute new acc for p  */
-    }
-  }
+  if (nstep==0)
+    hackgrav_all();				/* compute initial acc      */
   output();					/* do major or minor output */
   for (p = bodytab; p < bodytab+nbody; p++) {	/* loop advancing bodies    */
     ADDMULVS(Vel(p), Acc(p), dthf);             /* advance v by 1/2 step    */
     ADDMULVS(Pos(p), Vel(p), dt);               /* advance r by 1 step      */
   }
-  for (p = bodytab; p < bodytab+nbody; p++) {	/* loop getting new forces  */
-    hackgrav(p);				/*   compute new acc for p  */
-  }
+  hackgrav_all();				/* get new forces           */
   for (p = bodytab; p < bodytab+nbody; p++) {   /* loop over all bodies     */
     ADDMULVS(Vel(p), Acc(p), dthf);             /* advance v by 1/2 step    */
   }
@@ -166,19 +162,14 @@ void stepsystem_euler(void)
 
   dt = 1.0 / freq;				/* get basic time-step      */
 
-  if (nstep==0) {
-    for (p = bodytab; p < bodytab+nbody; p++) {
-      hackgrav(p);				/*   compute new acc for p  */
-    }
-  }
+  if (nstep==0)
+    hackgrav_all();				/* compute initial acc      */
   output();					/* do major or minor output */
   for (p = bodytab; p < bodytab+nbody; p++) {	/* loop advancing bodies    */
     ADDMULVS(Pos(p), Vel(p), dt);               /* advance r by 1 step      */
     ADDMULVS(Vel(p), Acc(p), dt);               /* advance v by 1 step      */
   }
-  for (p = bodytab; p < bodytab+nbody; p++) {	/* loop getting new forces  */
-    hackgrav(p);				/*   compute new acc for p  */
-  }
+  hackgrav_all();				/* get new forces           */
 
   nstep++;					/* count another mu-step    */
   tnow = tnow + dt;				/* finally, advance time    */
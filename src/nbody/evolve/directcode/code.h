@@ -53,3 +53,4 @@ void pickvec(vector x, bool cf);
 
 /* grav.c */
 void hackgrav(bodyptr p);
+void hackgrav_all(void);
@@ -3,6 +3,7 @@
  *   
  *      16-feb-04    cloned from hackcode1 for DirectCode
  *      29-jul-09    eps < 0 allowed for pseudo-newtonian
+ *      16-oct-26    hackgrav_all: tiled kernel on copies of the positions
  *
  */
 
@@ -65,3 +66,166 @@ void hackgrav(bodyptr p)
 }
 
 
+
+/*
+ * HACKGRAV_ALL: evaluate the grav field at all particles. Positions and
+ * masses are copied to one array per component; the field is summed
+ * for ITILE particles at a time, with the innermost loop over those
+ * particles so it can be done in SIMD registers, and the other
+ * particles are taken in blocks of JBLOCK that stay in the L1 cache.
+ * The tiles are divided over the threads (np=). Each pair takes one
+ * square root and one division, so results differ from hackgrav() in
+ * the last bits.
+ */
+
+#define ITILE   8		/* field particles per tile, multiple of SIMD width */
+#define JBLOCK  512		/* source particles per block */
+
+local int   nsoa = 0;		/* length of the copies */
+local real *xsoa, *ysoa, *zsoa;	/* positions */
+local real *msoa;		/* masses, times gravc */
+
+local int gravtile_plummer(int i0);
+local int gravtile_pn(int i0);
+local void gravtile_save(int i0, real *ax, real *ay, real *az, real *phi);
+
+void hackgrav_all(void)
+{
+  int i, nbad = 0;
+  bodyptr p;
+
+  if (nbody > nsoa) {				/* (re)allocate copies      */
+    xsoa = (real *) reallocate(xsoa, nbody * sizeof(real));
+    ysoa = (real *) reallocate(ysoa, nbody * sizeof(real));
+    zsoa = (real *) reallocate(zsoa, nbody * sizeof(real));
+    msoa = (real *) reallocate(msoa, nbody * sizeof(real));
+    nsoa = nbody;
+  }
+  for (i = 0, p = bodytab; i < nbody; i++, p++) {	/* copy positions   */
+    xsoa[i] = Pos(p)[0];
+    ysoa[i] = Pos(p)[1];
+    zsoa[i] = Pos(p)[2];
+    msoa[i] = gravc * Mass(p);
+  }
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic) reduction(+:nbad)
+#endif
+  for (i = 0; i < nbody; i += ITILE)		/* loop over tiles          */
+    nbad += (eps >= 0.0 ? gravtile_plummer(i) : gravtile_pn(i));
+  if (nbad > 0) error("PN violation at time=%g",tnow);
+}
+
+/*
+ * GRAVTILE_PLUMMER: field at particles i0..i0+ITILE-1 for eps >= 0;
+ * a short last tile repeats its first particle in the unused lanes.
+ * All lanes compute every pair, and the particle itself is masked out
+ * afterwards, so the loop has no branches.
+ */
+
+local int gravtile_plummer(int i0)
+{
+  real x0[ITILE], y0[ITILE], z0[ITILE];
+  real ax[ITILE], ay[ITILE], az[ITILE], phi0[ITILE];
+  int idx[ITILE], ii, j, jb, jend;
+  real eps2 = eps*eps;
+
+  for (ii = 0; ii < ITILE; ii++) {
+    idx[ii] = (i0 + ii < nbody ? i0 + ii : i0);
+    x0[ii] = xsoa[idx[ii]];
+    y0[ii] = ysoa[idx[ii]];
+    z0[ii] = zsoa[idx[ii]];
+    ax[ii] = ay[ii] = az[ii] = phi0[ii] = 0.0;
+  }
+  for (jb = 0; jb < nbody; jb += JBLOCK) {	/* blocks of sources        */
+    jend = MIN(jb + JBLOCK, nbody);
+    for (j = jb; j < jend; j++) {
+      real xj = xsoa[j], yj = ysoa[j], zj = zsoa[j], mj = msoa[j];
+#if defined(_OPENMP)
+#pragma omp simd
+#endif
+      for (ii = 0; ii < ITILE; ii++) {		/*   field particles        */
+	real dx = xj - x0[ii], dy = yj - y0[ii], dz = zj - z0[ii];
+	real drsq = dx*dx + dy*dy + dz*dz;
+	real rinv, phii, mor3;
+
+	drsq += eps2;				/*   use standard softening */
+	rinv = 1.0 / sqrt(drsq);
+	phii = mj * rinv;
+	mor3 = phii * rinv * rinv;
+	phii = (idx[ii] != j ? phii : 0.0);	/*   skip self              */
+	mor3 = (idx[ii] != j ? mor3 : 0.0);
+	phi0[ii] -= phii;
+	ax[ii] += dx * mor3;
+	ay[ii] += dy * mor3;
+	az[ii] += dz * mor3;
+      }
+    }
+  }
+  gravtile_save(i0, ax, ay, az, phi0);
+  return 0;
+}
+
+/*
+ * GRAVTILE_PN: same for the pseudo-newtonian eps < 0; returns the
+ * number of pairs closer than -eps.
+ */
+
+local int gravtile_pn(int i0)
+{
+  real x0[ITILE], y0[ITILE], z0[ITILE];
+  real ax[ITILE], ay[ITILE], az[ITILE], phi0[ITILE];
+  int idx[ITILE], nbad[ITILE], ii, j, jb, jend, n = 0;
+
+  for (ii = 0; ii < ITILE; ii++) {
+    idx[ii] = (i0 + ii < nbody ? i0 + ii : i0);
+    x0[ii] = xsoa[idx[ii]];
+    y0[ii] = ysoa[idx[ii]];
+    z0[ii] = zsoa[idx[ii]];
+    ax[ii] = ay[ii] = az[ii] = phi0[ii] = 0.0;
+    nbad[ii] = 0;
+  }
+  for (jb = 0; jb < nbody; jb += JBLOCK) {	/* blocks of sources        */
+    jend = MIN(jb + JBLOCK, nbody);
+    for (j = jb; j < jend; j++) {
+      real xj = xsoa[j], yj = ysoa[j], zj = zsoa[j], mj = msoa[j];
+#if defined(_OPENMP)
+#pragma omp simd
+#endif
+      for (ii = 0; ii < ITILE; ii++) {		/*   field particles        */
+	real dx = xj - x0[ii], dy = yj - y0[ii], dz = zj - z0[ii];
+	real drsq = dx*dx + dy*dy + dz*dz;
+	real r = sqrt(drsq), drabs, inv, phii, mor3;
+
+	drabs = r + eps;			/*   r-e                    */
+	inv = 1.0 / (drabs * r);
+	phii = mj * r * inv;
+	mor3 = phii * inv;
+	nbad[ii] += (idx[ii] != j && drabs < 0);
+	phii = (idx[ii] != j ? phii : 0.0);	/*   skip self              */
+	mor3 = (idx[ii] != j ? mor3 : 0.0);
+	phi0[ii] -= phii;
+	ax[ii] += dx * mor3;
+	ay[ii] += dy * mor3;
+	az[ii] += dz * mor3;
+      }
+    }
+  }
+  gravtile_save(i0, ax, ay, az, phi0);
+  for (ii = 0; ii < ITILE && i0 + ii < nbody; ii++)
+    n += nbad[ii];
+  return n;
+}
+
+local void gravtile_save(int i0, real *ax, real *ay, real *az, real *phi)
+{
+  bodyptr p;
+  int ii;
+
+  for (ii = 0; ii < ITILE && i0 + ii < nbody; ii++) {
+    p = bodytab + i0 + ii;
+    Phi(p) = phi[ii];
+    Acc(p)[0] = ax[ii];
+    Acc(p)[1] = ay[ii];
+    Acc(p)[2] = az[ii];
+  }
+}
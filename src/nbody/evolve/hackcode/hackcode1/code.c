@@ -13,6 +13,8 @@
  *                plus LOTS of prototype cleanup
  *     23-jul-11  V1.5    Use log= to be able to bypass log  pjt
  *                        removed debug= to enable system key
+ *     16-oct-26  V1.6    forces computed in threads (np=) with OpenMP
+ *     16-oct-26  V1.7    ncrit= to walk the tree once per group of bodies
  */
 
 #define global                                  /* don't default to extern  */
@@ -39,6 +41,7 @@ string defv[] = {		/* DEFAULT PARAMETER VALUES */
     "eps=0.05\n			  usual potential softening ",
     "tol=1.0\n			  cell subdivision tolerence ",
     "fcells=1.0\n		  cell allocation parameter ",
+    "ncrit=0\n			  max bodies per group walk (0: walk per body) ",
     "options=mass,phase\n	  misc. control options ",
 
     "tstop=2.0\n		  time to stop integration ",
@@ -46,7 +49,7 @@ string defv[] = {		/* DEFAULT PARAMETER VALUES */
     "minor_freqout=32.0\n	  minor data-output frequency ",
 
     "log=-\n                      logging output",
-    "VERSION=1.5b\n		  1-apr-2023 PJT",
+    "VERSION=1.7\n		  16-oct-2026",
     NULL,
 };
 
@@ -79,6 +82,7 @@ void startrun(void)
     savefile = getparam("save");
     logfile = getparam("log");
     options = getparam("options");		/* set control options      */
+    ncrit = getiparam("ncrit");			/* group walk if > 0        */
     if (*contfile)				/* resume interrupted run   */
 	restorestate(contfile);
     else if (*restfile) {			/* resume w/ new parameters */
@@ -160,24 +164,41 @@ void stepsystem(void)
 {
     real dthf, dt;
     register bodyptr p;
-    vector acc1, dacc, dvel, vel1, dpos;
+    vector dacc, dvel, vel1, dpos;
+    int i, n2b, nbc;
+    permanent real *acc1 = NULL;		/* old accelerations        */
 
     dt = 1.0 / freq;				/* get basic time-step      */
     dthf = 0.5 * dt;				/* and basic half-step      */
     maketree(bodytab, nbody);			/* load bodies into tree    */
+    if (nstep > 0) {				/* save old accelerations   */
+	if (acc1 == NULL)
+	    acc1 = (real *) allocate(nbody * NDIM * sizeof(real));
+	for (i = 0; i < nbody; i++)
+	    SETV(acc1 + i*NDIM, Acc(bodytab + i));
+    }
     nfcalc = n2bcalc = nbccalc = 0;		/* zero interaction counts  */
-    for (p = bodytab; p < bodytab+nbody; p++) { /* loop over particles      */
-	SETV(acc1, Acc(p));			/*   save old acceleration  */
-	hackgrav(p);				/*   compute new acc for p  */
-	nfcalc++;				/*   count force calcs      */
-	n2bcalc += n2bterm;			/*   and 2-body terms       */
-	nbccalc += nbcterm;			/*   and body-cell terms    */
-	if (nstep > 0) {			/*   if past first step?    */
-	    SUBV(dacc, Acc(p), acc1);		/*     use change in accel  */
-	    MULVS(dvel, dacc, dthf);		/*     to make 2nd order    */
-	    ADDV(Vel(p), Vel(p), dvel);		/*     correction to vel    */
+    if (ncrit > 0)				/* one walk per group?      */
+	hackgrav_group(bodytab, nbody, ncrit, &nfcalc, &n2bcalc, &nbccalc);
+    else {
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic,64) private(p,n2b,nbc) reduction(+:nfcalc,n2bcalc,nbccalc)
+#endif
+	for (i = 0; i < nbody; i++) {		/* loop over particles      */
+	    p = bodytab + i;
+	    hackgrav_r(p, &n2b, &nbc);		/*   compute new acc for p  */
+	    nfcalc++;				/*   count force calcs      */
+	    n2bcalc += n2b;			/*   and 2-body terms       */
+	    nbccalc += nbc;			/*   and body-cell terms    */
 	}
     }
+    if (nstep > 0)				/* if past first step?      */
+	for (i = 0; i < nbody; i++) {
+	    p = bodytab + i;
+	    SUBV(dacc, Acc(p), acc1 + i*NDIM);	/*   use change in accel    */
+	    MULVS(dvel, dacc, dthf);		/*   to make 2nd order      */
+	    ADDV(Vel(p), Vel(p), dvel);		/*   correction to vel      */
+	}
     output();					/* do major or minor output */
     for (p = bodytab; p < bodytab+nbody; p++) {	/* loop advancing bodies    */
 	MULVS(dvel, Acc(p), dthf);		/*   use current accel'n    */
@@ -30,6 +30,7 @@ global real fcells;			/* ratio of cells/bodies allocated */
 
 global real tol;                        /* accuracy parameter: 0.0 => exact */
 global real eps;                        /* potential softening parameter */
+global int ncrit;			/* max bodies per group walk, or 0 */
 
 global int n2bterm;                     /* number 2-body of terms evaluated */
 global int nbcterm;			/* num of body-cell terms evaluated */
@@ -1,131 +1,507 @@
 /*
- * GRAV.C: routines to compute gravity. Public routines: hackgrav().
+ * GRAV.C: routines to compute gravity. Public routines: hackgrav(),
+ *         hackgrav_r(), hackgrav_group().
  *	21-may-92 extra forward decl for SGI
+ *	16-oct-26 walk state per call, so forces can be computed in threads
+ *	16-oct-26 hackgrav_group: one walk per group of bodies
  */
 
 #include "code.h"
 
 /*
- * HACKGRAV: evaluate grav field at a given particle.
+ * WALKSTATE: everything a tree walk for one body needs, so that walks
+ * for different bodies can run at the same time.
  */
 
-local bodyptr pskip;			/* body to skip in force evaluation */
-local vector pos0;			/* point to evaluate field at */
-local real phi0;			/* resulting potential at pos0 */
-local vector acc0;			/* resulting acceleration at pos0 */
+typedef struct {
+    bodyptr pskip;			/* body to skip in force evaluation */
+    vector pos0;			/* point to evaluate field at */
+    real phi0;				/* resulting potential at pos0 */
+    vector acc0;			/* resulting acceleration at pos0 */
+    nodeptr pmem;			/* for memorized data to be shared */
+    vector dr;				/* between gravsub and subdivp */
+    real drsq;
+    real tolsq;				/* tol squared */
+    int n2bterm;			/* number 2-body of terms evaluated */
+    int nbcterm;			/* num of body-cell terms evaluated */
+} walkstate, *walkptr;
+
+/*
+ * ILIST: an interaction list of bodies or cells, one array per
+ * component, so the force loops over it can be vectorized.
+ */
+
+typedef struct {
+    int n, max;				/* length used and allocated */
+    real *mass;
+    real *pos[NDIM];
+    nodeptr *node;			/* bodies only, to skip self */
+#ifdef QUADPOLE
+    real *quad[NDIM][NDIM];		/* cells only */
+#endif
+} ilist;
+
+/*
+ * GROUPSTATE: a group of bodies close together, and the lists of
+ * bodies and cells that all of them interact with.
+ */
+
+typedef struct {
+    bodyptr *gbody;			/* bodies in the group */
+    int ngbody, maxgbody;
+    vector gcen;			/* center of the group */
+    real grad;				/* all bodies within grad of gcen */
+    real tolsq;				/* tol squared */
+    ilist blist;			/* bodies to interact with */
+    ilist clist;			/* cells to interact with */
+} groupstate, *groupptr;
 
 /* forward declarations: */
-local void walksub(nodeptr, real);
-local bool subdivp(nodeptr, real);
-local void gravsub(nodeptr);
+local void hackwalk(walkptr);
+local void walksub(walkptr, nodeptr, real);
+local bool subdivp(walkptr, nodeptr, real);
+local void gravsub(walkptr, nodeptr);
+local int  findgroups(nodeptr, int);
+local void addgroup(nodeptr);
+local void groupbodies(groupptr, nodeptr);
+local void collectbodies(groupptr, nodeptr);
+local void groupwalk(groupptr, nodeptr, real);
+local void listadd(ilist *, nodeptr);
+local void listfree(ilist *);
+local int  groupforce(groupptr, bodyptr);
+
+local nodeptr *grouptab = NULL;		/* groups found by findgroups */
+local int ngroup = 0, maxgroup = 0;
+
+/*
+ * HACKGRAV: evaluate grav field at a given particle; the number of
+ * interactions is left in n2bterm and nbcterm.
+ */
 
 void hackgrav(bodyptr p)
 {
-    pskip = p;					/* exclude p from f.c.      */
-    SETV(pos0, Pos(p));				/* set field point          */
-    phi0 = 0.0;					/* init potential, etc      */
-    CLRV(acc0);
-    n2bterm = nbcterm = 0;
-    hackwalk((proc)gravsub);				/* recursively compute      */
-    Phi(p) = phi0;				/* stash the pot.           */
-    SETV(Acc(p), acc0);				/* and the acceleration     */
+    hackgrav_r(p, &n2bterm, &nbcterm);
 }
-
+
 /*
- * GRAVSUB: compute a single 2-body interaction.
+ * HACKGRAV_R: same, but the number of interactions is returned, and
+ * it can be called for different bodies at the same time.
  */
 
-local nodeptr pmem;                     /* for memorized data to be shared */
-local vector dr;			/* between gravsub and subdivp */
-local real drsq;
+void hackgrav_r(bodyptr p, int *n2b, int *nbc)
+{
+    walkstate ws;
+
+    ws.pskip = p;				/* exclude p from f.c.      */
+    SETV(ws.pos0, Pos(p));			/* set field point          */
+    ws.phi0 = 0.0;				/* init potential, etc      */
+    CLRV(ws.acc0);
+    ws.pmem = NULL;
+    ws.n2bterm = ws.nbcterm = 0;
+    hackwalk(&ws);				/* recursively compute      */
+    Phi(p) = ws.phi0;				/* stash the pot.           */
+    SETV(Acc(p), ws.acc0);			/* and the acceleration     */
+    *n2b = ws.n2bterm;
+    *nbc = ws.nbcterm;
+}
+
+/*
+ * GRAVSUB: compute a single 2-body interaction.
+ */
 
-local void gravsub(nodeptr p)                   /* body or cell to interact with */
+local void gravsub(walkptr ws, nodeptr p)	/* body or cell to interact with */
 {
-    static real drabs, phii, mor3;
-    static vector ai, quaddr;
-    static real dr5inv, phiquad, drquaddr;
+    real drabs, phii, mor3;
+    vector ai;
+#ifdef QUADPOLE
+    vector quaddr;
+    real dr5inv, phiquad, drquaddr;
+#endif
 
-    if (p != pmem) {                            /* cant use memorized data? */
-        SUBV(dr, Pos(p), pos0);                 /*   then compute sep.      */
-	DOTVP(drsq, dr, dr);			/*   and sep. squared       */
+    if (p != ws->pmem) {                        /* cant use memorized data? */
+        SUBV(ws->dr, Pos(p), ws->pos0);         /*   then compute sep.      */
+	DOTVP(ws->drsq, ws->dr, ws->dr);	/*   and sep. squared       */
     }
-    drsq += eps*eps;                            /* use standard softening   */
-    drabs = sqrt(drsq);
+    ws->drsq += eps*eps;                        /* use standard softening   */
+    drabs = sqrt(ws->drsq);
     phii = Mass(p) / drabs;
-    phi0 -= phii;                               /* add to grav. pot.        */
-    mor3 = phii / drsq;
-    MULVS(ai, dr, mor3);
-    ADDV(acc0, acc0, ai);                       /* add to net accel.        */
+    ws->phi0 -= phii;                           /* add to grav. pot.        */
+    mor3 = phii / ws->drsq;
+    MULVS(ai, ws->dr, mor3);
+    ADDV(ws->acc0, ws->acc0, ai);               /* add to net accel.        */
 #ifdef QUADPOLE
     if(Type(p) == CELL) {                       /* if cell, add quad. term  */
-        dr5inv = 1.0/(drsq * drsq * drabs);     /*   dr ** (-5)             */
-        MULMV(quaddr, Quad(p), dr);             /*   form Q * dr            */
-        DOTVP(drquaddr, dr, quaddr);            /*   form dr * Q * dr       */
+        dr5inv = 1.0/(ws->drsq * ws->drsq * drabs); /* dr ** (-5)           */
+        MULMV(quaddr, Quad(p), ws->dr);         /*   form Q * dr            */
+        DOTVP(drquaddr, ws->dr, quaddr);        /*   form dr * Q * dr       */
         phiquad = -0.5 * dr5inv * drquaddr;     /*   quad. part of poten.   */
-        phi0 = phi0 + phiquad;                  /*   increment potential    */
-        phiquad = 5.0 * phiquad / drsq;         /*   save for acceleration  */
-        MULVS(ai, dr, phiquad);                 /*   components of acc.     */
-        SUBV(acc0, acc0, ai);                   /*   increment              */
+        ws->phi0 = ws->phi0 + phiquad;          /*   increment potential    */
+        phiquad = 5.0 * phiquad / ws->drsq;     /*   save for acceleration  */
+        MULVS(ai, ws->dr, phiquad);             /*   components of acc.     */
+        SUBV(ws->acc0, ws->acc0, ai);           /*   increment              */
         MULVS(quaddr, quaddr, dr5inv);   
-        SUBV(acc0, acc0, quaddr);               /*   acceleration           */
+        SUBV(ws->acc0, ws->acc0, quaddr);       /*   acceleration           */
     }
 #endif
 }
-
+
 /*
  * HACKWALK: walk the tree opening cells too close to a given point.
  */
 
-local proc hacksub;
-local real tolsq;
-
-void hackwalk(proc sub)				/* routine to do calculation */
+local void hackwalk(walkptr ws)
 {
-    hacksub = sub;
-    tolsq = tol * tol;
-    walksub(troot, rsize * rsize);
+    ws->tolsq = tol * tol;
+    walksub(ws, troot, rsize * rsize);
 }
 
 /*
  * WALKSUB: recursive routine to do hackwalk operation.
  */
 
-local void walksub(nodeptr p,                          /* pointer into body-tree */
-		   real dsq)                              /* size of box squared */
+local void walksub(walkptr ws,			/* state of this walk */
+		   nodeptr p,                   /* pointer into body-tree */
+		   real dsq)                    /* size of box squared */
 {
     register nodeptr *pp;
     register int k;
     
     if (debug_level)
       dprintf(2,"walksub: p = 0x%x  dsq = %f\n", p, dsq);
-    if (subdivp(p, dsq)) {                      /* should p be opened?      */
+    if (subdivp(ws, p, dsq)) {                  /* should p be opened?      */
         pp = & Subp(p)[0];                      /*   point to sub-cells     */
         for (k = 0; k < NSUB; k++) {            /*   loop over sub-cells    */
             if (*pp != NULL)                    /*     does this one exist? */
-                walksub(*pp, dsq / 4.0);	/*       then use it        */
+                walksub(ws, *pp, dsq / 4.0);	/*       then use it        */
             pp++;                               /*     point to next one    */
         }
-    } else if (p != (nodeptr) pskip) {          /* not to be skipped?       */
-        (*hacksub)(p);                          /*   then use it            */
+    } else if (p != (nodeptr) ws->pskip) {      /* not to be skipped?       */
+        gravsub(ws, p);                         /*   then use it            */
 	if (Type(p) == BODY)
-	    n2bterm++;				/*     count body-body int. */
+	    ws->n2bterm++;			/*     count body-body int. */
 	else
-	    nbcterm++;				/*     count body-cell int  */
+	    ws->nbcterm++;			/*     count body-cell int  */
     }
 }
-
+
 /*
  * SUBDIVP: decide if a node should be opened.
  * Side effects: sets pmem, dr, and drsq.
  */
 
-local bool subdivp(nodeptr p,      /* body/cell to be tested */
+local bool subdivp(walkptr ws,     /* state of this walk */
+		   nodeptr p,      /* body/cell to be tested */
 		   real dsq)       /* size of cell squared */
 {
     if (Type(p) == BODY)                        /* at tip of tree?          */
         return (FALSE);                         /*   then cant subdivide    */
-    SUBV(dr, Pos(p), pos0);                     /* compute displacement     */
-    DOTVP(drsq, dr, dr);                        /* and find dist squared    */
-    pmem = p;                                   /* remember we know them    */
-    return (tolsq * drsq < dsq);                /* use geometrical rule     */
+    SUBV(ws->dr, Pos(p), ws->pos0);             /* compute displacement     */
+    DOTVP(ws->drsq, ws->dr, ws->dr);            /* and find dist squared    */
+    ws->pmem = p;                               /* remember we know them    */
+    return (ws->tolsq * ws->drsq < dsq);        /* use geometrical rule     */
+}
+
+/*
+ * HACKGRAV_GROUP: evaluate grav field at all bodies in btab. The tree
+ * is split in groups of at most ncrit bodies, and walked once for
+ * each group, opening every cell that any body in the group would
+ * open; the resulting list of bodies and cells is then summed for each
+ * body of the group. Bodies without mass are not in the tree, and get
+ * a walk of their own. The number of force calculations and
+ * interactions is returned.
+ */
+
+void hackgrav_group(bodyptr btab, int nbody, int ncrit,
+		    int *nfc, int *n2b, int *nbc)
+{
+    groupstate gs;
+    bodyptr p;
+    int i, g, nf = 0, nb = 0, nc = 0, n2, n3;
+
+    ngroup = 0;					/* split tree in groups     */
+    if (findgroups(troot, ncrit) <= ncrit)
+	addgroup(troot);
+#if defined(_OPENMP)
+#pragma omp parallel private(gs,g,i,p,n2,n3) reduction(+:nf,nb,nc)
+#endif
+    {
+	memset(&gs, 0, sizeof(gs));		/* lists of this thread     */
+	gs.tolsq = tol * tol;
+#if defined(_OPENMP)
+#pragma omp for schedule(dynamic,16)
+#endif
+	for (g = 0; g < ngroup; g++) {		/* loop over groups         */
+	    groupbodies(&gs, grouptab[g]);
+	    gs.blist.n = gs.clist.n = 0;
+	    groupwalk(&gs, troot, rsize * rsize);	/* one walk per group */
+	    for (i = 0; i < gs.ngbody; i++) {	/*   sum forces on bodies   */
+		nb += groupforce(&gs, gs.gbody[i]);
+		nc += gs.clist.n;
+		nf++;
+	    }
+	}
+	if (gs.gbody != NULL)
+	    free(gs.gbody);
+	listfree(&gs.blist);
+	listfree(&gs.clist);
+#if defined(_OPENMP)
+#pragma omp for schedule(dynamic,64)
+#endif
+	for (i = 0; i < nbody; i++) {		/* bodies not in the tree   */
+	    p = btab + i;
+	    if (Mass(p) == 0.0) {
+		hackgrav_r(p, &n2, &n3);
+		nb += n2;
+		nc += n3;
+		nf++;
+	    }
+	}
+    }
+    *nfc = nf;
+    *n2b = nb;
+    *nbc = nc;
+}
+
+/*
+ * FINDGROUPS: find the largest cells with at most ncrit bodies, and
+ * add them (or single bodies) to grouptab. Returns the number of
+ * bodies in p.
+ */
+
+local int findgroups(nodeptr p, int ncrit)
+{
+    int nsub[NSUB], n, k;
+
+    if (Type(p) == BODY)
+	return 1;
+    n = 0;
+    for (k = 0; k < NSUB; k++) {
+	nsub[k] = Subp(p)[k] != NULL ? findgroups(Subp(p)[k], ncrit) : 0;
+	n += nsub[k];
+    }
+    if (n > ncrit)				/* too large for one group? */
+	for (k = 0; k < NSUB; k++)		/*   then subcells are      */
+	    if (nsub[k] > 0 && nsub[k] <= ncrit)
+		addgroup(Subp(p)[k]);
+    return n;
+}
+
+local void addgroup(nodeptr p)
+{
+    if (ngroup == maxgroup) {
+	maxgroup = (maxgroup == 0 ? 1024 : 2 * maxgroup);
+	grouptab = (nodeptr *) reallocate(grouptab, maxgroup * sizeof(nodeptr));
+    }
+    grouptab[ngroup++] = p;
+}
+
+/*
+ * GROUPBODIES: collect the bodies of a group, and find a sphere
+ * around them.
+ */
+
+local void groupbodies(groupptr gs, nodeptr p)
+{
+    vector lo, hi, dr;
+    real drsq;
+    int i, k;
+
+    gs->ngbody = 0;
+    collectbodies(gs, p);
+    SETV(lo, Pos(gs->gbody[0]));
+    SETV(hi, Pos(gs->gbody[0]));
+    for (i = 1; i < gs->ngbody; i++)
+	for (k = 0; k < NDIM; k++) {
+	    lo[k] = MIN(lo[k], Pos(gs->gbody[i])[k]);
+	    hi[k] = MAX(hi[k], Pos(gs->gbody[i])[k]);
+	}
+    ADDV(gs->gcen, lo, hi);
+    DIVVS(gs->gcen, gs->gcen, 2.0);
+    gs->grad = 0.0;
+    for (i = 0; i < gs->ngbody; i++) {
+	SUBV(dr, Pos(gs->gbody[i]), gs->gcen);
+	DOTVP(drsq, dr, dr);
+	gs->grad = MAX(gs->grad, drsq);
+    }
+    gs->grad = sqrt(gs->grad);
+}
+
+local void collectbodies(groupptr gs, nodeptr p)
+{
+    int k;
+
+    if (Type(p) == BODY) {
+	if (gs->ngbody == gs->maxgbody) {
+	    gs->maxgbody = (gs->maxgbody == 0 ? 64 : 2 * gs->maxgbody);
+	    gs->gbody = (bodyptr *)
+		reallocate(gs->gbody, gs->maxgbody * sizeof(bodyptr));
+	}
+	gs->gbody[gs->ngbody++] = (bodyptr) p;
+    } else
+	for (k = 0; k < NSUB; k++)
+	    if (Subp(p)[k] != NULL)
+		collectbodies(gs, Subp(p)[k]);
+}
+
+/*
+ * GROUPWALK: walk the tree for a group; a cell is used as a whole if
+ * the nearest point of the group's sphere passes the opening test of
+ * subdivp(), so if it does so for all bodies in the group.
+ */
+
+local void groupwalk(groupptr gs, nodeptr p, real dsq)
+{
+    vector dr;
+    real drsq, d;
+    int k;
+
+    if (Type(p) == BODY) {
+	listadd(&gs->blist, p);
+	return;
+    }
+    SUBV(dr, Pos(p), gs->gcen);
+    DOTVP(drsq, dr, dr);
+    d = sqrt(drsq) - gs->grad;			/* distance to the group    */
+    if (d > 0.0 && gs->tolsq * d * d >= dsq)
+	listadd(&gs->clist, p);
+    else
+	for (k = 0; k < NSUB; k++)
+	    if (Subp(p)[k] != NULL)
+		groupwalk(gs, Subp(p)[k], dsq / 4.0);
+}
+
+local void listadd(ilist *l, nodeptr p)
+{
+    int k;
+#ifdef QUADPOLE
+    int m;
+#endif
+
+    if (l->n == l->max) {
+	l->max = (l->max == 0 ? 1024 : 2 * l->max);
+	l->mass = (real *) reallocate(l->mass, l->max * sizeof(real));
+	for (k = 0; k < NDIM; k++)
+	    l->pos[k] = (real *) reallocate(l->pos[k], l->max * sizeof(real));
+	if (Type(p) == BODY)
+	    l->node = (nodeptr *) reallocate(l->node, l->max * sizeof(nodeptr));
+#ifdef QUADPOLE
+	if (Type(p) == CELL)
+	    for (k = 0; k < NDIM; k++)
+		for (m = 0; m < NDIM; m++)
+		    l->quad[k][m] = (real *)
+			reallocate(l->quad[k][m], l->max * sizeof(real));
+#endif
+    }
+    l->mass[l->n] = Mass(p);
+    for (k = 0; k < NDIM; k++)
+	l->pos[k][l->n] = Pos(p)[k];
+    if (Type(p) == BODY)
+	l->node[l->n] = p;
+#ifdef QUADPOLE
+    if (Type(p) == CELL)
+	for (k = 0; k < NDIM; k++)
+	    for (m = 0; m < NDIM; m++)
+		l->quad[k][m][l->n] = Quad(p)[k][m];
+#endif
+    l->n++;
+}
+
+local void listfree(ilist *l)
+{
+    int k;
+#ifdef QUADPOLE
+    int m;
+#endif
+
+    if (l->max == 0)
+	return;
+    free(l->mass);
+    if (l->node != NULL)
+	free(l->node);
+    for (k = 0; k < NDIM; k++) {
+	free(l->pos[k]);
+#ifdef QUADPOLE
+	for (m = 0; m < NDIM; m++)
+	    if (l->quad[k][m] != NULL)
+		free(l->quad[k][m]);
+#endif
+    }
+}
+
+/*
+ * GROUPFORCE: sum the interaction lists of a group for one of its
+ * bodies. The body itself is skipped, as in gravsub(); other bodies at
+ * the same position are not. Returns the number of body-body terms.
+ */
+
+local int groupforce(groupptr gs, bodyptr p)
+{
+    ilist *bl = &gs->blist, *cl = &gs->clist;
+    real x0[NDIM], a[NDIM], phi, eps2;
+    int j, k, n2b = 0;
+
+    eps2 = eps * eps;
+    for (k = 0; k < NDIM; k++) {
+	x0[k] = Pos(p)[k];
+	a[k] = 0.0;
+    }
+    phi = 0.0;
+#if defined(_OPENMP)
+#pragma omp simd reduction(+:phi,n2b,a[:NDIM])
+#endif
+    for (j = 0; j < bl->n; j++) {		/* body-body terms          */
+	real dr[NDIM], drsq = 0.0, rinv, mr;
+	int k, self = (bl->node[j] == (nodeptr) p);
+
+	for (k = 0; k < NDIM; k++) {
+	    dr[k] = bl->pos[k][j] - x0[k];
+	    drsq += dr[k] * dr[k];
+	}
+	rinv = (self ? 0.0 : 1.0 / sqrt(drsq + eps2));	/* skip self */
+	mr = bl->mass[j] * rinv;
+	n2b += ! self;
+	phi -= mr;
+	mr *= rinv * rinv;
+	for (k = 0; k < NDIM; k++)
+	    a[k] += dr[k] * mr;
+    }
+#if defined(_OPENMP)
+#pragma omp simd reduction(+:phi,a[:NDIM])
+#endif
+    for (j = 0; j < cl->n; j++) {		/* body-cell terms          */
+	real dr[NDIM], drsq = eps2, rinv, mr;
+	int k;
+#ifdef QUADPOLE
+	real qdr[NDIM], dr5inv, drqdr = 0.0, phiq;
+	int m;
+#endif
+
+	for (k = 0; k < NDIM; k++) {
+	    dr[k] = cl->pos[k][j] - x0[k];
+	    drsq += dr[k] * dr[k];
+	}
+	rinv = 1.0 / sqrt(drsq);
+	mr = cl->mass[j] * rinv;
+	phi -= mr;
+	mr *= rinv * rinv;
+	for (k = 0; k < NDIM; k++)
+	    a[k] += dr[k] * mr;
+#ifdef QUADPOLE
+	dr5inv = rinv * rinv * rinv * rinv * rinv;	/* dr ** (-5)       */
+	for (k = 0; k < NDIM; k++) {		/*   form Q * dr            */
+	    qdr[k] = 0.0;
+	    for (m = 0; m < NDIM; m++)
+		qdr[k] += cl->quad[k][m][j] * dr[m];
+	    drqdr += dr[k] * qdr[k];		/*   and dr * Q * dr        */
+	}
+	phiq = -0.5 * dr5inv * drqdr;		/*   quad. part of poten.   */
+	phi += phiq;
+	phiq = 5.0 * phiq * rinv * rinv;
+	for (k = 0; k < NDIM; k++)
+	    a[k] -= dr[k] * phiq + qdr[k] * dr5inv;
+#endif
+    }
+    Phi(p) = phi;
+    SETV(Acc(p), a);
+    return n2b;
 }
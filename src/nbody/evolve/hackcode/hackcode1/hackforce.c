@@ -18,6 +18,7 @@
  *	7-aug-94  V1.5a declaration of atof() fails on macro-versions (linux)
  *     20-sep-01      b NULL -> 0
  *     29-mar-04  V1.6  using 'global' macro to prevent mu;ltiple definitons
+ *     16-oct-26  V1.7  forces computed in threads (np=) with OpenMP
  */
 
 #define global                                  /* don't default to extern  */
@@ -45,7 +46,7 @@ string defv[] = {
     "rmin=\n              Lower left corner of initial box [default is -rsize/2 (centered)",
     "options=mass,phase\n Output options: phase and/or mass",
     "fcells=0.75\n        Cell/body allocation ratio",
-    "VERSION=1.6b\n       1-apr-2023 PJT",
+    "VERSION=1.7\n        16-oct-2026",
     NULL,
 };
 
@@ -179,7 +180,7 @@ void force_calc(void)
     real *pp, *ap;
     double cpubase;
     string *rminxstr;
-    int i;
+    int i, n2b, nbc;
     bodyptr bp;
 
     tol = getdparam("tol");
@@ -203,13 +204,16 @@ void force_calc(void)
 	   rsize, rmin[0], rmin[1], rmin[2]);
     cpubase = cputime();
     n2btot = nbctot = 0;
-    for (bp = testdata; bp < testdata+ntest; bp++) {
-	hackgrav(bp);
-	*pp++ = Phi(bp);
-	SETV(ap, Acc(bp));
-	ap += NDIM;
-	n2btot += n2bterm;
-	nbctot += nbcterm;
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic,64) private(bp,n2b,nbc) reduction(+:n2btot,nbctot)
+#endif
+    for (i = 0; i < ntest; i++) {
+	bp = testdata + i;
+	hackgrav_r(bp, &n2b, &nbc);
+	pp[i] = Phi(bp);
+	SETV(ap + i*NDIM, Acc(bp));
+	n2btot += n2b;
+	nbctot += nbc;
     }
     cpufcal = cputime() - cpubase;
 }
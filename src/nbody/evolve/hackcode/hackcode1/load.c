@@ -2,6 +2,12 @@
  * LOAD.C: routines to create body-tree.
  * Public routines: maketree().
  *
+ * The bodies are sorted on their Morton (Z-order) key, the interleaved
+ * bits of their integerized coordinates, so the bodies of every cell
+ * form a contiguous range, and the tree is built by splitting ranges.
+ * It is the same tree that inserting the bodies one at a time gives,
+ * but the cells are stored in depth-first order.
+ *
  *	4-nov-91  added decl. intcoord() for _trace_
  *	18-nov-91 malloc -> allocate
  *	21-may-92 extra forward decl for SGI
@@ -9,21 +15,50 @@
  *	 4-mar-96 removed redundant (bad prototype) floor() definition
  *      28-nov-00 fixed bad index bug in printf() - documented a leak
  *      29-mar-04 prototyped
+ *      16-oct-26 build the tree bottom-up from bodies sorted by Morton
+ *                key, in a growable cell pool; hackcofm in threads
  */
 
 #include "code.h"
 
+/*
+ * BKEY: a massive body and its Morton key; the key holds the top
+ * KeyBits bits of each integerized coordinate, k=0 most significant.
+ */
+
+typedef unsigned long long mkey;
+
+typedef struct {
+    mkey key;
+    bodyptr p;
+} bkey;
+
+#define KeyBits  (63 / NDIM)		/* bits per dimension in a key */
+#define RadixBits 11			/* bits sorted per radix pass */
+
 local cellptr ctab = NULL;	/* cells are allocated from here */
 local int ncell, maxcell;	/* count cells in use, max available */
 local int first = 1;            /* first time a debug output is added */
 
+local bkey *ktab = NULL, *ktmp = NULL;	/* sorted bodies, and scratch */
+local int nkey, maxkey;		/* massive bodies, max available */
+local int ibits;		/* number of bits in integer coords */
+local int kbits;		/* lowest bit still in the keys */
+
 /* local forward declarations: */
-static void expandbox(bodyptr p);
-static void loadtree(bodyptr p);
-static bool intcoord(int xp[3], vector rp);
-static int subindex(int x[3], int l);
-static void hackcofm(nodeptr q);
-static cellptr makecell(void);
+local void expandbox(bodyptr p);
+local bool intcoord(int xp[NDIM], vector rp);
+local int subindex(int x[NDIM], int l);
+local mkey makekey(int xp[NDIM]);
+local void sortkeys(bkey *k, bkey *tmp, int n);
+local int splitrange(int lo, int hi, int b, int bnd[NSUB+1]);
+local int octant(bkey *k, int b);
+local int countcells(int lo, int hi, int b);
+local nodeptr buildtree(int lo, int hi, int b);
+local void hackcofm(nodeptr q, int lev);
+local cellptr makecell(void);
+
+#define TaskLevels 3		/* levels with a thread task per subcell */
 
 /*
  * MAKETREE: initialize tree structure for hack force calculation.
@@ -34,42 +69,81 @@ void maketree(
   int nbody)			/* number of bodies in above array */
 {
     register bodyptr p;
+    int i, n, xp[NDIM];
+    bool inbox = TRUE;
 
     if (first) {
       node x1;
       body x2;
-      phasebody x3;
       cell x4;
       dprintf(1,"node: %d\n", sizeof(x1));
       dprintf(1,"body: %d\n", sizeof(x2));
       dprintf(1,"cell: %d\n", sizeof(x4));
+      for (ibits = 0; (1 << ibits) != IMAX; ibits++)
+	  ;
+      kbits = ibits - MIN(KeyBits, ibits);
       first = 0;
     }
-
-    if (ctab == NULL) {				/* first time through?      */
-	maxcell = fcells * nbody;		/*   typ. need: 0.5 nbody   */
-	ctab = (cellptr) allocate(maxcell * sizeof(cell));   /* NEVER FREED */
-						/*   allocate cell space    */
+    if (nbody > maxkey) {			/* (re)size key space       */
+	if (ktab != NULL) {
+	    free(ktab);
+	    free(ktmp);
+	}
+	maxkey = nbody;
+	ktab = (bkey *) allocate(maxkey * sizeof(bkey));
+	ktmp = (bkey *) allocate(maxkey * sizeof(bkey));
     }
-    ncell = 0;					/* reset cells in use       */
-    troot = NULL;				/* deallocate current tree  */
+#if defined(_OPENMP)
+#pragma omp parallel for private(xp) reduction(&&:inbox)
+#endif
+    for (i = 0; i < nbody; i++)			/* all inside the box?      */
+	if (Mass(btab + i) != 0.0)
+	    inbox = inbox && intcoord(xp, Pos(btab + i));
+    nkey = 0;
     for (p = btab; p < btab+nbody; p++)		/* loop over all bodies     */
 	if (Mass(p) != 0.0) {			/*   only load massive ones */
-	    expandbox(p);			/*     expand root to fit   */
-	    loadtree(p);			/*     insert into tree     */
+	    if (! inbox)
+		expandbox(p);			/*     expand root to fit   */
+	    ktab[nkey++].p = p;
 	}
-    hackcofm(troot);				/* find c-of-m coordinates  */
+#if defined(_OPENMP)
+#pragma omp parallel for private(xp)
+#endif
+    for (i = 0; i < nkey; i++) {		/* integerize and key       */
+	intcoord(xp, Pos(ktab[i].p));
+	ktab[i].key = makekey(xp);
+    }
+    sortkeys(ktab, ktmp, nkey);			/* sort in Morton order     */
+    troot = NULL;				/* deallocate current tree  */
+    if (nkey == 0)
+	return;
+    n = countcells(0, nkey, ibits - 1);		/* cells needed             */
+    if (n > maxcell) {				/* grow cell pool           */
+	if (ctab != NULL)
+	    free(ctab);
+	maxcell = MAX(n + n/8, fcells * nbody);
+	ctab = (cellptr) allocate(maxcell * sizeof(cell));   /* NEVER FREED */
+    }
+    ncell = 0;					/* reset cells in use       */
+    troot = buildtree(0, nkey, ibits - 1);	/* depth first from root    */
+    dprintf(1,"maketree: %d bodies in %d cells\n", nkey, ncell);
+#if defined(_OPENMP)
+#pragma omp parallel
+#pragma omp single
+#endif
+    hackcofm(troot, 0);				/* find c-of-m coordinates  */
 }
-
+
 /*
- * EXPANDBOX: enlarge cubical "box", salvaging existing tree structure.
+ * EXPANDBOX: enlarge cubical "box" until it holds body p; bodies are
+ * tested in the order of the body array, so the box grows just as
+ * it did when the bodies were loaded one at a time.
  */
 
 local void expandbox(bodyptr p)                       /* body to be loaded */
 {
-    int k, xtmp[NDIM], xmid[NDIM];
+    int k, xtmp[NDIM];
     vector rmid;
-    cellptr newt;
 
     while (! intcoord(xtmp, Pos(p))) {		/* expand box (rarely)      */
         if(debug_level)
@@ -82,51 +156,139 @@ local void expandbox(bodyptr p)                       /* body to be loaded */
 	if(debug_level)
 	  dprintf(1,"\t   rmin = [%8.4f,%8.4f,%8.4f]\trsize = %8.4f\n",
                    rmin[0], rmin[1], rmin[2], rsize);
-        if (troot != NULL) {                     /*   repot existing tree?   */
-            newt = makecell();                  /*     create new root cell */
-            assert(intcoord(xmid, rmid));	/*     locate old root cell */
-            k = subindex(xmid, IMAX >> 1);      /*     find old tree index  */
-            Subp(newt)[k] = troot;               /*     graft old on new     */
-	    if(debug_level)
-  	      dprintf(1,"expandbox: old root goes in subcell %d\n", k);
-            troot = (nodeptr) newt;              /*     plant new tree       */
-        }
     }
 }
-
+
 /*
- * LOADTREE: descend tree and insert particle.
+ * MAKEKEY: interleave the top bits of the integerized coordinates.
  */
 
-local void loadtree(bodyptr p)			/* body to load into tree */
+local mkey makekey(int xp[NDIM])
 {
-    int l, xp[NDIM], xq[NDIM];
-    nodeptr *qptr;
-    cellptr c;
+    mkey key = 0;
+    int b, k;
 
-    assert(intcoord(xp, Pos(p)));		/* form integer coords      */
-    l = IMAX >> 1;				/* start with top bit       */
-    qptr = &troot;				/* start with tree root     */
-    while (*qptr != NULL) {			/* loop descending tree     */
-        if(debug_level)
-          dprintf(1,"loadtree: descending tree  l = 0x%x\n", l);
-	assert(l != 0);				/*   dont run out of bits   */
-	if (Type(*qptr) == BODY) {		/*   reached a "leaf"?      */
-	    if(debug_level)
-   	      dprintf(1,"loadtree: replacing body with cell\n");
-	    c = makecell();			/*     alloc a new cell     */
-	    assert(intcoord(xq, Pos(*qptr)));	/*     get integer coords   */
-	    Subp(c)[subindex(xq, l)] = *qptr;	/*     put body in cell     */
-	    *qptr = (nodeptr) c;		/*     link cell in tree    */
+    for (b = ibits - 1; b >= kbits; b--)
+	for (k = 0; k < NDIM; k++)
+	    key = (key << 1) | ((xp[k] >> b) & 1);
+    return key;
+}
+
+/*
+ * SORTKEYS: LSD radix sort on the keys; digits that are the same for
+ * all keys are skipped. The result is left in k.
+ */
+
+local void sortkeys(bkey *k, bkey *tmp, int n)
+{
+    permanent int count[1 << RadixBits];
+    mkey diff = 0;
+    bkey *src = k, *dst = tmp, *t;
+    int shift, i, d, sum, c;
+
+    for (i = 1; i < n; i++)			/* bits that differ         */
+	diff |= k[i].key ^ k[0].key;
+    for (shift = 0; shift < 64; shift += RadixBits) {
+	if (((diff >> shift) & ((1 << RadixBits) - 1)) == 0)
+	    continue;
+	memset(count, 0, sizeof(count));
+	for (i = 0; i < n; i++)
+	    count[(src[i].key >> shift) & ((1 << RadixBits) - 1)]++;
+	for (d = 0, sum = 0; d < (1 << RadixBits); d++) {
+	    c = count[d];
+	    count[d] = sum;
+	    sum += c;
 	}
-	qptr = &Subp(*qptr)[subindex(xp, l)];	/*   move down one level    */
-	l = l >> 1;				/*   and test next bit      */
+	for (i = 0; i < n; i++)
+	    dst[count[(src[i].key >> shift) & ((1 << RadixBits) - 1)]++] = src[i];
+	t = src;
+	src = dst;
+	dst = t;
     }
-    if(debug_level)
-      dprintf(1,"loadtree: installing body  l = 0x%x\n", l);
-    *qptr = (nodeptr) p;			/* found place, store p     */
+    if (src != k)
+	memcpy(k, src, n * sizeof(bkey));
 }
-
+
+/*
+ * OCTANT: subcell index of a body at bit b of its integer coordinates.
+ */
+
+local int octant(bkey *k, int b)
+{
+    int xp[NDIM];
+
+    if (b >= kbits)				/* still in the key?        */
+	return (int) ((k->key >> ((b - kbits) * NDIM)) & (NSUB - 1));
+    intcoord(xp, Pos(k->p));
+    return subindex(xp, 1 << b);
+}
+
+/*
+ * SPLITRANGE: find the ranges of sorted bodies in each subcell of a cell
+ * at bit b; below the bits in the keys the (rare, small) range is
+ * sorted on subcell first. Returns the number of non-empty subcells.
+ */
+
+local int splitrange(int lo, int hi, int b, int bnd[NSUB+1])
+{
+    int i, j, k, nsub = 0;
+    bkey t;
+
+    assert(b >= 0);				/* dont run out of bits     */
+    if (b < kbits)
+	for (i = lo + 1; i < hi; i++) {		/* insertion sort           */
+	    t = ktab[i];
+	    for (j = i; j > lo && octant(&ktab[j-1], b) > octant(&t, b); j--)
+		ktab[j] = ktab[j-1];
+	    ktab[j] = t;
+	}
+    i = lo;
+    for (k = 0; k < NSUB; k++) {
+	bnd[k] = i;
+	while (i < hi && octant(&ktab[i], b) == k)
+	    i++;
+	nsub += (i > bnd[k]);
+    }
+    bnd[NSUB] = hi;
+    return nsub;
+}
+
+/*
+ * COUNTCELLS: number of cells in the tree of sorted bodies lo..hi-1.
+ */
+
+local int countcells(int lo, int hi, int b)
+{
+    int bnd[NSUB+1], k, n = 1;
+
+    if (hi - lo < 2)				/* a single body            */
+	return 0;
+    splitrange(lo, hi, b, bnd);
+    for (k = 0; k < NSUB; k++)
+	n += countcells(bnd[k], bnd[k+1], b - 1);
+    return n;
+}
+
+/*
+ * BUILDTREE: make the tree of sorted bodies lo..hi-1, all in the
+ * same cell above bit b, depth first.
+ */
+
+local nodeptr buildtree(int lo, int hi, int b)
+{
+    int bnd[NSUB+1], k;
+    cellptr c;
+
+    if (hi - lo == 1)				/* a single body: leaf      */
+	return (nodeptr) ktab[lo].p;
+    c = makecell();
+    splitrange(lo, hi, b, bnd);
+    for (k = 0; k < NSUB; k++)
+	if (bnd[k+1] > bnd[k])
+	    Subp(c)[k] = buildtree(bnd[k], bnd[k+1], b - 1);
+    return (nodeptr) c;
+}
+
 /*
  * INTCOORD: compute integerized coordinates.
  * Returns: TRUE unless rp was out of bounds.
@@ -140,8 +302,6 @@ local bool intcoord(
     bool inb;
     double xsc;
 
-    if(debug_level)
-      dprintf(1,"intcoord: rp = [%8.4f,%8.4f,%8.4f]\n", rp[0], rp[1], rp[2]);
     inb = TRUE;					/* use to check bounds      */
     for (k = 0; k < NDIM; k++) {		/* loop over dimensions     */
         xsc = (rp[k] - rmin[k]) / rsize;        /*   scale to range [0,1)   */
@@ -150,8 +310,6 @@ local bool intcoord(
         else                                    /*   out of range           */
             inb = FALSE;                        /*     then remember that   */
     }
-    if(debug_level)
-      dprintf(1,"\t  xp = [%8x,%8x,%8x]\tinb = %d\n", xp[0], xp[1], xp[2], inb);
     return inb;
 }
 
@@ -165,38 +323,46 @@ local int subindex(
 {
     register int i, k;
 
-    if(debug_level)
-      dprintf(1,"subindex: x = [%8x,%8x,%8x]\tl = %8x\n", x[0],x[1],x[2],l);
     i = 0;                                      /* sum index in i           */
     for (k = 0; k < NDIM; k++)                  /* check each dimension     */
         if (x[k] & l)                           /*   if beyond midpoint     */
             i += NSUB >> (k + 1);               /*     skip over subcells   */
-    if(debug_level)
-      dprintf(1,"          returning %d\n", i);
     return i;
 }
-
+
 /*
- * HACKCOFM: descend tree finding center-of-mass coordinates.
+ * HACKCOFM: descend tree finding center-of-mass coordinates; the
+ * subcells of the top TaskLevels levels are done in parallel.
  */
 
-local void hackcofm(nodeptr q)                   /* pointer into body-tree */
+local void hackcofm(nodeptr q, int lev)          /* pointer into body-tree */
 {
     register int i;
     register nodeptr r;
-    static vector tmpv;
+    vector tmpv;
 #ifdef QUADPOLE
-    static vector dr;
-    static real drsq;
-    static matrix drdr, Idrsq, tmpm;
+    vector dr;
+    real drsq;
+    matrix drdr, Idrsq, tmpm;
 #endif
     if (Type(q) == CELL) {                      /* is this a cell?          */
+        for (i = 0; i < NSUB; i++) {            /*   loop over subcells     */
+            r = Subp(q)[i];
+            if (r != NULL && Type(r) == CELL) { /*     find subcell cm      */
+#if defined(_OPENMP)
+#pragma omp task if(lev < TaskLevels) firstprivate(r)
+#endif
+                hackcofm(r, lev + 1);
+            }
+        }
+#if defined(_OPENMP)
+#pragma omp taskwait
+#endif
         Mass(q) = 0.0;                          /*   init total mass        */
         CLRV(Pos(q));				/*   and c. of m.           */
         for (i = 0; i < NSUB; i++) {            /*   loop over subcells     */
             r = Subp(q)[i];
             if (r != NULL) {                    /*     does subcell exist?  */
-                hackcofm(r);                    /*       find subcell cm    */
                 Mass(q) += Mass(r);             /*       sum total mass     */
                 MULVS(tmpv, Pos(r), Mass(r));   /*       find moment        */
                 ADDV(Pos(q), Pos(q), tmpv);     /*       sum tot. moment    */
@@ -234,13 +400,10 @@ local cellptr makecell(void)
     register cellptr c;
     register int i;
 
-    if (ncell >= maxcell)
-	error("makecell: need more than %d cells; increase fcells\n",
-	      maxcell);
+    if (ncell >= maxcell)			/* countcells was wrong     */
+	error("makecell: need more than %d cells\n", maxcell);
     c = ctab + ncell;
     ncell++;
-    if(debug_level)
-      dprintf(1,"cell %d allocated at address 0x%x\n", ncell, (int) c);
     Type(c) = CELL;
     for (i = 0; i < NSUB; i++)
 	Subp(c)[i] = NULL;
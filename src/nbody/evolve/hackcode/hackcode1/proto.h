@@ -13,7 +13,8 @@ void restorestate(string file);
 
 /* grav.c */
 void hackgrav(bodyptr p);
-void hackwalk(proc sub);
+void hackgrav_r(bodyptr p, int *n2b, int *nbc);
+void hackgrav_group(bodyptr btab, int nbody, int ncrit, int *nfc, int *n2b, int *nbc);
 
 /* hackforce.c */
 int  input_data(void);
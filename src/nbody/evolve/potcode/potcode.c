@@ -19,6 +19,8 @@
  *      6-jul-03     b  computed the guiding center             PJT/RPO
  *     29-sep-05     c  variuos gcc4 fixes in other routines    PJT
  *     12-aug-09 V5.1  modified Euler and Leapfrog implemented  PJT
+ *     16-oct-26 V5.3  force() uses potential_n(), NCHUNK bodies at a time
+ *               V5.4  potcache= to tabulate expensive potentials
  *
  * To improve:  use allocate() for number of particles; not static
  */
@@ -32,6 +34,7 @@ string defv[] = {
     "potname=???\n        name of potential(5)",
     "potpars=\n           parameters to potential",
     "potfile=\n           optional filename to potential",
+    "potcache=\n          tabulate potential: mode(sph,axi,cart),rmax[,tol[,file]]",
     "save=\n		  state file name",
     "freq=64.0\n	  fundamental frequency (inv delta-t)",
     "mode=4\n		  integrator: 0=> Euler 1 => RK, 2 => PC, 3 => PC1 4=>RK4 5=> Leapfrog",
@@ -46,7 +49,7 @@ string defv[] = {
     "sigma=0\n            diffusion angle (degrees) per timestep",
     "seed=0\n		  random seed",
     "headline=PotCode\n   random mumble for humans",
-    "VERSION=5.2\n        2-jul-2021 PJT",
+    "VERSION=5.4\n        16-oct-2026",
     NULL,
 };
 
@@ -55,6 +58,9 @@ string usage = "Analytical potential orbit integrator";
 string cvsid="$Id$";
 
 local proc  pot;
+local potproc_n_real potn;
+
+#define NCHUNK 256	/* bodies per call of potential_n() */
 
 void setparams(void);
 void force(bodyptr btab, int nb, real time);
@@ -88,9 +94,11 @@ void setparams(void)
 
     dprintf(1,"Compiled with MBODY=%d\n",MBODY);
 
+    set_potential_cache(getparam("potcache"));
     pot = get_potential (getparam("potname"),
        			 getparam("potpars"), 
 			 getparam("potfile"));
+    potn = get_potential_n();
     ome = get_pattern();     /* pattern speed first par of potential */
     ome2 = ome*ome;
     half_ome2 = 0.5 * ome2;
@@ -119,23 +127,26 @@ void force(
 	   int nb,			/* number of bodies */
 	   real time)			/* current time */
 {
-    bodyptr p;
-    vector lacc,lpos;
-    real   lphi;
-    int    ndim=NDIM;
+    bodyptr p, q;
+    vector lacc[NCHUNK],lpos[NCHUNK];
+    real   lphi[NCHUNK];
+    int    ndim=NDIM, n, i;
 
-    for (p = btab; p < btab+nb; p++) {		/* loop over bodies */
-        SETV(lpos,Pos(p));
-        (*pot)(&ndim,lpos,lacc,&lphi,&time);
+    for (p = btab; p < btab+nb; p += n) {	/* loop over chunks of bodies */
+        n = MIN(NCHUNK, btab+nb-p);
+        for (i=0, q=p; i<n; i++, q++)
+            SETV(lpos[i],Pos(q));
+        (*potn)(&ndim,&n,lpos[0],lacc[0],lphi,&time);
 
-	if (ome!=0.0) {
-	   lphi -= half_ome2*(sqr(lpos[0])+sqr(lpos[1]));
-           lacc[0] += ome2*lpos[0] + two_ome*Vel(p)[1];
-           lacc[1] += ome2*lpos[1] - two_ome*Vel(p)[0];
+        for (i=0, q=p; i<n; i++, q++) {
+	    if (ome!=0.0) {
+	       lphi[i] -= half_ome2*(sqr(lpos[i][0])+sqr(lpos[i][1]));
+               lacc[i][0] += ome2*lpos[i][0] + two_ome*Vel(q)[1];
+               lacc[i][1] += ome2*lpos[i][1] - two_ome*Vel(q)[0];
+            }
+            Phi(q) = lphi[i];
+            SETV(Acc(q),lacc[i]);
         }
-
-        Phi(p) = lphi;
-        SETV(Acc(p),lacc);
     }
 }
 
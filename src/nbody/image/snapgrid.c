@@ -30,6 +30,8 @@
  *       2-mar-11   5.3 implemented h3,h4 as moment -3 and -4
  *      18-may-12   5.4 added smoothing in VZ (szvar)
  *     13-feb-2013  6.0 units changed on a cube (now density instead of surface brightness?)
+ *     16-oct-2026  6.2 chunk= to grid snapshots that do not fit in memory
+ *                  6.3 evaluate expressions in batch (btreval)
  *
  * Todo: - mean=t may not be correct for nz>1 
  *       - hermite h3 and h4 for proper kinemetry
@@ -77,7 +79,8 @@ string defv[] = {		/* keywords/default values/help */
 	"stack=f\n			  Stack all selected snapshots?",
 	"integrate=f\n                    Sum or Integrate along 'dvar'?",
 	"proj=\n                          Sky projection (SIN, TAN, ARC, NCP, GLS, CAR, MER, AIT)",
-	"VERSION=6.1a\n			  9-feb-2024 PJT",
+	"chunk=0\n                        If >0, read snapshots in chunks of this many bodies",
+	"VERSION=6.3\n			  16-oct-2026",
 	NULL,
 };
 
@@ -98,6 +101,7 @@ local int    nobj, bits, nbody=0, noutxy=0, noutz=0, nzero=0;
 local real   tnow;
 local Body   *btab = NULL;
 local string times;
+local int    chunk, ioff=0, ntot;	/* chunked input: first body of chunk */
 
 		/* IMAGE INTERFACE */
 local imageptr  iptr=NULL, iptr0=NULL, iptr1=NULL, iptr2=NULL, iptr3=NULL, iptr4=NULL;
@@ -132,11 +136,15 @@ local double xref, yref, xrefpix, yrefpix, xinc, yinc, rot;
 
 extern string  *burststring(string,string);
 extern rproc   btrtrans(string);
+extern void    btreval(rproc, Body *, int, real, int, real *);
+
+#define NBLOCK  256                     /* bodies per batch of expressions */
 
 
 local void setparams(void);
 local void compfuncs(void);
 local int read_snap(void);
+local bool read_chunk(void);
 local void allocate_image(void);
 local void clear_image(void);
 local void bin_data(int ivar);
@@ -291,6 +299,8 @@ void setparams()
     if (nvar < 1) error("Need evar=");
     if (nvar > MAXVAR) error("Too many evar's (%d > MAXVAR = %d)",nvar,MAXVAR);
     if (Qstack && nvar>1) error("stack=t with multiple (%d) evar=",nvar);
+    chunk = getiparam("chunk");
+    if (chunk>0 && nvar>1) error("chunk= with multiple (%d) evar=",nvar);
     xlab = hasvalue("xlab") ? getparam("xlab") : xvar;
     ylab = hasvalue("ylab") ? getparam("ylab") : yvar;
     zlab = hasvalue("zlab") ? getparam("zlab") : zvar;
@@ -328,13 +338,21 @@ int read_snap()
 {		
     for(;;) {		
         get_history(instr);
-        get_snap(instr,&btab,&nobj,&tnow,&bits);
+        if (chunk > 0) {     /* first chunk only, see read_chunk() */
+            bits = 0;
+            if (!get_tag_ok(instr, SnapShotTag))
+                break;       /* no snapshot at all */
+            if (!get_snap_chunk(instr,&btab,&nobj,&tnow,&bits,chunk,&ioff,&ntot))
+                continue;    /* skip, no particles */
+        } else
+            get_snap(instr,&btab,&nobj,&tnow,&bits);
         if (bits==0) 
             break;           /* no snapshot at all */
-        if ( (bits&PhaseSpaceBit)==0 )
-            continue;       /* skip, no data, probably diagnostics */
-        if (streq(times,"all") || within(tnow, times, TIMEFUZZ))
+        if ( (bits&PhaseSpaceBit)!=0 &&
+             (streq(times,"all") || within(tnow, times, TIMEFUZZ)))
             break;          /* take it, if time in timerange */
+        if (chunk > 0)      /* skip, no data or not in timerange */
+            get_snap_chunk(instr,&btab,&nobj,&tnow,&bits,0,&ioff,&ntot);
     }
     if (bits) {
     	if (Qstack)
@@ -345,6 +363,17 @@ int read_snap()
     return bits;
 }
 
+/*
+ * READ_CHUNK: read the next chunk of the current snapshot, if chunk>0
+ */
+
+local bool read_chunk(void)
+{
+    if (chunk <= 0)
+        return FALSE;
+    return get_snap_chunk(instr,&btab,&nobj,&tnow,&bits,chunk,&ioff,&ntot);
+}
+
 #define CV(i)  (CubeValue(i,ix,iy,iz))
 
 void allocate_image()
@@ -469,7 +498,9 @@ void bin_data(int ivar)
     real brightness, cell_factor, x, y, z, z0, t,sum;
     real expfac, fac, sfac, flux, b, emtau, depth;
     real e, emax, twosqs;
-    int    i, j, k, ix, iy, iz, n, nneg, ioff;
+    real   xval[NBLOCK], yval[NBLOCK], zval[NBLOCK], fval[NBLOCK];
+    real   tval[NBLOCK], dval[NBLOCK], sval[NBLOCK];
+    int    i, j, k, ix, iy, iz, n, nneg, im, kb, nb;
     int    ix0, iy0, ix1, iy1, m, mmax;
     Body   *bp;
     Point  *pp, *pf,*pl, **ptab;
@@ -479,7 +510,7 @@ void bin_data(int ivar)
       /* first time around allocate a map[] of pointers to Point's */
         if (map==NULL)
             map = (Point **) allocate(Nx(iptr)*Ny(iptr)*sizeof(Point *));
-        if (map==NULL || !Qstack) {
+        if (!Qstack && ioff==0) {   /* but not for a next chunk */
             for (iy=0; iy<Ny(iptr); iy++)
             for (ix=0; ix<Nx(iptr); ix++)
                 map[ix+Nx(iptr)*iy] = NULL;
@@ -504,18 +535,32 @@ void bin_data(int ivar)
     emax = 10.0;
 
 		/* big loop: walk through all particles and accumulate ccd data */
-    for (i=0, bp=btab; i<nobj; i++, bp++) {
-        x = xfunc(bp,tnow,i);            /* transform */
-	y = yfunc(bp,tnow,i);
+    for (i=ioff, bp=btab; i<ioff+nobj; i++, bp++) {
+        kb = (i-ioff) % NBLOCK;
+        if (kb == 0) {                   /* transform the next block */
+            nb = MIN(NBLOCK, ioff+nobj-i);
+            btreval(xfunc, bp, nb, tnow, i, xval);
+            btreval(yfunc, bp, nb, tnow, i, yval);
+            btreval(zfunc, bp, nb, tnow, i, zval);
+            btreval(efunc[ivar], bp, nb, tnow, i, fval);
+            if (Qdepth || Qint) {
+                btreval(tfunc, bp, nb, tnow, i, tval);
+                btreval(dfunc, bp, nb, tnow, i, dval);
+            }
+            if (Qsmooth)
+                btreval(sfunc, bp, nb, tnow, i, sval);
+        }
+        x = xval[kb];
+	y = yval[kb];
 	if (Qwcs) wcs(&x,&y);            /* convert to an astronomical WCS, if requested */
-        z = zfunc(bp,tnow,i);
-        flux = efunc[ivar](bp,tnow,i);
+        z = zval[kb];
+        flux = fval[kb];
         if (Qdepth || Qint) {
-            emtau = odepth( tfunc(bp,tnow,i) );
-            depth = dfunc(bp,tnow,i);
+            emtau = odepth( tval[kb] );
+            depth = dval[kb];
 	}
         if (Qsmooth) {
-            twosqs = sfunc(bp,tnow,i);
+            twosqs = sval[kb];
             twosqs = 2.0 * sqr(twosqs);
         }
 
@@ -575,10 +620,10 @@ void bin_data(int ivar)
 		    pp->i  = i;
 		    pp->depth = depth;
                     pp->next = NULL;
-                    ioff = ix + Nx(iptr)*iy; /* location in grid map[] */
-                    pf = map[ioff];
+                    im = ix + Nx(iptr)*iy;   /* location in grid map[] */
+                    pf = map[im];
                     if (pf==NULL) {
-                        map[ioff] = pp;
+                        map[im] = pp;
                         pp->last = pp;
                     } else {
                         pl = pf->last;
@@ -992,6 +1037,8 @@ void nemo_main (void)
 		clear_image();
 	    }
             bin_data(i);	            /* bin and accumulate */
+            while (read_chunk())            /* rest of a chunked snapshot */
+                bin_data(i);
             if (!Qstack) {                  /* if multiple images: */
 	      if (Qdepth||Qint)
 		los_data();
@@ -4,6 +4,7 @@
  *	25-aug-93  V1.0	Created (cloned off mkhomsph)	PJT
  *	23-mar-96  V1.0a proto cleanup, free memory 	PJT
  *       9-sep-01      b    gsl/xrandom
+ *      16-oct-26  V1.2  seed=N,philox: bodies from own streams, in parallel
  */
 
 #include <stdinc.h>
@@ -21,11 +22,11 @@ string defv[] = {	/* DEFAULT INPUT PARAMETERS */
     "nbody=256\n    Number of particles",
     "size=1.0\n     Size of cube",
     "sigma=0.0\n    Isotropic velocity dispersion",
-    "seed=0\n       Random number seed",
+    "seed=0\n       Random number seed (N,philox for parallel)",
     "zerocm=t\n     Center c.o.m. ?",
     "headline=\n    Text headline for output",
     "bench=0\n      Add a number of benchmarks",
-    "VERSION=1.1\n  2-oct-2022 PJT",
+    "VERSION=1.2\n  16-oct-2026",
     NULL,
 };
 
@@ -91,10 +92,26 @@ void mkcube(void)
 {
     Body *bp;
     real mass_i;
-    int i;
+    int i, k;
 
     btab = (Body *) allocate(nbody * sizeof(Body));
     mass_i = 1.0/nbody;
+    if (xrandom_philox()) {             /* body i from its own stream */
+#ifdef _OPENMP
+#pragma omp parallel for private(bp,k)
+#endif
+      for (i = 0; i < nbody; i++) {
+	bp = btab + i;
+	k = 0;
+	Mass(bp) = mass_i;
+	Phase(bp)[0][0] = xrandom_i(i,&k,rmin,rmax);
+	Phase(bp)[0][1] = xrandom_i(i,&k,rmin,rmax);
+	Phase(bp)[0][2] = xrandom_i(i,&k,rmin,rmax);
+	Phase(bp)[1][0] = (sigma > 0) ? grandom_i(i,&k,0.0,sigma) : 0.0;
+	Phase(bp)[1][1] = (sigma > 0) ? grandom_i(i,&k,0.0,sigma) : 0.0;
+	Phase(bp)[1][2] = (sigma > 0) ? grandom_i(i,&k,0.0,sigma) : 0.0;
+      }
+    } else
     for (bp=btab, i = 0; i < nbody; bp++, i++) {
 	Mass(bp) = mass_i;
 	Phase(bp)[0][0] = xrandom(rmin,rmax);
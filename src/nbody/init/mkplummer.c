@@ -20,6 +20,7 @@
  *      22-mar-04       V2.7  merged version with a hole      ncm+pjt
  *      31-mar-05       V2.8  added nmodel=                       pjt
  *      30-may-07       V2.8b allocate() with size_t
+ *      16-oct-26       V3.1  seed=N,philox: reproducible per-body streams, OpenMP
  */
 
 
@@ -40,6 +41,7 @@
 
 extern rproc  getrfunc();
 Body    *mkplummer();
+local real ran(bool, int, int *, real, real);
 
 local string headline;		/* random text message */
 
@@ -54,7 +56,7 @@ string  defv[] = {                        /* DEFAULT INPUT PARAMETERS */
     "rfrac=22.8042468\n       Radius fraction used of Plummer distribution\n\
                               NOTE: the above two values are chosen so\n\
                                     that m( rfrac ) = mfrac                ",
-    "seed=0\n                 Seed for the random number generator",
+    "seed=0\n                 Seed for the random number generator (N,philox for parallel)",
     "time=0.0\n               Time at which snapshot is taken",
     "zerocm=t\n               Centrate snapshot (t/f)?",
     "scale=-1\n               Model scale factor (-1=virial 1=natural)",
@@ -66,7 +68,7 @@ string  defv[] = {                        /* DEFAULT INPUT PARAMETERS */
     "headline=\n	      Verbiage for output",
     "nmodel=1\n               number of models to produce",
     "mode=1\n                 0=no data,  1=data, no analysis 2=data, analysis",
-    "VERSION=3.0b\n           2-sep-2021 PJT",
+    "VERSION=3.1\n            16-oct-2026",
     NULL,
 };
 
@@ -132,7 +134,7 @@ void nemo_main(void)
     for (i=0; i<nmodel; i++) {
       if (i>0) {
 	seed++;
-	sprintf(sseed,"%d",seed);
+	sprintf(sseed,xrandom_philox() ? "%d,philox" : "%d",seed);
 	init_xrandom(sseed);
       }
       btab[i] = mkplummer(nbody, mlow, mfrac, rfrac, seed, snap_time, zerocm, scale,
@@ -140,7 +142,8 @@ void nemo_main(void)
     }
     if (mode > 0) {
       bits = (MassBit | PhaseSpaceBit | TimeBit);
-      sprintf(hisline,"init_xrandom: seed used %d",seed);
+      sprintf(hisline,xrandom_philox() ? "init_xrandom: seed used %d,philox" :
+	      "init_xrandom: seed used %d",seed);
       put_string(outstr, HeadlineTag, hisline);
       put_history (outstr);           /* update history */
       if (*headline)
@@ -212,6 +215,16 @@ void nemo_main(void)
 }
 
 
+/*
+ *  ran  --  next random number for body i: from its own counter based stream
+ *           when par, so bodies can be made in any order, else from xrandom()
+ */
+
+local real ran(bool par, int i, int *k, real lo, real hi)
+{
+    return par ? xrandom_i(i, k, lo, hi) : xrandom(lo, hi);
+}
+
 /*-----------------------------------------------------------------------------
  *  mkplummer  --  builds a nbody system according to a Plummer model,
  *                 in VIRIAL units (M=G=-4E=1, with E the total energy),
@@ -246,6 +259,9 @@ void nemo_main(void)
  *                 returns: snap: a pointer to the new snapshot, containing
  *			          a Plummer model in which all particles have
  *			          equal masses.
+ *                 NOTE: with seed=N,philox and no mass spectrum the bodies
+ *                       are made in parallel, body i from its own stream,
+ *                       hence independent of the number of threads.
  *                 NOTE: after sprinkling in particles according to a Plummer
  *                       distribution, the whole system is shifted in position
  *                       and velocity so as to put the center of mass at rest
@@ -267,6 +283,8 @@ real  mr[2];
 rproc mf;
 {
     register int  i;
+    int   k;                    /* position in body's random stream       */
+    bool  par;                  /* bodies from independent streams ?      */
     real  mtot;
     real  radius=0.0;		/* absolute value of position vector      */
     real  velocity;		/* absolute value of velocity vector      */
@@ -327,31 +345,36 @@ rproc mf;
 /*
  *  now we construct the individual particles:
  */
-    mtot = 0.0;
-    for (i = 0, bp=btab; i < nbody; i++, bp++) {
+    if (quiet < 0 || quiet > 2)
+	error("Illegal quiet=%d parameter\n",quiet);
+    par = xrandom_philox() && !mf;
+#ifdef _OPENMP
+#pragma omp parallel for if(par) private(bp,k,radius,velocity,theta,phi,x,y,m_min,m_max,m_med)
+#endif
+    for (i = 0; i < nbody; i++) {
+	bp = btab + i;
+	k = 0;
 	if (mf)     /* if mass spectrum given: */
 	    Mass(bp) = frandom( mr[0], mr[1], mf );
         else        /* else all stars equal mass */
             Mass(bp) = 1.0/ (real) nbody;
-	mtot += Mass(bp);
 /*
  *  the position coordinates are determined by inverting the cumulative
  *  mass-radius relation, with the cumulative mass drawn randomly from
  *  [0, mfrac]; cf. Aarseth et al. (1974), eq. (A2).
  */
         if (quiet==0)
-	    radius = 1.0 / sqrt( pow (xrandom(mlow,mfrac), -2.0/3.0) - 1.0);
+	    radius = 1.0 / sqrt( pow (ran(par,i,&k,mlow,mfrac), -2.0/3.0) - 1.0);
         else if (quiet==1) {
             m_min = (i * mfrac)/nbody;
             m_max = ((i+1) * mfrac)/nbody;
-            radius = 1.0 / sqrt( pow (xrandom(m_min,m_max), -2.0/3.0) - 1.0);
-        } else if (quiet==2) {
+            radius = 1.0 / sqrt( pow (ran(par,i,&k,m_min,m_max), -2.0/3.0) - 1.0);
+        } else {
             m_med = ((i+0.5) * mfrac)/nbody;
             radius = 1.0 / sqrt( pow (m_med, -2.0/3.0) - 1.0);
-	} else	
-	    error("Illegal quiet=%d parameter\n",quiet);
-	theta = acos(xrandom(-1.0, 1.0));
-	phi = xrandom(0.0, TWO_PI);
+	}
+	theta = acos(ran(par,i,&k,-1.0, 1.0));
+	phi = ran(par,i,&k,0.0, TWO_PI);
 	Pos(bp)[0] = radius * sin( theta ) * cos( phi );
 	Pos(bp)[1] = radius * sin( theta ) * sin( phi );
         Pos(bp)[2] = radius * cos( theta );
@@ -372,19 +395,22 @@ rproc mf;
  *  g(x) in [0,1] : 0.1 > max g(x) = 0.092 for 0 < x < 1.
  */
 	while (y > x*x*pow( 1.0 - x*x, 3.5)) {
-	    x = xrandom(0.0,1.0);
-	    y = xrandom(0.0,0.1);
+	    x = ran(par,i,&k,0.0,1.0);
+	    y = ran(par,i,&k,0.0,0.1);
         }
 /*
  *  If y < g(x), proceed to calculate the velocity components:
  */
 	velocity = x * sqrt(2.0) * pow( 1.0 + radius*radius, -0.25);
-	theta = acos(xrandom(-1.0, 1.0));
-	phi = xrandom(0.0,TWO_PI);
+	theta = acos(ran(par,i,&k,-1.0, 1.0));
+	phi = ran(par,i,&k,0.0,TWO_PI);
 	Vel(bp)[0] = velocity * sin( theta ) * cos( phi );
 	Vel(bp)[1] = velocity * sin( theta ) * sin( phi );
 	Vel(bp)[2] = velocity * cos( theta );
     }
+    mtot = 0.0;
+    for (i = 0, bp=btab; i < nbody; i++, bp++)
+	mtot += Mass(bp);
     dprintf(1,"Total mass (before scaling) = %g\n",mtot);
 /*
  * Now transform to the VIRIAL coordinates by applying
@@ -0,0 +1,480 @@
+/*
+ * SNAPDATA.C: read a snapshot into a structure of arrays.
+ *
+ *	get_snap() scatters the particle data into an array of Body's,
+ *	most of which is not used by a typical reduction program.
+ *	get_snapdata() instead keeps one contiguous array per field
+ *	(and per component for vectors), and only reads and allocates
+ *	the fields that are asked for. Loops over the particles then
+ *	stream through memory and vectorize.
+ *
+ *	get_snapdata_chunk() reads a snapshot a chunk of bodies at a time,
+ *	using random access I/O, for snapshots that do not fit in memory.
+ *
+ *	16-oct-26	created
+ *	16-oct-26	chunked input
+ *	16-oct-26	file sets are refused
+ */
+
+#include <stdinc.h>
+#include <filestruct.h>
+#include <vectmath.h>
+#include <snapshot/snapshot.h>
+#include <snapshot/snapdata.h>
+
+local int  sd_params(stream, snapdataptr);
+local void sd_csys(stream);
+local void sd_scalar(stream, string, int, real **, int);
+local void sd_ran(stream, string, string, void *, size_t, size_t);
+local real *sd_buf(snapdataptr, size_t);
+local void sd_vector(stream, string, int, int, real **);
+local void sd_split(const real *, int, int, real **);
+local void sd_resize(snapdataptr, int);
+local real *sd_alloc(real *, int);
+
+/*
+ * GET_SNAPDATA: read the next snapshot, but only the fields selected
+ * by want (MassBit, PosBit, VelBit, PhaseSpaceBit, ...). Arrays are
+ * allocated as needed, and reused in a next call. Returns FALSE if
+ * the next item in the input is not a snapshot.
+ */
+
+bool get_snapdata(stream instr, snapdataptr sd, int want)
+{
+    int nbody, i;
+    bool qpos, qvel;
+
+    if (sd->str != NULL)
+	error("get_snapdata: still inside a chunked snapshot");
+    if (strfileset(instr, &i) != NULL)
+	error("get_snapdata: cannot read a file set, use get_snap");
+    if (! get_tag_ok(instr, SnapShotTag))
+	return FALSE;
+    if (want & PhaseSpaceBit)
+	want |= PosBit | VelBit;
+    qpos = (want & PosBit) != 0;
+    qvel = (want & VelBit) != 0;
+    get_set(instr, SnapShotTag);
+    nbody = sd_params(instr, sd);
+    sd_resize(sd, nbody);
+    sd->ntot = nbody;
+    sd->first = 0;
+    if (get_tag_ok(instr, ParticlesTag)) {
+	get_set(instr, ParticlesTag);
+	sd_csys(instr);
+	if ((want & MassBit) && get_tag_ok(instr, MassTag)) {
+	    sd_scalar(instr, MassTag, nbody, &sd->mass, sd->nmax);
+	    sd->bits |= MassBit;
+	}
+	if ((qpos || qvel) && get_tag_ok(instr, PhaseSpaceTag)) {
+	    const real *rvp;
+	    real *rvbuf = NULL;
+
+	    rvp = (const real *) get_data_ptr(instr, PhaseSpaceTag, RealType,
+					      nbody, 2, NDIM, 0);
+	    if (rvp == NULL) {
+		rvbuf = (real *) allocate((size_t)nbody * 2 * NDIM * sizeof(real));
+		get_data_coerced(instr, PhaseSpaceTag, RealType, rvbuf,
+				 nbody, 2, NDIM, 0);
+		rvp = rvbuf;
+	    }
+	    if (qpos) {
+		for (i = 0; i < NDIM; i++)
+		    sd->pos[i] = sd_alloc(sd->pos[i], sd->nmax);
+		sd_split(rvp, nbody, 2*NDIM, sd->pos);
+		sd->bits |= PosBit;
+	    }
+	    if (qvel) {
+		for (i = 0; i < NDIM; i++)
+		    sd->vel[i] = sd_alloc(sd->vel[i], sd->nmax);
+		sd_split(rvp + NDIM, nbody, 2*NDIM, sd->vel);
+		sd->bits |= VelBit;
+	    }
+	    if (rvbuf != NULL)
+		free(rvbuf);
+	} else {
+	    if (qpos && get_tag_ok(instr, PosTag)) {
+		for (i = 0; i < NDIM; i++)
+		    sd->pos[i] = sd_alloc(sd->pos[i], sd->nmax);
+		sd_vector(instr, PosTag, nbody, NDIM, sd->pos);
+		sd->bits |= PosBit;
+	    }
+	    if (qvel && get_tag_ok(instr, VelTag)) {
+		for (i = 0; i < NDIM; i++)
+		    sd->vel[i] = sd_alloc(sd->vel[i], sd->nmax);
+		sd_vector(instr, VelTag, nbody, NDIM, sd->vel);
+		sd->bits |= VelBit;
+	    }
+	}
+	if ((sd->bits & PosBit) && (sd->bits & VelBit))
+	    sd->bits |= PhaseSpaceBit;
+	if ((want & PotentialBit) && get_tag_ok(instr, PotentialTag)) {
+	    sd_scalar(instr, PotentialTag, nbody, &sd->phi, sd->nmax);
+	    sd->bits |= PotentialBit;
+	}
+	if ((want & AccelerationBit) && get_tag_ok(instr, AccelerationTag)) {
+	    for (i = 0; i < NDIM; i++)
+		sd->acc[i] = sd_alloc(sd->acc[i], sd->nmax);
+	    sd_vector(instr, AccelerationTag, nbody, NDIM, sd->acc);
+	    sd->bits |= AccelerationBit;
+	}
+	if ((want & AuxBit) && get_tag_ok(instr, AuxTag)) {
+	    sd_scalar(instr, AuxTag, nbody, &sd->aux, sd->nmax);
+	    sd->bits |= AuxBit;
+	}
+	if ((want & DensBit) && get_tag_ok(instr, DensityTag)) {
+	    sd_scalar(instr, DensityTag, nbody, &sd->dens, sd->nmax);
+	    sd->bits |= DensBit;
+	}
+	if ((want & EpsBit) && get_tag_ok(instr, EpsTag)) {
+	    sd_scalar(instr, EpsTag, nbody, &sd->eps, sd->nmax);
+	    sd->bits |= EpsBit;
+	}
+	if ((want & KeyBit) && get_tag_ok(instr, KeyTag)) {
+	    if (sd->key == NULL)
+		sd->key = (int *) allocate(sd->nmax * sizeof(int));
+	    get_data_coerced(instr, KeyTag, IntType, sd->key, nbody, 0);
+	    sd->bits |= KeyBit;
+	}
+	get_tes(instr, ParticlesTag);
+    }
+    get_tes(instr, SnapShotTag);
+    return TRUE;
+}
+
+/*
+ * GET_SNAPDATA_CHUNK: read the next chunk of at most chunk bodies. The
+ * first call enters the next snapshot (FALSE if there is none), and
+ * each call then leaves bodies first .. first+nbody-1 (out of ntot) in
+ * the arrays. After the last chunk the snapshot is closed and FALSE is
+ * returned.  For seekable input only one chunk is in memory at a time.
+ */
+
+bool get_snapdata_chunk(stream instr, snapdataptr sd, int want, int chunk)
+{
+    int n, i;
+    size_t off;
+    real *bp;
+
+    if (chunk <= 0)
+	error("get_snapdata_chunk: bad chunk=%d", chunk);
+    if (sd->str == NULL) {			/* enter a new snapshot     */
+	if (strfileset(instr, &n) != NULL)
+	    error("get_snapdata_chunk: cannot read a file set, use get_snap");
+	if (! get_tag_ok(instr, SnapShotTag))
+	    return FALSE;
+	get_set(instr, SnapShotTag);
+	sd->ntot = sd_params(instr, sd);
+	sd->first = 0;
+	sd->nbody = 0;
+	if (! get_tag_ok(instr, ParticlesTag)) {
+	    get_tes(instr, SnapShotTag);
+	    return FALSE;
+	}
+	get_set(instr, ParticlesTag);
+	sd_csys(instr);
+	sd->str = instr;
+    } else if (sd->str != instr)
+	error("get_snapdata_chunk: still inside a snapshot of another stream");
+    else
+	sd->first += sd->nbody;			/* on to the next chunk     */
+    if (sd->first >= sd->ntot) {
+	end_snapdata_chunk(instr, sd);
+	return FALSE;
+    }
+    n = MIN(chunk, sd->ntot - sd->first);
+    sd_resize(sd, n);
+    off = (size_t) sd->first;
+    if (want & PhaseSpaceBit)
+	want |= PosBit | VelBit;
+    sd->bits &= TimeBit;
+    if ((want & MassBit) && get_tag_ok(instr, MassTag)) {
+	sd->mass = sd_alloc(sd->mass, sd->nmax);
+	sd_ran(instr, MassTag, RealType, sd->mass, off, n);
+	sd->bits |= MassBit;
+    }
+    if ((want & (PosBit|VelBit)) && get_tag_ok(instr, PhaseSpaceTag)) {
+	bp = sd_buf(sd, (size_t) n * 2 * NDIM);
+	sd_ran(instr, PhaseSpaceTag, RealType, bp, off*2*NDIM, (size_t)n*2*NDIM);
+	if (want & PosBit) {
+	    for (i = 0; i < NDIM; i++)
+		sd->pos[i] = sd_alloc(sd->pos[i], sd->nmax);
+	    sd_split(bp, n, 2*NDIM, sd->pos);
+	    sd->bits |= PosBit;
+	}
+	if (want & VelBit) {
+	    for (i = 0; i < NDIM; i++)
+		sd->vel[i] = sd_alloc(sd->vel[i], sd->nmax);
+	    sd_split(bp + NDIM, n, 2*NDIM, sd->vel);
+	    sd->bits |= VelBit;
+	}
+    } else {
+	if ((want & PosBit) && get_tag_ok(instr, PosTag)) {
+	    bp = sd_buf(sd, (size_t) n * NDIM);
+	    sd_ran(instr, PosTag, RealType, bp, off*NDIM, (size_t)n*NDIM);
+	    for (i = 0; i < NDIM; i++)
+		sd->pos[i] = sd_alloc(sd->pos[i], sd->nmax);
+	    sd_split(bp, n, NDIM, sd->pos);
+	    sd->bits |= PosBit;
+	}
+	if ((want & VelBit) && get_tag_ok(instr, VelTag)) {
+	    bp = sd_buf(sd, (size_t) n * NDIM);
+	    sd_ran(instr, VelTag, RealType, bp, off*NDIM, (size_t)n*NDIM);
+	    for (i = 0; i < NDIM; i++)
+		sd->vel[i] = sd_alloc(sd->vel[i], sd->nmax);
+	    sd_split(bp, n, NDIM, sd->vel);
+	    sd->bits |= VelBit;
+	}
+    }
+    if ((sd->bits & PosBit) && (sd->bits & VelBit))
+	sd->bits |= PhaseSpaceBit;
+    if ((want & PotentialBit) && get_tag_ok(instr, PotentialTag)) {
+	sd->phi = sd_alloc(sd->phi, sd->nmax);
+	sd_ran(instr, PotentialTag, RealType, sd->phi, off, n);
+	sd->bits |= PotentialBit;
+    }
+    if ((want & AccelerationBit) && get_tag_ok(instr, AccelerationTag)) {
+	bp = sd_buf(sd, (size_t) n * NDIM);
+	sd_ran(instr, AccelerationTag, RealType, bp, off*NDIM, (size_t)n*NDIM);
+	for (i = 0; i < NDIM; i++)
+	    sd->acc[i] = sd_alloc(sd->acc[i], sd->nmax);
+	sd_split(bp, n, NDIM, sd->acc);
+	sd->bits |= AccelerationBit;
+    }
+    if ((want & AuxBit) && get_tag_ok(instr, AuxTag)) {
+	sd->aux = sd_alloc(sd->aux, sd->nmax);
+	sd_ran(instr, AuxTag, RealType, sd->aux, off, n);
+	sd->bits |= AuxBit;
+    }
+    if ((want & DensBit) && get_tag_ok(instr, DensityTag)) {
+	sd->dens = sd_alloc(sd->dens, sd->nmax);
+	sd_ran(instr, DensityTag, RealType, sd->dens, off, n);
+	sd->bits |= DensBit;
+    }
+    if ((want & EpsBit) && get_tag_ok(instr, EpsTag)) {
+	sd->eps = sd_alloc(sd->eps, sd->nmax);
+	sd_ran(instr, EpsTag, RealType, sd->eps, off, n);
+	sd->bits |= EpsBit;
+    }
+    if ((want & KeyBit) && get_tag_ok(instr, KeyTag)) {
+	if (sd->key == NULL)
+	    sd->key = (int *) allocate(sd->nmax * sizeof(int));
+	sd_ran(instr, KeyTag, IntType, sd->key, off, n);
+	sd->bits |= KeyBit;
+    }
+    return TRUE;
+}
+
+/*
+ * END_SNAPDATA_CHUNK: skip the remaining chunks of the current snapshot.
+ */
+
+void end_snapdata_chunk(stream instr, snapdataptr sd)
+{
+    if (sd->str == NULL)
+	return;
+    if (sd->str != instr)
+	error("end_snapdata_chunk: not reading this stream");
+    get_tes(instr, ParticlesTag);
+    get_tes(instr, SnapShotTag);
+    sd->str = NULL;
+}
+
+/*
+ * FREE_SNAPDATA: release all arrays, the structure itself is kept.
+ */
+
+void free_snapdata(snapdataptr sd)
+{
+    sd_resize(sd, 0);
+    sd->nmax = 0;
+    if (sd->buf != NULL)
+	free(sd->buf);
+    sd->buf = NULL;
+    sd->nbuf = 0;
+}
+
+/*
+ * SD_PARAMS: read the Parameters set, returns the number of bodies.
+ */
+
+local int sd_params(stream instr, snapdataptr sd)
+{
+    int nbody = 0;
+
+    sd->bits = 0;
+    if (get_tag_ok(instr, ParametersTag)) {
+	get_set(instr, ParametersTag);
+	if (get_tag_ok(instr, NobjTag))
+	    get_data(instr, NobjTag, IntType, &nbody, 0);
+	else if (get_tag_ok(instr, NBodyTag))
+	    get_data(instr, NBodyTag, IntType, &nbody, 0);
+	else
+	    error("get_snapdata: cannot find Nobj or NBody in snapshot");
+	if (get_tag_ok(instr, TimeTag)) {
+	    get_data_coerced(instr, TimeTag, RealType, &sd->time, 0);
+	    sd->bits |= TimeBit;
+	}
+	get_tes(instr, ParametersTag);
+    }
+    return nbody;
+}
+
+local void sd_csys(stream instr)
+{
+    int cs;
+
+    if (get_tag_ok(instr, CoordSystemTag)) {
+	get_data(instr, CoordSystemTag, IntType, &cs, 0);
+	if (cs != CSCode(Cartesian, NDIM, 2))
+	    error("get_snapdata: cannot handle %s = %#o", CoordSystemTag, cs);
+    }
+}
+
+/*
+ * SD_RAN: read len elements, starting at off, from a particle field;
+ * the dimensions given to get_data_set() are not checked.
+ */
+
+local void sd_ran(stream instr, string tag, string typ, void *dat,
+		  size_t off, size_t len)
+{
+    get_data_set(instr, tag, typ, 0);
+    get_data_ran(instr, tag, dat, off, len);
+    get_data_tes(instr, tag);
+}
+
+local real *sd_buf(snapdataptr sd, size_t n)
+{
+    if (n > sd->nbuf) {
+	sd->buf = (real *) reallocate(sd->buf, n * sizeof(real));
+	sd->nbuf = n;
+    }
+    return sd->buf;
+}
+
+/*
+ * SD_SCALAR: read a scalar field straight into its array.
+ */
+
+local void sd_scalar(stream instr, string tag, int nbody, real **dst, int nmax)
+{
+    *dst = sd_alloc(*dst, nmax);
+    get_data_coerced(instr, tag, RealType, *dst, nbody, 0);
+}
+
+/*
+ * SD_VECTOR: read a [nbody][ndim] field and split it in its components.
+ */
+
+local void sd_vector(stream instr, string tag, int nbody, int ndim, real **dst)
+{
+    const real *vp;
+    real *vbuf = NULL;
+
+    vp = (const real *) get_data_ptr(instr, tag, RealType, nbody, ndim, 0);
+    if (vp == NULL) {
+	vbuf = (real *) allocate((size_t)nbody * ndim * sizeof(real));
+	get_data_coerced(instr, tag, RealType, vbuf, nbody, ndim, 0);
+	vp = vbuf;
+    }
+    sd_split(vp, nbody, ndim, dst);
+    if (vbuf != NULL)
+	free(vbuf);
+}
+
+/*
+ * SD_SPLIT: copy NDIM components, stride reals apart, into NDIM arrays.
+ */
+
+local void sd_split(const real *src, int nbody, int stride, real **dst)
+{
+    int i, k;
+
+    for (k = 0; k < NDIM; k++) {
+	real *dp = dst[k];
+	const real *sp = src + k;
+	for (i = 0; i < nbody; i++, sp += stride)
+	    dp[i] = *sp;
+    }
+}
+
+/*
+ * SD_RESIZE: set the number of bodies; if the arrays are too small
+ * they are all released, and reallocated on demand.
+ */
+
+local void sd_resize(snapdataptr sd, int nbody)
+{
+    int i;
+
+    if (nbody > sd->nmax || nbody == 0) {
+#define SD_FREE(p)  if ((p) != NULL) { free(p); (p) = NULL; }
+	SD_FREE(sd->mass);
+	SD_FREE(sd->phi);
+	SD_FREE(sd->aux);
+	SD_FREE(sd->dens);
+	SD_FREE(sd->eps);
+	SD_FREE(sd->key);
+	for (i = 0; i < NDIM; i++) {
+	    SD_FREE(sd->pos[i]);
+	    SD_FREE(sd->vel[i]);
+	    SD_FREE(sd->acc[i]);
+	}
+#undef SD_FREE
+	sd->nmax = nbody;
+    }
+    sd->nbody = nbody;
+}
+
+local real *sd_alloc(real *p, int nmax)
+{
+    return p != NULL ? p : (real *) allocate(nmax * sizeof(real));
+}
+
+#ifdef TESTBED
+
+#include <getparam.h>
+#include <history.h>
+
+string defv[] = {
+    "in=???\n       Input snapshot",
+    "VERSION=1.0\n  16-oct-26",
+    NULL,
+};
+
+string usage = "test get_snapdata(): center of mass and mean speed";
+
+void nemo_main(void)
+{
+    stream instr;
+    snapdata sd;
+    real cm[NDIM], v2, mtot;
+    int i, k;
+
+    memset(&sd, 0, sizeof(sd));
+    instr = stropen(getparam("in"), "r");
+    get_history(instr);
+    while (get_snapdata(instr, &sd, MassBit | PhaseSpaceBit)) {
+	if ((sd.bits & (MassBit|PhaseSpaceBit)) != (MassBit|PhaseSpaceBit))
+	    continue;
+	mtot = v2 = 0.0;
+	for (k = 0; k < NDIM; k++) {
+	    cm[k] = 0.0;
+	    for (i = 0; i < sd.nbody; i++)
+		cm[k] += sd.mass[i] * sd.pos[k][i];
+	}
+	for (i = 0; i < sd.nbody; i++) {
+	    mtot += sd.mass[i];
+	    for (k = 0; k < NDIM; k++)
+		v2 += sd.mass[i] * sd.vel[k][i] * sd.vel[k][i];
+	}
+	printf("%g %d %g %g %g %g\n", sd.time, sd.nbody,
+	       cm[0]/mtot, cm[1]/mtot, cm[2]/mtot, sqrt(v2/mtot));
+	get_history(instr);
+    }
+    free_snapdata(&sd);
+    strclose(instr);
+}
+
+#endif
@@ -5,6 +5,7 @@
  *
  * V0.1  2-mar-2019   created - PJT
  * V0.3  7-mar-2019   added list option to i1,i2   - PJT
+ * V0.6 16-oct-2026   knn= to only check nearest neighbours (kd-tree)
  */
 
 #include <stdinc.h>
@@ -13,6 +14,7 @@
 #include <filestruct.h>
 #include <history.h>
 #include <vectmath.h>
+#include <kdtree.h>
 
 #include <snapshot/snapshot.h>
 #include <snapshot/body.h>
@@ -25,7 +27,8 @@ string defv[] = {
     "i2=1\n                     Second star, must be > i1 (or list of stars > i2)",
     "bound=t\n                  Only show bound stars?",
     "out=\n                     Optional out with strongest bound pair sink'd",
-    "VERSION=0.5\n	        9-apr-2019 PJT",
+    "knn=0\n                    If > 0, only check this many nearest neighbours of i1",
+    "VERSION=0.6\n	        16-oct-2026",
     NULL,
 };
 
@@ -34,89 +37,79 @@ string usage="analyse binaries in a snapshot, optionally merge a selected pair";
 
 #define MAXNBODY 10000
 
-
+local Body *btab = NULL;
+local bool Qbound;
+local int  i1_min, i2_min, nch=0, nbn=0;
+local real w_min;
+
+local void binary(int k1, int k2);
+
 
 void nemo_main(void)
 {
   stream instr, outstr;
-  Body *btab = NULL, *bp, *bp1, *bp2;
-  int n1,i1[MAXNBODY],j1, n2,i2[MAXNBODY],j2;
-  int nbody, bits, i1_min,i2_min, nch=0, nbn=0;
-  real tsnap, m1, m2, mu, T,W,E,a,b,L,period, w_sum, p, e, w_min;
-  vector x, v, w_pos, w_vel, H;
-  bool Qbound = getbparam("bound");
-
+  Body *bp, *bp1, *bp2;
+  int n1,*i1,j1, n2,*i2,j2, nmax, knn, k, nk, *nnb;
+  int nbody, bits;
+  real tsnap, w_sum, *pts, *d2;
+  vector x, v, w_pos, w_vel;
+  bool *in2;
+  kdtree *kd;
+
+  Qbound = getbparam("bound");
+  knn = getiparam("knn");
   instr = stropen(getparam("in"), "r");                  // get snapshot
   get_history(instr);
   get_snap(instr, &btab, &nbody, &tsnap, &bits);
 
   if (hasvalue("out")) outstr = stropen(getparam("out"), "w");
 
-  n1 = nemoinpi(getparam("i1"),i1,MAXNBODY);             // get list of stars-1
-  n2 = nemoinpi(getparam("i2"),i2,MAXNBODY);             // get list of stars-2
+  nmax = MAX(nbody, MAXNBODY);
+  i1 = (int *) allocate(nmax * sizeof(int));
+  i2 = (int *) allocate(nmax * sizeof(int));
+  n1 = nemoinpi(getparam("i1"),i1,nmax);                 // get list of stars-1
+  n2 = nemoinpi(getparam("i2"),i2,nmax);                 // get list of stars-2
+  if (n1 < 0 || n2 < 0) error("Error parsing i1= or i2= (max %d)",nmax);
 
   w_min  = 0.0;
   i1_min = -1;
   i2_min = -1;
 
-  for (j2=0; j2<n2; j2++)                                // loop over the list
+  if (knn > 0) {                                         // only the knn nearest
+    in2 = (bool *) allocate(nbody * sizeof(bool));
+    for (j2=0; j2<nbody; j2++) in2[j2] = FALSE;
+    for (j2=0; j2<n2; j2++)
+      if (i2[j2] >= 0 && i2[j2] < nbody) in2[i2[j2]] = TRUE;
+    pts = (real *) allocate((size_t)nbody * NDIM * sizeof(real));
+    for (j2=0, bp=btab; j2<nbody; j2++, bp++)
+      SETV(pts+j2*NDIM, Pos(bp));
+    kd = kd_build(pts, nbody, NDIM, 0);
+    nnb = (int *) allocate(knn * sizeof(int));
+    d2 = (real *) allocate(knn * sizeof(real));
     for (j1=0; j1<n1; j1++) {
-      bp1 = &btab[i1[j1]];                               // pointer to body
-      bp2 = &btab[i2[j2]];
-      dprintf(2,"i1,i2:    %d %d\n",i1[j1],i2[j2]);
-      if (i1[j1] >= i2[j2])continue;                     // skip
-      if (i2[j2] >= nbody) continue;      
-      if (i1[j1] >= nbody) {                             // or break when illegal
-	error("nbody=%d\n",nbody);
-	break;
-      }
-      nch++;                                             // count #checks
-      
-      m1 = Mass(bp1);
-      m2 = Mass(bp2);
-      mu = m1+m2;                                        // not reduced mass here!
-
-      SUBV(x,Pos(bp1),Pos(bp2));
-      SUBV(v,Vel(bp1),Vel(bp2));
-
-      T = 0.5 * (v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);     // kinetic
-      W = -mu/sqrt(x[0]*x[0] + x[1]*x[1] + x[2]*x[2]);   // potential
-      E = T + W;
-      a = -mu/2/E;                                       // semi major axis
-      if (a>0 && W < w_min) {
-	w_min = W;                   // find max bound cluster
-	i1_min = i1[j1];
-	i2_min = i2[j2];
-	dprintf(1,"W_min:    %g %d %d\n",w_min, i1[j1],i2[j2]);
-      } else 
-	dprintf(2,"Unbound a=%g %d %d\n",a,i1[j1],i2[j2]);
-
-      CROSSVP(H,x,v);
-      ABSV(L,H);
-
-      p = L*L/mu;
-      e = sqrt(1 - p/a);                                 // eccentricity
-      if (e<1)
-	b = a * sqrt(1-e*e);                             // ellipse
-      else 
-	b = a * sqrt(e*e-1);                             // hyperbola
-      
-      if (a>0 || !Qbound) {
-	printf("i1,i2:    %d %d\n",i1[j1],i2[j2]);
-	printf("m1,m2,mu: %g %g %g\n",m1,m2,mu);
-	printf("pos,vel:  %g %g %g %g %g %g\n", x[0],x[1],x[2],v[0],v[1],v[2]);
-	printf("T,W,E:    %g %g %g \n",T,W,E);
-	printf("H,|H|:    %g %g %g %g\n",H[0],H[1],H[2],L);
-	printf("a,b,p,e:  %g %g %g %g\n",a,b,p,e);
-      }
-      
-      if (a>0) {
-	period = TWO_PI * a * sqrt(a/mu);
-	printf("period:   %g\n",period);
-	nbn++;
-      } else if (!Qbound) !
-	printf("period:   Inf (Not a binary)!\n");
+      if (i1[j1] >= nbody) error("nbody=%d\n",nbody);
+      nk = kd_knn(kd, pts+i1[j1]*NDIM, knn, i1[j1], nnb, d2);
+      for (k=0; k<nk; k++)
+	if (nnb[k] > i1[j1] && in2[nnb[k]]) binary(i1[j1], nnb[k]);
     }
+    kd_free(kd);
+    free(pts);
+    free(nnb);
+    free(d2);
+    free(in2);
+  } else {
+    for (j2=0; j2<n2; j2++)                              // loop over the list
+      for (j1=0; j1<n1; j1++) {
+	dprintf(2,"i1,i2:    %d %d\n",i1[j1],i2[j2]);
+	if (i1[j1] >= i2[j2])continue;                   // skip
+	if (i2[j2] >= nbody) continue;      
+	if (i1[j1] >= nbody) {                           // or break when illegal
+	  error("nbody=%d\n",nbody);
+	  break;
+	}
+	binary(i1[j1], i2[j2]);
+      }
+  }
   dprintf(1,"Checked %d pairs, %d were bound\n",nch,nbn);
   printf("W_min:    %g for %d %d (found %d bound pairs)\n",w_min,i1_min,i2_min,nbn);
   
@@ -155,3 +148,61 @@ void nemo_main(void)
     strclose(outstr);
   }
 }
+
+/*
+ * BINARY:  analyse the pair k1,k2 and keep track of the most bound
+ */
+
+local void binary(int k1, int k2)
+{
+  Body *bp1 = &btab[k1], *bp2 = &btab[k2];
+  real m1, m2, mu, T,W,E,a,b,L,period, p, e;
+  vector x, v, H;
+
+  nch++;                                             // count #checks
+  
+  m1 = Mass(bp1);
+  m2 = Mass(bp2);
+  mu = m1+m2;                                        // not reduced mass here!
+
+  SUBV(x,Pos(bp1),Pos(bp2));
+  SUBV(v,Vel(bp1),Vel(bp2));
+
+  T = 0.5 * (v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);     // kinetic
+  W = -mu/sqrt(x[0]*x[0] + x[1]*x[1] + x[2]*x[2]);   // potential
+  E = T + W;
+  a = -mu/2/E;                                       // semi major axis
+  if (a>0 && W < w_min) {
+    w_min = W;                   // find max bound cluster
+    i1_min = k1;
+    i2_min = k2;
+    dprintf(1,"W_min:    %g %d %d\n",w_min, k1,k2);
+  } else 
+    dprintf(2,"Unbound a=%g %d %d\n",a,k1,k2);
+
+  CROSSVP(H,x,v);
+  ABSV(L,H);
+
+  p = L*L/mu;
+  e = sqrt(1 - p/a);                                 // eccentricity
+  if (e<1)
+    b = a * sqrt(1-e*e);                             // ellipse
+  else 
+    b = a * sqrt(e*e-1);                             // hyperbola
+  
+  if (a>0 || !Qbound) {
+    printf("i1,i2:    %d %d\n",k1,k2);
+    printf("m1,m2,mu: %g %g %g\n",m1,m2,mu);
+    printf("pos,vel:  %g %g %g %g %g %g\n", x[0],x[1],x[2],v[0],v[1],v[2]);
+    printf("T,W,E:    %g %g %g \n",T,W,E);
+    printf("H,|H|:    %g %g %g %g\n",H[0],H[1],H[2],L);
+    printf("a,b,p,e:  %g %g %g %g\n",a,b,p,e);
+  }
+  
+  if (a>0) {
+    period = TWO_PI * a * sqrt(a/mu);
+    printf("period:   %g\n",period);
+    nbn++;
+  } else if (!Qbound)
+    printf("period:   Inf (Not a binary)!\n");
+}
@@ -5,6 +5,7 @@
  *      13-may-91       V1.1 added time to list of options  PJT
  *	 6-nov-93	V1.2 moment, NEMO V2.			pjt
  *      17-aug-2022     V1.3 Allow out=
+ *      16-oct-2026     V1.4 chunk= for snapshots that do not fit in memory
  */
 
 #include <stdinc.h>
@@ -25,7 +26,8 @@ string defv[] = {		/* DEFAULT INPUT PARAMETERS */
     "times=all\n                Times of snapshot",
     "format=%g\n                Format to print with",
     "out=\n                     If min or max given, output in a 1-body snapshot",
-    "VERSION=1.3\n		17-aug-2022 pjt",
+    "chunk=0\n                  If >0, read snapshots in chunks of this many bodies",
+    "VERSION=1.4\n		16-oct-2026",
     NULL,
 };
 
@@ -41,9 +43,10 @@ void nemo_main()
     real   var0[MAXOPT], var1[MAXOPT], var2[MAXOPT];
     Moment var[MAXOPT];
     string headline=NULL, options, times, mnmxmode;
-    Body *btab = NULL, *bp, *bq;
+    Body *btab = NULL, *bp, *bq, bmin, bmax, *bout;
     bool   Qmin, Qmax, Qmean, Qsig, Qtime, scanopt();
     int i, n, nbody, bits, nsep, isep, nopt, ParticlesBit, iout, imin, imax;
+    int chunk, ioff, ntot;
     char fmt[20],*pfmt;
     string *burststring(), *opt;
     rproc btrtrans(), fopt[MAXOPT], faux;
@@ -96,6 +99,7 @@ void nemo_main()
         tabstr = stdout;
 
     times = getparam("times");
+    chunk = getiparam("chunk");
     pfmt = getparam("format");
     strcpy (fmt,pfmt);
     if (strchr(fmt,' ')==NULL && strchr(fmt,',')==NULL)
@@ -107,34 +111,45 @@ void nemo_main()
 	get_history(instr);
         if (!get_tag_ok(instr, SnapShotTag))
             break;                                  /* done with work */
-        get_snap(instr, &btab, &nbody, &tsnap, &bits);
-        if (!streq(times,"all") && !within(tsnap,times,0.0001))
-            continue;                   /* skip work on this snapshot */
-        if ( (bits & ParticlesBit) == 0)
-            continue;                   /* skip work, only diagnostics here */
+        if (chunk > 0) {                /* only a chunk of bodies at a time */
+            if (!get_snap_chunk(instr, &btab, &nbody, &tsnap, &bits, chunk, &ioff, &ntot))
+                continue;               /* no particles in this snapshot */
+        } else {
+            get_snap(instr, &btab, &nbody, &tsnap, &bits);
+            ioff = 0;
+        }
+        if ((!streq(times,"all") && !within(tsnap,times,0.0001)) ||
+            (bits & ParticlesBit) == 0) {   /* skip work on this snapshot */
+            if (chunk > 0)
+                get_snap_chunk(instr, &btab, &nbody, &tsnap, &bits, 0, &ioff, &ntot);
+            continue;
+        }
 
          iout = imin = imax = -1;
-	 for (bp = btab, i=0; bp < btab+nbody; bp++, i++) {
-	   for (n=0; n<nopt; n++) {
-	     aux = fopt[n](bp,tsnap,i);
-	     if (i==0) ini_moment(&var[n],2,0);
-	     accum_moment(&var[n], aux, 1.0);
-	     if (Qout) {
-	       if (aux==min_moment(&var[0])) imin=i;
-	       if (aux==max_moment(&var[0])) imax=i;
+         do {
+	   for (bp = btab, i=ioff; bp < btab+nbody; bp++, i++) {
+	     for (n=0; n<nopt; n++) {
+	       aux = fopt[n](bp,tsnap,i);
+	       if (i==0) ini_moment(&var[n],2,0);
+	       accum_moment(&var[n], aux, 1.0);
+	       if (Qout) {
+	         if (aux==min_moment(&var[0])) { imin=i; bmin = *bp; }
+	         if (aux==max_moment(&var[0])) { imax=i; bmax = *bp; }
+	       }
 	     }
 	   }
-	 }
+         } while (chunk > 0 &&
+                  get_snap_chunk(instr, &btab, &nbody, &tsnap, &bits, chunk, &ioff, &ntot));
 	    
 	 if (Qtime)
 	   fprintf(tabstr,fmt,tsnap);
 	 if (Qmin) {
-	   if (Qout) iout = imin;
+	   if (Qout) { iout = imin; bout = &bmin; }
 	   for (n=0; n<nopt; n++)
 	     fprintf(tabstr,fmt,min_moment(&var[n]));
 	 }
 	 if (Qmax) {
-	   if (Qout) iout = imax;
+	   if (Qout) { iout = imax; bout = &bmax; }
 	   for (n=0; n<nopt; n++)
 	     fprintf(tabstr,fmt,max_moment(&var[n]));
 	 }
@@ -153,8 +168,7 @@ void nemo_main()
 	 fprintf(tabstr,"\n");
 	 if (iout>=0) {
 	   int ibody = 1;
-	   Body *b1 = &btab[iout];
-	   put_snap(outstr, &b1, &ibody, &tsnap, &bits);	      	      
+	   put_snap(outstr, &bout, &ibody, &tsnap, &bits);	      	      
 	 }
 	 
     } // for()
@@ -10,9 +10,9 @@
  *      10-mar-04  V1.4  add log=                                       pjt
  *      27-jul-05   1.5  added sort=                                    pjt
  *       1-apr-21   1.6  deal with no masses in snapshot for Tjeerd     pjt
- *
- *  Bug: if the massfractions are too close such that there
- *       are bins withouth mass, this algorithm fails
+ *      16-oct-26   2.0  partial selection (selectptr) instead of qsort of all bodies,
+ *                       which also fixes fractions too close to have mass between them;
+ *                       sort= evaluated in batch
  */
 
 #include <stdinc.h>
@@ -32,7 +32,7 @@ string defv[] = {
     "tab=f\n			Full table of r,m(r) ? ",
     "log=f\n                    Print radii in log10() ? ",
     "sort=r\n                   Observerble to sort masses by",
-    "VERSION=1.6\n              1-apr-2021 PJT",
+    "VERSION=2.0\n              16-oct-2026",
     NULL,
 };
 
@@ -43,15 +43,15 @@ string cvsid="$Id$";
 
 #define MFRACT 256
 
-local void snapsort(Body *, int , real, rproc_body);
-local int rank_aux(Body *, Body *);
+extern void selectptr(real *x, real *w, int *idx, int n, int nq, real *wq, int *kq);
 
 
 void nemo_main()
 {
     stream instr;
-    real   tsnap, mf[MFRACT], tmass, cmass, fmass, mold, rold, rlag;
-    int    k, nbody, bits, nfract;
+    real   tsnap, mf[MFRACT], fm[MFRACT], tmass, cmass, mold, rold, rlag;
+    real   *rad = NULL, *mass = NULL;
+    int    i, j, k, nbody, nmax = 0, bits, nfract, kq[MFRACT], *idx = NULL;
     bool   Qtab = getbparam("tab");
     bool   Qlog = getbparam("log");
     Body *btab = NULL, *bp;
@@ -78,7 +78,17 @@ void nemo_main()
         if ((bits & PhaseSpaceBit) == 0)
             continue;                       /* if no positions -  skip */
         if (!Qtab) printf("%g",tsnap);
-        snapsort(btab,nbody,tsnap,sortptr);/* sort; hides radius in aux */
+        if (nbody > nmax) {
+            if (idx) {
+                free(idx);
+                free(rad);
+                free(mass);
+            }
+            nmax = nbody;
+            idx  = (int *) allocate(nmax*sizeof(int));
+            rad  = (real *) allocate(nmax*sizeof(real));
+            mass = (real *) allocate(nmax*sizeof(real));
+        }
         for (bp=btab, tmass=0.0; bp<btab+nbody; bp++)
             tmass += Mass(bp);
         if (tmass == 0.0) {
@@ -87,25 +97,24 @@ void nemo_main()
 	  for (bp=btab;  bp<btab+nbody; bp++)
 	    Mass(bp) = 1.0/nbody;
 	}
-        k=0;  
-        fmass=mf[0]*tmass;
-        mold=0.0;
-        rold=0.0;
-        cmass=0.0;
-        for (bp=btab; bp<btab+nbody; bp++) {    /* loop over bodies */
-            cmass += Mass(bp);
-            if(cmass>=fmass) {
-            	if (Qtab) printf("%g", mf[k]);
-		rlag = rold + (tmass*mf[k]-mold)*(Aux(bp)-rold)/(cmass-mold);
-		if (Qlog) rlag = log10(rlag);
-                printf(" %g", rlag);
-                if (Qtab) printf("\n");
-                k++;
-                if (k >= nfract) break;
-                fmass = mf[k] * tmass;
+        btreval(sortptr, btab, nbody, tsnap, 0, rad);
+        for (i=0, bp=btab; i<nbody; i++, bp++)
+            mass[i] = Mass(bp);
+        for (k=0; k<nfract; k++)
+            fm[k] = mf[k]*tmass;
+        selectptr(rad, mass, idx, nbody, nfract, fm, kq);   /* no full sort */
+        mold = rold = 0.0;          /* mass and largest rad before kq[k] */
+        for (k=0, j=0; k<nfract; k++) {
+            for ( ; j<kq[k]; j++) {
+                mold += mass[idx[j]];
+                if (j == 0 || rad[idx[j]] > rold) rold = rad[idx[j]];
             }
-            rold = Aux(bp);
-            mold = cmass;
+            cmass = mold + mass[idx[j]];
+            if (Qtab) printf("%g", mf[k]);
+            rlag = rold + (fm[k]-mold)*(rad[idx[j]]-rold)/(cmass-mold);
+            if (Qlog) rlag = log10(rlag);
+            printf(" %g", rlag);
+            if (Qtab) printf("\n");
         }
         if (!Qtab) printf("\n");
 #if 0
@@ -115,19 +124,3 @@ void nemo_main()
 #endif
     }   /* for(;;) */
 } /* nemo_main() */
-
-void snapsort(Body *btab, int nbody, real tsnap, rproc_body sortptr) 
-{
-    int i;
-    Body *b;
-
-    for (i = 0, b = btab; i < nbody; i++, b++)
-      Aux(b) = sortptr(b,tsnap,i);
-    qsort(btab, nbody, sizeof(Body), rank_aux);
-}
-
-int rank_aux(Body *a, Body *b)
-{
-    return (Aux(a) < Aux(b) ? -1 : Aux(a) > Aux(b) ? 1 : 0);
-}
-
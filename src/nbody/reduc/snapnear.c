@@ -2,6 +2,7 @@
  *  SNAPNEAR: find nearest point in a snapshot
  *
  *   22-jul-2020    V0.1   drafted
+ *   16-oct-2026    V0.2   kd-tree, allow more than one point in vals=
  */
 
 #include <stdinc.h>
@@ -10,6 +11,7 @@
 #include <vectmath.h>
 #include <filestruct.h>
 #include <history.h>
+#include <kdtree.h>
 
 #include <snapshot/snapshot.h>	
 #include <snapshot/body.h>
@@ -18,28 +20,30 @@
 
 string defv[] = {
     "in=???\n			Input file (snapshot)",
-    "vals=\n                    Values of the things to compare",
+    "vals=\n                    Values of the things to compare (one or more points)",
     "options=x,y,z\n	        Things to compare",
     "times=all\n		Times to select snapshot",
-    "VERSION=0.1\n		22-jul-2020 PJT",
+    "VERSION=0.2\n		16-oct-2026",
     NULL,
 };
 
 string usage="find a near point in a snapshot";
 
 #define MAXOPT    50
+#define MAXVALS   10000
 
 extern string *burststring(string,string);
 
 void nemo_main()
 {
     stream instr, tabstr;
-    real   tsnap, dr, aux, d, dmin;
-    real   vars[MAXOPT], bvars[MAXOPT];
+    real   tsnap, dr, aux, d2, *pts;
+    real   vars[MAXVALS];
     string times;
     Body *btab = NULL, *bp, *bq;
-    int i, n, nbody, bits, nsep, isep, nopt, ParticlesBit, nvals;
+    int i, j, n, nbody, bits, nsep, isep, nopt, ParticlesBit, nvals;
     int imin;
+    kdtree *kd;
     string *opt;
     rproc_body fopt[MAXOPT];
 
@@ -58,9 +62,9 @@ void nemo_main()
       }
     }
     
-    nvals = nemoinpr(getparam("vals"),vars,nopt);
-    if (nopt != nvals)
-      error("Need %d values",nopt);
+    nvals = nemoinpr(getparam("vals"),vars,MAXVALS);
+    if (nvals <= 0 || nvals % nopt)
+      error("Need a multiple of %d values",nopt);
     times = getparam("times");
 
     get_history(instr);                 /* read history */
@@ -72,26 +76,21 @@ void nemo_main()
       if ( (bits & ParticlesBit) == 0)
 	continue;                   /* skip work, only diagnostics here */
 
-      for (bp = btab, i=0; bp < btab+nbody; bp++, i++) {     
-	d = 0.0;
-	for (n=0; n<nopt; n++) {
-	  bvars[n] = fopt[n](bp,tsnap,i);
-	  d += sqr(bvars[n]-vars[n]);
-	}
-	d = sqrt(d);
-	if (i==0) {
-	  dmin = d;
-	  imin = 0;
-	} else if (d < dmin) {
-	  dmin = d;
-	  imin = i;
-	}
-      }	
-      bp = btab+imin;
-      printf("%g %g %g ",Pos(bp)[0],Pos(bp)[1],Pos(bp)[2]);
-      printf("%g %g %g ",Vel(bp)[0],Vel(bp)[1],Vel(bp)[2]);
-      printf("%d %g",imin,dmin);
-      printf("\n");
+      pts = (real *) allocate((size_t)nbody * nopt * sizeof(real));
+      for (bp = btab, i=0; bp < btab+nbody; bp++, i++)
+	for (n=0; n<nopt; n++)
+	  pts[i*nopt+n] = fopt[n](bp,tsnap,i);
+      kd = kd_build(pts, nbody, nopt, 0);
+      for (j=0; j<nvals; j+=nopt) {            /* nearest for each point */
+	if (kd_knn(kd, vars+j, 1, -1, &imin, &d2) < 1) break;
+	bp = btab+imin;
+	printf("%g %g %g ",Pos(bp)[0],Pos(bp)[1],Pos(bp)[2]);
+	printf("%g %g %g ",Vel(bp)[0],Vel(bp)[1],Vel(bp)[2]);
+	printf("%d %g",imin,sqrt(d2));
+	printf("\n");
+      }
+      kd_free(kd);
+      free(pts);
     }
     strclose(instr);
 }
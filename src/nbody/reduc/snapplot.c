@@ -24,6 +24,7 @@
  *          c 7-oct-02  atof->natof					  pjt
  *      V3.5  9-oct-03  finally able to read the new snapshot(5NEMO) style PJT
  *      V3.5b  11-oct-21 C99 build                                         PPT
+ *      V3.6  16-oct-26 evaluate the expressions once per snapshot, in batch
  */
 
 #include <stdinc.h>
@@ -70,7 +71,7 @@ string defv[] = {
 #endif
     "frame=\n			  base filename for rasterfiles(5)",
     "trak=\n                      alternative for trakplot (t|f)",
-    "VERSION=3.5b\n		  14-oct-2021 PPT",
+    "VERSION=3.6\n		  16-oct-2026",
     NULL,
 };
 
@@ -109,6 +110,12 @@ local real *phiptr = NULL;
 local real *accptr = NULL;
 local real *auxptr = NULL;
 
+#define NBLOCK  256                     /* bodies per batch of expressions */
+
+local int  nval = 0;                    /* values of the expressions */
+local real *xval, *yval, *pval, *cval;
+local int  *vval;
+
 real xtrans(real), ytrans(real);
 
 local bool scansnap(void);
@@ -280,6 +287,8 @@ void setrange(real *rval, string rexp)
 
 extern btrproc btrtrans(string);	/* in reality: rproc */
 extern btiproc btitrans(string);	/* in reality: iproc */
+extern void btreval(btrproc, Body *, int, real, int, real *);
+extern void btieval(btiproc, Body *, int, real, int, int *);
 
 void compfuncs()
 {
@@ -490,44 +499,73 @@ void setticks(real tiks[], int *ntik, string tikstr)
 void plotsnap()
 {
     real t, *mp, *psp, *pp, *ap, *acp;
-    int vismax, visnow, i, vis, icol;
+    int vismax, visnow, i, k, n, icol;
     real psz, col, x, y;
-    Body b;
+    Body btab[NBLOCK], *b;
 
     t = (timeptr != NULL ? *timeptr : 0.0);	/* get current time value   */
-    CLRV(Acc(&b));				/* zero unsupported fields  */
-    Key(&b) = 0;
-    visnow = vismax = 0;
-    do {					/* loop painting layers     */
-	visnow++;				/*   make next layer visib. */
-	mp  = massptr;				/*   (re)set data pointers  */
-	psp = phaseptr;
-	pp  = phiptr;
-	ap  = auxptr;
-	acp = accptr;
-	for (i = 0; i < nbody; i++) {		/*   loop over all bodies   */
-	    Mass(&b) = (mp != NULL ? *mp++ : 0.0);
+    if (nbody > nval) {
+        if (nval) {
+            free(xval);
+            free(yval);
+            free(pval);
+            free(cval);
+            free(vval);
+        }
+        nval = nbody;
+        xval = (real *) allocate(nval * sizeof(real));
+        yval = (real *) allocate(nval * sizeof(real));
+        pval = (real *) allocate(nval * sizeof(real));
+        cval = (real *) allocate(nval * sizeof(real));
+        vval = (int *) allocate(nval * sizeof(int));
+    }
+    for (k = 0; k < NBLOCK; k++) {		/* zero unsupported fields  */
+	CLRV(Acc(btab+k));
+	Key(btab+k) = 0;
+    }
+    mp  = massptr;				/* set data pointers        */
+    psp = phaseptr;
+    pp  = phiptr;
+    ap  = auxptr;
+    acp = accptr;
+    for (i = 0; i < nbody; i += n) {		/* loop over blocks of bodies */
+	n = MIN(NBLOCK, nbody-i);
+	for (k = 0, b = btab; k < n; k++, b++) {
+	    Mass(b) = (mp != NULL ? *mp++ : 0.0);
 						/*     set mass if supplied */
-	    SETV(Pos(&b), psp);			/*     always set position  */
+	    SETV(Pos(b), psp);			/*     always set position  */
 	    psp += NDIM;			/*     and advance p.s. ptr */
-	    SETV(Vel(&b), psp);			/*     always set velocity  */
+	    SETV(Vel(b), psp);			/*     always set velocity  */
 	    psp += NDIM;			/*     and advance ptr      */
-	    Phi(&b) = (pp != NULL ? *pp++ : 0.0);	
-	    Aux(&b) = (ap != NULL ? *ap++ : 0.0);
-	    if (acp) {				
-	    	SETV(Acc(&b),acp);		/*     set accel's          */	
-	    	acp += NDIM;			/*     and advance ptr      */
+	    Phi(b) = (pp != NULL ? *pp++ : 0.0);
+	    Aux(b) = (ap != NULL ? *ap++ : 0.0);
+	    if (acp) {
+		SETV(Acc(b),acp);		/*     set accel's          */
+		acp += NDIM;			/*     and advance ptr      */
 	    }
 	    					/*     set phi,aux if given */
-	    vis = (*vfunc)(&b, t, i);		/*     evaluate visibility  */
-	    vismax = MAX(vismax, vis);		/*     remember how hi to go*/
-	    if (vis == visnow) {		/*     if body is visible   */
-		x = xtrans((*xfunc)(&b, t, i));	/*       evaluate x,y coords*/
-		y = ytrans((*yfunc)(&b, t, i));
+	}
+	btieval(vfunc, btab, n, t, i, vval+i);	/*   evaluate visibility    */
+	btreval(xfunc, btab, n, t, i, xval+i);	/*   and x,y coords etc.    */
+	btreval(yfunc, btab, n, t, i, yval+i);
+	btreval(pfunc, btab, n, t, i, pval+i);
+#ifdef COLOR
+	btreval(cfunc, btab, n, t, i, cval+i);
+#endif
+    }
+    for (i = 0, vismax = 0; i < nbody; i++)
+	vismax = MAX(vismax, vval[i]);		/* remember how hi to go    */
+    visnow = 0;
+    do {					/* loop painting layers     */
+	visnow++;				/*   make next layer visib. */
+	for (i = 0; i < nbody; i++) {		/*   loop over all bodies   */
+	    if (vval[i] == visnow) {		/*     if body is visible   */
+		x = xtrans(xval[i]);		/*       transform x,y      */
+		y = ytrans(yval[i]);
 		if (xbox[0] < x && x < xbox[1] && ybox[0] < y && y < ybox[1]) {
-		    psz = (*pfunc)(&b, t, i);	/*         eval point size  */
+		    psz = pval[i];		/*         point size       */
 #ifdef COLOR
-		    col = (*cfunc)(&b, t, i);
+		    col = cval[i];
                     col = (col - crange[0])/(crange[1] - crange[0]);
 		    icol = 1 + (plncolors() - 2) *
 			         MAX(0.0, MIN(1.0, col));
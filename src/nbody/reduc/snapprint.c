@@ -20,6 +20,8 @@
  *      31-dec-02       V2.1 gcc3/SINGLEPREC             pjt
  *       4-sep-03       V2.2 allow CSV output based      pjt
  *      24-feb-04       V2.4 add newline=t               pjt
+ *      16-oct-26       V2.5 add chunk=
+ *                      V2.6 evaluate options in batch (btreval)
  */
 
 #include <stdinc.h>
@@ -45,20 +47,23 @@ string defv[] = {
     "newline=f\n                add newline in the header?",
     "csv=f\n                    Use Comma Separated Values format",
     "comment=f\n                Add table columns as common, instead of debug",
-    "VERSION=2.4\n		24-feb-04 PJT",
+    "chunk=0\n                  If >0, read snapshots in chunks of this many bodies",
+    "VERSION=2.6\n		16-oct-26",
     NULL,
 };
 
 string usage="tabulate a snapshot";
 
 #define MAXOPT    50
+#define NBLOCK   256            /* bodies per batch of options */
 
 extern string *burststring(string,string);
 
 void nemo_main()
 {
     stream instr, tabstr;
-    real   tsnap, dr, aux;
+    real   tsnap, dr;
+    permanent real val[MAXOPT][NBLOCK];
     string times;
     Body *btab = NULL, *bp, *bq;
     bool   Qsepar, Qhead = getbparam("header");
@@ -66,6 +71,7 @@ void nemo_main()
     bool   Qcomment = getbparam("comment");
     bool   Qnewline = getbparam("newline");
     int i, n, nbody, bits, nsep, isep, nopt, ParticlesBit;
+    int chunk = getiparam("chunk"), ioff, ntot, k, nb;
     char fmt[20],*pfmt;
     string *opt;
     rproc_body fopt[MAXOPT];
@@ -113,6 +119,8 @@ void nemo_main()
       Qsepar=TRUE;
     } else
       Qsepar=FALSE;
+    if (Qsepar && chunk > 0)
+      error("separ= needs all bodies in memory, cannot use chunk=");
 
 
     get_history(instr);                 /* read history */
@@ -121,29 +129,49 @@ void nemo_main()
 	get_history(instr);
         if (!get_tag_ok(instr, SnapShotTag))
             break;                                  /* done with work */
+        if (chunk > 0) {                /* only a chunk of bodies at a time */
+            if (!get_snap_chunk(instr, &btab, &nbody, &tsnap, &bits, chunk, &ioff, &ntot))
+                continue;               /* no particles in this snapshot */
+            if ((!streq(times,"all") && 
+                 !((bits & TimeBit) && within(tsnap,times,0.001))) ||
+                (bits & ParticlesBit) == 0) {
+                get_snap_chunk(instr, &btab, &nbody, &tsnap, &bits, 0, &ioff, &ntot);
+                continue;               /* skip work on this snapshot */
+            }
+        } else {
 #if 0
-        get_snap(instr, &btab, &nbody, &tsnap, &bits);
-        if (!streq(times,"all") && !within(tsnap,times,0.0001))
-            continue;                   /* skip work on this snapshot */
+            get_snap(instr, &btab, &nbody, &tsnap, &bits);
+            if (!streq(times,"all") && !within(tsnap,times,0.0001))
+                continue;                   /* skip work on this snapshot */
 #else
-        get_snap_by_t(instr, &btab, &nbody, &tsnap, &bits, times);	
+            get_snap_by_t(instr, &btab, &nbody, &tsnap, &bits, times);	
 #endif
-        if ( (bits & ParticlesBit) == 0)
-            continue;                   /* skip work, only diagnostics here */
+            if ( (bits & ParticlesBit) == 0)
+                continue;                   /* skip work, only diagnostics here */
+            ioff = 0;
+            ntot = nbody;
+        }
 	if (!Qsepar) {				/* printf options */
 	    if (Qhead) {
-	      fprintf(tabstr,"%d ",nbody);
+	      fprintf(tabstr,"%d ",ntot);
 	      if (Qnewline) fprintf(tabstr,"\n");
 	      fprintf(tabstr,"%g\n",tsnap);
 	    }
-            for (bp = btab, i=0; bp < btab+nbody; bp++, i++) {
-                for (n=0; n<nopt; n++) {
-                    aux = fopt[n](bp,tsnap,i);
-		    if (Qcsv && n>0) fprintf(tabstr,",");
-                    fprintf(tabstr,fmt,aux);
+            do {
+                for (i=0; i<nbody; i+=nb) {
+                    nb = MIN(NBLOCK, nbody-i);
+                    for (n=0; n<nopt; n++)      /* evaluate a block at once */
+                        btreval(fopt[n], btab+i, nb, tsnap, ioff+i, val[n]);
+                    for (k=0; k<nb; k++) {
+                        for (n=0; n<nopt; n++) {
+		            if (Qcsv && n>0) fprintf(tabstr,",");
+                            fprintf(tabstr,fmt,val[n][k]);
+                        }
+                        fprintf(tabstr,"\n");
+                    }
                 }
-                fprintf(tabstr,"\n");
-            }
+            } while (chunk > 0 &&
+                     get_snap_chunk(instr, &btab, &nbody, &tsnap, &bits, chunk, &ioff, &ntot));
         } else {
             isep=nsep;
             for (bp=btab+1; bp<btab+nbody; bp++)
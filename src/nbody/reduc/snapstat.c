@@ -19,6 +19,7 @@
  *      11-feb-19   1.6  add crossing time estimate
  *       8-apr-19   1.6c   fix times= bug
  *      11-apr-19   1.6d   add virial ration 2T/W
+ *      16-oct-26   1.7  chunk= for snapshots that do not fit in memory
  */
 
 /**************** INCLUDE FILES ********************************/ 
@@ -28,6 +29,7 @@
 #include <vectmath.h>
 #include <filestruct.h>
 #include <snapshot/snapshot.h>  
+#include <snapshot/snapdata.h>
 
 #ifndef HUGE
 # define  HUGE  1e20
@@ -53,7 +55,8 @@ string defv[] = {                /* DEFAULT INPUT PARAMETERS */
     "rms=false\n                Want rms",
     "ecutoff=0.0\n              Cutoff for bound particles",
     "verbose=t\n                verbose mode?",
-    "VERSION=1.6d\n             11-apr-2019 PJT",
+    "chunk=0\n                  If >0, read snapshots in chunks of this many bodies",
+    "VERSION=1.7\n              16-oct-2026",
     NULL
 };
 
@@ -113,13 +116,15 @@ local real *epot=NULL;                              /* potential energies */
 local real *rad=NULL;                               /* radii */
 local int  *idr=NULL;                               /* index array for sorting */
 
+local int chunk_snap(stream, int);
+
 
 /****************************** START OF PROGRAM **********************/
 
 void nemo_main()
 {
     stream instr;
-    int    gs;
+    int    gs, chunk;
     
     times = getparam("times");
     minradfrac = getdparam("minradfrac");
@@ -138,10 +143,18 @@ void nemo_main()
     need_phi = FALSE | Qexact | Qpot;
     need_acc = FALSE | Qexact | Qpot;
     need_rad = TRUE;
+    chunk = getiparam("chunk");
+    if (chunk > 0 && (Qpot || Qr_v || Qr_h || Qr_c || Qexact))
+        error("chunk= cannot be used with pot=, r_v=, r_h=, r_c= or exact=");
     
     instr = stropen(getparam("in"), "r");
 
     for(;;) {
+      if (chunk > 0) {
+        if (chunk_snap(instr, chunk) < 0)
+          break;
+        continue;
+      }
       if ( (gs = get_snap(instr)) > 0) {
 	if (!streq(times,"all") && !within(tsnap,times,TIMEFUZZ)) {
 	  dprintf(1,"Skipping time %g\n", tsnap);
@@ -257,6 +270,48 @@ get_snap(stream instr) /* returns:   -1: not a snapshot   0: no ParticlesTag */
     return 1;
 }
 
+/*
+ *  chunk_snap:  analyse the next snapshot a chunk of bodies at a time;
+ *               only the statistics that can be accumulated are done.
+ *      returns:   -1:  not a Snapshot, take it as EOF
+ *                  0:  no Particles here, or skipped
+ *		    1:  yes, Particles here
+ */
+
+local int chunk_snap(stream instr, int chunk)
+{
+    permanent snapdata sd;
+    int i;
+
+    get_history(instr);
+    if (!get_tag_ok(instr, SnapShotTag))
+      return -1;
+    if (!get_snapdata_chunk(instr, &sd, MassBit|PhaseSpaceBit, chunk))
+      return 0;
+    nbody = sd.ntot;
+    tsnap = (sd.bits & TimeBit) ? sd.time : 0.0;
+    if (!streq(times,"all") && !within(tsnap,times,TIMEFUZZ)) {
+      dprintf(1,"Skipping time %g\n", tsnap);
+      end_snapdata_chunk(instr, &sd);
+      return 0;
+    }
+    if ((sd.bits & PhaseSpaceBit) == 0) {
+      warning("No phasespace in snapshot: time=%f",tsnap);
+      end_snapdata_chunk(instr, &sd);
+      return 0;
+    }
+    ini_analysis();
+    do {
+      dprintf(2,"chunk of %d bodies at %d\n",sd.nbody,sd.first);
+      for (i=0; i<sd.nbody; i++)
+        add_analysis(sd.first+i, (sd.bits & MassBit) ? sd.mass[i] : 0.0,
+                     sd.pos[0][i], sd.pos[1][i], sd.pos[2][i],
+                     sd.vel[0][i], sd.vel[1][i], sd.vel[2][i]);
+    } while (get_snapdata_chunk(instr, &sd, MassBit|PhaseSpaceBit, chunk));
+    report_analysis();
+    return 1;
+}
+
 snap_alloc()
 {
     mass = (real *) reallocate(mass, nbody*sizeof(real));
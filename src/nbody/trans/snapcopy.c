@@ -9,6 +9,7 @@
  *      13-feb-04       V1.1f    silenced more compiler warnings (shetty bug?)
  *      15-nov-06        1.2    set time to 0 if it was absent     PJT/AP
  *    27-dec-2019        1.3    special case body= selection
+ *    16-oct-2026        2.1    evaluate select= once, in batch
  *
  *	BUG: should optionally copy other sets within the snapshot
  *	     set, e.g. diagnostics and story
@@ -35,7 +36,7 @@ string defv[] = {
     "precision=double\n Precision of results to store (double/single) [unused]",
     "keep=all\n         Items to copy in snapshot",
     "i=-1\n             Select one body to select (overrides select=)",
-    "VERSION=2.0a\n     8-aug-2022 PJT",
+    "VERSION=2.1\n      16-oct-2026",
     NULL,
 };
 
@@ -50,7 +51,7 @@ void nemo_main(void)
     real   tsnap;
     string times, precision, keep;
     Body   *btab = NULL, *bpi, *bpo;
-    int    i, nbody, nout, nreject, bitsi, bitso, vis, visnow, vismax;
+    int    i, nbody, nout, nreject, bitsi, bitso, *vis = NULL, nvis = 0;
     int    isnap = 0;
     bool   Qall;
     int    ibody = getiparam("i");
@@ -109,18 +110,18 @@ void nemo_main(void)
             dprintf(0,"Warning: Keyfield reinitialized\n");
         for (bpi = btab; bpi < btab+nbody; bpi++)
             Key(bpi) = 0;                    /* set to false */
-        visnow = vismax = nreject = 0;
 	if (ibody < 0) {   // use the select=
-	  do {				/* loop through all particles */
-	    visnow++;
-            for (bpi = btab, i=0; i<nbody; bpi++,i++) {
-	      vis = (*sfunc)(bpi, tsnap, i);
-	      dprintf(2,"sfunc [%d] = %d\n",i,vis);
-	      vismax = MAX(vismax,vis);
-	      if (vis==visnow)
-		Key(bpi) = 1;
-            }
-	  } while (visnow < vismax);          /* do all layers */
+	  if (nbody > nvis) {
+	    if (vis) free(vis);
+	    nvis = nbody;
+	    vis = (int *) allocate(nvis*sizeof(int));
+	  }
+	  btieval(sfunc, btab, nbody, tsnap, 0, vis);   /* all particles */
+	  for (bpi = btab, i=0; i<nbody; bpi++,i++) {
+	    dprintf(2,"sfunc [%d] = %d\n",i,vis[i]);
+	    if (vis[i] > 0)		/* any layer counts */
+	      Key(bpi) = 1;
+	  }
 	} else
 	  Key(btab+ibody) = 1;
         nreject = 0;
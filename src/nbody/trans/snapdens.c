@@ -16,6 +16,8 @@
  *     12-apr-03        V1.5 add nn= keyword for atlas  PJT
  *     29-dec-04            a   forgotten m2tot=0       PJT
  *      5-apr-06            c   ndim not set            PJT
+ *     16-oct-26        V2.0 kd-tree neighbour search, OpenMP, no more MAXK
+ *                          a   kmax>=nbody uses nbody-1 neighbours
  */
 
 #include <stdinc.h>
@@ -23,6 +25,7 @@
 #include <math.h>
 #include <vectmath.h>		/* otherwise NDIM undefined */
 #include <filestruct.h>
+#include <kdtree.h>
 
 #include <snapshot/snapshot.h>	
 #include <snapshot/body.h>
@@ -39,7 +42,7 @@ string defv[] = {
     "tfactor=-1.0\n               conversion factor v->r [virial=sqrt(2)]",
     "nn=f\n                       add NN index to the Key field?",
     "ndim=3\n                     3dim or 2dim densities?",
-    "VERSION=1.5c\n		  5-apr-2006 PJT",
+    "VERSION=2.0a\n		  16-oct-2026",
     NULL,
 };
 
@@ -55,22 +58,17 @@ string cvsid="$Id$";
 #define FAC5   1.0              /* T.B.D. */
 #define FAC6   1.0              /* T.B.D. */
 
-#define MAXK   256
-
-int   iindex[MAXK+1];             /* pointer to nearest neighbours */
-Body  *bindex[MAXK+1];            /* pointer to body */
-real  r[MAXK+1];                  /* radius squared to nearest neighbours */
+#define NBLOCK 4096             /* bodies per block of parallel searches */
 
 Body  *btab = NULL;               /* pointer to snapshot Body datastructure */
-int   nbody, kmax, klen, ndim;
+int   nbody, kmax, ndim;
 
 bool  Qdens, Qtab, Qnn;
 char  *fmt;
 real  tfactor;
 
 local void density(void);
-local real raddif(Body *, Body *);
-local void stat_nn(Body *);
+local void stat_nn(Body *, int, int *, real *);
 
 
 nemo_main()
@@ -87,8 +85,8 @@ nemo_main()
     else
         outstr = NULL;
     kmax = getiparam("kmax");
-    if (kmax > MAXK)
-        error("parameter kmax=%d too large (%d)",kmax,MAXK);
+    if (kmax < 1)
+        error("parameter kmax=%d must be positive",kmax);
     Qdens = getbparam("dens"); 
     Qtab = getbparam("tab");  
     Qnn = getbparam("nn");  
@@ -108,6 +106,12 @@ nemo_main()
         get_snap(instr, &btab, &nbody, &tsnap, &bits);
 	if ( (bits & PhaseSpaceBit)==0)
 	  error("need phasespace in snapshot");
+	if (nbody < 2)
+	  error("need at least 2 bodies, nbody=%d",nbody);
+	if (kmax >= nbody) {
+	  warning("kmax=%d too large for nbody=%d, using %d",kmax,nbody,nbody-1);
+	  kmax = nbody-1;
+	}
 	if ( (bits & MassBit)==0) {
 	  warning("no masses in snapshot, assume M=1, m_i=1/%d",nbody);
 	  dm = 1.0 / (double) nbody;
@@ -132,8 +136,10 @@ nemo_main()
 local void density(void)
 {
     double tmp2, drmin, mtot, m2tot, rdtot, com[NDIM], rmtot[NDIM], mmax;
-    Body  *bi, *bj;
-    int    i, j, k, kk;
+    real   *pts, *r2;
+    Body  *bi;
+    int    i, j, i0, n, nd, *nnb, *klen;
+    kdtree *kd;
     
     drmin = HUGE;       /* init minimum interparticle distance */
     mmax = -HUGE;       /* init maximum density */
@@ -141,46 +147,44 @@ local void density(void)
     for (j=0; j<NDIM; j++)
         rmtot[j] = 0.0;
     mtot = m2tot = 0.0;
-    for (i=0, bi=btab; i<nbody; i++, bi++) {
-        klen = 0;                   /* reset nearest neighbours list length */
-        for (k=0; k<=kmax; k++) {          /* .. and index pointers etc */
-            iindex[k] = -1;
-            bindex[k] = NULL;
-            r[k] = HUGE;
-        }
-        for (j=0, bj=btab; j<nbody; j++, bj++) { /* look at all other stars */
-            if (i==j)                            /* except itself */
-                continue;
-            tmp2 = raddif(bi,bj);                /* radius diff squared */
-            if (tmp2 < drmin)
-                drmin = tmp2;
-            if (tmp2 > r[klen])          /* if already larger than largest */
-                continue;                        /* goto next star 'j' */
-            for (k=0; k<=klen; k++) {     /* check where to insert in list */
-                if (tmp2 < r[k]) {
-                    if (klen<kmax)               /* increase list length */
-                        klen++;
-                    for (kk=klen-1; kk>k; kk--) {/* shift higher values */
-                        r[kk] = r[kk-1];
-                        iindex[kk] = iindex[kk-1];
-                        bindex[kk] = bindex[kk-1];
-                    } /* for-kk */
-                    r[k] = tmp2;                 /* and insert in list */
-                    iindex[k] = j;
-                    bindex[k] = bj;
-                    break;                       /* done with k-loop */
-                } /* if */
-            } /* for-k */
-        } /* for-j */
-        stat_nn(bi);                       /* statistics of NN list stars */
+
+    nd = (tfactor > 0.0 ? 2*NDIM : NDIM);  /* search in (x,v*tfactor) or x */
+    pts = (real *) allocate((size_t)nbody * nd * sizeof(real));
+    for (i=0, bi=btab; i<nbody; i++, bi++)
         for (j=0; j<NDIM; j++) {
-            rmtot[j] += Aux(bi) * Pos(bi)[j]; /* (phase space) density weight */
+            pts[i*nd+j] = Pos(bi)[j];
+            if (nd > NDIM) pts[i*nd+NDIM+j] = Vel(bi)[j] * tfactor;
         }
-        mtot +=  Aux(bi);
-	m2tot += Aux(bi) * Aux(bi);
-        if (Aux(bi) > mmax)
-            mmax = Aux(bi);
-    } /* for-i */
+    kd = kd_build(pts, nbody, nd, 0);
+    nnb  = (int *)  allocate(NBLOCK * kmax * sizeof(int));
+    r2   = (real *) allocate(NBLOCK * kmax * sizeof(real));
+    klen = (int *)  allocate(NBLOCK * sizeof(int));
+
+    for (i0=0; i0<nbody; i0+=NBLOCK) {      /* blocks of bodies: */
+        n = MIN(NBLOCK, nbody-i0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,64)
+#endif
+        for (i=0; i<n; i++)                 /* nearest neighbours in parallel */
+            klen[i] = kd_knn(kd, pts+(i0+i)*nd, kmax, i0+i, nnb+i*kmax, r2+i*kmax);
+        for (i=0, bi=btab+i0; i<n; i++, bi++) {   /* the rest in order */
+            if (r2[i*kmax] < drmin)
+                drmin = r2[i*kmax];
+            stat_nn(bi, klen[i], nnb+i*kmax, r2+i*kmax);
+            for (j=0; j<NDIM; j++) {
+                rmtot[j] += Aux(bi) * Pos(bi)[j]; /* (phase space) density weight */
+            }
+            mtot +=  Aux(bi);
+            m2tot += Aux(bi) * Aux(bi);
+            if (Aux(bi) > mmax)
+                mmax = Aux(bi);
+        }
+    }
+    kd_free(kd);
+    free(pts);
+    free(nnb);
+    free(r2);
+    free(klen);
 /* Table header in debug mode */
     dprintf(1,"Weighted_c_o_m[%d]  ",NDIM);
     dprintf(1,"Nearest_neighbor_distance   ");
@@ -206,28 +210,10 @@ local void density(void)
         
 }
 
-/* calculate distance squared between 2 stars */
-
-local real raddif(Body *bi, Body *bj)
-{
-    int i, j;
-    real rtmp;
-    
-    rtmp = 0.0;
-    for (i=0; i<NDIM; i++)
-        rtmp += sqr(Pos(bi)[i] - Pos(bj)[i]);
-    if (tfactor > 0.0) {
-        for (i=0; i<NDIM; i++)
-            rtmp += sqr((Vel(bi)[i] - Vel(bj)[i])*tfactor);
-    }
-    
-    return rtmp;
-}
-
 /*  stat_nn:   some statistics on the K nearest neighbors of a star
- *
+ *             klen neighbours nnb[] at distance squared r[], nearest first
  */
-local void stat_nn(Body *bi)
+local void stat_nn(Body *bi, int klen, int *nnb, real *r)
 {
     real sigma, sigma2, rad, dens, fc, fc2, radius;
     real v1[NDIM], v2[NDIM], s[NDIM];
@@ -240,8 +226,8 @@ local void stat_nn(Body *bi)
     }
     dprintf(2,"NN[%d] list: ",klen);
     for (k=0; k<klen; k++) {            /* loop over nearest neighbors */
-        bp = bindex[k];
-	dprintf(2," %d",iindex[k]);
+        bp = btab + nnb[k];
+	dprintf(2," %d",nnb[k]);
         if (k<klen-1) dens += Mass(bp); /* eq (II.2) in CH 1985 ApJ 298,80) */
         for (i=0; i<NDIM; i++) {
             v1[i] += Vel(bp)[i];
@@ -276,7 +262,7 @@ local void stat_nn(Body *bi)
 
     Aux(bi) = (Qdens ? dens : fc);        /* replace (phase space) density */
     if (Qnn)
-      Key(bi) = iindex[0];
+      Key(bi) = nnb[0];
     if (tfactor>0 && !Qdens)  Aux(bi) = fc2;	/* new new */
     if (Qtab) {
         ABSV(radius,Pos(bi));
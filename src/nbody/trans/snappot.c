@@ -2,6 +2,7 @@
  *  SNAPPOT:    add a potential force/acc to a snapshot
  *
  *  25-mar-05   Created         Peter Teuben
+ *  16-oct-26   V1.1 use potential_n(), NCHUNK bodies at a time
  *
  */
 
@@ -26,7 +27,7 @@ string defv[] = {
   "potpars=\n           parameters to potential",
   "potfile=\n           optional filename to potential",
   "times=all\n          Which times to work on",
-  "VERSION=1.0\n	4-apr-97 pjt",
+  "VERSION=1.1\n	16-oct-2026",
   NULL,
 };
 
@@ -35,6 +36,7 @@ string usage="add analytical potentials/forces to an N-body system";
 string cvsid="$Id$";
 
 #define TIMEFUZZ	0.0001	/* tolerance in time comparisons */
+#define NCHUNK		256	/* bodies per call of potential_n() */
 
 void nemo_main(void)
 {
@@ -43,19 +45,20 @@ void nemo_main(void)
   string times;
   Body *btab = NULL, *bp;
   int nbody, bits;
-  potproc_real pot;
+  potproc_n_real potn;
   real ome,ome2,half_ome2,two_ome;
 
-  vector lacc,lpos;
-  real   lphi;
-  int    ndim=NDIM;
+  vector lacc[NCHUNK],lpos[NCHUNK];
+  real   lphi[NCHUNK];
+  int    ndim=NDIM, n, i;
 
 
   times = getparam("times");
 
-  pot = get_potential (getparam("potname"),
-		       getparam("potpars"), 
-		       getparam("potfile"));
+  get_potential (getparam("potname"),
+		 getparam("potpars"), 
+		 getparam("potfile"));
+  potn = get_potential_n();
   ome = get_pattern();     /* pattern speed first par of potential */
   ome2 = ome*ome;
   half_ome2 = 0.5 * ome2;
@@ -79,18 +82,21 @@ void nemo_main(void)
     else if (!streq(times,"all") && !within(tsnap, times, TIMEFUZZ))
       continue;		/* however skip this snapshot */
     dprintf (1,"Snapshot time=%f shifting\n",tsnap);
-    for (bp = btab; bp < btab+nbody; bp++) {
-      SETV(lpos,Pos(bp));
-      (*pot)(&ndim,lpos,lacc,&lphi,&tsnap);
-
-      if (ome!=0.0) {
-	lphi -= half_ome2*(sqr(lpos[0])+sqr(lpos[1]));
-	lacc[0] += ome2*lpos[0] + two_ome*Vel(bp)[1];
-	lacc[1] += ome2*lpos[1] - two_ome*Vel(bp)[0];
+    for (bp = btab; bp < btab+nbody; bp += n) {
+      n = MIN(NCHUNK, btab+nbody-bp);
+      for (i=0; i<n; i++)
+	SETV(lpos[i],Pos(bp+i));
+      (*potn)(&ndim,&n,lpos[0],lacc[0],lphi,&tsnap);
+
+      for (i=0; i<n; i++) {
+	if (ome!=0.0) {
+	  lphi[i] -= half_ome2*(sqr(lpos[i][0])+sqr(lpos[i][1]));
+	  lacc[i][0] += ome2*lpos[i][0] + two_ome*Vel(bp+i)[1];
+	  lacc[i][1] += ome2*lpos[i][1] - two_ome*Vel(bp+i)[0];
+	}
+	Phi(bp+i) = lphi[i];
+	SETV(Acc(bp+i),lacc[i]);
       }
-
-      Phi(bp) = lphi;
-      SETV(Acc(bp),lacc);
     }
     bits |= (PotentialBit|AccelerationBit|TimeBit);
     put_snap(outstr, &btab, &nbody, &tsnap, &bits);
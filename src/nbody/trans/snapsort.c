@@ -10,6 +10,8 @@
  *     1-nov-07       a  bug when Aux is present                    pjt
  *    29-feb-08          fix a memory leak on btab                  jcl
  *    19-Jun-09          fix a bug when Aux is present              jcl
+ *    16-oct-26   V2.0   sort=radix (default): sort (rank,index) pairs, then
+ *                       move the bodies once; rank= evaluated in batch
  */
 
 #include <stdinc.h>
@@ -28,8 +30,8 @@ string defv[] = {
     "out=???\n		Output file name (snapshot)",
     "rank=r\n	        Value used in ranking particles",
     "times=all\n        Range of times to process ",
-    "sort=qsort\n       Sort mode {qsort;...}",
-    "VERSION=1.6\n      11-oct-2023 PJT ",
+    "sort=radix\n       Sort mode {radix;qsort;...}",
+    "VERSION=2.0\n      16-oct-2026",
     NULL,
 };
 
@@ -39,6 +41,9 @@ string usage="sort particles according to a user-specified ranking";
 /* #define FLOGGER 1       /* merge in the cute flogger test routines */
 
 void snapsort(Body *, int , real , bool, bool, rproc_body, iproc);
+local void snapsort_radix(Body *, int , real , rproc_body);
+
+extern void sortptr_radix(real *x, int *idx, int n);
 
 void nemo_main()
 {
@@ -92,16 +97,20 @@ void snapsort(
     Body *b;
     real *aux;
 
+    if (!Qkey) { /* initialize Key's if they didn't exist */
+      for (i = 0, b = btab; i < nbody; i++, b++)
+	Key(b) = i;
+    }
+    if (mysort == NULL) {   /* radix: Aux is not used */
+      snapsort_radix(btab, nbody, tsnap, rank);
+      return;
+    }
+
     if (Qaux) {  /* make backup copy of Aux */
       aux = (real *) allocate(nbody*sizeof(real));
       for (i = 0, b = btab; i < nbody; i++, b++)
 	aux[i] = Aux(b);
     }
-    if (!Qkey) { /* initialize Key's if they didn't exist */
-      for (i = 0, b = btab; i < nbody; i++, b++)
-	Key(b) = i;
-    }
-    
 
     for (i = 0, b = btab; i < nbody; i++, b++) {
 	Aux(b) = (rank)(b, tsnap, i);
@@ -116,6 +125,33 @@ void snapsort(
     }
 }
 
+/*
+ *  sort (rank,index) pairs with a radix sort, and move the (large)
+ *  bodies only once, instead of in every exchange of the sort
+ */
+
+local void snapsort_radix(Body *btab, int nbody, real tsnap, rproc_body rank)
+{
+    int i, *idx;
+    real *r;
+    Body *tmp;
+
+    r = (real *) allocate(nbody*sizeof(real));
+    idx = (int *) allocate(nbody*sizeof(int));
+    btreval(rank, btab, nbody, tsnap, 0, r);
+    sortptr_radix(r, idx, nbody);
+    tmp = (Body *) allocate(nbody*sizeof(Body));
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (i = 0; i < nbody; i++)
+      bcopy(btab+idx[i], tmp+i, sizeof(Body));
+    memcpy(btab, tmp, nbody*sizeof(Body));
+    free(tmp);
+    free(idx);
+    free(r);
+}
+
 
 
 /*
@@ -158,6 +194,7 @@ local sortmode smode[] = {
     "shell",    shell_sort,
 #endif
     "qsort",    (iproc) qsort,      /* standard Unix qsort() */
+    "radix",    NULL,               /* sortptr_radix(), see snapsort() */
     NULL, NULL,
 };
 
@@ -16,6 +16,8 @@
  *             9-oct-03         more precision in output
  *       2.1  31-dec-03         implemented timefuzz=nearest 
  *       2.2  13-jun-07  WD     using within() from stdinc.h
+ *       2.3  16-oct-26         jump to the first requested time via the item index
+ *       2.3a 16-oct-26         ... but only if partcyc/diagcyc do not count frames
  */
 
 /* #define INTERACT */
@@ -35,10 +37,11 @@ string defv[] = {
     "amnesia=false\n		  if true, do not output history, etc",
     "checkall=false\n             must it check all snapshots",
     "timefuzz=0.00001\n           time fuzzy, or use 'nearest'",
+    "index=f\n                    save a sidecar index (in.toc) for faster access next time",
 #if defined(INTERACT)
     "more=y\n                     needs interactive SETPARAM part",
 #endif
-    "VERSION=2.2a\n               8-may-2023 PJT/WD",
+    "VERSION=2.3a\n               16-oct-2026 PJT/WD",
     NULL,
 };
 
@@ -53,6 +56,7 @@ string usage="cut a snapshot file down to size";
    extern bool within(real, string, real);
 */
 extern bool beyond(real, string, real);
+local real lowest(string, real);
 
 void nemo_main()
 {
@@ -89,6 +93,14 @@ void nemo_main()
     partcyc = getiparam("partcyc");
     diagcyc = getiparam("diagcyc");
     checkall = getbparam("checkall");
+    if (!Qnear && !Qfirst && !checkall && !streq(times,"all") && *times != '#' &&
+	partcyc <= 1 && diagcyc <= 1 &&        /* skipped frames not counted */
+	get_index(instr, getbparam("index")) > 0) {     /* skip ahead if we can */
+      if (Qlast)
+	get_index_seek(instr, SnapShotTag, -1);
+      else
+	get_index_time(instr, SnapShotTag, lowest(times, timefuzz));
+    }
 #if defined(INTERACT)
     more=getbparam("more");
 #endif
@@ -263,3 +275,29 @@ bool beyond(real val, string range, real fuzz)
     return (FALSE);
 }
 
+
+/*
+ * LOWEST: lowest value still within the specified range (see within())
+ */
+
+local real lowest(string range, real fuzz)
+{
+    char *endptr, *subptr, *sepptr;
+    real sublow, low = 0.0;
+    bool first = TRUE;
+
+    endptr = range + strlen(range);		/* point to term. NULL */
+    for (subptr = range; subptr != endptr; ) {	/* for each subrange */
+        sepptr = strchr(subptr, ',');		/*   pnt to subrange end */
+	if (sepptr == NULL)			/*   last subrange listed? */
+	    sepptr = endptr;			/*     fix up subend ptr */
+	sublow = atof(subptr) - fuzz/2.0;	/*   set low end of range */
+	if (first || sublow < low)
+	    low = sublow;
+	first = FALSE;
+	subptr = sepptr;			/*   advance subrange ptr */
+	if (*subptr == ',')			/*   more ranges to do? */
+	    subptr++;				/*     move on to next */
+    }
+    return low;
+}
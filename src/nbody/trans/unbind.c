@@ -19,12 +19,15 @@
  *	22-dec-92	V2.4 again write out 0 length snapshots	PJT
  *      28-dec-92       V2.4a - fixed cases where Mass output negative  PJT/SF
  *	15-aug-96       V2.5 code cleaned (old version crashed on linux)  PJT
+ *      16-oct-26       V3.0 iter=, tree=, theta=, incr=: iterate with tree or
+ *                           exact potentials, subtracting removed stars
  */
 
 #include <stdinc.h>
 #include <getparam.h>
 #include <vectmath.h>
 #include <filestruct.h>
+#include <kdtree.h>
 
 #include <snapshot/snapshot.h>
 #include <snapshot/body.h>
@@ -35,12 +38,16 @@ string defv[] = {                /* DEFAULT INPUT PARAMETERS */
     "in=???\n           Input file name",
     "out=???\n          Output file name",
     "exact=f\n          Exact N-squared potential ?",
-    "eps=0.025\n        Softening length in case exact potentials",
+    "tree=f\n           Tree code potential ?",
+    "theta=0.5\n        Opening angle for tree=t",
+    "eps=0.025\n        Softening length in case exact or tree potentials",
+    "iter=1\n           Max number of iterations (0=until no more unbound)",
+    "incr=0.1\n         Subtract removed stars if fewer than this fraction, else recompute",
     "ecutoff=0.0\n      Cutoff for (un)binding",
     "bind=t\n           Output bound(t) or unbound(f) stars",
     "map=f\n            Print map of bound/unbound",
     "times=all\n        Times of shapshots to copy",
-    "VERSION=2.5\n      15-aug-96 PJT",
+    "VERSION=3.0\n      16-oct-2026",
     NULL,
 };
 
@@ -57,17 +64,28 @@ local int    bits;                    /* bitmap of output quantities */
  
 local double  ecutoff;                /* cutoff energy */
 local int     nesc;                   /* counter how many flagged as escaped */
+local int    *iesc = NULL;            /* iteration a star escaped, 0 if bound */
 
 local double sqreps;                  /* square of softening length */
+local double theta2;                  /* square of opening angle */
+local int    niter;                   /* max number of iterations */
+local double fincr;                   /* max fraction for subtracting */
 local bool   Qexact;                  /* exact potential ? */
+local bool   Qtree;                   /* tree potential ? */
 local bool   Qbind;                   /* true=keep bound   false=keep escapers */
 local bool   Qmap;                    /* true=make map of bound/unnound */
 
 
+local void tree(void);
+local void subtract(int);
+
+#define KDSTACK 128                   /* depth of tree walks */
+
 nemo_main()
 {
-    int  i;
-    double ekin;
+    int  i, k, it, nnew;
+    bool Qdone;
+    double ekin, cpu0;
     Body  *bp;
 
     instr = stropen(getparam("in"), "r");       /* get parameters */
@@ -75,8 +93,14 @@ nemo_main()
     sqreps = sqr(getdparam("eps"));
     ecutoff = getdparam("ecutoff");
     Qexact = getbparam("exact");
+    Qtree = getbparam("tree");
     Qbind = getbparam("bind");
     Qmap = getbparam("map");
+    theta2 = sqr(getdparam("theta"));
+    niter = getiparam("iter");
+    fincr = getdparam("incr");
+    if (Qtree && (theta2 <= 0 || theta2 > 1))
+        error("theta=%g must be in (0,1]",getdparam("theta"));
     dprintf (1,"Stars with binding energy above %f will be ",ecutoff);
     if (Qbind)
         dprintf(1,"removed\n");
@@ -85,16 +109,40 @@ nemo_main()
 
     while (read_snap()) {             /* read snapshot */
         nesc = 0;
-        for (bp=btab; bp<btab+nbody; bp++) {
+        for (it=1; ; it++) {          /* iterate: flag, update potentials */
+            cpu0 = cputime();
+            nnew = 0;
+            for (bp=btab, i=0; bp<btab+nbody; bp++, i++) {
+                if (iesc[i]) continue;
                 ekin = 0;
-                for (i=0; i<NDIM; i++)
-                        ekin += sqr(Vel(bp)[i]);
+                for (k=0; k<NDIM; k++)
+                        ekin += sqr(Vel(bp)[k]);
                 ekin *= 0.5;
-                Phi(bp) += ekin;
-                if (Phi(bp) >= ecutoff) {
-                        Mass(bp) *= -1;         /* flag as escaper */
-                        nesc++;
+                if (Phi(bp) + ekin >= ecutoff) {
+                        iesc[i] = it;           /* flag as escaper */
+                        nnew++;
                 } 
+            }
+            nesc += nnew;
+            Qdone = (nnew == 0 || it == niter || nesc == nbody);
+            if (!Qdone) {
+                if ((!Qexact && !Qtree) || nnew <= fincr*(nbody-nesc))
+                    subtract(it);       /* remove their contribution */
+                else if (Qtree)
+                    tree();             /* or start over */
+                else
+                    exact();
+            }
+            dprintf(niter==1 ? 1 : 0,"iter %d: %d unbound, %d bound left, %.3f sec\n",
+                    it, nnew, nbody-nesc, (cputime()-cpu0)*60.0);
+            if (Qdone) break;
+        }
+        for (bp=btab; bp<btab+nbody; bp++) {   /* output binding energy */
+                ekin = 0;
+                for (k=0; k<NDIM; k++)
+                        ekin += sqr(Vel(bp)[k]);
+                ekin *= 0.5;
+                Phi(bp) += ekin;
         }
         if (Qbind)
             dprintf (0,"%d out of %d stars bound and written to file\n",
@@ -109,11 +157,12 @@ nemo_main()
     strclose(instr);
 }
 
-
+
 read_snap()
 {                               
     int    i;
     Body   *b;
+    double cpu0 = cputime();
         
     for(;;) {         /* 'infinite' loop until we find a ParticleTag */
         get_history(instr);
@@ -122,13 +171,22 @@ read_snap()
         get_snap(instr, &btab, &nbody, &stime, &bits);
         if ((bits & MassBit) == 0 || (bits & PhaseSpaceBit) == 0)
                 error("missing essential data");
+        if (iesc) free(iesc);
+        iesc = (int *) allocate(nbody * sizeof(int));
+        for (i=0; i<nbody; i++)
+            iesc[i] = 0;
         if (Qexact) {
             dprintf (0,"Doing an exact potential calculation\n");
             exact();            /* fill in newtonian potentials */
+        } else if (Qtree) {
+            dprintf (1,"Doing a tree potential calculation\n");
+            tree();
         } else if ((bits & PotentialBit)==0)            
-            error("missing potentials in snapshot, use hackforce or exact=t");
+            error("missing potentials in snapshot, use hackforce, tree=t or exact=t");
         else
            dprintf (1,"Using potentials in snapshot for energy calculation\n");
+        if (Qexact || Qtree)
+            dprintf(niter==1 ? 1 : 0,"potentials: %.3f sec\n",(cputime()-cpu0)*60.0);
         if ((bits & KeyBit) == 0) {
             warning ("Keys (re)set according to their order in file");
             for (i=0, b=btab; i<nbody; i++, b++)
@@ -146,13 +204,11 @@ write_snap()
         permanent bool first=TRUE;
 
         for (b1=btab, b2=btab; b1<btab+nbody; b1++) {
-            if (Qbind && Mass(b1)<0)
+            if (Qbind && iesc[b1-btab])
                 continue;               /* no copy */
-            else if (!Qbind && Mass(b1)>0)
+            else if (!Qbind && !iesc[b1-btab])
                 continue;                /* no copy */
 
-            if (Mass(b1) < 0)           /* negative mass was used as a signal */
-                Mass(b1) = -Mass(b1);
             if (b1==b2) {
                 b2++;
                 continue;       /* no need to copy yet, still in sync */
@@ -183,7 +239,7 @@ map()
   
     for (bp=btab, i=0; i<nbody; bp++, i++) {
         if (i%50 == 0) printf("\n");
-        if (Phi(bp) >= ecutoff)
+        if (iesc[i])
             printf("*");    /*       a '*' for an unbound star */
         else
             printf(".");    /*      a  '.' for a bound star */
@@ -191,7 +247,7 @@ map()
 }
 
 /*
- * newton_potential exact 
+ * newton_potential exact, of the stars still bound
  */
  
 exact()
@@ -200,10 +256,12 @@ exact()
     int i,j,k;
     real rij;
     
-    for (bi=btab; bi<btab+nbody; bi++)
-        Phi(bi) = 0.0;
+    for (i=0, bi=btab; i<nbody; i++, bi++)
+        if (!iesc[i]) Phi(bi) = 0.0;    /* escapers keep their last one */
     for (i=1, bi=btab+1; i<nbody; i++, bi++) {
+        if (iesc[i]) continue;
         for (j=0, bj=btab; j<i; bj++, j++) {
+            if (iesc[j]) continue;
             rij = 0.0;
             for (k=0; k<NDIM; k++)
                 rij += sqr(Pos(bi)[k] - Pos(bj)[k]);
@@ -213,3 +271,193 @@ exact()
         }
     }
 }
+
+/*
+ * subtract the potential of the stars that escaped in iteration it
+ * from the stars still bound
+ */
+
+local void subtract(int it)
+{
+    Body *bi, *bj;
+    int i, j, k, n, *inew;
+    real rij, phi;
+
+    inew = (int *) allocate(nbody * sizeof(int));
+    for (i=0, n=0; i<nbody; i++)
+        if (iesc[i] == it) inew[n++] = i;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,64) private(bi,bj,i,k,rij,phi)
+#endif
+    for (j=0; j<nbody; j++) {
+        if (iesc[j]) continue;
+        bj = btab+j;
+        phi = 0.0;
+        for (i=0; i<n; i++) {
+            bi = btab+inew[i];
+            rij = 0.0;
+            for (k=0; k<NDIM; k++)
+                rij += sqr(Pos(bi)[k] - Pos(bj)[k]);
+            phi += Mass(bi)/sqrt(sqreps + rij);
+        }
+        Phi(bj) += phi;
+    }
+    free(inew);
+}
+
+/*
+ * tree potential of the stars still bound: Barnes-Hut monopoles on the
+ * k-d tree nodes.  The tree is walked once per leaf (group of stars),
+ * accepting a node if the longest side of its box is less than theta
+ * times the distance from its centre of mass to the group's box; the
+ * accepted nodes and stars go in an interaction list for the group.
+ */
+
+typedef struct ilist {
+    int   n, nmax;
+    real *x, *y, *z, *m;
+} ilist;
+
+local void add_ilist(ilist *il, real *pos, real m)
+{
+    if (il->n == il->nmax) {
+        il->nmax = il->nmax ? 2*il->nmax : 1024;
+        il->x = (real *) reallocate(il->x, il->nmax * sizeof(real));
+        il->y = (real *) reallocate(il->y, il->nmax * sizeof(real));
+        il->z = (real *) reallocate(il->z, il->nmax * sizeof(real));
+        il->m = (real *) reallocate(il->m, il->nmax * sizeof(real));
+    }
+    il->x[il->n] = pos[0];
+    il->y[il->n] = pos[1];
+    il->z[il->n] = pos[2];
+    il->m[il->n] = m;
+    il->n++;
+}
+
+local void walk(kdtree *kd, real *tm, real *nm, real *nc, real *ns, int leaf,
+                ilist *il, real *phi)
+{
+    int stack[KDSTACK], sp = 0, i, j, k, d;
+    real d2, p, *gmin = kd->box + 2*NDIM*leaf, *x;
+    vector dr;
+    kdnode *np, *gp = kd->node + leaf;
+
+    il->n = 0;
+    stack[sp++] = 0;
+    while (sp > 0) {
+        k = stack[--sp];
+        np = kd->node + k;
+        if (k == leaf || nm[k] == 0.0) continue;
+        if (np->lo <= gp->lo && gp->hi <= np->hi) {     /* ancestor: open */
+            stack[sp++] = np->right;
+            stack[sp++] = np->left;
+            continue;
+        }
+        x = nc + k*NDIM;
+        for (d=0, d2=0.0; d<NDIM; d++) {                /* com to group box */
+            if (x[d] < gmin[d])
+                d2 += sqr(gmin[d]-x[d]);
+            else if (x[d] > gmin[NDIM+d])
+                d2 += sqr(x[d]-gmin[NDIM+d]);
+        }
+        if (ns[k] < theta2*d2)
+            add_ilist(il, x, nm[k]);
+        else if (np->left < 0)
+            for (i=np->lo; i<np->hi; i++)
+                add_ilist(il, kd->pos+i*NDIM, tm[i]);
+        else {
+            if (sp+2 > KDSTACK) error("walk: stack overflow");
+            stack[sp++] = np->right;
+            stack[sp++] = np->left;
+        }
+    }
+    for (i=gp->lo; i<gp->hi; i++) {                     /* the group's stars */
+        x = kd->pos + i*NDIM;
+        p = 0.0;
+        for (j=0; j<il->n; j++)
+            p -= il->m[j] / sqrt(sqreps + sqr(x[0]-il->x[j]) +
+                                 sqr(x[1]-il->y[j]) + sqr(x[2]-il->z[j]));
+        for (j=gp->lo; j<gp->hi; j++)
+            if (j != i) {
+                DOTPSUBV(d2, dr, x, kd->pos+j*NDIM);
+                p -= tm[j] / sqrt(sqreps + d2);
+            }
+        phi[i] = p;
+    }
+}
+
+local void tree(void)
+{
+    int i, k, d, n, nleaf, *ib, *leaf;
+    real *pts, *tm, *nm, *nc, *ns, *bmin, *phi;
+    kdnode *np;
+    kdtree *kd;
+    ilist il;
+
+    if (NDIM != 3) error("tree=t needs NDIM=3");
+    ib = (int *) allocate(nbody * sizeof(int));
+    for (i=0, n=0; i<nbody; i++)
+        if (!iesc[i]) ib[n++] = i;
+    pts = (real *) allocate((size_t)n * NDIM * sizeof(real));
+    for (k=0; k<n; k++)
+        SETV(pts+k*NDIM, Pos(btab+ib[k]));
+    kd = kd_build(pts, n, NDIM, 0);
+    tm = (real *) allocate(n * sizeof(real));
+    for (i=0; i<n; i++)                         /* masses in tree order */
+        tm[i] = Mass(btab+ib[kd->idx[i]]);
+    nm = (real *) allocate(kd->nnode * sizeof(real));
+    nc = (real *) allocate(kd->nnode * NDIM * sizeof(real));
+    ns = (real *) allocate(kd->nnode * sizeof(real));
+    leaf = (int *) allocate(kd->nnode * sizeof(int));
+    for (k=kd->nnode-1, nleaf=0; k>=0; k--) {   /* children come after parent */
+        np = kd->node + k;
+        nm[k] = 0.0;
+        CLRV(nc+k*NDIM);
+        if (np->left < 0) {
+            for (i=np->lo; i<np->hi; i++) {
+                nm[k] += tm[i];
+                ADDMULVS(nc+k*NDIM, kd->pos+i*NDIM, tm[i]);
+            }
+            leaf[nleaf++] = k;
+        } else {
+            nm[k] = nm[np->left] + nm[np->right];
+            ADDMULVS(nc+k*NDIM, nc+np->left*NDIM, nm[np->left]);
+            ADDMULVS(nc+k*NDIM, nc+np->right*NDIM, nm[np->right]);
+        }
+        if (nm[k] != 0.0)
+            DIVVS(nc+k*NDIM, nc+k*NDIM, nm[k]);
+        bmin = kd->box + 2*NDIM*k;
+        for (d=0, ns[k]=0.0; d<NDIM; d++)       /* longest side squared */
+            ns[k] = MAX(ns[k], sqr(bmin[NDIM+d]-bmin[d]));
+    }
+    phi = (real *) allocate((n > 0 ? n : 1) * sizeof(real));
+#ifdef _OPENMP
+#pragma omp parallel private(il)
+#endif
+    {
+        il.n = il.nmax = 0;
+        il.x = il.y = il.z = il.m = NULL;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,16)
+#endif
+        for (k=0; k<nleaf; k++)
+            walk(kd, tm, nm, nc, ns, leaf[k], &il, phi);
+        if (il.nmax) {
+            free(il.x);
+            free(il.y);
+            free(il.z);
+            free(il.m);
+        }
+    }
+    for (i=0; i<n; i++)
+        Phi(btab+ib[kd->idx[i]]) = phi[i];
+    kd_free(kd);
+    free(pts);
+    free(ib);
+    free(tm);
+    free(nm);
+    free(nc);
+    free(ns);
+    free(leaf);
+    free(phi);
+}
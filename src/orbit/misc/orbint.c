@@ -36,6 +36,7 @@
  *      10-dec-2019     V4.2 Add optional Phi/Acc to output     PJT
  *                           but not implemented for all cases - also fixed pattern speed bug
  *      21-mar-2021     V4.3 optional tstop which override nsteps  PJT
+ *      16-oct-2026     V4.4 potcache= to tabulate expensive potentials
  *                           
  *
  */
@@ -55,11 +56,12 @@ string defv[] = {
     "potname=\n	  	  potential name (default from orbit)",
     "potpars=\n	          parameters of potential ",
     "potfile=\n		  extra data-file for potential ",
+    "potcache=\n          tabulate potential: mode(sph,axi,cart),rmax[,tol[,file]]",
     "mode=rk4\n           integration method (euler,leapfrog,rk2,rk4)",
     "eta=\n               if used, stop if abs(de/e) > eta",
     "variable=f\n         Use variable timesteps (needs eta=)",
     "tstop=\n             If given, this overrides nsteps=",
-    "VERSION=4.3\n        21-mar-2021 PJT",
+    "VERSION=4.4\n        16-oct-2026",
     NULL,
 };
 
@@ -122,6 +124,7 @@ void nemo_main ()
 
     if (allocate_orbit (&o_out,Ndim(o_in),nsteps/nsave+1)==0)
 		error ("Error allocating output orbit");
+    set_potential_cache(getparam("potcache"));
     pot=get_potential(PotName(o_in), PotPars(o_in), PotFile(o_in));
     if (pot==NULL) 
 		error("Potential %s could not be loaded",PotName(o_in));
@@ -0,0 +1,517 @@
+/*
+ *  ORBINTN: integrate an ensemble of stellar orbits, with initial
+ *           conditions from a snapshot or table, in one potential.
+ *           Orbits are advanced together in batches of nbatch, with
+ *           one call to potential_n() per force evaluation of a batch;
+ *           batches are run in parallel with OpenMP.
+ *           The integrators are those of orbint (leapfrog, rk4) and
+ *           orbintv (dop853).
+ *
+ *      16-oct-2026    V1.0  created, cloned off orbint and orbintv
+ */
+
+#include <stdinc.h>
+#include <getparam.h>
+#include <vectmath.h>
+#include <filestruct.h>
+#include <history.h>
+#include <table.h>
+#include <orbit.h>
+#include <snapshot/snapshot.h>
+
+#include <dop853.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+string defv[] = {
+    "in=???\n             input snapshot, or table with x,y,z,vx,vy,vz per row",
+    "out=???\n            output file, an orbit(5) for each body",
+    "tstop=10\n           time to integrate (from time of snapshot)",
+    "dt=0.01\n            timestep (leapfrog, rk4)",
+    "dtout=0.1\n          output step time",
+    "potname=???\n        potential name",
+    "potpars=\n           parameters of potential",
+    "potfile=\n           extra data-file for potential",
+    "potcache=\n          tabulate potential: mode(sph,axi,cart),rmax[,tol[,file]]",
+    "mode=rk4\n           integration method (leapfrog,rk4,dop853)",
+    "tol=-7\n             tolerance of dop853 integration (log10 if < 0)",
+    "nbatch=256\n         number of orbits integrated together",
+    "VERSION=1.0\n        16-oct-2026",
+    NULL,
+};
+
+string usage = "integrate an ensemble of stellar orbits";
+
+string cvsid="$Id$";
+
+
+local int    nbody;                     /* number of orbits */
+local double (*ic)[6];                  /* initial phase space */
+local real   *mass;                     /* masses, for the orbits */
+local int    *key;                      /* keys, for the orbits */
+local double t0;                        /* start time */
+
+local int    nsteps, nsave, nout;       /* how often */
+local double dt, dt2, dtout, eta;       /* stepping */
+local double omega, omega2, tomega;     /* pattern speed */
+local int    imode;                     /* integrator */
+
+local potproc_double    pot;            /* the potential */
+local potproc_n_double  potn;           /* ... and its batch version */
+
+extern int match(string, string, int *);
+
+local void read_ic(string);
+local void integrate_leapfrog(int, double (*)[6], orbitptr *);
+local void integrate_rk4(int, double (*)[6], orbitptr *);
+local void integrate_dop853(int, double (*)[6], orbitptr *);
+
+
+/*----------------------------------------------------------------------------*/
+void nemo_main()
+{
+    int i, j, b, m, nb, nbatch, ngroup;
+    stream outstr;
+    orbitptr *orb;
+
+    read_ic(getparam("in"));
+
+    dt = getdparam("dt");
+    dt2 = 0.5*dt;
+    dtout = getdparam("dtout");
+    eta = getdparam("tol");
+    if (eta < 0) eta = pow(10.0,eta);
+    match(getparam("mode"),"leapfrog rk4 dop853",&imode);
+    if (imode!=0x01 && imode!=0x02 && imode!=0x04)
+        error("Illegal integration mode=%s",getparam("mode"));
+    if (imode==0x04) {              /* dop853: dense output at dtout */
+        nout = (int) (getdparam("tstop")/dtout + 1.001);
+    } else {                        /* fixed step */
+        nsteps = (int) (getdparam("tstop")/dt + 0.5);
+        nsave  = (int) (dtout/dt + 0.5);
+        if (nsave < 1) nsave = 1;
+        nout = nsteps/nsave + 1;
+    }
+    dprintf(1,"nbody=%d nout=%d\n",nbody,nout);
+
+    set_potential_cache(getparam("potcache"));
+    pot = get_potential_double(getparam("potname"),getparam("potpars"),
+                               getparam("potfile"));
+    if (pot==NULL)
+        error("Potential %s could not be loaded",getparam("potname"));
+    potn = get_potential_n_double();
+    omega = get_pattern();
+    dprintf(0,"Pattern speed=%g\n",omega);
+    omega2 = omega*omega;
+    tomega = 2.0*omega;
+
+    nbatch = getiparam("nbatch");
+    if (nbatch < 1) error("nbatch=%d must be positive",nbatch);
+    nb = (nbody + nbatch - 1) / nbatch;       /* number of batches */
+#ifdef _OPENMP
+    ngroup = imode==0x04 ? 1 : omp_get_max_threads(); /* dop853: not re-entrant */
+#else
+    ngroup = 1;
+#endif
+    ngroup = MIN(ngroup,nb);                  /* batches in memory at once */
+    orb = (orbitptr *) allocate(ngroup*nbatch*sizeof(orbitptr));
+    for (i=0; i<ngroup*nbatch; i++) {
+        orb[i] = NULL;
+        if (allocate_orbit(&orb[i],3,nout)==0)
+            error("Error allocating orbit");
+        PotName(orb[i]) = getparam("potname");
+        PotPars(orb[i]) = getparam("potpars");
+        PotFile(orb[i]) = getparam("potfile");
+    }
+
+    outstr = stropen(getparam("out"),"w");
+    put_history(outstr);
+    for (i=0; i<nb; i+=ngroup) {              /* loop over groups of batches */
+        m = MIN(ngroup,nb-i);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if(m>1)
+#endif
+        for (b=0; b<m; b++) {
+            int k0 = (i+b)*nbatch;
+            int nk = MIN(nbatch,nbody-k0);
+            if (imode==0x01)
+                integrate_leapfrog(nk,ic+k0,orb+b*nbatch);
+            else if (imode==0x02)
+                integrate_rk4(nk,ic+k0,orb+b*nbatch);
+            else
+                integrate_dop853(nk,ic+k0,orb+b*nbatch);
+        }
+        for (b=0; b<m; b++)                   /* stream them out, in order */
+            for (j=0; j<nbatch && (i+b)*nbatch+j<nbody; j++) {
+                Masso(orb[b*nbatch+j]) = mass[(i+b)*nbatch+j];
+                Key(orb[b*nbatch+j])   = key[(i+b)*nbatch+j];
+                write_orbit(outstr,orb[b*nbatch+j]);
+            }
+    }
+    strclose(outstr);
+}
+
+/*
+ * READ_IC: initial conditions from the first snapshot with phase space
+ *          or from the first six columns of a table
+ */
+local void read_ic(string name)
+{
+    stream instr;
+    int i, k, colnr[6];
+    real *coldat[6], *phase;
+    bool Qsnap;
+
+    instr = stropen(name,"r");
+    Qsnap = qsf(instr);
+    strclose(instr);
+    instr = stropen(name,"r");
+    t0 = 0.0;
+    if (Qsnap) {
+        for (;;) {
+            get_history(instr);
+            if (!get_tag_ok(instr,SnapShotTag))
+                error("%s: no snapshot with phase space found",name);
+            get_set(instr,SnapShotTag);
+            get_set(instr,ParametersTag);
+            get_data(instr,NobjTag,IntType,&nbody,0);
+            if (get_tag_ok(instr,TimeTag))
+                get_data_coerced(instr,TimeTag,DoubleType,&t0,0);
+            get_tes(instr,ParametersTag);
+            if (get_tag_ok(instr,ParticlesTag)) break;
+            get_tes(instr,SnapShotTag);
+        }
+        get_set(instr,ParticlesTag);
+        mass = (real *) allocate(nbody*sizeof(real));
+        key = (int *) allocate(nbody*sizeof(int));
+        phase = (real *) allocate(nbody*6*sizeof(real));
+        if (get_tag_ok(instr,MassTag))
+            get_data_coerced(instr,MassTag,RealType,mass,nbody,0);
+        else
+            for (i=0; i<nbody; i++) mass[i] = 0.0;
+        if (get_tag_ok(instr,KeyTag))
+            get_data(instr,KeyTag,IntType,key,nbody,0);
+        else
+            for (i=0; i<nbody; i++) key[i] = i;
+        if (get_tag_ok(instr,PhaseSpaceTag))
+            get_data_coerced(instr,PhaseSpaceTag,RealType,phase,nbody,2,NDIM,0);
+        else {
+            real *tmp = (real *) allocate(nbody*NDIM*sizeof(real));
+            get_data_coerced(instr,PosTag,RealType,tmp,nbody,NDIM,0);
+            for (i=0; i<nbody; i++)
+                for (k=0; k<3; k++) phase[6*i+k] = tmp[3*i+k];
+            get_data_coerced(instr,VelTag,RealType,tmp,nbody,NDIM,0);
+            for (i=0; i<nbody; i++)
+                for (k=0; k<3; k++) phase[6*i+3+k] = tmp[3*i+k];
+            free(tmp);
+        }
+        get_tes(instr,ParticlesTag);
+        get_tes(instr,SnapShotTag);
+    } else {
+        nbody = nemo_file_lines(name,0);
+        if (nbody <= 0) error("%s: no lines in table",name);
+        for (k=0; k<6; k++) {
+            colnr[k] = k+1;
+            coldat[k] = (real *) allocate(nbody*sizeof(real));
+        }
+        nbody = get_atable(instr,6,colnr,coldat,nbody);
+        if (nbody <= 0) error("%s: no data in table",name);
+        mass = (real *) allocate(nbody*sizeof(real));
+        key = (int *) allocate(nbody*sizeof(int));
+        phase = (real *) allocate(nbody*6*sizeof(real));
+        for (i=0; i<nbody; i++) {
+            mass[i] = 0.0;
+            key[i] = i;
+            for (k=0; k<6; k++) phase[6*i+k] = coldat[k][i];
+        }
+        for (k=0; k<6; k++) free(coldat[k]);
+    }
+    strclose(instr);
+    ic = (double (*)[6]) allocate(nbody*sizeof(double[6]));
+    for (i=0; i<nbody; i++)
+        for (k=0; k<6; k++) ic[i][k] = phase[6*i+k];
+    free(phase);
+    dprintf(1,"read %d initial conditions from %s at time %g\n",nbody,name,t0);
+}
+
+/*
+ * energy (Jacobi integral in a rotating frame)
+ */
+local double energy(double *pos, double *vel, double epot)
+{
+    return 0.5*(sqr(vel[0]) + sqr(vel[1]) + sqr(vel[2]))
+           + epot - 0.5*omega2*(sqr(pos[0]) + sqr(pos[1]));
+}
+
+/*
+ * SAVE_STEP: store step isave of an orbit, with rotating frame corrections
+ */
+local void save_step(orbitptr o, int isave, double time,
+                     double *pos, double *vel, double *acc, double epot)
+{
+    Torb(o,isave) = time;
+    Xorb(o,isave) = pos[0];
+    Yorb(o,isave) = pos[1];
+    Zorb(o,isave) = pos[2];
+    Uorb(o,isave) = vel[0];
+    Vorb(o,isave) = vel[1];
+    Worb(o,isave) = vel[2];
+#ifdef ORBIT_PHI
+    Porb(o,isave) = epot - 0.5*omega2*(pos[0]*pos[0]+pos[1]*pos[1]);
+    AXorb(o,isave)= acc[0] + omega2*pos[0] + tomega*vel[1];
+    AYorb(o,isave)= acc[1] + omega2*pos[1] - tomega*vel[0];
+    AZorb(o,isave)= acc[2];
+#endif
+}
+
+/*
+ * SET_IOM: energy at start and its relative error at the end
+ */
+local void set_iom(orbitptr o, double e0, double e1)
+{
+    I1(o) = e0;
+    I2(o) = I3(o) = 0.0;
+    IE1(o) = ABS((e1-e0)/(e0 == 0.0 ? 1.0 : e0));
+    IE2(o) = IE3(o) = 0.0;
+}
+
+/*
+ * forces for n orbits at once
+ */
+local void force(int n, double *pos, double *acc, double *epot, double time)
+{
+    int ndim = 3;
+
+    (*potn)(&ndim,&n,pos,acc,epot,&time);
+}
+
+/* Standard Leapfrog, as integrate_leapfrog1() in orbint, for n orbits */
+local void integrate_leapfrog(int n, double (*y)[6], orbitptr *o)
+{
+    int i, j;
+    double time, *pos, *vel, *acc, *epot, *e0, *p, *v, *a;
+
+    pos  = (double *) allocate(n*3*sizeof(double));
+    vel  = (double *) allocate(n*3*sizeof(double));
+    acc  = (double *) allocate(n*3*sizeof(double));
+    epot = (double *) allocate(n*sizeof(double));
+    e0   = (double *) allocate(n*sizeof(double));
+    for (j=0; j<n; j++) {
+        pos[3*j]   = y[j][0];  pos[3*j+1] = y[j][1];  pos[3*j+2] = y[j][2];
+        vel[3*j]   = y[j][3];  vel[3*j+1] = y[j][4];  vel[3*j+2] = y[j][5];
+    }
+    time = t0;
+    force(n,pos,acc,epot,time);
+    for (j=0; j<n; j++) {
+        p = pos+3*j;  v = vel+3*j;  a = acc+3*j;
+        e0[j] = energy(p,v,epot[j]);
+        save_step(o[j],0,time,p,v,a,epot[j]);
+        /* prepare half step for LEAPFROG to get VEL and POS out of sync */
+        v[0] += dt2*(a[0]+omega2*p[0]+tomega*v[1]);
+        v[1] += dt2*(a[1]+omega2*p[1]-tomega*v[0]);
+        v[2] += dt2*a[2];
+    }
+    for (i=1; i<=nsteps; i++) {
+        time += dt;
+        for (j=0; j<3*n; j++)
+            pos[j] += dt*vel[j];
+        force(n,pos,acc,epot,time);
+        for (j=0; j<n; j++) {
+            p = pos+3*j;  v = vel+3*j;  a = acc+3*j;
+            /* bring back to sync for possible output */
+            v[0] += dt2*(a[0]+omega2*p[0]+tomega*v[1]);
+            v[1] += dt2*(a[1]+omega2*p[1]-tomega*v[0]);
+            v[2] += dt2*a[2];
+            if (i % nsave == 0)
+                save_step(o[j],i/nsave,time,p,v,a,epot[j]);
+            if (i == nsteps)
+                set_iom(o[j],e0[j],energy(p,v,epot[j]));
+            /* put back out of sync */
+            v[0] += dt2*(a[0]+omega2*p[0]+tomega*v[1]);
+            v[1] += dt2*(a[1]+omega2*p[1]-tomega*v[0]);
+            v[2] += dt2*a[2];
+        }
+    }
+    for (j=0; j<n; j++) {
+        if (nsteps == 0) set_iom(o[j],e0[j],e0[j]);
+        Nsteps(o[j]) = nout;
+    }
+    free(pos);  free(vel);  free(acc);  free(epot);  free(e0);
+}
+
+/*
+ * one RK stage for n orbits, as set_rk() in orbint:
+ *   ko = dt * f(pos + s*ki, vel + s*ki)  (with acc already at that point)
+ */
+local void set_rk(int n, double *ko, double *pos, double *vel, double *acc,
+                  double s, double *ki, double *tpos, double *tvel)
+{
+    int j;
+    double *k, *q, *tp, *tv, *a;
+
+    for (j=0; j<n; j++) {
+        k = ko+6*j;  q = ki+6*j;  tp = tpos+3*j;  tv = tvel+3*j;  a = acc+3*j;
+        if (s > 0) {
+            tv[0] = vel[3*j]   + s*q[3];
+            tv[1] = vel[3*j+1] + s*q[4];
+            tv[2] = vel[3*j+2] + s*q[5];
+        } else {
+            tp[0] = pos[3*j];  tp[1] = pos[3*j+1];  tp[2] = pos[3*j+2];
+            tv[0] = vel[3*j];  tv[1] = vel[3*j+1];  tv[2] = vel[3*j+2];
+        }
+        k[0] = dt*tv[0];
+        k[1] = dt*tv[1];
+        k[2] = dt*tv[2];
+        k[3] = dt*(a[0] + omega2*tp[0] + tomega*tv[1]);
+        k[4] = dt*(a[1] + omega2*tp[1] - tomega*tv[0]);
+        k[5] = dt*a[2];
+    }
+}
+
+local void rk_pos(int n, double *tpos, double *pos, double s, double *ki)
+{
+    int j;
+
+    for (j=0; j<n; j++) {
+        tpos[3*j]   = pos[3*j]   + s*ki[6*j];
+        tpos[3*j+1] = pos[3*j+1] + s*ki[6*j+1];
+        tpos[3*j+2] = pos[3*j+2] + s*ki[6*j+2];
+    }
+}
+
+/* 4th order RK4 integration, as integrate_rk4() in orbint, for n orbits */
+local void integrate_rk4(int n, double (*y)[6], orbitptr *o)
+{
+    int i, j, k;
+    double time, *pos, *vel, *acc, *tacc, *epot, *tpot, *e0, *tpos, *tvel;
+    double *k1, *k2, *k3, *k4;
+
+    pos  = (double *) allocate(n*3*sizeof(double));
+    vel  = (double *) allocate(n*3*sizeof(double));
+    acc  = (double *) allocate(n*3*sizeof(double));
+    tacc = (double *) allocate(n*3*sizeof(double));
+    tpos = (double *) allocate(n*3*sizeof(double));
+    tvel = (double *) allocate(n*3*sizeof(double));
+    epot = (double *) allocate(n*sizeof(double));
+    tpot = (double *) allocate(n*sizeof(double));
+    e0   = (double *) allocate(n*sizeof(double));
+    k1   = (double *) allocate(n*6*sizeof(double));
+    k2   = (double *) allocate(n*6*sizeof(double));
+    k3   = (double *) allocate(n*6*sizeof(double));
+    k4   = (double *) allocate(n*6*sizeof(double));
+    for (j=0; j<n; j++) {
+        pos[3*j]   = y[j][0];  pos[3*j+1] = y[j][1];  pos[3*j+2] = y[j][2];
+        vel[3*j]   = y[j][3];  vel[3*j+1] = y[j][4];  vel[3*j+2] = y[j][5];
+    }
+    time = t0;
+    for (i=0; ; i++) {
+        force(n,pos,acc,epot,time);
+        if (i % nsave == 0)
+            for (j=0; j<n; j++) {
+                if (i==0) e0[j] = energy(pos+3*j,vel+3*j,epot[j]);
+                save_step(o[j],i/nsave,time,pos+3*j,vel+3*j,acc+3*j,epot[j]);
+            }
+        if (i>=nsteps) {
+            for (j=0; j<n; j++)
+                set_iom(o[j],e0[j],energy(pos+3*j,vel+3*j,epot[j]));
+            break;
+        }
+        time += dt;
+
+        set_rk(n,k1,pos,vel,acc,0.0,k1,tpos,tvel);
+        rk_pos(n,tpos,pos,0.5,k1);
+        force(n,tpos,tacc,tpot,time-dt2);
+        set_rk(n,k2,pos,vel,tacc,0.5,k1,tpos,tvel);
+        rk_pos(n,tpos,pos,0.5,k2);
+        force(n,tpos,tacc,tpot,time-dt2);
+        set_rk(n,k3,pos,vel,tacc,0.5,k2,tpos,tvel);
+        rk_pos(n,tpos,pos,1.0,k3);
+        force(n,tpos,tacc,tpot,time);
+        set_rk(n,k4,pos,vel,tacc,1.0,k3,tpos,tvel);
+
+        for (j=0; j<n; j++)
+            for (k=0; k<3; k++) {
+                pos[3*j+k] += (k1[6*j+k] + 2*k2[6*j+k] + 2*k3[6*j+k] + k4[6*j+k])/6.0;
+                vel[3*j+k] += (k1[6*j+k+3] + 2*k2[6*j+k+3] + 2*k3[6*j+k+3] + k4[6*j+k+3])/6.0;
+            }
+    }
+    for (j=0; j<n; j++) Nsteps(o[j]) = nout;
+    free(pos);  free(vel);  free(acc);  free(tacc);  free(tpos);  free(tvel);
+    free(epot); free(tpot); free(e0);
+    free(k1);   free(k2);   free(k3);   free(k4);
+}
+
+/*
+ * dop853, as in orbintv, one orbit at a time (dop853() keeps state in
+ * static variables, so this is not called in parallel)
+ */
+local orbitptr o853;                    /* orbit being integrated */
+local int      i853;                    /* steps saved */
+local double   x853;                    /* next output time */
+
+local void rhs(unsigned n, double x, double *y, double *f)
+{
+    double acc[3], epot;
+    int ndim = 3;
+
+    (*pot)(&ndim,y,acc,&epot,&x);
+    f[0] = y[3];
+    f[1] = y[4];
+    f[2] = y[5];
+    f[3] = acc[0] + omega2*y[0] + tomega*y[4];    /* rotating frame */
+    f[4] = acc[1] + omega2*y[1] - tomega*y[3];    /* corrections    */
+    f[5] = acc[2];
+}
+
+local void save853(double x, double *y)
+{
+    double acc[3], epot;
+    int ndim = 3;
+
+    (*pot)(&ndim,y,acc,&epot,&x);
+    save_step(o853,i853++,x,y,y+3,acc,epot);
+}
+
+local void solout8(long nr, double xold, double x, double *y, unsigned n, int *irtrn)
+{
+    double pv[6];
+    int k;
+
+    if (nr==1) {
+        x853 = x + dtout;
+        save853(x,y);
+    } else
+        while (x >= x853 && i853 < nout) {
+            for (k=0; k<6; k++) pv[k] = contd8(k,x853);
+            save853(x853,pv);
+            x853 = t0 + i853*dtout;
+        }
+}
+
+local void integrate_dop853(int n, double (*y)[6], orbitptr *o)
+{
+    int j, k, res;
+    double rtoler, atoler, yy[6], acc[3], e0, e1;
+    int ndim = 3;
+
+    for (j=0; j<n; j++) {
+        o853 = o[j];
+        i853 = 0;
+        for (k=0; k<6; k++) yy[k] = y[j][k];
+        (*pot)(&ndim,yy,acc,&e0,&t0);
+        e0 = energy(yy,yy+3,e0);
+        rtoler = eta;
+        atoler = rtoler;
+        res = dop853(6, rhs, t0, yy, t0+(nout-1)*dtout, &rtoler, &atoler, 0,
+                     solout8, 2, stdout, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
+                     0, 0, 0, 6, NULL, 0);
+        if (res < 0) warning("dop853 returned %d for orbit %d",res,(int)(y-ic)+j);
+        if (i853 < nout) save853(t0+(nout-1)*dtout,yy);   /* last one */
+        Nsteps(o[j]) = i853;
+        e1 = Porb(o[j],i853-1) + 0.5*(sqr(Uorb(o[j],i853-1)) +
+             sqr(Vorb(o[j],i853-1)) + sqr(Worb(o[j],i853-1)));
+        set_iom(o[j],e0,e1);
+    }
+}
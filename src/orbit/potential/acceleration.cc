@@ -40,6 +40,8 @@
 // version 3.3  17/02/2010  WD  allow for nemo string bug
 // version 3.4  23/08/2010  WD  empty accnames: return 0 (rather than trigger
 //                              Segmentation fault)
+// version 3.5  16/10/2026      fallback uses potential_n_float/double(), if
+//                              present, for chunks of bodies
 //
 //------------------------------------------------------------------------------
 
@@ -181,6 +183,22 @@ namespace {
     }
   };
 
+  //----------------------------------------------------------------------------
+  // grav_n<scalar> auxiliary for using potential_n_float/double()
+  template<typename scalar> struct grav_n;
+
+  template<> struct grav_n<float> {
+    typedef potproc_n_float pter;
+    static pter get(potproc_n_double, potproc_n_float pf) { return pf; }
+    static const float*time() { return &t_float; }
+  };
+
+  template<> struct grav_n<double> {
+    typedef potproc_n_double pter;
+    static pter get(potproc_n_double pd, potproc_n_float) { return pd; }
+    static const double*time() { return &t_double; }
+  };
+
   //----------------------------------------------------------------------------
   // declare type of pointer to inipotential()
   typedef void(*inipot_pter)       // return: void
@@ -190,9 +208,43 @@ namespace {
   //----------------------------------------------------------------------------
   // class fallback
   class fallback {
-    inipot_pter    ip;
-    potproc_double pd;
-    potproc_float  pf;
+    inipot_pter      ip;
+    potproc_double   pd;
+    potproc_float    pf;
+    potproc_n_double pnd;
+    potproc_n_float  pnf;
+    //--------------------------------------------------------------------------
+    // using potential_n(): gather up to K flagged bodies, call, scatter
+    template<int NDIM, typename scalar>
+    void acc_TN(typename grav_n<scalar>::pter pn,
+		int          nbod,
+		const scalar*pos,
+		const int   *flag,
+		scalar      *pot,
+		scalar      *acc,
+		int          add)
+    {
+      const int K = 64;
+      scalar X[K*NDIM], A[K*NDIM], P[K];
+      int    I[K];
+      for(int n=0; n!=nbod; ) {
+	int k=0;
+	for(; n!=nbod && k!=K; ++n)
+	  if(flag==0 || flag[n] & 1) {
+	    v_ass<NDIM>(X+k*NDIM,pos+n*NDIM);
+	    I[k++] = n;
+	  }
+	if(k==0) break;
+	pn(&ndim,&k,X,A,P,grav_n<scalar>::time());
+	for(int j=0; j!=k; ++j) {
+	  const int i = I[j];
+	  if(add & 1) pot[i] += P[j];
+	  else        pot[i]  = P[j];
+	  if(add & 2) v_add<NDIM>(acc+i*NDIM,A+j*NDIM);
+	  else        v_ass<NDIM>(acc+i*NDIM,A+j*NDIM);
+	}
+      }
+    }
     //--------------------------------------------------------------------------
     template<int NDIM, typename scalar>
     void acc_TT(int          nbod,
@@ -202,6 +254,9 @@ namespace {
 		scalar      *acc,
 		int          add)
     {
+      typename grav_n<scalar>::pter pn = grav_n<scalar>::get(pnd,pnf);
+      if(pn)
+	return acc_TN<NDIM,scalar>(pn,nbod,pos,flag,pot,acc,add);
       if(add & 1) {
 	if(add & 2) {
 	  // add both potential and acceleration
@@ -257,13 +312,16 @@ namespace {
     
   public:
 
-    fallback() : ip(0), pd(0), pf(0) {}
+    fallback() : ip(0), pd(0), pf(0), pnd(0), pnf(0) {}
 
-    void set (inipot_pter i, potproc_double d, potproc_float f)
+    void set (inipot_pter i, potproc_double d, potproc_float f,
+	      potproc_n_double nd=0, potproc_n_float nf=0)
     {
-      ip = i;
-      pd = d;
-      pf = f;
+      ip  = i;
+      pd  = d;
+      pf  = f;
+      pnd = nd;
+      pnf = nf;
     }
 
     inipot_pter const&IniPotPter() const { return ip; }
@@ -539,10 +597,13 @@ namespace {
       potproc_float  pf = (potproc_float)  findfunc("potential_float");
       if((pf==0 && pd==0) || ip==0)
 	error(const_cast<char*>("get_acceleration: no potential found either"));
-      // 6.B.2 call inipotential() once
+      // 6.B.2 try to get the optional potential_n_double/float
+      potproc_n_double pnd = (potproc_n_double) findfunc("potential_n_double");
+      potproc_n_float  pnf = (potproc_n_float)  findfunc("potential_n_float");
+      // 6.B.3 call inipotential() once
       ip(&npar,pars,const_cast<char*>(accfile));
-      // 6.B.3 initialize FallBack[fb] and return AccFallBack[fb]
-      (FallBack[fb]).set(ip,pd,pf);
+      // 6.B.4 initialize FallBack[fb] and return AccFallBack[fb]
+      (FallBack[fb]).set(ip,pd,pf,pnd,pnf);
     }
     return AccFallBack[fb];
   }
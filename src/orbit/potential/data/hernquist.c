@@ -11,6 +11,7 @@
  *                      version for the new potproc interface       wd
  *      sep-2004        replaced call to sqr(A) with A*A
  *                      sqr() is bullshit and should never be used! wd
+ *      oct-2026        potential_n_double and _float: n positions at once
  */
 
 /*CTEX
@@ -85,3 +86,43 @@ void potential_float  (int *ndim,
 		       float *pot,
 		       float *time) POT
 #undef POT
+
+/*
+ * potential_n: n positions at once, pos[n][3] -> acc[n][3], pot[n]
+ *              a plain loop without branches, which the compiler vectorizes;
+ *              the arithmetic is that of POT, so the results are the same
+ */
+#define POT_N(TYPE)							\
+void potential_n_##TYPE (int *ndim,					\
+			 int *np,					\
+			 TYPE *pos,					\
+			 TYPE *acc,					\
+			 TYPE *pot,					\
+			 TYPE *time)					\
+{									\
+    int    i, n = *np;							\
+    real   r2,r,f,p;							\
+									\
+    if (*ndim != 3) {							\
+        for (i=0; i<n; i++)						\
+            potential_##TYPE(ndim,pos+i*(*ndim),acc+i*(*ndim),pot+i,time); \
+        return;								\
+    }									\
+    for (i=0; i<n; i++) {						\
+        r2  = pos[3*i]*pos[3*i];             /* summed as in POT */	\
+        r2 += pos[3*i+1]*pos[3*i+1];					\
+        r2 += pos[3*i+2]*pos[3*i+2];					\
+        r  = sqrt(r2);                       /* radius */		\
+        f  = 1.0/(r+a);                      /* temporary storage */	\
+        p  = r2==0.0 ? -hmass/a : -hmass * f; /* potential */		\
+        pot[i] = p;							\
+        f  = (TYPE) p * f / r;               /* radial force / r  */	\
+        acc[3*i]   = r2==0.0 ? 0.0 : pos[3*i]   * f;			\
+        acc[3*i+1] = r2==0.0 ? 0.0 : pos[3*i+1] * f;			\
+        acc[3*i+2] = r2==0.0 ? 0.0 : pos[3*i+2] * f;			\
+    }									\
+}
+
+POT_N(double)
+POT_N(float)
+#undef POT_N
@@ -6,6 +6,7 @@
  *	mar-92  happy gcc2.0	PJT
  *	oct-93  get_pattern()	PJT
  *      sep-04  float/double	PJT
+ *      oct-26  potential_n_double: n positions at once
  */
 
 /*CTEX
@@ -58,3 +59,30 @@ void potential_double (int *ndim,double *pos,double *acc,double *pot,double *tim
         acc[i] = tmp*pos[i];
 	
 }
+
+/*
+ * potential_n_double: n positions at once, pos[n][3] -> acc[n][3], pot[n]
+ *                     a plain loop without branches
+ */
+void potential_n_double (int *ndim,int *np,double *pos,double *acc,double *pot,double *time)
+{
+    double a, p, tmp;
+    int    i, n = *np;
+
+    if (*ndim != 3) {
+        for (i=0; i<n; i++)
+            potential_double(ndim,pos+i*(*ndim),acc+i*(*ndim),pot+i,time);
+        return;
+    }
+    for (i=0; i<n; i++) {
+        a = iso_radius2 + pos[3*i]*pos[3*i] + pos[3*i+1]*pos[3*i+1]
+                        + pos[3*i+2]*pos[3*i+2];
+        a = sqrt(a);
+        p = -iso_mass / (iso_radius + a);
+        tmp = p / (a * (iso_radius + a));
+        pot[i] = p;
+        acc[3*i]   = tmp*pos[3*i];
+        acc[3*i+1] = tmp*pos[3*i+1];
+        acc[3*i+2] = tmp*pos[3*i+2];
+    }
+}
@@ -3,6 +3,7 @@
  *	dec-93    allowed r_c=0 exception, by setting v_0^2 = 2*m_c
  *      jun-01    stdinc.h
  *      sep-04    double/float
+ *      oct-26    potential_n_double: n positions at once
  */
 
 /*CTEX
@@ -84,3 +85,28 @@ void potential_double (int *ndim, double *pos, double *acc, double *pot, double
     for (i=0; i<*ndim; i++)
         acc[i] = f*pos[i]*iq2[i];
 }
+
+/*
+ * potential_n_double: n positions at once, pos[n][3] -> acc[n][3], pot[n]
+ *                     a plain loop without branches
+ */
+void potential_n_double (int *ndim, int *np, double *pos, double *acc, double *pot, double *time)
+{
+    double f, rad;
+    int    i, n = *np;
+
+    if (*ndim != 3) {
+        for (i=0; i<n; i++)
+            potential_double(ndim,pos+i*(*ndim),acc+i*(*ndim),pot+i,time);
+        return;
+    }
+    for (i=0; i<n; i++) {
+        rad = rc2 + pos[3*i]*pos[3*i]*iq2[0] + pos[3*i+1]*pos[3*i+1]*iq2[1]
+                  + pos[3*i+2]*pos[3*i+2]*iq2[2];
+        pot[i] = mor * log(rad);
+        f = -2.0*mor/rad;
+        acc[3*i]   = f*pos[3*i]  *iq2[0];
+        acc[3*i+1] = f*pos[3*i+1]*iq2[1];
+        acc[3*i+2] = f*pos[3*i+2]*iq2[2];
+    }
+}
@@ -19,6 +19,7 @@
  *  7-mar-92 merged sun and 3b1 versions once more			 pjt
  *    oct-93 get_pattern
  *    dec-2023   re-arranged parameters as omega,mass,a,b to be consistent    PJT
+ *    oct-2026   potential_n_double: n positions at once
  *
  */
 
@@ -88,3 +89,32 @@ void potential_double(int *ndim,double *pos,double *acc,double *pot,double *time
         acc[Z] *= (miya_ascal+qpar)/qpar;
 
 }
+
+/*
+ * potential_n_double: n positions at once, pos[n][3] -> acc[n][3], pot[n]
+ *                     a plain loop without branches or calls to sqr()
+ */
+void potential_n_double(int *ndim,int *np,double *pos,double *acc,double *pot,double *time)
+{
+    double qpar, spar, rcyl, tmp, p, b2 = miya_bscal*miya_bscal;
+    int i, n = *np;
+
+    if (*ndim != 3) {
+        for (i=0; i<n; i++)
+            potential_double(ndim,pos+i*(*ndim),acc+i*(*ndim),pot+i,time);
+        return;
+    }
+    for (i=0; i<n; i++) {
+        rcyl = sqrt (pos[3*i+X]*pos[3*i+X] + pos[3*i+Y]*pos[3*i+Y]);
+        qpar = sqrt (pos[3*i+Z]*pos[3*i+Z] + b2);
+        spar = sqrt (rcyl*rcyl + (miya_ascal+qpar)*(miya_ascal+qpar));
+
+        p = - miya_mass / spar;
+        tmp = p / (spar*spar);
+        pot[i] = p;
+        acc[3*i]   = tmp*pos[3*i];
+        acc[3*i+1] = tmp*pos[3*i+1];
+        acc[3*i+2] = tmp*pos[3*i+2];
+        acc[3*i+Z] *= miya_ascal > 0.0 ? (miya_ascal+qpar)/qpar : 1.0;
+    }
+}
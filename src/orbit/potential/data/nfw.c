@@ -25,6 +25,7 @@
  * 0.1   18-nov-2002    converted from C++ to C                           WD   |
  * 0.2   24-may-2005    bit more dprintf() output                        PJT   |
  * 0.3    7-apr-2009    add shapes to play with non-spherical            PJT   |
+ * 0.4   16-oct-2026    potential_n_##TYPE: n positions at once                |
  *                                                                             |
  *----------------------------------------------------------------------------*/
 
@@ -84,3 +85,34 @@ POTENTIAL(double)
 
 #undef POTENTIAL
 //------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// n positions at once, X[n][3] -> F[n][3], P[n]: a loop without branches
+#define POTENTIAL_N(TYPE)						\
+void potential_n_##TYPE(int*NDIM, int*N, TYPE*X, TYPE*F, TYPE*P, TYPE*T) { \
+  register double r,fr,ir;						\
+  int i;								\
+  if(*NDIM != 3) {							\
+    for(i=0; i<*N; ++i)							\
+      potential_##TYPE(NDIM,X+i*(*NDIM),F+i*(*NDIM),P+i,T);		\
+    return;								\
+  }									\
+  for(i=0; i<*N; ++i) {							\
+    r  = X[3*i]*X[3*i] + X[3*i+1]*X[3*i+1]*iq2 + X[3*i+2]*X[3*i+2]*iq3;	\
+    r  = sqrt(r);							\
+    ir = 1./r;								\
+    fr = log(1+ia*r) * ir;						\
+    P[i] =-fac*fr;							\
+    fr*= ir;								\
+    fr-= ir/(r+a);							\
+    fr*=-fac*ir;							\
+    F[3*i  ] = fr * X[3*i];						\
+    F[3*i+1] = fr * X[3*i+1]*iq2;					\
+    F[3*i+2] = fr * X[3*i+2]*iq3;					\
+  }									\
+}
+
+POTENTIAL_N(float)
+POTENTIAL_N(double)
+
+#undef POTENTIAL_N
+//------------------------------------------------------------------------------
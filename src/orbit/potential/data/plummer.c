@@ -2,6 +2,7 @@
  * plummer.c:  (spherical) plummer potential
  *
  *	sep-2001	provide both a _double and _float version for the new potproc interface
+ *	oct-2026	potential_n_double and _float: n positions at once
  *
  */
 
@@ -99,3 +100,50 @@ void potential_float (int *ndim,float *pos,float *acc,float *pot,float *time)
 #endif
 }
 
+
+/*
+ * potential_n: n positions at once, pos[n][3] -> acc[n][3], pot[n]
+ *              a plain loop without branches, which the compiler vectorizes
+ */
+
+void potential_n_double (int *ndim,int *np,double *pos,double *acc,double *pot,double *time)
+{
+    int i, n = *np;
+    double tmp, p;
+
+    if (*ndim != 3) {
+        for (i=0; i<n; i++)
+            potential_double(ndim,pos+i*(*ndim),acc+i*(*ndim),pot+i,time);
+        return;
+    }
+    for (i=0; i<n; i++) {
+        tmp = 1.0/(r2 + pos[3*i]*pos[3*i] + pos[3*i+1]*pos[3*i+1] + pos[3*i+2]*pos[3*i+2]);
+        p = -sqrt(tmp);
+        tmp *= p * plummer_mass;
+        pot[i] = p * plummer_mass;
+        acc[3*i]   = tmp*pos[3*i];
+        acc[3*i+1] = tmp*pos[3*i+1];
+        acc[3*i+2] = tmp*pos[3*i+2];
+    }
+}
+
+void potential_n_float (int *ndim,int *np,float *pos,float *acc,float *pot,float *time)
+{
+    int i, n = *np;
+    float tmp, p;
+
+    if (*ndim != 3) {
+        for (i=0; i<n; i++)
+            potential_float(ndim,pos+i*(*ndim),acc+i*(*ndim),pot+i,time);
+        return;
+    }
+    for (i=0; i<n; i++) {
+        tmp = 1.0/(r2 + pos[3*i]*pos[3*i] + pos[3*i+1]*pos[3*i+1] + pos[3*i+2]*pos[3*i+2]);
+        p = -sqrt(tmp);
+        tmp *= p * plummer_mass;
+        pot[i] = p * plummer_mass;
+        acc[3*i]   = tmp*pos[3*i];
+        acc[3*i+1] = tmp*pos[3*i+1];
+        acc[3*i+2] = tmp*pos[3*i+2];
+    }
+}
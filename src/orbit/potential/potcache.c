@@ -0,0 +1,495 @@
+/* potcache.c - set_potential_cache, potcache_wrap */
+
+/*------------------------------------------------------------------------------
+ *  POTCACHE:  tabulate a static potential(5NEMO) once on a grid, and serve
+ *             potential and forces by cubic interpolation from that table
+ *             for expensive potentials (special functions, table lookups,
+ *             fortran). Positions outside the table fall back to the
+ *             potential itself.
+ *
+ *             The geometry of the table is chosen by the user:
+ *                1 (sph)  Phi(r), log spaced r in [rmax*RMINFAC,rmax]
+ *                2 (axi)  Phi(R,z), R in [0,rmax], z in [-rmax,rmax]
+ *                3 (cart) Phi(x,y,z) in [-rmax,rmax]^3
+ *             the grid is refined (doubled) until the maximum force error
+ *             on a set of test points, relative to the maximum force, is
+ *             below tol. The table is sampled at time=0.
+ *
+ *      16-oct-26     V1.0  created
+ *------------------------------------------------------------------------------
+ */
+
+#include  <stdinc.h>
+#include  <strlib.h>
+#include  <extstring.h>
+#include  <filefn.h>
+#include  <filestruct.h>
+#include  <potential.h>
+
+#define PotCacheTag "PotCache"
+
+#define RMINFAC  1.0e-4      /* inner edge of the spherical table / rmax     */
+#define NTEST    4000        /* number of test points to estimate the error  */
+
+typedef struct {
+    int    mode;             /* 1: spherical 2: axisymmetric 3: cartesian    */
+    double rmax;             /* extent of table                              */
+    double tol;              /* wanted max relative force error              */
+    string file;             /* optional file to keep the table              */
+    char   type;             /* 'd' or 'f': type of exact potential          */
+    proc   exact;            /* the potential tabulated                      */
+    int    ndim;             /* dimensions of the table (1,2,3)              */
+    int    nq;               /* quantities per node: pot + ndim forces       */
+    int    n[3];             /* nodes per dimension                          */
+    int    st[3];            /* stride per dimension                         */
+    double o[3], h[3];       /* origin and spacing per dimension             */
+    double *tab;             /* the table                                    */
+    double errpot, erracc;   /* max relative error in potential and force    */
+} potcache;
+
+local potcache pc;
+local bool     want = FALSE; /* cache the next potential loaded?             */
+
+/*-----------------------------------------------------------------------------
+ *  set_potential_cache --  request the next potential loaded to be tabulated
+ *          spec = "mode,rmax[,tol[,file]]"; empty or NULL: no cache
+ *-----------------------------------------------------------------------------
+ */
+void set_potential_cache(string spec)
+{
+    string *sp;
+    int nsp;
+
+    want = FALSE;
+    if (spec == NULL || *spec == 0) return;
+    sp = burststring(spec,", ");
+    nsp = xstrlen(sp,sizeof(string)) - 1;
+    if (nsp < 2)
+        error("potcache=%s: need at least mode,rmax",spec);
+    switch (*sp[0]) {
+      case '1': case 's':  pc.mode = 1;  break;
+      case '2': case 'a':  pc.mode = 2;  break;
+      case '3': case 'c':  pc.mode = 3;  break;
+      default:  error("potcache=%s: mode must be 1|sph, 2|axi or 3|cart",spec);
+    }
+    pc.rmax = atof(sp[1]);
+    if (pc.rmax <= 0) error("potcache=%s: need rmax > 0",spec);
+    pc.tol = nsp > 2 ? atof(sp[2]) : 1e-5;
+    if (pc.tol <= 0) error("potcache=%s: need tol > 0",spec);
+    pc.file = NULL;
+    if (nsp > 3) {
+        if (strchr(sp[3],'/') == NULL && getenv("NEMOOBJ") != NULL) {
+            pc.file = (string) allocate(strlen(getenv("NEMOOBJ"))+strlen(sp[3])+12);
+            sprintf(pc.file,"%s/potential/%s",getenv("NEMOOBJ"),sp[3]);
+        } else
+            pc.file = scopy(sp[3]);
+    }
+    freestrings(sp);
+    want = TRUE;
+}
+
+/*
+ * the table: axes and storage for n nodes along the radial direction
+ */
+local void cache_axes(int n)
+{
+    int d;
+
+    pc.ndim = pc.mode;
+    pc.nq = pc.ndim + 1;
+    for (d=0; d<3; d++) {
+        pc.n[d] = 1;
+        pc.o[d] = 0.0;
+        pc.h[d] = 1.0;
+    }
+    switch (pc.mode) {
+      case 1:
+        pc.n[0] = n;
+        pc.o[0] = log(pc.rmax*RMINFAC);
+        pc.h[0] = -log(RMINFAC)/(n-1);
+        break;
+      case 2:
+        pc.n[0] = n;
+        pc.n[1] = 2*n-1;
+        pc.o[0] = 0.0;
+        pc.o[1] = -pc.rmax;
+        pc.h[0] = pc.h[1] = pc.rmax/(n-1);
+        break;
+      case 3:
+        for (d=0; d<3; d++) {
+            pc.n[d] = n;
+            pc.o[d] = -pc.rmax;
+            pc.h[d] = 2*pc.rmax/(n-1);
+        }
+        break;
+    }
+    pc.st[0] = pc.nq;
+    pc.st[1] = pc.st[0] * pc.n[0];
+    pc.st[2] = pc.st[1] * pc.n[1];
+    if (pc.tab) free(pc.tab);
+    pc.tab = (double *) allocate(pc.st[2] * pc.n[2] * sizeof(double));
+}
+
+local int cache_size(void)
+{
+    return pc.st[2] * pc.n[2];
+}
+
+/*
+ * the exact potential at time=0 in 3D, in double precision
+ */
+local void cache_exact(double *pos, double *acc, double *pot)
+{
+    int k, ndim = 3;
+    double dtime = 0.0;
+    float fpos[3], facc[3], fpot, ftime = 0.0;
+
+    if (pc.type == 'f') {
+        for (k=0; k<3; k++) fpos[k] = pos[k];
+        (*(potproc_float)pc.exact)(&ndim,fpos,facc,&fpot,&ftime);
+        for (k=0; k<3; k++) acc[k] = facc[k];
+        *pot = fpot;
+    } else
+        (*(potproc_double)pc.exact)(&ndim,pos,acc,pot,&dtime);
+}
+
+/*
+ * tensor product of 4-point (cubic) Lagrange interpolation in the table,
+ * with one-sided stencils at the edges. returns FALSE outside the table
+ */
+local bool cache_interp(double *u, double *f)
+{
+    int d, a, b, c, k, i, i0[3], m[3];
+    double w[3][4], t, s, wbc, wa, *tp;
+
+    for (d=0; d<3; d++) {
+        if (d >= pc.ndim) {
+            i0[d] = 0;
+            m[d] = 1;
+            w[d][0] = 1.0;
+            continue;
+        }
+        t = (u[d]-pc.o[d])/pc.h[d];
+        if (t < 0.0 || t > pc.n[d]-1) return FALSE;
+        i = (int) t - 1;
+        if (i < 0) i = 0;
+        if (i > pc.n[d]-4) i = pc.n[d]-4;
+        s = t - i;
+        w[d][0] = -(s-1)*(s-2)*(s-3)/6.0;
+        w[d][1] =  s*(s-2)*(s-3)/2.0;
+        w[d][2] = -s*(s-1)*(s-3)/2.0;
+        w[d][3] =  s*(s-1)*(s-2)/6.0;
+        i0[d] = i;
+        m[d] = 4;
+    }
+    for (k=0; k<pc.nq; k++) f[k] = 0.0;
+    for (c=0; c<m[2]; c++)
+        for (b=0; b<m[1]; b++) {
+            wbc = w[2][c]*w[1][b];
+            tp = pc.tab + (i0[2]+c)*pc.st[2] + (i0[1]+b)*pc.st[1] + i0[0]*pc.st[0];
+            for (a=0; a<m[0]; a++, tp+=pc.nq) {
+                wa = wbc*w[0][a];
+                for (k=0; k<pc.nq; k++)
+                    f[k] += wa*tp[k];
+            }
+        }
+    return TRUE;
+}
+
+/*
+ * potential and forces from the table; returns FALSE outside the table
+ */
+local bool cache_eval(const double *pos, double *acc, double *pot)
+{
+    double u[3], f[4], r, R;
+
+    switch (pc.mode) {
+      case 1:
+        r = sqrt(pos[0]*pos[0] + pos[1]*pos[1] + pos[2]*pos[2]);
+        if (r <= 0.0) return FALSE;
+        u[0] = log(r);
+        if (!cache_interp(u,f)) return FALSE;
+        *pot = f[0];
+        acc[0] = f[1]*pos[0]/r;
+        acc[1] = f[1]*pos[1]/r;
+        acc[2] = f[1]*pos[2]/r;
+        return TRUE;
+      case 2:
+        R = sqrt(pos[0]*pos[0] + pos[1]*pos[1]);
+        u[0] = R;
+        u[1] = pos[2];
+        if (!cache_interp(u,f)) return FALSE;
+        *pot = f[0];
+        acc[0] = R > 0.0 ? f[1]*pos[0]/R : 0.0;
+        acc[1] = R > 0.0 ? f[1]*pos[1]/R : 0.0;
+        acc[2] = f[2];
+        return TRUE;
+      case 3:
+        u[0] = pos[0];
+        u[1] = pos[1];
+        u[2] = pos[2];
+        if (!cache_interp(u,f)) return FALSE;
+        *pot = f[0];
+        acc[0] = f[1];
+        acc[1] = f[2];
+        acc[2] = f[3];
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/*
+ * sample the exact potential on the nodes of the table
+ */
+local void cache_sample(void)
+{
+    int i0, i1, i2, k;
+    double pos[3], acc[3], pot, *tp;
+
+    for (i2=0; i2<pc.n[2]; i2++)
+      for (i1=0; i1<pc.n[1]; i1++)
+        for (i0=0; i0<pc.n[0]; i0++) {
+            tp = pc.tab + i2*pc.st[2] + i1*pc.st[1] + i0*pc.st[0];
+            switch (pc.mode) {
+              case 1:
+                pos[0] = exp(pc.o[0] + i0*pc.h[0]);
+                pos[1] = pos[2] = 0.0;
+                break;
+              case 2:
+                pos[0] = pc.o[0] + i0*pc.h[0];
+                pos[1] = 0.0;
+                pos[2] = pc.o[1] + i1*pc.h[1];
+                break;
+              case 3:
+                pos[0] = pc.o[0] + i0*pc.h[0];
+                pos[1] = pc.o[1] + i1*pc.h[1];
+                pos[2] = pc.o[2] + i2*pc.h[2];
+                break;
+            }
+            cache_exact(pos,acc,&pot);
+            tp[0] = pot;
+            if (pc.mode == 2) {
+                tp[1] = acc[0];
+                tp[2] = acc[2];
+            } else
+                for (k=0; k<pc.ndim; k++)
+                    tp[k+1] = acc[k];
+        }
+}
+
+/*
+ * radical inverse in base b: the Halton sequence for the test points
+ */
+local double halton(int i, int b)
+{
+    double f = 1.0, h = 0.0;
+
+    while (i > 0) {
+        f /= b;
+        h += f * (i % b);
+        i /= b;
+    }
+    return h;
+}
+
+/*
+ * max errors of the table in potential and force, relative to the max
+ * potential and force, on NTEST points spread over the whole table
+ * (in all directions, also for modes 1 and 2)
+ */
+local void cache_errors(void)
+{
+    int i, k;
+    double h1, h2, h3, r, R, ct, st, phi, pos[3], ae[3], ac[3], pe, pt, da;
+    double maxp=0, maxa=0, maxdp=0, maxda=0;
+
+    for (i=1; i<=NTEST; i++) {
+        h1 = halton(i,2);
+        h2 = halton(i,3);
+        h3 = halton(i,5);
+        switch (pc.mode) {
+          case 1:
+            r = pc.rmax * pow(RMINFAC,h1);
+            ct = 2*h2-1;
+            st = sqrt(1-ct*ct);
+            phi = TWO_PI*h3;
+            pos[0] = r*st*cos(phi);
+            pos[1] = r*st*sin(phi);
+            pos[2] = r*ct;
+            break;
+          case 2:
+            R = pc.rmax*h1;
+            phi = TWO_PI*h3;
+            pos[0] = R*cos(phi);
+            pos[1] = R*sin(phi);
+            pos[2] = pc.rmax*(2*h2-1);
+            break;
+          case 3:
+            pos[0] = pc.rmax*(2*h1-1);
+            pos[1] = pc.rmax*(2*h2-1);
+            pos[2] = pc.rmax*(2*h3-1);
+            break;
+        }
+        if (!cache_eval(pos,ac,&pt)) continue;
+        cache_exact(pos,ae,&pe);
+        maxp = MAX(maxp, ABS(pe));
+        maxdp = MAX(maxdp, ABS(pt-pe));
+        da = 0.0;
+        for (k=0; k<3; k++)
+            da += sqr(ac[k]-ae[k]);
+        maxda = MAX(maxda, sqrt(da));
+        maxa = MAX(maxa, sqrt(sqr(ae[0])+sqr(ae[1])+sqr(ae[2])));
+    }
+    pc.errpot = maxp > 0 ? maxdp/maxp : maxdp;
+    pc.erracc = maxa > 0 ? maxda/maxa : maxda;
+}
+
+/*
+ * build the table, doubling the resolution until the force error is
+ * below tol, or the table gets too large
+ */
+local void cache_build(void)
+{
+    int n    = pc.mode==1 ?    65 : pc.mode==2 ?   33 :  17;
+    int nmax = pc.mode==1 ? 16385 : pc.mode==2 ? 1025 : 129;
+
+    for (;;) {
+        cache_axes(n);
+        cache_sample();
+        cache_errors();
+        dprintf(1,"potcache: n=%d  max error pot %g  acc %g\n",
+                n, pc.errpot, pc.erracc);
+        if (pc.erracc <= pc.tol) break;
+        if (2*n-1 > nmax) {
+            warning("potcache: tolerance %g not reached with n=%d",pc.tol,n);
+            break;
+        }
+        n = 2*n-1;
+    }
+}
+
+/*
+ * keeping the table in a file: it is re-used if name, parameters and
+ * geometry are the same
+ */
+local bool cache_same(stream str, string tag, string val)
+{
+    string s;
+    bool same;
+
+    if (!get_tag_ok(str,tag)) return FALSE;
+    s = get_string(str,tag);
+    same = streq(s, val ? val : "");
+    free(s);
+    return same;
+}
+
+local bool cache_read(string name, string pars, string data)
+{
+    stream str;
+    int mode, n;
+    double rmax, tol, err[2];
+    bool ok;
+
+    if (!fexist(pc.file)) return FALSE;
+    str = stropen(pc.file,"r");
+    if (!get_tag_ok(str,PotCacheTag)) {
+        strclose(str);
+        return FALSE;
+    }
+    get_set(str,PotCacheTag);
+    ok = cache_same(str,"Name",name) && cache_same(str,"Pars",pars) &&
+         cache_same(str,"File",data);
+    get_data(str,"Mode",IntType,&mode,0);
+    get_data(str,"Rmax",DoubleType,&rmax,0);
+    get_data(str,"Tol",DoubleType,&tol,0);
+    ok = ok && mode==pc.mode && rmax==pc.rmax && tol==pc.tol;
+    if (ok) {
+        get_data(str,"Ngrid",IntType,&n,0);
+        cache_axes(n);
+        get_data(str,"Errors",DoubleType,err,2,0);
+        get_data(str,"Table",DoubleType,pc.tab,cache_size(),0);
+        pc.errpot = err[0];
+        pc.erracc = err[1];
+    }
+    get_tes(str,PotCacheTag);
+    strclose(str);
+    return ok;
+}
+
+local void cache_write(string name, string pars, string data)
+{
+    stream str;
+    double err[2];
+
+    str = stropen(pc.file,"w!");
+    put_set(str,PotCacheTag);
+    put_string(str,"Name",name);
+    put_string(str,"Pars",pars ? pars : "");
+    put_string(str,"File",data ? data : "");
+    put_data(str,"Mode",IntType,&pc.mode,0);
+    put_data(str,"Rmax",DoubleType,&pc.rmax,0);
+    put_data(str,"Tol",DoubleType,&pc.tol,0);
+    put_data(str,"Ngrid",IntType,&pc.n[0],0);
+    err[0] = pc.errpot;
+    err[1] = pc.erracc;
+    put_data(str,"Errors",DoubleType,err,2,0);
+    put_data(str,"Table",DoubleType,pc.tab,cache_size(),0);
+    put_tes(str,PotCacheTag);
+    strclose(str);
+}
+
+/*
+ * the replacements for potential_double() and potential_float()
+ */
+local void potcache_double(const int *ndim, const double *pos, double *acc,
+                           double *pot, const double *time)
+{
+    if (*ndim == 3 && cache_eval(pos,acc,pot)) return;
+    (*(potproc_double)pc.exact)(ndim,pos,acc,pot,time);
+}
+
+local void potcache_float(const int *ndim, const float *pos, float *acc,
+                          float *pot, const float *time)
+{
+    int k;
+    double dpos[3], dacc[3], dpot;
+
+    if (*ndim == 3) {
+        for (k=0; k<3; k++) dpos[k] = pos[k];
+        if (cache_eval(dpos,dacc,&dpot)) {
+            for (k=0; k<3; k++) acc[k] = dacc[k];
+            *pot = dpot;
+            return;
+        }
+    }
+    (*(potproc_float)pc.exact)(ndim,pos,acc,pot,time);
+}
+
+/*-----------------------------------------------------------------------------
+ *  potcache_wrap --  called by load_potential() after inipotential(): if
+ *          a cache was requested, tabulate pot (or read the table from
+ *          file) and return the routine serving from the table instead.
+ *          Only the first potential loaded after set_potential_cache()
+ *          is cached.
+ *-----------------------------------------------------------------------------
+ */
+proc potcache_wrap(proc pot, char type, string name, string pars, string data)
+{
+    bool old;
+
+    if (!want) return pot;
+    want = FALSE;
+    pc.exact = pot;
+    pc.type = type;
+    old = pc.file != NULL && cache_read(name,pars,data);
+    if (!old) {
+        cache_build();
+        if (pc.file) cache_write(name,pars,data);
+    }
+    dprintf(0,"[potcache: %s tabulated on %dx%dx%d grid%s%s, max rel. error pot %.2g acc %.2g]\n",
+            name, pc.n[0], pc.n[1], pc.n[2],
+            old ? " read from " : pc.file ? " saved in " : "",
+            pc.file ? pc.file : "", pc.errpot, pc.erracc);
+    return type=='f' ? (proc) potcache_float : (proc) potcache_double;
+}
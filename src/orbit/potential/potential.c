@@ -39,6 +39,9 @@
  *      14-jul-05         d made dummy functions global, for new (FC4) linker 
  *      18-sep-08         e make 'r' == SINGLEPREC? 'f' : 'd'              WD
  *      10-jan-22     V5.5  implement a set_potential()                    PJT
+ *      16-oct-26     V5.6  get_potential_n(): batch version, optional
+ *                          potential_n_double/float, else generic loop
+ *                    V5.7  optional table of the potential, see potcache.c
  *------------------------------------------------------------------------------
  */
 
@@ -55,6 +58,9 @@ local int  local_npar=0;        /* actual used number of par's               */
 local real local_omega=0;	/* pattern speed                             */
 local proc l_potential=NULL;    /* actual storage of pointer to exter worker */
 local proc l_inipotential=NULL; /* actual storage of pointer to exter inits  */
+local proc l_potential_n=NULL;  /* batch worker of last potential, if any    */
+local proc l_potential_1=NULL;  /* scalar worker called by generic batch     */
+local char l_type = 0;          /* type (f or d) of last potential loaded    */
 local bool Qfortran = FALSE;    /* was a fortran routine used ? -- a hack -- */
 local bool first = TRUE;        /* see if first time called for mysymbols()  */
 
@@ -63,6 +69,7 @@ void potential_dummy_for_c(void);
 /* forward declarations */
 
 local proc load_potential(string, string, string, char); /* load by name    */
+extern proc potcache_wrap(proc, char, string, string, string); /* potcache.c */
 
 /*-----------------------------------------------------------------------------
  *  get_potential --  returns the pointer ptr to the function which carries out
@@ -93,6 +100,67 @@ potproc_float  get_potential_float(string potname, string potpars, string potfil
     return (potproc_float) l_potential;
 }
 
+/*-----------------------------------------------------------------------------
+ *  get_potential_n --  returns the pointer to the function which computes
+ *          potential and accelerations for n positions at once, for the
+ *          potential loaded last. If the potential(5) does not provide a
+ *          potential_n_double() or potential_n_float(), a generic loop over
+ *          its scalar routine is returned.
+ *-----------------------------------------------------------------------------
+ */
+local void potential_n_loop_double(const int *ndim, const int *n,
+				   const double *pos, double *acc, double *pot,
+				   const double *time)
+{
+    int i, nd = *ndim;
+    potproc_double p = (potproc_double) l_potential_1;
+
+    for (i=0; i<*n; i++)
+        (*p)(ndim, pos+i*nd, acc+i*nd, pot+i, time);
+}
+
+local void potential_n_loop_float(const int *ndim, const int *n,
+				  const float *pos, float *acc, float *pot,
+				  const float *time)
+{
+    int i, nd = *ndim;
+    potproc_float p = (potproc_float) l_potential_1;
+
+    for (i=0; i<*n; i++)
+        (*p)(ndim, pos+i*nd, acc+i*nd, pot+i, time);
+}
+
+potproc_n_double get_potential_n_double()
+{
+    if (first) error("get_potential_n_double: get_potential not called yet");
+    if (l_type != 'd')
+        error("get_potential_n_double: last potential was not loaded as double");
+    if (l_potential_n)
+        return (potproc_n_double) l_potential_n;
+    l_potential_1 = l_potential;
+    return potential_n_loop_double;
+}
+
+potproc_n_float get_potential_n_float()
+{
+    if (first) error("get_potential_n_float: get_potential not called yet");
+    if (l_type != 'f')
+        error("get_potential_n_float: last potential was not loaded as float");
+    if (l_potential_n)
+        return (potproc_n_float) l_potential_n;
+    l_potential_1 = l_potential;
+    return potential_n_loop_float;
+}
+
+potproc_n_real get_potential_n()
+{
+#ifdef SINGLEPREC
+    return get_potential_n_float();
+#else
+    return get_potential_n_double();
+#endif
+}
+
 /*-----------------------------------------------------------------------------
  *  get_inipotential --  returns the pointer ptr to the last inipotential
  *          function which initializes the potential
@@ -137,7 +205,7 @@ local proc load_potential(string fname, string parameters, string dataname, char
 {
     char  name[256], cmd[256], path[256], pname[32];
     char  *fullname, *nemopath, *potpath;
-    proc  pot, ini_pot;
+    proc  pot, ini_pot, cached;
     int never=0;
 
     if (parameters!=NULL && *parameters!=0) {              /* get parameters */
@@ -248,6 +316,17 @@ local proc load_potential(string fname, string parameters, string dataname, char
       return NULL;
     }
 
+    /* the batch version is optional, and only looked for in C potentials */
+    l_type = search_type;
+    l_potential_n = NULL;
+    if (!Qfortran) {
+      strcpy(pname, search_type=='f' ? "potential_n_float" : "potential_n_double");
+      mapsys(pname);
+      l_potential_n = (proc) findfn (pname);
+      if (l_potential_n)
+	dprintf(1,"\"%s\" loaded from file \"%s\"\n",pname,fullname);
+    }
+
     strcpy(pname,"inipotential");
     mapsys(pname);
     ini_pot = (proc) findfn (pname);              		/* C */
@@ -286,6 +365,11 @@ local proc load_potential(string fname, string parameters, string dataname, char
     	local_omega = local_par[0];
     	dprintf(1,"get_potential: modified omega=%g\n",local_omega);
     }
+    cached = potcache_wrap(pot, search_type, fname, parameters, dataname);
+    if (cached != pot) {          /* tabulated, see set_potential_cache() */
+        l_potential = pot = cached;
+        l_potential_n = NULL;
+    }
     if (pot==NULL) potential_dummy_for_c();    /* should never be called */
     return pot;
 }
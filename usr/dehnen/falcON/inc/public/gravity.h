@@ -723,6 +723,14 @@ namespace falcON {
       A_CB=0, A_CC=0;
 #ifdef ENHANCED_IACT_STATS
       P_CB=0, P_CC=0, P_CX=0;
+#endif
+    }
+    void add      (GravStats const&S)              // add stats of other threads
+    {
+      D_BB+=S.D_BB, D_CB+=S.D_CB, D_CC+=S.D_CC, D_CX+=S.D_CX;
+      A_CB+=S.A_CB, A_CC+=S.A_CC;
+#ifdef ENHANCED_IACT_STATS
+      P_CB+=S.P_CB, P_CC+=S.P_CC, P_CX+=S.P_CX;
 #endif
     }
 
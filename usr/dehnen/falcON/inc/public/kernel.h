@@ -216,6 +216,15 @@ namespace falcON {
     //--------------------------------------------------------------------------
     void eval_grav    (grav::cell_iter const&, TaylorSeries const&) const;
     void eval_grav_all(grav::cell_iter const&, TaylorSeries const&) const;
+#ifdef _OPENMP
+    // parallel evaluation: sub-trees with more than Nt bodies are passed to  
+    // openMP tasks, each thread uses its own kernel K[thread] for the rest   
+    static void eval_grav_omp(grav::cell_iter     const&,
+			      TaylorSeries        const&,
+			      const GravKernBase*const*K,
+			      unsigned                 Nt,
+			      bool                     all);
+#endif
     //--------------------------------------------------------------------------
     // public methods                                                           
     //--------------------------------------------------------------------------
@@ -223,6 +232,8 @@ namespace falcON {
     int      const&coeffs_used() const { return MAXNC; }
     unsigned       chunks_used() const {
       return COEFF_POOL?  COEFF_POOL->N_chunks() : 0u; }
+    unsigned       coeffs_taken() const {
+      return COEFF_POOL?  COEFF_POOL->N_alloc_max() : 0u; }
     /// given X^2 and Eps^2, compute negative gravitational potential
     static real Psi(kern_type k, real Xq, real Eq);
     //--------------------------------------------------------------------------
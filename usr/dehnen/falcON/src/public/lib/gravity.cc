@@ -33,6 +33,10 @@
 #include <public/interact.h>
 #include <public/kernel.h>
 #include <numerics.h>
+#ifdef _OPENMP
+#  include <omp.h>
+#  include <vector>
+#endif
 
 using namespace falcON;
 ////////////////////////////////////////////////////////////////////////////////
@@ -235,6 +239,144 @@ namespace {
 		 square(radius(C)+abs(com[1]-center(C)[1])) +
 		 square(radius(C)+abs(com[2]-center(C)[2])) );
   }
+  //////////////////////////////////////////////////////////////////////////////
+  //                                                                            
+  // PassUp<INDI_SOFT>::cell()                                                  
+  //   pass flag, mass, [N*eps/2,] cofm, rmax, multipoles from the kids up to   
+  //   the cell                                                                 
+  // PassUpTree<INDI_SOFT>()                                                    
+  //   do so for all cells of a sub-tree, using openMP tasks for sub-trees with 
+  //   more than Nt leafs; returns # active cells                               
+  //                                                                            
+  //////////////////////////////////////////////////////////////////////////////
+  template<bool> struct PassUp;
+#define MASS_WEIGHTED_SOFTENING 1
+  template<> struct PassUp<1> {
+    // with eps_i: pass flag, mass, N*eps/2, cofm, rmax, multipoles
+    static void cell(cell_iter const&Ci, bool REUSE) {
+      Ci->reset_active_flag();                     //     reset activity flag   
+      Ci->reset_sink_flag();                       //     reset sink flag       
+      real eh (zero);                              //     reset eps/2           
+      real mon(zero);                              //     reset monopole        
+      vect com(zero);                              //     reset dipole          
+      LoopCellKids(cell_iter,Ci,c) {               //     LOOP sub-cells c      
+	eh  += eph (c) *
+#ifdef MASS_WEIGHTED_SOFTENING
+	    mass(c)                                //       sum up M * eps/2    
+#else
+	    number(c)
+#endif
+	    ;
+	mon += mass(c);                            //       sum up monopole     
+	com += mass(c) * cofm(c);                  //       sum up dipole       
+	Ci->add_active_flag(c);                    //       add in activity flag
+	Ci->add_sink_flag(c);                      //       add in sink flag    
+      }                                            //     END LOOP              
+      LoopLeafKids(cell_iter,Ci,l) {               //     LOOP sub-leafs s      
+#ifdef MASS_WEIGHTED_SOFTENING
+	eh  += mass(l) * eph(l);                   //       sum up M * eps/2    
+#else
+	eh  += eph (l);                            //       sum up eps/2        
+#endif
+	mon += mass(l);                            //       sum up monopole     
+	com += mass(l) * cofm(l);                  //       sum up dipole       
+	Ci->add_active_flag(l);                    //       add in activity flag
+	Ci->add_sink_flag(l);                      //       add in sink flag    
+      }                                            //     END LOOP              
+      Ci->mass() = mon;                            //     set mass              
+      mon        = (mon==zero)? zero:one/mon;      //     1/mass                
+      com       *= mon;                            //     cofm = dipole/mass    
+#ifdef MASS_WEIGHTED_SOFTENING
+      eh        /= mass(Ci);                       //     mean eps/2            
+#else
+      eh        /= number(Ci);                     //     mean eps/2            
+#endif
+      Ci->eph()  = eh;                             //     set eps/2             
+      Mset P(zero);                                //     reset multipoles      
+      real dmax(zero);                             //     reset d_max           
+      LoopLeafKids(cell_iter,Ci,l) {               //     LOOP sub-leafs s      
+	vect Xi = cofm(l); Xi-= com;               //       distance vector     
+	update_max(dmax,norm(Xi));                 //       update d_max^2      
+	P.add_body(Xi,mass(l));                    //       add multipoles      
+      }                                            //     END LOOP              
+      if(has_leaf_kids(Ci)) dmax = sqrt(dmax);     //     d_max due to sub-leafs
+      LoopCellKids(cell_iter,Ci,c) {               //     LOOP sub-cells c      
+	vect Xi = cofm(c); Xi-= com;               //       distance vector     
+	real Xq = norm(Xi);                        //       distance^2          
+	real x  = dmax - rmax(c);                  //       auxiliary           
+	if(zero>x || Xq>square(x))                 //       IF(d>d_max)         
+	  dmax = sqrt(Xq) + rmax(c);               //         set d_max = d     
+	P.add_cell(Xi,mass(c),poles(c));           //       add multipoles      
+      }                                            //     END LOOP              
+      Ci->rmax() = REUSE? dmax :                   //     r_max=d_max           
+	           min(dmax,bmax(com,Ci));         //     r_max=min(d_max,b_max)
+      Ci->cofm() = com;                            //     set dipole = mass*cofm
+      Ci->poles()= P;                              //     assign multipoles     
+    }
+  };
+  template<> struct PassUp<0> {
+    // without eps_i: pass flag, mass, cofm, rmax, multipoles
+    static void cell(cell_iter const&Ci, bool REUSE) {
+      Ci->reset_active_flag();                     //     reset activity flag   
+      Ci->reset_sink_flag();                       //     reset sink flag       
+      real mon(zero);                              //     reset monopole        
+      vect com(zero);                              //     reset dipole          
+      LoopCellKids(cell_iter,Ci,c) {               //     LOOP sub-cells c      
+	mon += mass(c);                            //       sum up monopole     
+	com += mass(c) * cofm(c);                  //       sum up dipole       
+	Ci->add_active_flag(c);                    //       add in activity flag
+	Ci->add_sink_flag(c);                      //       add in sink flag    
+      }                                            //     END LOOP              
+      LoopLeafKids(cell_iter,Ci,l) {               //     LOOP sub-leafs s      
+	mon += mass(l);                            //       sum up monopole     
+	com += mass(l) * cofm(l);                  //       sum up dipole       
+	Ci->add_active_flag(l);                    //       add in activity flag
+	Ci->add_sink_flag(l);                      //       add in sink flag    
+      }                                            //     END LOOP              
+      Ci->mass() = mon;                            //     set mass              
+      mon        = (mon==zero)? zero:one/mon;      //     1/mass                
+      com       *= mon;                            //     cofm = dipole/mass    
+      Mset P(zero);                                //     reset multipoles      
+      real dmax(zero);                             //     reset d_max           
+      LoopLeafKids(cell_iter,Ci,l) {               //     LOOP sub-leafs s      
+	vect Xi = cofm(l); Xi-= com;               //       distance vector     
+	update_max(dmax,norm(Xi));                 //       update d_max^2      
+	P.add_body(Xi,mass(l));                    //       add multipoles      
+      }                                            //     END LOOP              
+      if(has_leaf_kids(Ci)) dmax = sqrt(dmax);     //     d_max due to sub-leafs
+      LoopCellKids(cell_iter,Ci,c) {               //     LOOP sub-cells c      
+	vect Xi = cofm(c); Xi-= com;               //       distance vector     
+	real Xq = norm(Xi);                        //       distance^2          
+	real x  = dmax - rmax(c);                  //       auxiliary           
+	if(zero>x || Xq>square(x))                 //       IF(d>d_max)         
+	  dmax = sqrt(Xq) + rmax(c);               //         set d_max = d     
+	P.add_cell(Xi,mass(c),poles(c));           //       add multipoles      
+      }                                            //     END LOOP              
+      Ci->rmax() = REUSE? dmax :                   //     r_max=d_max           
+	           min(dmax,bmax(com,Ci));         //     r_max=min(d_max,b_max)
+      Ci->cofm() = com;                            //     set dipole = mass*cofm
+      Ci->poles()= P;                              //     assign multipoles     
+    }
+  };
+#ifdef _OPENMP
+  template<bool SOFT> int PassUpTree(cell_iter const&C, bool REUSE, unsigned Nt)
+  {
+    int n=0, m=0;                                  // # active cells            
+    LoopCellKids(cell_iter,C,c)                    // LOOP cell kids            
+      if(number(c) > Nt) {                         //   IF large: task          
+#pragma omp task firstprivate(c) shared(n)
+	{
+	  int k = PassUpTree<SOFT>(c,REUSE,Nt);
+#pragma omp atomic
+	  n += k;
+	}
+      } else                                       //   ELSE: recursive call    
+	m += PassUpTree<SOFT>(c,REUSE,Nt);
+#pragma omp taskwait
+    PassUp<SOFT>::cell(C,REUSE);                   // pass up to this cell      
+    return is_active(C)? n+m+1 : n+m;
+  }
+#endif
   //////////////////////////////////////////////////////////////////////////////
   //                                                                            
   // class GravIactBase                                                         
@@ -440,6 +582,24 @@ namespace {
       flush_buffers();                             // finish interactions       
       eval_grav(C,TaylorSeries(cofm(C)));          // start recursion           
     }
+#ifdef _OPENMP
+    //--------------------------------------------------------------------------
+    // support for the openMP parallel interaction & evaluation phases          
+    //--------------------------------------------------------------------------
+    bool must_split(cell_iter const&A) const {     // will self-iaction split?  
+      return is_active(A) && !do_direct(A);
+    }
+    //--------------------------------------------------------------------------
+    void flush() const {                           // finish interactions       
+      flush_buffers();
+    }
+    //--------------------------------------------------------------------------
+    static void evaluate(cell_iter          const&C,
+			 const GravKernBase*const*K,
+			 unsigned                 Nt) {
+      if(is_active(C)) eval_grav_omp(C,TaylorSeries(cofm(C)),K,Nt,0);
+    }
+#endif
     //--------------------------------------------------------------------------
     void set_sink(real e, real f)
     {
@@ -567,6 +727,24 @@ namespace {
       flush_buffers();                             // finish interactions       
       eval_grav_all(C,TaylorSeries(cofm(C)));      // start recursion           
     }
+#ifdef _OPENMP
+    //--------------------------------------------------------------------------
+    // support for the openMP parallel interaction & evaluation phases          
+    //--------------------------------------------------------------------------
+    bool must_split(cell_iter const&A) const {     // will self-iaction split?  
+      return !do_direct(A);
+    }
+    //--------------------------------------------------------------------------
+    void flush() const {                           // finish interactions       
+      flush_buffers();
+    }
+    //--------------------------------------------------------------------------
+    static void evaluate(cell_iter          const&C,
+			 const GravKernBase*const*K,
+			 unsigned                 Nt) {
+      eval_grav_omp(C,TaylorSeries(cofm(C)),K,Nt,1);
+    }
+#endif
     //--------------------------------------------------------------------------
     void set_sink(real e, real f)
     {
@@ -580,6 +758,212 @@ namespace {
       RFAQ = one;
     }
   };
+#ifdef _OPENMP
+  //////////////////////////////////////////////////////////////////////////////
+  //                                                                          //
+  // openMP parallel interaction & evaluation phase                           //
+  //                                                                          //
+  // The root self-interaction is split into cell-self, cell-cell, and        //
+  // leaf-kid tasks, exactly as MutualInteractor<> would split it, down to    //
+  // cells of about Nx bodies. The tasks are arranged in phases such that the //
+  // tasks of one phase act on disjoint sub-trees: they are performed         //
+  // concurrently without any locking, each thread using its own interactor,  //
+  // interaction stacks, and pool of Taylor coefficients. The cell-cell tasks //
+  // between the sub-cells of one cell are scheduled in rounds of disjoint    //
+  // pairs (round robin), the tasks of a phase are shared dynamically.        //
+  //                                                                          //
+  //////////////////////////////////////////////////////////////////////////////
+  struct GravTask {
+    cell_iter A,B;                                 // cells to interact         
+    char      T;                                   // self(A), A-B, A-leaf kids 
+    GravTask(cell_iter const&a, cell_iter const&b, char t)
+      : A(a), B(b), T(t) {}
+  };
+  typedef std::vector<GravTask> GravPhase;         // tasks done concurrently   
+  //----------------------------------------------------------------------------
+  class GravPlan : public std::vector<GravPhase> {
+    const unsigned Nx;                             // split cells with N > Nx   
+    void add(unsigned p, GravTask const&t) {
+      if(p >= size()) resize(p+1);
+      (*this)[p].push_back(t);
+    }
+  public:
+    explicit GravPlan(unsigned nx) : Nx(nx) {}
+    // add cell-cell tasks between the cell kids of C, starting at phase p;
+    // returns next free phase
+    unsigned add_pairs(cell_iter const&C, unsigned p) {
+      std::vector<cell_iter> K;
+      LoopCellKids(cell_iter,C,c) K.push_back(c);
+      const unsigned n=K.size(), m=n+(n&1);        // # kids, rounded up to even
+      if(n<2) return p;
+      for(unsigned r=0; r!=m-1; ++r,++p)           // LOOP rounds               
+	for(unsigned i=0; i!=m/2; ++i) {           //   LOOP pairs of round     
+	  unsigned a = i? (i+r-1)%(m-1)+1 : 0;     //     first: fixed or moving
+	  unsigned b = (m-2-i+r)%(m-1)+1;          //     second: moving        
+	  if(a<n && b<n) add(p,GravTask(K[a],K[b],'c'));
+	}                                          //   END LOOP                
+      return p;                                    // END LOOP                  
+    }
+    // add tasks for the self-interaction of C, starting at phase p;
+    // returns next free phase
+    template<typename IACT>
+    unsigned add_self(IACT const&I, cell_iter const&C, unsigned p) {
+      if(number(C) <= Nx || !I.must_split(C)) {    // IF C is small enough      
+	add(p,GravTask(C,C,'x'));                  //   one task: self(C)       
+	return p+1;                                //   DONE                    
+      }                                            // ENDIF                     
+      unsigned q=p;                                // self-iactions of kids:    
+      LoopCellKids(cell_iter,C,c)                  //   concurrently, starting  
+	update_max(q,add_self(I,c,p));             //   at phase p              
+      q = add_pairs(C,q);                          // then kid-kid iactions     
+      if(has_leaf_kids(C))                         // then leaf kids' iactions  
+	add(q++,GravTask(C,C,'l'));
+      return q;
+    }
+  };
+  //----------------------------------------------------------------------------
+  template<typename IACT>
+  void DoTask(GravTask                const&T,
+	      IACT                    const&I,
+	      MutualInteractor<IACT>  const&MI)
+  {
+    switch(T.T) {
+    case 'x': MI.cell_self(T.A);     break;
+    case 'c': MI.cell_cell(T.A,T.B); break;
+    case 'l':
+      LoopCellKids(cell_iter,T.A,c)
+	LoopLeafKids(cell_iter,T.A,s)
+	  MI.cell_leaf(c,s);
+      LoopLeafKids(cell_iter,T.A,s1)
+	LoopLeafSecd(cell_iter,T.A,s1+1,s2)
+	  I.interact(s1,s2);
+      break;
+    }
+    I.flush();
+  }
+  //----------------------------------------------------------------------------
+  // interactions of the root's leaf kids (as in GravEstimator::approx())
+  void RootLeafs(GravIactAll                   &I,
+		 MutualInteractor<GravIactAll> const&MI,
+		 cell_iter                     const&R,
+		 real e, real es, real fs)
+  {
+    LoopCellKids(cell_iter,R,c1)
+      LoopLeafKids(cell_iter,R,s2)
+	if(is_sink(s2)) {
+	  I.set_sink(es,fs);
+	  MI.cell_leaf(c1,s2);
+	  I.unset_sink(e);
+	} else
+	  MI.cell_leaf(c1,s2);
+    I.flush();
+    LoopLeafKids(cell_iter,R,s1) {
+      LoopLeafSecd(cell_iter,R,s1+1,s2)
+	if(is_sink(s1) || is_sink(s2)) {
+	  I.set_sink(es,fs);
+	  I.interact(s1,s2);
+	  I.unset_sink(e);
+	} else
+	  I.interact(s1,s2);
+      s1->normalize_grav();
+    }
+  }
+  //----------------------------------------------------------------------------
+  void RootLeafs(GravIact                   &I,
+		 MutualInteractor<GravIact> const&MI,
+		 cell_iter                  const&R,
+		 real e, real es, real fs)
+  {
+    LoopCellKids(cell_iter,R,c1)
+      LoopLeafKids(cell_iter,R,s2)
+	if(is_active(c1) || is_active(s2)) {
+	  if(is_sink(s2)) {
+	    I.set_sink(es,fs);
+	    I.direct_summation(c1,s2);
+	    I.unset_sink(e);
+	  } else
+	    MI.cell_leaf(c1,s2);
+	}
+    I.flush();
+    LoopLeafKids(cell_iter,R,s1) {
+      LoopLeafSecd(cell_iter,R,s1+1,s2)
+	if(is_sink(s1) || is_sink(s2)) {
+	  I.set_sink(es,fs);
+	  I.interact(s1,s2);
+	  I.unset_sink(e);
+	} else
+	  I.interact(s1,s2);
+      if(is_active(s1)) s1->normalize_grav();
+    }
+  }
+  //----------------------------------------------------------------------------
+  template<typename IACT>
+  void ApproxOMP(const OctTree  *T,                // I: tree                   
+		 cell_iter const&R,                // I: root cell              
+		 kern_type       k,                // I: kernel                 
+		 GravStats      *S,                // I: statistics             
+		 real            e,                // I: eps                    
+		 real            es,               // I: eps for sinks          
+		 real            fs,               // I: factor for sinks       
+		 unsigned        np,               // I: pool size              
+		 bool            s,                // I: individual eps?        
+		 const unsigned *d,                // I: direct sum control     
+		 unsigned       &Nco,              // O: # coeffs used          
+		 unsigned       &Nch)              // O: # chunks used          
+  {
+    const int      Nt = omp_get_max_threads();
+    const unsigned Nx = max(256u, number(R)/(8*Nt));
+    std::vector<const GravKernBase*> KT(Nt);       // kernel of each thread     
+    std::vector<GravStats>           ST(Nt);       // stats of each thread      
+    GravPlan                         PL(Nx);       // phases of tasks           
+    Nco = 0;
+    Nch = 0;
+#pragma omp parallel
+    {
+      const int t = omp_get_thread_num();
+      ST[t].reset(
+#ifdef WRITE_IACTION_INFO
+		  T
+#endif
+		  );
+      IACT GK(k,&ST[t],e,4+np/Nt,s,d);             // this thread's interactor  
+      MutualInteractor<IACT> MI(&GK,T->depth()-1); // this thread's stacks      
+      KT[t] = &GK;
+      // 1  plan interaction phase                                              
+#pragma omp single
+      {
+	unsigned p=0;
+	LoopCellKids(cell_iter,R,c)
+	  update_max(p,PL.add_self(GK,c,0));
+	PL.add_pairs(R,p);
+      }
+      // 2  interaction phase, except for root's leaf kids                      
+      for(unsigned p=0; p!=PL.size(); ++p) {
+#pragma omp for schedule(dynamic,1)
+	for(int i=0; i<int(PL[p].size()); ++i)
+	  DoTask(PL[p][i],GK,MI);
+      }
+      // 3  interactions with root's leaf kids                                  
+#pragma omp single
+      RootLeafs(GK,MI,R,e,es,fs);
+      // 4  evaluation phase                                                    
+#pragma omp single
+      {
+	LoopCellKids(cell_iter,R,c) {
+#pragma omp task firstprivate(c)
+	  IACT::evaluate(c,&KT[0],Nx);
+	}
+      }
+      // 5  collect stats; all kernels must survive until the evaluation is done
+#pragma omp critical
+      {
+	S->add(ST[t]);
+	Nco += GK.coeffs_taken();
+	Nch += GK.chunks_used();
+      }
+    }
+  }
+#endif
   //////////////////////////////////////////////////////////////////////////////
   //                                                                          //
   // UpdateLeafs()                                                            //
@@ -748,113 +1132,28 @@ unsigned GravEstimator::pass_up(const GravMAC*MAC,
   // passes up: flag, mass, cofm, rmax[, eph], multipoles; sets rcrit           
   report REPORT("GravEstimator::pass_up_for_approx()");
   int n=0;                                         // counter: active cells     
+#ifdef _OPENMP
+  const int Nt = omp_get_max_threads();
+  if(Nt > 1 && !omp_in_parallel() && TREE->N_leafs() > 10000) {
+    const unsigned Nx = max(256u, TREE->N_leafs()/(8*Nt));
+#pragma omp parallel
+#pragma omp single
+    n = INDI_SOFT?                                 // tasks for large sub-trees 
+      PassUpTree<1>(root(),REUSE,Nx) :
+      PassUpTree<0>(root(),REUSE,Nx) ;
+  } else
+#endif
   if(INDI_SOFT) {                                  // IF(individual eps_i)      
     // 1    with eps_i: pass flag, mass, N*eps/2, cofm, rmax, multipoles
-#define MASS_WEIGHTED_SOFTENING 1
     LoopCellsUp(grav::cell_iter,TREE,Ci) {         //   LOOP cells upwards      
-      Ci->reset_active_flag();                     //     reset activity flag   
-      Ci->reset_sink_flag();                       //     reset sink flag       
-      real eh (zero);                              //     reset eps/2           
-      real mon(zero);                              //     reset monopole        
-      vect com(zero);                              //     reset dipole          
-      LoopCellKids(cell_iter,Ci,c) {               //     LOOP sub-cells c      
-	eh  += eph (c) *
-#ifdef MASS_WEIGHTED_SOFTENING
-	    mass(c)                                //       sum up M * eps/2    
-#else
-	    number(c)
-#endif
-	    ;
-	mon += mass(c);                            //       sum up monopole     
-	com += mass(c) * cofm(c);                  //       sum up dipole       
-	Ci->add_active_flag(c);                    //       add in activity flag
-	Ci->add_sink_flag(c);                      //       add in sink flag    
-      }                                            //     END LOOP              
-      LoopLeafKids(cell_iter,Ci,l) {               //     LOOP sub-leafs s      
-#ifdef MASS_WEIGHTED_SOFTENING
-	eh  += mass(l) * eph(l);                   //       sum up M * eps/2    
-#else
-	eh  += eph (l);                            //       sum up eps/2        
-#endif
-	mon += mass(l);                            //       sum up monopole     
-	com += mass(l) * cofm(l);                  //       sum up dipole       
-	Ci->add_active_flag(l);                    //       add in activity flag
-	Ci->add_sink_flag(l);                      //       add in sink flag    
-      }                                            //     END LOOP              
+      PassUp<1>::cell(Ci,REUSE);                   //     pass up to cell       
       if(is_active(Ci)) n++;                       //     count active cells    
-      Ci->mass() = mon;                            //     set mass              
-      mon        = (mon==zero)? zero:one/mon;      //     1/mass                
-      com       *= mon;                            //     cofm = dipole/mass    
-#ifdef MASS_WEIGHTED_SOFTENING
-      eh        /= mass(Ci);                       //     mean eps/2            
-#else
-      eh        /= number(Ci);                     //     mean eps/2            
-#endif
-      Ci->eph()  = eh;                             //     set eps/2             
-      Mset P(zero);                                //     reset multipoles      
-      real dmax(zero);                             //     reset d_max           
-      LoopLeafKids(cell_iter,Ci,l) {               //     LOOP sub-leafs s      
-	vect Xi = cofm(l); Xi-= com;               //       distance vector     
-	update_max(dmax,norm(Xi));                 //       update d_max^2      
-	P.add_body(Xi,mass(l));                    //       add multipoles      
-      }                                            //     END LOOP              
-      if(has_leaf_kids(Ci)) dmax = sqrt(dmax);     //     d_max due to sub-leafs
-      LoopCellKids(cell_iter,Ci,c) {               //     LOOP sub-cells c      
-	vect Xi = cofm(c); Xi-= com;               //       distance vector     
-	real Xq = norm(Xi);                        //       distance^2          
-	real x  = dmax - rmax(c);                  //       auxiliary           
-	if(zero>x || Xq>square(x))                 //       IF(d>d_max)         
-	  dmax = sqrt(Xq) + rmax(c);               //         set d_max = d     
-	P.add_cell(Xi,mass(c),poles(c));           //       add multipoles      
-      }                                            //     END LOOP              
-      Ci->rmax() = REUSE? dmax :                   //     r_max=d_max           
-	           min(dmax,bmax(com,Ci));         //     r_max=min(d_max,b_max)
-      Ci->cofm() = com;                            //     set dipole = mass*cofm
-      Ci->poles()= P;                              //     assign multipoles     
     }                                              //   END LOOP                
   } else {                                         // ELSE (no individual eps)  
     // 2    without eps_i: pass flag, mass, cofm, rmax, multipoles              
     LoopCellsUp(grav::cell_iter,TREE,Ci) {         //   LOOP cells upwards      
-      Ci->reset_active_flag();                     //     reset activity flag   
-      Ci->reset_sink_flag();                       //     reset sink flag       
-      real mon(zero);                              //     reset monopole        
-      vect com(zero);                              //     reset dipole          
-      LoopCellKids(cell_iter,Ci,c) {               //     LOOP sub-cells c      
-	mon += mass(c);                            //       sum up monopole     
-	com += mass(c) * cofm(c);                  //       sum up dipole       
-	Ci->add_active_flag(c);                    //       add in activity flag
-	Ci->add_sink_flag(c);                      //       add in sink flag    
-      }                                            //     END LOOP              
-      LoopLeafKids(cell_iter,Ci,l) {               //     LOOP sub-leafs s      
-	mon += mass(l);                            //       sum up monopole     
-	com += mass(l) * cofm(l);                  //       sum up dipole       
-	Ci->add_active_flag(l);                    //       add in activity flag
-	Ci->add_sink_flag(l);                      //       add in sink flag    
-      }                                            //     END LOOP              
+      PassUp<0>::cell(Ci,REUSE);                   //     pass up to cell       
       if(is_active(Ci)) n++;                       //     count active cells    
-      Ci->mass() = mon;                            //     set mass              
-      mon        = (mon==zero)? zero:one/mon;      //     1/mass                
-      com       *= mon;                            //     cofm = dipole/mass    
-      Mset P(zero);                                //     reset multipoles      
-      real dmax(zero);                             //     reset d_max           
-      LoopLeafKids(cell_iter,Ci,l) {               //     LOOP sub-leafs s      
-	vect Xi = cofm(l); Xi-= com;               //       distance vector     
-	update_max(dmax,norm(Xi));                 //       update d_max^2      
-	P.add_body(Xi,mass(l));                    //       add multipoles      
-      }                                            //     END LOOP              
-      if(has_leaf_kids(Ci)) dmax = sqrt(dmax);     //     d_max due to sub-leafs
-      LoopCellKids(cell_iter,Ci,c) {               //     LOOP sub-cells c      
-	vect Xi = cofm(c); Xi-= com;               //       distance vector     
-	real Xq = norm(Xi);                        //       distance^2          
-	real x  = dmax - rmax(c);                  //       auxiliary           
-	if(zero>x || Xq>square(x))                 //       IF(d>d_max)         
-	  dmax = sqrt(Xq) + rmax(c);               //         set d_max = d     
-	P.add_cell(Xi,mass(c),poles(c));           //       add multipoles      
-      }                                            //     END LOOP              
-      Ci->rmax() = REUSE? dmax :                   //     r_max=d_max           
-	           min(dmax,bmax(com,Ci));         //     r_max=min(d_max,b_max)
-      Ci->cofm() = com;                            //     set dipole = mass*cofm
-      Ci->poles()= P;                              //     assign multipoles     
     }                                              //   END LOOP                
   }                                                // ENDIF                     
   // 3  normalize multipoles                                                    
@@ -1017,6 +1316,16 @@ void GravEstimator::approx(const GravMAC*GMAC,
 #endif
                );
   Ncsize = 4+(all? TREE->N_cells() : N_active_cells())/16;
+#ifdef _OPENMP
+  if(omp_get_max_threads() > 1 && !omp_in_parallel()) {
+    if(all)                                        // IF all are active         
+      ApproxOMP<GravIactAll>(TREE,root(),KERNEL,STATS,EPS,EPSSINK,FSINK,
+			     Ncsize,INDI_SOFT,DIR,Ncoeffs,Nchunks);
+    else                                           // ELSE                      
+      ApproxOMP<GravIact>   (TREE,root(),KERNEL,STATS,EPS,EPSSINK,FSINK,
+			     Ncsize,INDI_SOFT,DIR,Ncoeffs,Nchunks);
+  } else
+#endif
   if(all) {                                        // IF all are active         
     GravIactAll GK(KERNEL,STATS,EPS,Ncsize,INDI_SOFT,DIR);
                                                    //   init gravity kernel     
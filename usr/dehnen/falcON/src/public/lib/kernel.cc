@@ -30,6 +30,9 @@
 #include <public/kernel.h>
 #include <public/tensor_set.h>
 #include <utils/WDMath.h>
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
 
 ////////////////////////////////////////////////////////////////////////////////
 //                                                                            //
@@ -148,6 +151,38 @@ void GravKernBase::eval_grav_all(cell_iter    const&C,
   LoopCellKids(cell_iter,C,c)                      // LOOP C's cell kids        
     eval_grav_all(c,G);                            //   recursive call          
 }
+#ifdef _OPENMP
+//------------------------------------------------------------------------------
+// openMP parallel evaluation phase.                                            
+// The coefficients of a cell are returned to the pool of the kernel of the     
+// thread evaluating it, which must not be the pool they were taken from: all   
+// kernels must stay alive until the evaluation phase has finished.             
+void GravKernBase::eval_grav_omp(cell_iter          const&C,
+				 TaylorSeries       const&T,
+				 const GravKernBase*const*K,
+				 unsigned                 Nt,
+				 bool                     all)
+{
+  const GravKernBase*KC = K[omp_get_thread_num()]; // this thread's kernel      
+  TaylorSeries G(T);                               // G = copy of T             
+  G.shift_and_add(C);                              // shift G; G+=T_C           
+  KC->take_coeffs(C);                              // free memory: C's coeffs   
+  LoopLeafKids(cell_iter,C,l) if(all || is_active(l)) {
+    l->normalize_grav();                           //   pot,acc/=mass           
+    if(!is_empty(G)) G.extract_grav(l);            //   add pot,acc due to G    
+  }                                                // END LOOP                  
+  LoopCellKids(cell_iter,C,c) if(all || is_active(c)) {
+    if(number(c) > Nt) {                           //   IF(large sub-tree)      
+#pragma omp task firstprivate(c) shared(G)
+      eval_grav_omp(c,G,K,Nt,all);                 //     evaluate as task      
+    } else if(all)                                 //   ELSE                    
+      KC->eval_grav_all(c,G);                      //     serial recursion      
+    else
+      KC->eval_grav(c,G);                          //     serial recursion      
+  }                                                // END LOOP                  
+#pragma omp taskwait
+}
+#endif
 //------------------------------------------------------------------------------
 real GravKernBase::Psi(kern_type k, real Xq, real Eq)
 {
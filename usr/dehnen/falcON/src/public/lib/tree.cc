@@ -31,6 +31,9 @@
 #include <memory.h>
 #include <body.h>
 #include <sstream>
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
 
 #ifdef  falcON_PROPER
 #  define falcON_track_bug
@@ -43,6 +46,12 @@
 #endif
 
 using namespace falcON;
+#ifdef _OPENMP
+namespace {
+  // minimum number of bodies for parallel tree building and re-using           
+  const size_t N_omp = 10000;
+}
+#endif
 ////////////////////////////////////////////////////////////////////////////////
 namespace falcON {
   //////////////////////////////////////////////////////////////////////////////
@@ -497,6 +506,22 @@ namespace {
   };
   //////////////////////////////////////////////////////////////////////////////
   //                                                                            
+  // class falcON::box_alloc                                                    
+  //                                                                            
+  // block allocator for the boxes needed for adding a given number of dots     
+  //                                                                            
+  //////////////////////////////////////////////////////////////////////////////
+  class box_alloc : public block_alloc<box> {
+    const size_t NDOTS;                            // # dots to be added        
+  public:
+    box_alloc(size_t nd, size_t nb=0)
+      : block_alloc<box>(nb>0? nb : 1+nd/4), NDOTS(nd) {}
+    box* new_box(size_t const&nl) {
+      return &(new_element(estimate_N_alloc(NDOTS,nl))->reset());
+    }
+  };
+  //////////////////////////////////////////////////////////////////////////////
+  //                                                                            
   // class falcON::BoxDotTree                                                   
   //                                                                            
   // for building of a box-dot tree by adddot()                                 
@@ -514,7 +539,11 @@ namespace {
     int                NCRIT;                      // Ncrit                     
     int                DMAX, DEPTH;                // max/actual tree depth     
     size_t             NDOTS;                      // # dots (to be) added      
-    block_alloc<box>  *BM;                         // allocator for boxes       
+    box_alloc         *BM;                         // allocator for boxes       
+#ifdef _OPENMP
+    box_alloc         *BO[Nsub];                   // allocators for root octs  
+    bool               OMPB;                       // built by adddots_omp()?   
+#endif
     const OctTree     *TREE;                       // tree to link              
     real              *RA;                         // array with radius(level)  
     box               *P0;                         // root of box-dot tree      
@@ -550,20 +579,28 @@ namespace {
       if(i&4) centre(B)[2] += rad;  else  centre(B)[2] -= rad;
       return true;
     }
-    //
-    inline box* new_box(size_t const&nl) {
-      return &(BM->new_element(estimate_N_alloc(NDOTS,nl))->reset());
+#ifdef falcON_track_bug
+    /// is this a box of our box-dot tree?
+    inline bool is_box(const box*P) const {
+      if(BM->is_element(P)) return true;
+#ifdef _OPENMP
+      for(int i=0; i!=Nsub; ++i)
+	if(BO[i] && BO[i]->is_element(P)) return true;
+#endif
+      return false;
     }
+#endif
     //--------------------------------------------------------------------------
     // provides a new empty (daughter) box in the i th octant of B              
     inline box* make_subbox(                       // R: new box                
+			    box_alloc*A,           // I: box allocator          
 			    const box*B,           // I: parent box             
 			    int       i,           // I: parent box's octant    
 			    size_t    nl,          // I: # dots added sofar     
 			    dot      *L,           // I: dot of octant          
 			    bool      S)           // I: called by split_box?
     {
-      box* P = new_box(nl);                        // get box off the stack     
+      box* P = A->new_box(nl);                     // get box off the stack     
       P->LEVEL    = B->LEVEL;                      // set level                 
       P->centre() = B->centre();                   // copy centre of parent     
       if(!shrink_to_octant(P,i)) {                 // shrink to correct octant  
@@ -579,12 +616,12 @@ namespace {
 		       "###  presumably more than Ncrit=%d bodies have common"
 		       " position.\n###  dots to be added to octant %d of"
 		       " box %d (x=%g,%g,%g; n=%d; l=%d; r=%g):\n%s",
-		       DMAX,NCRIT,i,BM->number_of_element(B),
+		       DMAX,NCRIT,i,A->number_of_element(B),
 		       B->pos()[0],B->pos()[1],B->pos()[2],
 		       B->NUMBER, int(B->LEVEL), RA[B->LEVEL],
 		       out.str().c_str());
 	} else {
-	  B->dump(BM,RA,D0,TREE->my_bodies(),out);
+	  B->dump(A,RA,D0,TREE->my_bodies(),out);
 	  falcON_Error("exceeding maximum tree depth of %d\n"
 		       " presumably more than Ncrit=%d bodies have common"
 		       " position.\n problem occured when adding dot %d"
@@ -637,7 +674,8 @@ namespace {
     // the dots in the linked list.                                             
     // If all dots happen to be in just one octant, the process is repeated on  
     // the box of this octant.                                                  
-    void split_box(box*         P,                 // I: box to be splitted     
+    void split_box(box_alloc*   A,                 // I: box allocator          
+		   box*         P,                 // I: box to be splitted     
 		   size_t const&nl)                // I: # dots added so far    
     {
       int NUM[Nsub];                               // array with number of dots 
@@ -655,7 +693,7 @@ namespace {
 	for(ne=b=0; b!=Nsub; ++b) if(NUM[b]) {     //   LOOP non-empty octs     
 	  ne++;                                    //     count them            
 	  if(NUM[b]>1) {                           //     IF many dots          
-	    sub = make_subbox(P,b,nl,static_cast<dot*>(P->OCT[b]),1);
+	    sub = make_subbox(A,P,b,nl,static_cast<dot*>(P->OCT[b]),1);
 	                                           //       make sub-box        
 	    sub->DOTS = static_cast<dot*>(P->OCT[b]); //    assign sub-box's    
 	    sub->NUMBER = NUM[b];                  //       dot list & number   
@@ -669,6 +707,7 @@ namespace {
     //--------------------------------------------------------------------------
     // This routine makes twig boxes contain at most 1 dot                      
     void adddot_1(                                 // add single dot to box     
+		  box_alloc    *A,                 // I: box allocator          
 		  box   *const&base,               // I: base box to add to     
 		  dot   *const&Di,                 // I: dot to add             
 		  size_t const&nl)                 // I: # dots added sofar     
@@ -683,7 +722,7 @@ namespace {
 	} else if(P->marked_as_dot(b)) {           //   ELIF octant=dot         
 	  dot*Do = static_cast<dot*>(*oc);         //     get old dot           
 	  P->mark_as_box(b);                       //     mark octant as box    
-	  P = make_subbox(P,b,nl,Do,0);            //     create sub-box        
+	  P = make_subbox(A,P,b,nl,Do,0);          //     create sub-box        
 	  P->adddot_to_octs(Do);                   //     add dot to its octant 
 	  *oc = P;                                 //     assign sub-box to oc  
 	} else                                     //   ELSE octant=box         
@@ -693,6 +732,7 @@ namespace {
     //--------------------------------------------------------------------------
     // This routine makes twig boxes contain at most NCRIT > 1 dots             
     void adddot_N(                                 // add single dot to box     
+		  box_alloc    *A,                 // I: box allocator          
 		  box   *const&base,               // I: base box to add to     
 		  dot   *const&Di,                 // I: dot to add             
 		  size_t const&nl)                 // I: # dots added sofar     
@@ -700,7 +740,7 @@ namespace {
       for(box*P=base;;) {                          // LOOP over boxes           
 	if(P->is_twig()) {                         //   IF box == twig          
 	  P->adddot_to_list(Di);                   //     add dot to list       
-	  if(P->NUMBER>NCRIT) split_box(P,nl);     //     IF(N > NCRIT) split   
+	  if(P->NUMBER>NCRIT) split_box(A,P,nl);   //     IF(N > NCRIT) split   
 	  return;                                  //     DONE with this dot    
 	} else {                                   //   ELIF box==branch        
 	  int    b  = P->octant(Di);               //     dot's octant          
@@ -712,7 +752,7 @@ namespace {
 	  } else if(P->marked_as_dot(b)) {         //     ELIF octant=dot       
 	    dot*Do = static_cast<dot*>(*oc);       //       get old dot         
 	    P->mark_as_box(b);                     //       mark octant as box  
-	    P = make_subbox(P,b,nl,Do,0);          //       create sub-box      
+	    P = make_subbox(A,P,b,nl,Do,0);        //       create sub-box      
 	    P->adddot_to_list(Do);                 //       add old dot to list 
 	    *oc = P;                               //       assign sub-box to oc
 	  } else                                   //     ELSE octant=box       
@@ -746,9 +786,37 @@ namespace {
 		     OctTree::Cell*&,              // I/O: index: free cells    
 		     OctTree::Leaf*&)              // I/O: index: free leafs    
       const;
+#ifdef _OPENMP
+    //--------------------------------------------------------------------------
+    // adds the dots Ds[0...N-1] to the root box such that the result is the    
+    // same as for serial adddot_N() or adddot_1(): the dots are sorted into    
+    // the root octants, preserving their order, and the octants' sub-trees are 
+    // built in parallel, each using its own box allocator BO[i].               
+    void adddots_omp(dot*, size_t);
+    //--------------------------------------------------------------------------
+    // replaces link_cells_N/1(P0,...) after adddots_omp(): links the root cell 
+    // and then the sub-trees of its octants in parallel. Since the number of   
+    // cells and leafs of these sub-trees is known, so are their positions in   
+    // the cell and leaf arrays, which are the same as for serial linking.      
+    int link_cells_omp(OctTree::Cell*,             // R:   tree depth           
+		       OctTree::Cell*,             // I:   free cells           
+		       OctTree::Leaf*) const;      // I:   free leafs           
+    //--------------------------------------------------------------------------
+    // deletes the allocators for the root octants, if any                      
+    void reset_octs() {
+      for(int i=0; i!=Nsub; ++i)
+	if(BO[i]) { falcON_DEL_O(BO[i]); BO[i]=0; }
+    }
+    //--------------------------------------------------------------------------
+    BoxDotTree()
+      : BM(0), OMPB(false), TREE(0), RA(0), P0(0) {
+      for(int i=0; i!=Nsub; ++i) BO[i] = 0;
+    }
+#else
     //--------------------------------------------------------------------------
     BoxDotTree()
       : BM(0), TREE(0), RA(0), P0(0) {}
+#endif
     //--------------------------------------------------------------------------
     // to be called before adding any dots.                                     
     // - allocates boxes                                                        
@@ -765,11 +833,15 @@ namespace {
       DMAX     = dm;
       NDOTS    = nl;
       if(BM) falcON_DEL_O(BM);
-      BM       = new block_alloc<box>(nb>0? nb : 1+NDOTS/4);
+      BM       = new box_alloc(NDOTS,nb);
+#ifdef _OPENMP
+      reset_octs();
+      OMPB     = false;
+#endif
       TREE     = t;
       if(RA) falcON_DEL_A(RA);
       RA       = falcON_NEW(real,DMAX+1);
-      P0       = new_box(1);
+      P0       = BM->new_box(1);
       RA[0]    = sz;
       for(int l=0; l!=DMAX; ++l) RA[l+1] = half * RA[l];
       P0->LEVEL = 0;
@@ -782,13 +854,24 @@ namespace {
     ~BoxDotTree()
     {
       if(BM) falcON_DEL_O(BM);
+#ifdef _OPENMP
+      reset_octs();
+#endif
       if(RA) falcON_DEL_A(RA);
     }
     //--------------------------------------------------------------------------
     // const public methods (all inlined)                                       
     //--------------------------------------------------------------------------
   public:
+#ifdef _OPENMP
+    inline size_t       N_boxes    () const {
+      size_t n = BM->N_used();
+      for(int i=0; i!=Nsub; ++i) if(BO[i]) n += BO[i]->N_used();
+      return n;
+    }
+#else
     inline size_t       N_boxes    () const { return BM->N_used(); }
+#endif
 #if 0 // not used
     inline size_t       N_allocated() const { return BM->N_allocated(); }
     inline size_t       N_used     () const { return BM->N_used(); }
@@ -819,7 +902,7 @@ namespace {
 #ifdef falcON_track_bug
     if(C == CEND)
       report::info("TreeBuilder::link_cells_1(): >max # cells");
-    if(!BM->is_element(P))
+    if(!is_box(P))
       report::info("TreeBuilder::link_cells_1(): invalid box*");
 #endif
     int dep=0;                                     // depth of cell             
@@ -894,7 +977,7 @@ namespace {
 #ifdef falcON_track_bug
     if(C == CEND)
       report::info("TreeBuilder::link_cells_N(): >max # cells");
-    if(!BM->is_element(P))
+    if(!is_box(P))
       report::info("TreeBuilder::link_cells_N(): invalid box*");
 #endif
     int dep=0;                                     // depth of cell             
@@ -964,6 +1047,152 @@ namespace {
     dep++;                                         // increment depth           
     return dep;                                    // return cell's depth       
   }
+#ifdef _OPENMP
+  //----------------------------------------------------------------------------
+  void BoxDotTree::adddots_omp(dot*Ds, size_t N)
+  {
+    // 1  sort dots into root octants, preserving their order                   
+    const int Nt = omp_get_max_threads();
+    size_t*NT = falcON_NEW(size_t,Nsub*Nt);        // # dots per thread & octant
+    size_t NO[Nsub+1];                             // offsets of octants in DS  
+    dot  **DS = falcON_NEW(dot*,N);                // dots sorted by octant     
+#pragma omp parallel
+    {
+      size_t*nt = NT+Nsub*omp_get_thread_num();
+      for(int b=0; b!=Nsub; ++b) nt[b] = 0;
+#pragma omp for schedule(static)
+      for(long i=0; i<long(N); ++i)                // LOOP dots                 
+	nt[P0->octant(Ds+i)]++;                    //   count in thread & octant
+#pragma omp single
+      {
+	size_t k=0;
+	for(int b=0; b!=Nsub; ++b) {               // LOOP octants              
+	  NO[b] = k;                               //   offset of octant        
+	  for(int t=0; t!=omp_get_num_threads(); ++t) {
+	    size_t n = NT[Nsub*t+b];               //   LOOP threads            
+	    NT[Nsub*t+b] = k;                      //     offset in octant      
+	    k += n;
+	  }
+	}
+	NO[Nsub] = k;
+      }
+#pragma omp for schedule(static)
+      for(long i=0; i<long(N); ++i)                // LOOP dots (same chunks)   
+	DS[ nt[P0->octant(Ds+i)]++ ] = Ds+i;       //   put into octant's list  
+    }
+    // 2  build the sub-trees of the root octants in parallel                   
+    //    an octant with n>1 dots is a sub-box created when its second dot was  
+    //    added, holding the first dot, to which adddot_N/1() adds the others.  
+    box*SB[Nsub];
+#pragma omp parallel for schedule(dynamic,1)
+    for(int b=0; b<Nsub; ++b) {                    // LOOP octants              
+      const size_t n  = NO[b+1]-NO[b];             //   # dots in octant        
+      dot  **const Db = DS+NO[b];                  //   dots in octant          
+      SB[b] = 0;
+      if(n > 1) {                                  //   IF >1 dots              
+	BO[b] = new box_alloc(n);                  //     allocator for octant  
+	box*P = make_subbox(BO[b],P0,b,1,Db[0],0); //     create sub-box        
+	if(NCRIT > 1) {                            //     IF Ncrit > 1          
+	  P->adddot_to_list(Db[0]);                //       add first dot       
+	  for(size_t i=1; i!=n; ++i)               //       LOOP other dots     
+	    adddot_N(BO[b],P,Db[i],i);             //         add dot           
+	} else {                                   //     ELSE                  
+	  P->adddot_to_octs(Db[0]);                //       add first dot       
+	  for(size_t i=1; i!=n; ++i)               //       LOOP other dots     
+	    adddot_1(BO[b],P,Db[i],i);             //         add dot           
+	}                                          //     ENDIF                 
+	SB[b] = P;
+      }                                            //   ENDIF                   
+    }                                              // END LOOP                  
+    // 3  fill the root octants                                                 
+    for(int b=0; b!=Nsub; ++b) {
+      const size_t n = NO[b+1]-NO[b];
+      P0->NUMBER += n;
+      if(n == 1)
+	P0->OCT[b] = DS[NO[b]];
+      else if(n) {
+	P0->OCT[b] = SB[b];
+	P0->mark_as_box(b);
+      }
+    }
+    falcON_DEL_A(DS);
+    falcON_DEL_A(NT);
+    OMPB = true;
+  }
+  //----------------------------------------------------------------------------
+  int BoxDotTree::link_cells_omp(OctTree::Cell*C,  // I:   root cell            
+				 OctTree::Cell*Cf, // I:   free cells           
+				 OctTree::Leaf*Lf) // I:   free leafs           
+    const
+  {
+    // 1  link root cell, as link_cells_N/1() for a branch box                  
+    level_ (C) = P0->LEVEL;                        // copy level                
+    octant_(C) = 0;                                // set octant                
+#ifdef falcON_MPI
+    peano_ (C) = P0->PEANO;                        // copy peano map            
+    key_   (C) = 0;                                // set local peano key       
+#endif
+    centre_(C) = P0->centre();                     // copy centre               
+    number_(C) = P0->NUMBER;                       // copy number               
+    fcleaf_(C) = NoLeaf(TREE,Lf);                  // set cell: leaf kids       
+    nleafs_(C) = 0;                                // reset cell: # leaf kids   
+    int i,nsub=0;                                  // octant, # sub-boxes       
+    for(i=0; i!=Nsub; ++i) if(P0->OCT[i]) {        // LOOP non-empty octants    
+      if(P0->marked_as_box(i)) ++nsub;             //   IF   sub-boxes: count   
+      else {                                       //   ELIF sub-dots:          
+	static_cast<dot*>(P0->OCT[i])->set_leaf(Lf++); //   set leaf            
+	nleafs_(C)++;                              //     inc # sub-leafs       
+      }                                            //   END IF                  
+    }                                              // END LOOP                  
+    if(nsub==0) {                                  // IF no sub-boxes           
+      fcCell_(C) =-1;                              //   set cell: 1st sub-cell  
+      ncells_(C) = 0;                              //   set cell: # sub-cells   
+      return 1;                                    //   return depth            
+    }                                              // ENDIF                     
+    // 2  reserve cells & leafs for the sub-trees of the root octants           
+    OctTree::Cell*Ci[Nsub], *Cs[Nsub];             // sub-cell, its free cells  
+    OctTree::Leaf*Ls[Nsub];                        // free leafs of sub-cell    
+    int c = NoCell(TREE,C);                        // index of cell             
+    OctTree::Cell*Cn = Cf;                         // next sub-cell             
+    fccell_(C) = NoCell(TREE,Cn);                  // set cell: 1st sub-cell    
+    ncells_(C) = nsub;                             // set cell: # cell kids     
+    Cf += nsub;                                    // reserve nsub cells        
+    for(i=0; i!=Nsub; ++i)                         // LOOP octants              
+      if(P0->OCT[i] && P0->marked_as_box(i)) {     //   IF sub-box              
+	pacell_(Cn) = c;                           //     sub-cell's parent     
+	Ci[i] = Cn++;                              //     sub-cell              
+	Cs[i] = Cf;                                //     its free cells        
+	Ls[i] = Lf;                                //     its free leafs        
+	Cf   += BO[i]->N_used() - 1;               //     reserve cells         
+	Lf   += static_cast<box*>(P0->OCT[i])->NUMBER; // reserve leafs         
+      }                                            // END LOOP                  
+    // 3  link the sub-trees in parallel                                        
+    int de[Nsub];                                  // depth of sub-cells        
+#pragma omp parallel for schedule(dynamic,1)
+    for(i=0; i<Nsub; ++i) {                        // LOOP octants              
+      de[i] = 0;
+      if(P0->OCT[i] && P0->marked_as_box(i))       //   IF sub-box: link it     
+	de[i] = NCRIT > 1?
+	  link_cells_N(static_cast<box*>(P0->OCT[i]), i,
+#ifdef falcON_MPI
+		       P0->PEANO.key(i),
+#else
+		       0,
+#endif
+		       Ci[i], Cs[i], Ls[i]) :
+	  link_cells_1(static_cast<box*>(P0->OCT[i]), i,
+#ifdef falcON_MPI
+		       P0->PEANO.key(i),
+#else
+		       0,
+#endif
+		       Ci[i], Cs[i], Ls[i]) ;
+    }                                              // END LOOP                  
+    int dep=0;
+    for(i=0; i!=Nsub; ++i) if(de[i]>dep) dep=de[i];
+    return dep+1;                                  // return root's depth       
+  }
+#endif // _OPENMP
   //////////////////////////////////////////////////////////////////////////////
   //                                                                            
   // class falcON::TreeBuilder                                                  
@@ -1039,6 +1268,11 @@ namespace {
       OctTree::Cell*C0 = FstCell(TREE), *Cf=C0+1;
       OctTree::Leaf*Lf = FstLeaf(TREE) + NOUT;
       pacell_(C0) = OctTree::Cell::INVALID;
+#ifdef _OPENMP
+      if(OMPB)
+	DEPTH = link_cells_omp(C0,Cf,Lf);
+      else
+#endif
       DEPTH = NCRIT > 1?
 	link_cells_N(P0,0,0,C0,Cf,Lf) :
 	link_cells_1(P0,0,0,C0,Cf,Lf) ;
@@ -1101,14 +1335,19 @@ namespace {
   void TreeBuilder::build()
   {
     report REPORT("TreeBuilder::build()");
+#ifdef _OPENMP
+    if(omp_get_max_threads() > 1 && !omp_in_parallel() &&
+       size_t(DN-D0) > NOUT + N_omp)
+      return adddots_omp(D0+NOUT, size_t(DN-D0)-NOUT);
+#endif
     size_t nl=0;                                   // counter: # dots added     
     dot   *Di;                                     // actual dot loaded         
     if(Ncrit() > 1)                                // IF(N_crit > 1)            
       for(Di=D0+NOUT; Di!=DN; ++Di,++nl)           //   LOOP(dots)              
-	adddot_N(P0,Di,nl);                        //     add dots              
+	adddot_N(BM,P0,Di,nl);                     //     add dots              
     else                                           // ELSE                      
       for(Di=D0+NOUT; Di!=DN; ++Di,++nl)           //   LOOP(dots)              
-	adddot_1(P0,Di,nl);                        //     add dots              
+	adddot_1(BM,P0,Di,nl);                     //     add dots              
   }
   //----------------------------------------------------------------------------
   void TreeBuilder::report_infnan() const falcON_THROWING
@@ -1165,6 +1404,29 @@ namespace {
     dot*Di = D0 = falcON_NEW(dot,BB->N_bodies());
     XAVE = zero;
     XMAX = XMIN = BB->pos(mybody(LeafNo(TREE,0)));
+#ifdef _OPENMP
+    const long NL = TREE->N_leafs();
+    if(omp_get_max_threads() > 1 && !omp_in_parallel() && size_t(NL) > N_omp) {
+#pragma omp parallel
+      {
+	vect xave(zero), xmin(XMIN), xmax(XMAX);
+#pragma omp for schedule(static)
+	for(long i=0; i<NL; ++i) {
+	  dot*Dl = D0+i;
+	  Dl->set_up(BB,mybody(LeafNo(TREE,i)));
+	  Dl->pos().up_min_max(xmin,xmax);
+	  xave += Dl->pos();
+	}
+#pragma omp critical (TreeBuilder_setup_leaf_order)
+	{
+	  xmin.up_min_max(XMIN,XMAX);
+	  xmax.up_min_max(XMIN,XMAX);
+	  XAVE += xave;
+	}
+      }
+      Di += NL;
+    } else
+#endif
     _LoopLeafs(TREE,Li) {
       Di->set_up(BB,mybody(Li));
       Di->pos().up_min_max(XMIN,XMAX);
@@ -1413,6 +1675,14 @@ void OctTree::build(int        const&nc,           //[I: N_crit]
 //------------------------------------------------------------------------------
 void OctTree::reuse()
 {
+#ifdef _OPENMP
+  if(omp_get_max_threads() > 1 && !omp_in_parallel() && Ns > N_omp) {
+    const long NL = Ns;
+#pragma omp parallel for schedule(static)
+    for(long i=0; i<NL; ++i)
+      LEAFS[i].copy_from_bodies_pos(BSRCES);
+  } else
+#endif
   for(leaf_iterator Li=begin_leafs(); Li!=end_leafs(); ++Li)
     Li->copy_from_bodies_pos(BSRCES);
   STATE = state((STATE & origins) | re_used);      // reset state               